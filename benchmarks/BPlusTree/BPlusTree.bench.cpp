@@ -0,0 +1,103 @@
+#include "../../src/models/BPlusTree/BPlusTree.hpp"
+#include "../../src/models/BufferPool/BufferPool.hpp"
+#include "../../src/models/DiskManager/DiskManager.hpp"
+#include "../../tests/common/TempPath.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+// splitmix64 finalizer: a bijection, so distinct n give distinct keys in a
+// scattered insertion order.
+static uint64_t scramble(uint64_t n) {
+  n += 0x9e3779b97f4a7c15ull;
+  n = (n ^ (n >> 30)) * 0xbf58476d1ce4e5b9ull;
+  n = (n ^ (n >> 27)) * 0x94d049bb133111ebull;
+  return n ^ (n >> 31);
+}
+
+// YCSB-style 24-byte keys.
+static void key_for(uint64_t n, char (&buf)[32]) {
+  std::snprintf(buf, sizeof(buf), "user%020llu",
+                static_cast<unsigned long long>(scramble(n)));
+}
+
+static double seconds_since(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                       start)
+      .count();
+}
+
+static void bench_lookups(BPlusTree &tree, uint64_t keyCount,
+                          size_t threadCount, uint64_t totalLookups) {
+  uint64_t perThread = totalLookups / threadCount;
+  auto start = std::chrono::steady_clock::now();
+  std::vector<std::thread> workers;
+  for (size_t t = 0; t < threadCount; ++t) {
+    workers.emplace_back([&tree, keyCount, perThread, t]() {
+      std::mt19937_64 eng(t + 1);
+      std::uniform_int_distribution<uint64_t> pick(0, keyCount - 1);
+      char key[32];
+      for (uint64_t i = 0; i < perThread; ++i) {
+        key_for(pick(eng), key);
+        if (!tree.Get(key).has_value()) {
+          std::cerr << "missing key " << key << "\n";
+          std::abort();
+        }
+      }
+    });
+  }
+  for (auto &worker : workers) {
+    worker.join();
+  }
+  double elapsed = seconds_since(start);
+  std::cout << "  threads=" << threadCount << " lookups/sec="
+            << static_cast<long long>(
+                   static_cast<double>(perThread * threadCount) / elapsed)
+            << "\n";
+}
+
+int main(int argc, char **argv) {
+  uint64_t keyCount =
+      argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 10000000ull;
+  uint64_t lookups = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 2000000;
+
+  std::string path = make_temp_db_path();
+  {
+    // Room for every node at roughly 2/3 fill, so lookups measure the tree
+    // and not the disk.
+    size_t poolSize = static_cast<size_t>(keyCount / 50) + 1024;
+    BufferPool pool(poolSize, std::make_unique<DiskManager>(path));
+    BPlusTree tree(pool);
+
+    std::cout << "BPlusTree on " << keyCount << " keys (pool " << poolSize
+              << " frames)\n";
+    auto start = std::chrono::steady_clock::now();
+    char key[32];
+    for (uint64_t n = 0; n < keyCount; ++n) {
+      key_for(n, key);
+      tree.Put(key, n);
+    }
+    double elapsed = seconds_since(start);
+    std::cout << "  inserts/sec="
+              << static_cast<long long>(static_cast<double>(keyCount) /
+                                        elapsed)
+              << "\n";
+
+    for (size_t threads = 1; threads <= 8; threads *= 2) {
+      bench_lookups(tree, keyCount, threads, lookups);
+    }
+  }
+  safe_remove(path);
+  return 0;
+}
@@ -0,0 +1,262 @@
+#include "../../src/models/BufferPool/BufferPool.hpp"
+#include "../../src/models/DiskManager/DiskManager.hpp"
+#include "../../tests/common/TempPath.hpp"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+// Runs `totalOps` FetchBlock/ReleaseBlock pairs (or ReadPageGuards, with
+// `useGuards`) spread over `threadCount` threads and returns operations per
+// second.
+static double run_fetch_release(BufferPool &pool, size_t blockCount,
+                                size_t threadCount, size_t totalOps,
+                                bool useGuards) {
+  size_t opsPerThread = totalOps / threadCount;
+  auto start = std::chrono::steady_clock::now();
+
+  std::vector<std::thread> workers;
+  for (size_t t = 0; t < threadCount; ++t) {
+    workers.emplace_back([&pool, blockCount, opsPerThread, t, useGuards]() {
+      std::mt19937 eng(static_cast<unsigned>(t + 1));
+      std::uniform_int_distribution<BlockId> pick(
+          0, static_cast<BlockId>(blockCount - 1));
+      for (size_t op = 0; op < opsPerThread; ++op) {
+        BlockId id = pick(eng);
+        if (useGuards) {
+          ReadPageGuard guard = pool.FetchPageRead(id);
+          volatile char sink = guard.GetData()[0];
+          (void)sink;
+          continue;
+        }
+        Block *block = pool.FetchBlock(id);
+        block->RLatch();
+        volatile char sink = block->data[0];
+        (void)sink;
+        block->RUnlatch();
+        pool.ReleaseBlock(id, false);
+      }
+    });
+  }
+  for (auto &worker : workers) {
+    worker.join();
+  }
+
+  double elapsed =
+      std::chrono::duration<double>(std::chrono::steady_clock::now() - start)
+          .count();
+  return static_cast<double>(opsPerThread * threadCount) / elapsed;
+}
+
+static void bench_scaling(const char *label, size_t poolSize,
+                          size_t blockCount, size_t totalOps,
+                          bool useGuards = false) {
+  std::string path = make_temp_db_path();
+  {
+    auto dm = std::make_unique<DiskManager>(path);
+    for (size_t i = 0; i < blockCount; ++i) {
+      dm->AllocateBlock();
+    }
+    BufferPool pool(poolSize, std::move(dm));
+
+    std::cout << label << " (pool " << poolSize << " frames, " << blockCount
+              << " blocks)\n";
+    for (size_t threads = 1; threads <= 64; threads *= 2) {
+      double opsPerSec =
+          run_fetch_release(pool, blockCount, threads, totalOps, useGuards);
+      std::cout << "  threads=" << threads
+                << " ops/sec=" << static_cast<long long>(opsPerSec) << "\n";
+    }
+  }
+  safe_remove(path);
+}
+
+// Cycles sequentially over twice as many blocks as frames, so after the
+// first lap every FetchBlock is a miss that evicts a clean frame.
+static void bench_miss_path(size_t poolSize, size_t misses,
+                            DiskReadBackend backend) {
+  std::string path = make_temp_db_path();
+  {
+    size_t blockCount = poolSize * 2;
+    DiskManagerConfig diskConfig;
+    diskConfig.readBackend = backend;
+    auto dm = std::make_unique<DiskManager>(path, diskConfig);
+    for (size_t i = 0; i < blockCount; ++i) {
+      dm->AllocateBlock();
+    }
+    BufferPool pool(poolSize, std::move(dm));
+
+    for (BlockId id = 0; id < blockCount; ++id) {
+      pool.FetchBlock(id);
+      pool.ReleaseBlock(id, false);
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < misses; ++i) {
+      BlockId id = static_cast<BlockId>(i % blockCount);
+      pool.FetchBlock(id);
+      pool.ReleaseBlock(id, false);
+    }
+    double elapsed = std::chrono::duration<double>(
+                         std::chrono::steady_clock::now() - start)
+                         .count();
+    std::cout << "  frames=" << poolSize << " ns/miss="
+              << static_cast<long long>(elapsed * 1e9 /
+                                        static_cast<double>(misses))
+              << "\n";
+  }
+  safe_remove(path);
+}
+
+// Asks the kernel to drop the file's clean pages so the next lap reads from
+// the device instead of the page cache.
+static void drop_page_cache(const std::string &path) {
+  int fd = ::open(path.c_str(), O_RDONLY);
+  if (fd >= 0) {
+    ::fdatasync(fd);
+    ::posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+    ::close(fd);
+  }
+}
+
+// Full sequential scans over a file four times the pool, so every lap
+// misses on every block; compares blocks/sec for each readahead window.
+// With `cold` set the page cache is dropped before every lap.
+static void bench_sequential_scan(size_t poolSize, size_t laps, bool cold) {
+  std::string path = make_temp_db_path();
+  {
+    size_t blockCount = poolSize * 4;
+    auto dm = std::make_unique<DiskManager>(path);
+    for (size_t i = 0; i < blockCount; ++i) {
+      dm->AllocateBlock();
+    }
+    dm.reset();
+
+    for (size_t readahead : {0, 8, 32, 128}) {
+      BufferPoolConfig config;
+      config.readaheadBlocks = readahead;
+      BufferPool pool(poolSize, std::make_unique<DiskManager>(path), config);
+
+      double elapsed = 0;
+      for (size_t lap = 0; lap < laps; ++lap) {
+        if (cold) {
+          drop_page_cache(path);
+        }
+        auto start = std::chrono::steady_clock::now();
+        for (BlockId id = 0; id < blockCount; ++id) {
+          Block *block = pool.FetchBlock(id);
+          volatile char sink = block->data[0];
+          (void)sink;
+          pool.ReleaseBlock(id, false);
+        }
+        elapsed += std::chrono::duration<double>(
+                       std::chrono::steady_clock::now() - start)
+                       .count();
+      }
+      std::cout << "  readahead=" << readahead << " blocks/sec="
+                << static_cast<long long>(
+                       static_cast<double>(blockCount * laps) / elapsed)
+                << "\n";
+    }
+  }
+  safe_remove(path);
+}
+
+// The same pool memory and file size at each block size: a sequential scan
+// in MB/s, which favors large blocks, and uniformly random fetches, where
+// each miss reads a whole block to use a few bytes of it. The page cache
+// stays warm, so this measures the pool and the copies, not the device.
+static void bench_block_sizes(size_t fetches) {
+  constexpr size_t poolBytes = size_t{16} << 20;
+  constexpr size_t fileBytes = size_t{64} << 20;
+  for (size_t blockSize : {4096, 8192, 16384, 65536}) {
+    std::string path = make_temp_db_path();
+    {
+      DiskManagerConfig diskConfig;
+      diskConfig.blockSize = blockSize;
+      BlockId blockCount = static_cast<BlockId>(fileBytes / blockSize);
+      auto dm = std::make_unique<DiskManager>(path, diskConfig);
+      std::vector<char> buf(blockSize, 'b');
+      dm->AllocateBlocks(blockCount);
+      for (BlockId id = 0; id < blockCount; ++id) {
+        dm->WriteBlock(id, buf.data());
+      }
+      dm.reset();
+
+      BufferPool pool(poolBytes / blockSize,
+                      std::make_unique<DiskManager>(path, diskConfig));
+      auto start = std::chrono::steady_clock::now();
+      for (int lap = 0; lap < 4; ++lap) {
+        for (BlockId id = 0; id < blockCount; ++id) {
+          ReadPageGuard page = pool.FetchPageRead(id);
+          volatile char sink = page.GetData().back();
+          (void)sink;
+        }
+      }
+      double scan = std::chrono::duration<double>(
+                        std::chrono::steady_clock::now() - start)
+                        .count();
+
+      std::mt19937 eng(7);
+      std::uniform_int_distribution<BlockId> pick(0, blockCount - 1);
+      start = std::chrono::steady_clock::now();
+      for (size_t i = 0; i < fetches; ++i) {
+        ReadPageGuard page = pool.FetchPageRead(pick(eng));
+        volatile char sink = page.GetData()[0];
+        (void)sink;
+      }
+      double random = std::chrono::duration<double>(
+                          std::chrono::steady_clock::now() - start)
+                          .count();
+
+      std::cout << "  block=" << blockSize / 1024
+                << "KiB frames=" << poolBytes / blockSize << " scan MB/s="
+                << static_cast<long long>(4.0 * fileBytes / scan / 1e6)
+                << " random fetches/sec="
+                << static_cast<long long>(static_cast<double>(fetches) /
+                                          random)
+                << "\n";
+    }
+    safe_remove(path);
+  }
+}
+
+int main(int argc, char **argv) {
+  size_t totalOps = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 400000;
+
+  std::cout << "BufferPool FetchBlock/ReleaseBlock scaling\n";
+  bench_scaling("hit-only", 4096, 4096, totalOps);
+  bench_scaling("hit-only, ReadPageGuard", 4096, 4096, totalOps, true);
+  bench_scaling("mixed hit/miss", 1024, 4096, totalOps / 4);
+
+  std::cout << "BufferPool miss path (clean evictions)\n";
+  for (size_t frames : {1024, 4096, 16384}) {
+    bench_miss_path(frames, totalOps / 4, DiskReadBackend::Pread);
+  }
+  std::cout << "BufferPool miss path, Mmap backend (clean evictions)\n";
+  for (size_t frames : {1024, 4096, 16384}) {
+    bench_miss_path(frames, totalOps / 4, DiskReadBackend::Mmap);
+  }
+
+  std::cout << "BufferPool sequential scan, page cache warm (pool 1024 "
+               "frames, 4096 blocks)\n";
+  bench_sequential_scan(1024, 8, false);
+  std::cout << "BufferPool sequential scan, page cache dropped per lap\n";
+  bench_sequential_scan(1024, 4, true);
+
+  std::cout << "BufferPool block sizes (16 MiB pool, 64 MiB file)\n";
+  bench_block_sizes(totalOps / 2);
+  return 0;
+}
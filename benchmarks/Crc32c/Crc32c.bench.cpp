@@ -0,0 +1,78 @@
+#include "../../src/models/Crc32c/Crc32c.hpp"
+#include "../../src/types/Constants.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <thread>
+#include <vector>
+
+using ComputeFn = uint32_t (*)(const char *, size_t);
+
+// Checksums `totalBytes` in `chunk`-sized pieces of a buffer that stays in
+// cache and returns GB/s. The results are folded together so the calls
+// cannot be dropped.
+static double measure(ComputeFn compute, const std::vector<char> &data,
+                      size_t chunk, size_t totalBytes, uint32_t &sink) {
+  size_t chunks = data.size() / chunk;
+  auto start = std::chrono::steady_clock::now();
+  for (size_t done = 0, i = 0; done < totalBytes; done += chunk) {
+    sink ^= compute(data.data() + i * chunk, chunk);
+    i = i + 1 == chunks ? 0 : i + 1;
+  }
+  double elapsed =
+      std::chrono::duration<double>(std::chrono::steady_clock::now() - start)
+          .count();
+  return static_cast<double>(totalBytes) / elapsed / 1e9;
+}
+
+// GB/s on one core for BLOCK_SIZE pieces, what DiskManager checksums, and
+// for large buffers; then the hardware path on every core at once, which
+// should scale with cores since it touches no shared state.
+int main(int argc, char **argv) {
+  size_t totalBytes = argc > 1 ? std::strtoull(argv[1], nullptr, 10)
+                               : size_t{4} << 30;
+
+  std::vector<char> data(size_t{1} << 20);
+  std::mt19937 eng(1);
+  for (char &byte : data) {
+    byte = static_cast<char>(eng());
+  }
+  uint32_t sink = 0;
+
+  std::cout << "CRC32C throughput, one core (hardware path: "
+            << (Crc32c::IsHardwareAccelerated() ? "SSE4.2" : "unavailable")
+            << ")\n";
+  for (size_t chunk : {size_t{BLOCK_SIZE}, data.size()}) {
+    double hardware = measure(Crc32c::Compute, data, chunk, totalBytes, sink);
+    double software =
+        measure(Crc32c::ComputeSoftware, data, chunk, totalBytes / 4, sink);
+    std::cout << "  chunk=" << chunk << " Compute GB/s=" << hardware
+              << " ComputeSoftware GB/s=" << software << " ns/chunk="
+              << static_cast<double>(chunk) / hardware << "\n";
+  }
+
+  unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+  std::vector<double> rates(threads);
+  std::vector<uint32_t> sinks(threads);
+  std::vector<std::thread> workers;
+  for (unsigned t = 0; t < threads; ++t) {
+    workers.emplace_back([&, t] {
+      rates[t] =
+          measure(Crc32c::Compute, data, BLOCK_SIZE, totalBytes, sinks[t]);
+    });
+  }
+  double total = 0;
+  for (unsigned t = 0; t < threads; ++t) {
+    workers[t].join();
+    total += rates[t];
+    sink ^= sinks[t];
+  }
+  std::cout << "  " << threads << " threads, chunk=" << BLOCK_SIZE
+            << " GB/s per core=" << total / threads << " total GB/s=" << total
+            << "\n";
+  std::cout << "  (checksum " << sink << ")\n";
+  return 0;
+}
@@ -0,0 +1,116 @@
+#include "../../src/models/DiskManager/DiskManager.hpp"
+#include "../../tests/common/TempPath.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <string>
+#include <system_error>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+// Reads `reads` random blocks through `readBlock`, which returns a pointer to
+// the block's bytes, and prints the rate. Each read touches the first and
+// last byte, as a point lookup touching a couple of cache lines would.
+template <typename ReadBlock>
+static void bench_random_reads(const char *label, BlockId blockCount,
+                               size_t reads, const ReadBlock &readBlock) {
+  std::mt19937 eng(1);
+  std::uniform_int_distribution<BlockId> pick(0, blockCount - 1);
+  unsigned long long checksum = 0;
+
+  auto start = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < reads; ++i) {
+    const char *data = readBlock(pick(eng));
+    checksum += static_cast<unsigned char>(data[0]) +
+                static_cast<unsigned char>(data[BLOCK_SIZE - 1]);
+  }
+  double elapsed =
+      std::chrono::duration<double>(std::chrono::steady_clock::now() - start)
+          .count();
+
+  std::cout << "  " << label << " reads/sec="
+            << static_cast<long long>(static_cast<double>(reads) / elapsed)
+            << " ns/read="
+            << static_cast<long long>(elapsed * 1e9 /
+                                      static_cast<double>(reads))
+            << " (checksum " << checksum << ")\n";
+}
+
+// Allocates `blocks` blocks one at a time, then again in runs of 1024, each
+// into a fresh file.
+static void bench_allocation(BlockId blocks) {
+  std::cout << "DiskManager allocation (" << blocks << " blocks)\n";
+  for (BlockId run : {BlockId{1}, BlockId{1024}}) {
+    std::string path = make_temp_db_path();
+    {
+      DiskManager dm(path);
+      auto start = std::chrono::steady_clock::now();
+      for (BlockId allocated = 0; allocated < blocks; allocated += run) {
+        dm.AllocateBlocks(run);
+      }
+      double elapsed = std::chrono::duration<double>(
+                           std::chrono::steady_clock::now() - start)
+                           .count();
+      std::cout << "  run=" << run << " blocks/sec="
+                << static_cast<long long>(static_cast<double>(blocks) /
+                                          elapsed)
+                << "\n";
+    }
+    safe_remove(path);
+  }
+}
+
+// Random block reads from a file already in the page cache, so the numbers
+// compare the read path itself: a seek-and-read stream (the original
+// DiskManager), pread into a caller buffer, and the Mmap backend's in-place
+// view, which skips the syscall and the 4 KiB copy.
+int main(int argc, char **argv) {
+  BlockId blockCount = static_cast<BlockId>(
+      argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 16384);
+  size_t reads = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 1000000;
+
+  bench_allocation(1u << 20);
+
+  std::string path = make_temp_db_path();
+  {
+    DiskManagerConfig config;
+    config.readBackend = DiskReadBackend::Mmap;
+    DiskManager dm(path, config);
+    std::vector<char> buf(BLOCK_SIZE);
+    for (BlockId i = 0; i < blockCount; ++i) {
+      BlockId id = dm.AllocateBlock();
+      std::fill(buf.begin(), buf.end(), static_cast<char>(id));
+      dm.WriteBlock(id, buf.data());
+    }
+
+    std::cout << "DiskManager random block reads, page cache warm ("
+              << blockCount << " blocks)\n";
+
+    std::ifstream stream(path, std::ios::binary);
+    bench_random_reads("fstream      ", blockCount, reads, [&](BlockId id) {
+      stream.seekg(static_cast<std::streamoff>(id) * BLOCK_SIZE);
+      stream.read(buf.data(), BLOCK_SIZE);
+      return buf.data();
+    });
+
+    bench_random_reads("pread        ", blockCount, reads, [&](BlockId id) {
+      dm.ReadBlock(id, buf.data());
+      return buf.data();
+    });
+
+    // The first lap takes the page faults that map each block; the second
+    // is the steady state.
+    for (const char *label : {"mmap, 1st lap", "mmap, 2nd lap"}) {
+      bench_random_reads(label, blockCount, reads,
+                         [&](BlockId id) { return dm.MappedBlock(id); });
+    }
+  }
+  safe_remove(path);
+  return 0;
+}
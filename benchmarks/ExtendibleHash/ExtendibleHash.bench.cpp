@@ -0,0 +1,163 @@
+#include "../../src/models/BufferPool/BufferPool.hpp"
+#include "../../src/models/DiskManager/DiskManager.hpp"
+#include "../../src/models/Index/Index.hpp"
+#include "../../tests/common/TempPath.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+// splitmix64 finalizer: a bijection, so distinct n give distinct keys.
+static uint64_t scramble(uint64_t n) {
+  n += 0x9e3779b97f4a7c15ull;
+  n = (n ^ (n >> 30)) * 0xbf58476d1ce4e5b9ull;
+  n = (n ^ (n >> 27)) * 0x94d049bb133111ebull;
+  return n ^ (n >> 31);
+}
+
+// YCSB-style 24-byte keys, built before any timing starts.
+static std::vector<std::string> make_keys(uint64_t keyCount) {
+  std::vector<std::string> keys;
+  keys.reserve(keyCount);
+  char buf[32];
+  for (uint64_t n = 0; n < keyCount; ++n) {
+    std::snprintf(buf, sizeof(buf), "user%020llu",
+                  static_cast<unsigned long long>(scramble(n)));
+    keys.emplace_back(buf);
+  }
+  return keys;
+}
+
+static double seconds_since(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                       start)
+      .count();
+}
+
+// Runs `lookup` on random existing keys from 1 to 8 threads and prints the
+// aggregate rate. `lookup` returns false for a missing key. Each thread's
+// picks are drawn before the clock starts.
+template <typename Lookup>
+static void bench_lookups(const Lookup &lookup,
+                          const std::vector<std::string> &keys,
+                          uint64_t totalLookups) {
+  for (size_t threadCount = 1; threadCount <= 8; threadCount *= 2) {
+    uint64_t perThread = totalLookups / threadCount;
+    std::vector<std::vector<std::string_view>> picks(threadCount);
+    for (size_t t = 0; t < threadCount; ++t) {
+      std::mt19937_64 eng(t + 1);
+      std::uniform_int_distribution<size_t> pick(0, keys.size() - 1);
+      picks[t].reserve(perThread);
+      for (uint64_t i = 0; i < perThread; ++i) {
+        picks[t].push_back(keys[pick(eng)]);
+      }
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> workers;
+    for (size_t t = 0; t < threadCount; ++t) {
+      workers.emplace_back([&lookup, &picks, t]() {
+        for (std::string_view key : picks[t]) {
+          if (!lookup(key)) {
+            std::cerr << "missing key " << key << "\n";
+            std::abort();
+          }
+        }
+      });
+    }
+    for (auto &worker : workers) {
+      worker.join();
+    }
+    double elapsed = seconds_since(start);
+    std::cout << "  threads=" << threadCount << " lookups/sec="
+              << static_cast<long long>(
+                     static_cast<double>(perThread * threadCount) / elapsed)
+              << "\n";
+  }
+}
+
+static void bench_index(IndexType type, const char *name,
+                        const std::vector<std::string> &keys,
+                        uint64_t lookups) {
+  std::string path = make_temp_db_path();
+  {
+    uint64_t keyCount = keys.size();
+    // Room for every bucket or node, so lookups measure the index and not
+    // the disk.
+    size_t poolSize = static_cast<size_t>(keyCount / 40) + 1024;
+    BufferPool pool(poolSize, std::make_unique<DiskManager>(path));
+    std::unique_ptr<Index> index = Index::Create(type, pool);
+
+    std::cout << name << " on " << keyCount << " keys (pool " << poolSize
+              << " frames)\n";
+    auto start = std::chrono::steady_clock::now();
+    for (uint64_t n = 0; n < keyCount; ++n) {
+      index->Put(keys[n], n);
+    }
+    double elapsed = seconds_since(start);
+    std::cout << "  inserts/sec="
+              << static_cast<long long>(static_cast<double>(keyCount) /
+                                        elapsed)
+              << "\n";
+
+    bench_lookups(
+        [&index](std::string_view k) { return index->Get(k).has_value(); },
+        keys, lookups);
+  }
+  safe_remove(path);
+}
+
+// Lets the map look up a string_view without building a std::string.
+struct KeyHash {
+  using is_transparent = void;
+  size_t operator()(std::string_view key) const {
+    return std::hash<std::string_view>{}(key);
+  }
+};
+
+// In-memory ceiling: no pages, no pins, no latches.
+static void bench_unordered_map(const std::vector<std::string> &keys,
+                                uint64_t lookups) {
+  uint64_t keyCount = keys.size();
+  std::unordered_map<std::string, uint64_t, KeyHash, std::equal_to<>> map;
+  map.reserve(keyCount);
+
+  std::cout << "std::unordered_map on " << keyCount << " keys\n";
+  auto start = std::chrono::steady_clock::now();
+  for (uint64_t n = 0; n < keyCount; ++n) {
+    map.emplace(keys[n], n);
+  }
+  double elapsed = seconds_since(start);
+  std::cout << "  inserts/sec="
+            << static_cast<long long>(static_cast<double>(keyCount) / elapsed)
+            << "\n";
+
+  bench_lookups(
+      [&map](std::string_view k) { return map.find(k) != map.end(); }, keys,
+      lookups);
+}
+
+int main(int argc, char **argv) {
+  uint64_t keyCount =
+      argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 2000000ull;
+  uint64_t lookups = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 2000000;
+
+  std::vector<std::string> keys = make_keys(keyCount);
+  bench_index(IndexType::ExtendibleHash, "ExtendibleHash", keys, lookups);
+  bench_index(IndexType::BPlusTree, "BPlusTree", keys, lookups);
+  bench_unordered_map(keys, lookups);
+  return 0;
+}
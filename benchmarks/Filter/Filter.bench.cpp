@@ -0,0 +1,145 @@
+#include "../../src/models/Filter/BlockedBloomFilter.hpp"
+#include "../../src/models/Filter/CuckooFilter.hpp"
+#include "../../src/models/KVEngine/PagedEngine.hpp"
+#include "../../tests/common/TempPath.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <random>
+#include <string>
+#include <system_error>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+// Present keys are even numbers and absent keys odd ones, so both spread
+// over the whole key range and an absent lookup walks a real root-to-leaf
+// path when no filter stops it.
+static std::vector<std::string> make_keys(size_t count, bool present) {
+  std::vector<std::string> keys;
+  keys.reserve(count);
+  char key[24];
+  for (size_t i = 0; i < count; ++i) {
+    std::snprintf(key, sizeof(key), "user%016llu",
+                  static_cast<unsigned long long>(2 * i + (present ? 0 : 1)));
+    keys.emplace_back(key);
+  }
+  std::shuffle(keys.begin(), keys.end(), std::mt19937_64(42));
+  return keys;
+}
+
+static const char *filter_name(KeyFilterType type) {
+  switch (type) {
+  case KeyFilterType::Bloom:
+    return "bloom ";
+  case KeyFilterType::Cuckoo:
+    return "cuckoo";
+  case KeyFilterType::None:
+  default:
+    return "none  ";
+  }
+}
+
+// Loads `present` into an engine, reopens it so the pool starts cold, then
+// times a Get of each absent key. Prints mean and p99 latency.
+static void bench_negative_lookups(KeyFilterType type, size_t poolFrames,
+                                   const std::vector<std::string> &present,
+                                   const std::vector<std::string> &absent) {
+  std::string path = make_temp_db_path();
+  PagedEngineConfig config;
+  config.poolFrames = poolFrames;
+  config.filter.type = type;
+  config.filter.capacity = present.size();
+  {
+    PagedEngine engine(path, config);
+    for (size_t i = 0; i < present.size(); ++i) {
+      engine.Put(present[i], i);
+    }
+  }
+
+  PagedEngine engine(path, config);
+  std::vector<double> latencies;
+  latencies.reserve(absent.size());
+  size_t found = 0;
+  for (const auto &key : absent) {
+    auto start = std::chrono::steady_clock::now();
+    found += engine.Get(key).has_value() ? 1 : 0;
+    auto end = std::chrono::steady_clock::now();
+    latencies.push_back(
+        std::chrono::duration<double, std::nano>(end - start).count());
+  }
+
+  double total = 0;
+  for (double latency : latencies) {
+    total += latency;
+  }
+  std::sort(latencies.begin(), latencies.end());
+  double p99 = latencies[latencies.size() * 99 / 100];
+  std::cout << "  " << filter_name(type) << " frames=" << poolFrames
+            << " mean ns=" << total / static_cast<double>(latencies.size())
+            << " p99 ns=" << p99 << " found=" << found << "\n";
+  safe_remove(path);
+}
+
+// Probes per second straight against a filter, half of them for absent
+// keys.
+template <typename Probe>
+static void bench_probe(const char *name, const std::vector<std::string> &keys,
+                        Probe probe) {
+  size_t hits = 0;
+  auto start = std::chrono::steady_clock::now();
+  for (int round = 0; round < 5; ++round) {
+    for (const auto &key : keys) {
+      hits += probe(key) ? 1 : 0;
+    }
+  }
+  double elapsed =
+      std::chrono::duration<double>(std::chrono::steady_clock::now() - start)
+          .count();
+  std::cout << "  " << name << " probes/sec="
+            << static_cast<long long>(static_cast<double>(keys.size()) * 5 /
+                                      elapsed)
+            << " hits=" << hits / 5 << "\n";
+}
+
+int main(int argc, char **argv) {
+  size_t count = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 200000;
+  std::vector<std::string> present = make_keys(count, true);
+  std::vector<std::string> absent = make_keys(count, false);
+
+  std::cout << "Negative lookups over " << count << " keys\n";
+  // A pool that holds the whole tree, then one a fraction of its size.
+  for (size_t frames : {size_t{16384}, size_t{64}}) {
+    for (KeyFilterType type : {KeyFilterType::None, KeyFilterType::Bloom,
+                               KeyFilterType::Cuckoo}) {
+      bench_negative_lookups(type, frames, present, absent);
+    }
+  }
+
+  std::vector<std::string> mixed(present.begin(),
+                                 present.begin() + count / 2);
+  mixed.insert(mixed.end(), absent.begin(), absent.begin() + count / 2);
+  std::shuffle(mixed.begin(), mixed.end(), std::mt19937_64(7));
+
+  BlockedBloomFilter bloom(count, 10);
+  CuckooFilter cuckoo(count);
+  for (const auto &key : present) {
+    bloom.Add(key);
+    cuckoo.Add(key);
+  }
+  std::cout << "Filter probes (AVX2 "
+            << (BlockedBloomFilter::IsSimdAccelerated() ? "on" : "off")
+            << ")\n";
+  bench_probe("bloom simd    ", mixed,
+              [&](const std::string &key) { return bloom.MayContain(key); });
+  bench_probe("bloom portable", mixed, [&](const std::string &key) {
+    return bloom.MayContainPortable(key);
+  });
+  bench_probe("cuckoo        ", mixed,
+              [&](const std::string &key) { return cuckoo.MayContain(key); });
+  return 0;
+}
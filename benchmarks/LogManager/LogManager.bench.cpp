@@ -0,0 +1,69 @@
+#include "../../src/models/LogManager/LogManager.hpp"
+#include "../../tests/common/TempPath.hpp"
+
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <random>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+// `committers` threads each commit 100-byte records for `duration`; prints
+// commits/sec and how many commits shared each fdatasync.
+static void bench_commits(size_t committers,
+                          std::chrono::milliseconds duration) {
+  std::string path = make_temp_log_path();
+  {
+    LogManager log(path);
+
+    std::vector<std::thread> workers;
+    std::vector<uint64_t> commits(committers, 0);
+    auto deadline = std::chrono::steady_clock::now() + duration;
+    auto start = std::chrono::steady_clock::now();
+    for (size_t t = 0; t < committers; ++t) {
+      workers.emplace_back([&log, &commits, deadline, t]() {
+        std::string record(100, static_cast<char>('a' + t % 26));
+        while (std::chrono::steady_clock::now() < deadline) {
+          log.Commit(record.data(), record.size());
+          commits[t]++;
+        }
+      });
+    }
+    for (auto &worker : workers) {
+      worker.join();
+    }
+    double elapsed =
+        std::chrono::duration<double>(std::chrono::steady_clock::now() - start)
+            .count();
+
+    uint64_t total = 0;
+    for (uint64_t count : commits) {
+      total += count;
+    }
+    uint64_t syncs = log.GetSyncCount();
+    std::cout << "  committers=" << committers << " commits/sec="
+              << static_cast<long long>(static_cast<double>(total) / elapsed)
+              << " commits/sync="
+              << (syncs == 0 ? 0.0
+                             : static_cast<double>(total) /
+                                   static_cast<double>(syncs))
+              << "\n";
+  }
+  safe_remove(path);
+}
+
+int main(int argc, char **argv) {
+  long long millis = argc > 1 ? std::strtoll(argv[1], nullptr, 10) : 1000;
+  std::chrono::milliseconds duration(millis);
+
+  std::cout << "LogManager group commit (100-byte records)\n";
+  for (size_t committers = 1; committers <= 64; committers *= 2) {
+    bench_commits(committers, duration);
+  }
+  return 0;
+}
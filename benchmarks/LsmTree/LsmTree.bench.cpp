@@ -0,0 +1,110 @@
+#include "../../src/models/KVEngine/PagedEngine.hpp"
+#include "../../src/models/LsmTree/LsmTree.hpp"
+#include "../../tests/common/TempPath.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <numeric>
+#include <random>
+#include <string>
+#include <system_error>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+static uint64_t bytes_on_disk(const std::string &path) {
+  std::error_code ec;
+  if (!fs::is_directory(path, ec)) {
+    return fs::file_size(path, ec);
+  }
+  uint64_t bytes = 0;
+  for (const auto &entry : fs::directory_iterator(path, ec)) {
+    bytes += entry.file_size(ec);
+  }
+  return bytes;
+}
+
+// Keys in insertion order: 0..count-1, or shuffled.
+static std::vector<std::string> make_keys(size_t count, bool shuffled) {
+  std::vector<uint64_t> order(count);
+  std::iota(order.begin(), order.end(), 0);
+  if (shuffled) {
+    std::shuffle(order.begin(), order.end(), std::mt19937_64(42));
+  }
+  std::vector<std::string> keys;
+  keys.reserve(count);
+  char key[24];
+  for (uint64_t n : order) {
+    std::snprintf(key, sizeof(key), "user%016llu",
+                  static_cast<unsigned long long>(n));
+    keys.emplace_back(key);
+  }
+  return keys;
+}
+
+// Puts every key, then closes the engine so all of it is on disk; prints
+// puts/sec and the bandwidth of the data the caller handed in. For the LSM
+// tree it also prints what the flushes and compactions wrote, and the
+// write amplification that adds up to.
+static void bench_ingest(KVEngineType type,
+                         const std::vector<std::string> &keys,
+                         const char *order) {
+  std::string path = make_temp_path(type == KVEngineType::Lsm ? "" : ".db");
+  LsmTreeStats stats{};
+  auto start = std::chrono::steady_clock::now();
+  {
+    std::unique_ptr<KVEngine> engine;
+    if (type == KVEngineType::Lsm) {
+      engine = std::make_unique<LsmTree>(path);
+    } else {
+      engine = std::make_unique<PagedEngine>(path);
+    }
+    for (size_t i = 0; i < keys.size(); ++i) {
+      engine->Put(keys[i], i);
+    }
+    if (auto *lsm = dynamic_cast<LsmTree *>(engine.get())) {
+      lsm->Flush();
+      lsm->WaitForCompactions();
+      stats = lsm->GetStats();
+    }
+  }
+  double elapsed =
+      std::chrono::duration<double>(std::chrono::steady_clock::now() - start)
+          .count();
+
+  double userBytes =
+      static_cast<double>(keys.size() * (keys.front().size() + 8));
+  std::cout << "  " << (type == KVEngineType::Lsm ? "lsm  " : "paged") << " "
+            << order << " puts/sec="
+            << static_cast<long long>(static_cast<double>(keys.size()) /
+                                      elapsed)
+            << " ingest MB/s=" << userBytes / elapsed / 1e6
+            << " on-disk MB=" << static_cast<double>(bytes_on_disk(path)) / 1e6;
+  if (type == KVEngineType::Lsm) {
+    double written =
+        static_cast<double>(stats.bytesFlushed + stats.bytesCompacted);
+    std::cout << " table MB/s=" << written / elapsed / 1e6
+              << " write-amp=" << written / userBytes
+              << " flushes=" << stats.flushes
+              << " compactions=" << stats.compactions;
+  }
+  std::cout << "\n";
+  safe_remove(path);
+}
+
+int main(int argc, char **argv) {
+  size_t count = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1000000;
+
+  std::cout << "Ingest of " << count << " 20-byte keys with 8-byte values\n";
+  for (bool shuffled : {false, true}) {
+    std::vector<std::string> keys = make_keys(count, shuffled);
+    const char *order = shuffled ? "random    " : "sequential";
+    bench_ingest(KVEngineType::Lsm, keys, order);
+    bench_ingest(KVEngineType::Paged, keys, order);
+  }
+  return 0;
+}
@@ -0,0 +1,146 @@
+#include "../../src/models/DiskManager/DiskManager.hpp"
+#include "../../src/models/Lz4/Lz4.hpp"
+#include "../../tests/common/TempPath.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <random>
+#include <string>
+#include <system_error>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+static double seconds_since(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                       start)
+      .count();
+}
+
+// Pages of rows: a key, a couple of enum-like fields, a numeric score and a
+// free-text field drawn from a small vocabulary, which is roughly how our
+// values compress. `entropy` mixes in random bytes, 0 to 1.
+static std::vector<char> make_pages(size_t pages, double entropy) {
+  static const char *words[] = {"alpha", "bravo", "charlie", "delta",
+                                "echo",  "fox",   "golf",    "hotel"};
+  std::mt19937 eng(17);
+  std::uniform_real_distribution<double> coin(0, 1);
+  std::vector<char> data(pages * BLOCK_SIZE);
+  std::string rows;
+  for (size_t row = 0; rows.size() < data.size(); ++row) {
+    rows += "user:" + std::to_string(1000000 + row * 13) + "|status=" +
+            (row % 5 == 0 ? "inactive" : "active") +
+            "|region=eu-west-" + std::to_string(row % 3) +
+            "|score=" + std::to_string(eng() % 10000) + "|note=";
+    for (int w = 0; w < 4; ++w) {
+      rows += words[eng() % 8];
+      rows += ' ';
+    }
+    rows += ';';
+  }
+  for (size_t i = 0; i < data.size(); ++i) {
+    data[i] = coin(eng) < entropy ? static_cast<char>(eng()) : rows[i];
+  }
+  return data;
+}
+
+static void bench_codec(const char *label, const std::vector<char> &data) {
+  size_t pages = data.size() / BLOCK_SIZE;
+  std::vector<char> packed(pages * BLOCK_SIZE);
+  std::vector<size_t> sizes(pages);
+  size_t stored = 0;
+
+  auto start = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < pages; ++i) {
+    sizes[i] = Lz4::Compress(data.data() + i * BLOCK_SIZE, BLOCK_SIZE,
+                             packed.data() + i * BLOCK_SIZE, BLOCK_SIZE);
+    stored += sizes[i] == 0 ? BLOCK_SIZE : sizes[i];
+  }
+  double compressSeconds = seconds_since(start);
+
+  std::vector<char> page(BLOCK_SIZE);
+  size_t checksum = 0;
+  start = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < pages; ++i) {
+    if (sizes[i] != 0) {
+      checksum += Lz4::Decompress(packed.data() + i * BLOCK_SIZE, sizes[i],
+                                  page.data(), BLOCK_SIZE);
+      checksum += static_cast<unsigned char>(page[i % BLOCK_SIZE]);
+    }
+  }
+  double decompressSeconds = seconds_since(start);
+
+  double bytes = static_cast<double>(data.size());
+  std::cout << "  " << label << " ratio=" << bytes / static_cast<double>(stored)
+            << " compress MB/s=" << bytes / compressSeconds / 1e6
+            << " decompress MB/s=" << bytes / decompressSeconds / 1e6
+            << " ns/page compress="
+            << compressSeconds * 1e9 / static_cast<double>(pages)
+            << " decompress="
+            << decompressSeconds * 1e9 / static_cast<double>(pages)
+            << " (checksum " << checksum << ")\n";
+}
+
+// Writes every page through a DiskManager, syncs, then reads them all back
+// in random order; reports rates and the file's size on disk.
+static void bench_disk(const char *label, BlockCompression compression,
+                       const std::vector<char> &data) {
+  BlockId pages = static_cast<BlockId>(data.size() / BLOCK_SIZE);
+  std::string path = make_temp_db_path();
+  {
+    DiskManagerConfig config;
+    config.compression = compression;
+    DiskManager dm(path, config);
+    dm.AllocateBlocks(pages);
+
+    auto start = std::chrono::steady_clock::now();
+    for (BlockId id = 0; id < pages; ++id) {
+      dm.WriteBlock(id, data.data() + size_t{id} * BLOCK_SIZE);
+    }
+    dm.SyncFile();
+    double writeSeconds = seconds_since(start);
+
+    std::vector<BlockId> order(pages);
+    for (BlockId id = 0; id < pages; ++id) {
+      order[id] = id;
+    }
+    std::shuffle(order.begin(), order.end(), std::mt19937(5));
+    std::vector<char> page(BLOCK_SIZE);
+    start = std::chrono::steady_clock::now();
+    for (BlockId id : order) {
+      dm.ReadBlock(id, page.data());
+    }
+    double readSeconds = seconds_since(start);
+
+    std::cout << "  " << label << " write pages/sec="
+              << static_cast<long long>(pages / writeSeconds)
+              << " read pages/sec="
+              << static_cast<long long>(pages / readSeconds)
+              << " file MB=" << static_cast<double>(fs::file_size(path)) / 1e6
+              << "\n";
+  }
+  safe_remove(path);
+}
+
+// Compression ratio and CPU cost of the bundled codec on row-like pages at
+// a few levels of entropy, then what it does to DiskManager: fewer bytes
+// written and a smaller file, for CPU on every read and write.
+int main(int argc, char **argv) {
+  size_t pages = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 16384;
+
+  std::cout << "Lz4 on " << pages << " row-like pages\n";
+  for (double entropy : {0.0, 0.1, 0.3}) {
+    std::string label = "entropy=" + std::to_string(entropy).substr(0, 3);
+    bench_codec(label.c_str(), make_pages(pages, entropy));
+  }
+
+  std::cout << "DiskManager, page cache warm\n";
+  std::vector<char> data = make_pages(pages, 0.0);
+  bench_disk("uncompressed", BlockCompression::None, data);
+  bench_disk("lz4         ", BlockCompression::Lz4, data);
+  return 0;
+}
@@ -0,0 +1,160 @@
+#include "../../src/models/BufferPool/BufferPool.hpp"
+#include "../../src/models/DiskManager/DiskManager.hpp"
+#include "../../tests/common/TempPath.hpp"
+
+#include <pthread.h>
+#include <sched.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+constexpr size_t BLOCKS = 1024;
+
+// A pool holding all BLOCKS blocks, with metrics on or off. Huge pages are
+// off: whether a pool gets them varies from one pool to the next and
+// moves the hit loop by more than the metrics do.
+static std::unique_ptr<BufferPool> make_pool(const std::string &path,
+                                             bool metrics) {
+  DiskManagerConfig diskConfig;
+  diskConfig.metrics = metrics;
+  BufferPoolConfig config;
+  config.metrics = metrics;
+  config.hugePageFrames = false;
+  auto pool = std::make_unique<BufferPool>(
+      BLOCKS, std::make_unique<DiskManager>(path, diskConfig), config);
+  for (size_t i = 0; i < BLOCKS; ++i) {
+    pool->NewPage();
+  }
+  return pool;
+}
+
+// Keeps the calling thread on one CPU, so a migration mid-run does not
+// show up as overhead. Best effort: a restricted cpuset refuses.
+static void pin_to_cpu(size_t cpu) {
+  unsigned cpus = std::max(1u, std::thread::hardware_concurrency());
+  cpu_set_t cpuSet;
+  CPU_ZERO(&cpuSet);
+  CPU_SET(cpu % cpus, &cpuSet);
+  ::pthread_setaffinity_np(::pthread_self(), sizeof(cpuSet), &cpuSet);
+}
+
+// FetchBlock/ReleaseBlock pairs over resident blocks on `threadCount`
+// pinned threads, in nanoseconds per pair.
+static double time_hits(BufferPool &pool, size_t threadCount,
+                        size_t opsPerThread) {
+  auto start = std::chrono::steady_clock::now();
+  std::vector<std::thread> workers;
+  for (size_t t = 0; t < threadCount; ++t) {
+    workers.emplace_back([&pool, opsPerThread, t]() {
+      pin_to_cpu(t);
+      // A fixed pseudo-random walk, so both pools see the same blocks.
+      uint32_t x = static_cast<uint32_t>(t * 2654435761u + 1);
+      for (size_t op = 0; op < opsPerThread; ++op) {
+        x = x * 1664525u + 1013904223u;
+        BlockId id = (x >> 8) % BLOCKS;
+        Block *block = pool.FetchBlock(id);
+        volatile char sink = block->data[0];
+        (void)sink;
+        pool.ReleaseBlock(id, false);
+      }
+    });
+  }
+  for (auto &worker : workers) {
+    worker.join();
+  }
+  double elapsed = std::chrono::duration<double, std::nano>(
+                       std::chrono::steady_clock::now() - start)
+                       .count();
+  return elapsed / static_cast<double>(opsPerThread);
+}
+
+// Each round builds a fresh pool per mode and times it after a warm-up,
+// alternating which mode goes first so drift hits both alike. Prints the
+// fastest and median round of each mode, and the overhead of each round's
+// pair with a 95% confidence interval. Returns the pool of the last round
+// with metrics on.
+static std::unique_ptr<BufferPool> bench_overhead(const std::string &path,
+                                                  size_t threadCount,
+                                                  size_t opsPerThread,
+                                                  int rounds) {
+  std::vector<double> times[2];
+  std::vector<double> overheads;
+  std::unique_ptr<BufferPool> last;
+  for (int round = 0; round < rounds; ++round) {
+    for (int i = 0; i < 2; ++i) {
+      bool metrics = (round + i) % 2 == 1;
+      last.reset();
+      safe_remove(path);
+      auto pool = make_pool(path, metrics);
+      time_hits(*pool, threadCount, opsPerThread / 4);
+      times[metrics].push_back(time_hits(*pool, threadCount, opsPerThread));
+      if (metrics) {
+        last = std::move(pool);
+      }
+    }
+    overheads.push_back((times[1].back() - times[0].back()) /
+                        times[0].back() * 100.0);
+  }
+  for (auto &modeTimes : times) {
+    std::sort(modeTimes.begin(), modeTimes.end());
+  }
+
+  double mean = 0;
+  for (double overhead : overheads) {
+    mean += overhead;
+  }
+  mean /= static_cast<double>(overheads.size());
+  double variance = 0;
+  for (double overhead : overheads) {
+    variance += (overhead - mean) * (overhead - mean);
+  }
+  double halfWidth =
+      overheads.size() > 1
+          ? 1.96 * std::sqrt(variance / static_cast<double>(
+                                            overheads.size() - 1) /
+                             static_cast<double>(overheads.size()))
+          : 0;
+
+  double offMin = times[0].front();
+  double onMin = times[1].front();
+  std::cout << "  threads=" << threadCount << " off ns/fetch min=" << offMin
+            << " median=" << times[0][times[0].size() / 2]
+            << "\n            on ns/fetch min=" << onMin
+            << " median=" << times[1][times[1].size() / 2]
+            << "\n            overhead min-of-N="
+            << (onMin - offMin) / offMin * 100.0 << "% paired=" << mean
+            << "% +/- " << halfWidth << "%\n";
+  return last;
+}
+
+int main(int argc, char **argv) {
+  size_t ops = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 10000000;
+  int rounds = argc > 2 ? std::atoi(argv[2]) : 21;
+  std::string path = make_temp_db_path();
+
+  std::cout << "FetchBlock hit loop, metrics off vs on (" << rounds
+            << " rounds of " << ops << " fetches)\n";
+  auto pool = bench_overhead(path, 1, ops, rounds);
+  BufferPoolStats stats = pool->GetStats();
+  pool.reset();
+  unsigned cores = std::max(2u, std::thread::hardware_concurrency());
+  pool = bench_overhead(path, std::min(cores, 4u), ops / 2, rounds);
+  pool.reset();
+  safe_remove(path);
+
+  std::cout << "Stats of the last single-thread pool:\n"
+            << stats.ToText() << stats.ToJson() << "\n";
+  return 0;
+}
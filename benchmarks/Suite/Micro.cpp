@@ -0,0 +1,242 @@
+#include "../../src/models/BufferPool/BufferPool.hpp"
+#include "../../src/models/DiskManager/DiskManager.hpp"
+#include "./Suite.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <numeric>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+double SecondsSince(Clock::time_point start) {
+  return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+std::vector<BlockId> ShuffledIds(size_t blocks, uint64_t seed) {
+  std::vector<BlockId> ids(blocks);
+  std::iota(ids.begin(), ids.end(), BlockId{0});
+  std::shuffle(ids.begin(), ids.end(), std::mt19937_64(seed));
+  return ids;
+}
+
+BenchResult MakeResult(const std::string &name, const MicroConfig &config,
+                       bool timedEachOp) {
+  BenchResult result;
+  result.name = name;
+  result.params = {{"blocks", JsonNumber(uint64_t{config.blocks})},
+                   {"blockSize", JsonNumber(uint64_t{BLOCK_SIZE})},
+                   {"rounds", JsonNumber(uint64_t{config.rounds})}};
+  result.timedEachOp = timedEachOp;
+  return result;
+}
+
+std::unique_ptr<DiskManager> MakeFile(const std::string &path,
+                                      size_t blocks) {
+  auto diskManager = std::make_unique<DiskManager>(path);
+  diskManager->AllocateBlocks(static_cast<BlockId>(blocks));
+  return diskManager;
+}
+
+// FetchBlock of resident blocks, then ReleaseBlock of the same pins: the
+// pool holds every block, so neither touches the disk. Both are timed as a
+// whole pass; a clock read per call would cost as much as the call.
+void BenchHitPath(const MicroConfig &config,
+                  std::vector<BenchResult> &results) {
+  BenchResult fetch = MakeResult("fetch_block_hit", config, false);
+  BenchResult release = MakeResult("release_block", config, false);
+  fetch.params.emplace_back("frames", JsonNumber(uint64_t{config.blocks}));
+  release.params = fetch.params;
+
+  std::string path = make_temp_db_path();
+  {
+    BufferPool pool(config.blocks, MakeFile(path, config.blocks));
+    for (BlockId id = 0; id < config.blocks; ++id) {
+      pool.FetchBlock(id);
+      pool.ReleaseBlock(id, false);
+    }
+    for (size_t round = 0; round < config.rounds; ++round) {
+      std::vector<BlockId> ids = ShuffledIds(config.blocks, round + 1);
+      auto start = Clock::now();
+      for (BlockId id : ids) {
+        pool.FetchBlock(id);
+      }
+      fetch.seconds += SecondsSince(start);
+
+      // Odd rounds release dirty, so both kinds are in the mean.
+      start = Clock::now();
+      for (BlockId id : ids) {
+        pool.ReleaseBlock(id, round % 2 == 1);
+      }
+      release.seconds += SecondsSince(start);
+      fetch.ops += ids.size();
+      release.ops += ids.size();
+    }
+  }
+  safe_remove(path);
+  results.push_back(std::move(fetch));
+  results.push_back(std::move(release));
+}
+
+// FetchBlock of blocks that are not resident: a pool an eighth the size of
+// the file, walked in a fixed order that is not sequential (so read-ahead
+// stays out of it), always evicts the block fetched longest ago. The file
+// is in the page cache, so this is the pool's miss path plus a pread.
+void BenchMissPath(const MicroConfig &config,
+                   std::vector<BenchResult> &results) {
+  size_t frames = std::max<size_t>(config.blocks / 8, 16);
+  BenchResult fetch = MakeResult("fetch_block_miss", config, true);
+  fetch.params.emplace_back("frames", JsonNumber(uint64_t{frames}));
+
+  std::string path = make_temp_db_path();
+  {
+    BufferPoolConfig poolConfig;
+    poolConfig.readaheadBlocks = 0;
+    BufferPool pool(frames, MakeFile(path, config.blocks), poolConfig);
+    // A stride coprime to the block count visits every block once a lap.
+    size_t stride = 7;
+    while (std::gcd(stride, config.blocks) != 1) {
+      stride += 2;
+    }
+    auto walk = [&](size_t laps, bool timed) {
+      for (size_t i = 0; i < laps * config.blocks; ++i) {
+        BlockId id = static_cast<BlockId>(i * stride % config.blocks);
+        uint64_t start = timed ? NowNanos() : 0;
+        pool.FetchBlock(id);
+        if (timed) {
+          fetch.latency.Record(NowNanos() - start);
+        }
+        pool.ReleaseBlock(id, false);
+      }
+    };
+    walk(1, false);
+    BufferPoolStats before = pool.GetStats();
+    auto start = Clock::now();
+    walk(config.rounds, true);
+    fetch.seconds = SecondsSince(start);
+    fetch.ops = config.rounds * config.blocks;
+    BufferPoolStats after = pool.GetStats();
+    fetch.extra.emplace_back("misses",
+                             JsonNumber(after.misses - before.misses));
+  }
+  safe_remove(path);
+  results.push_back(std::move(fetch));
+}
+
+// NewBlock on a fresh file each round, into a pool large enough that no
+// frame is evicted; what it costs is the allocation and the frame.
+void BenchNewBlock(const MicroConfig &config,
+                   std::vector<BenchResult> &results) {
+  BenchResult result = MakeResult("new_block", config, false);
+  result.params.emplace_back("frames", JsonNumber(uint64_t{config.blocks}));
+  std::vector<BlockId> ids(config.blocks);
+  for (size_t round = 0; round < config.rounds; ++round) {
+    std::string path = make_temp_db_path();
+    {
+      BufferPool pool(config.blocks, std::make_unique<DiskManager>(path));
+      auto start = Clock::now();
+      for (size_t i = 0; i < config.blocks; ++i) {
+        ids[i] = pool.NewBlock()->block_id;
+      }
+      result.seconds += SecondsSince(start);
+      result.ops += config.blocks;
+      for (BlockId id : ids) {
+        pool.ReleaseBlock(id, true);
+      }
+    }
+    safe_remove(path);
+  }
+  results.push_back(std::move(result));
+}
+
+void BenchAllocateBlock(const MicroConfig &config,
+                        std::vector<BenchResult> &results) {
+  BenchResult result = MakeResult("allocate_block", config, false);
+  for (size_t round = 0; round < config.rounds; ++round) {
+    std::string path = make_temp_db_path();
+    {
+      DiskManager diskManager(path);
+      auto start = Clock::now();
+      for (size_t i = 0; i < config.blocks; ++i) {
+        diskManager.AllocateBlock();
+      }
+      result.seconds += SecondsSince(start);
+      result.ops += config.blocks;
+    }
+    safe_remove(path);
+  }
+  results.push_back(std::move(result));
+}
+
+// WriteBlock and ReadBlock straight to the DiskManager, in block order and
+// shuffled, each timed. Every round starts from a fresh file, written
+// sequentially first so the random writes overwrite and the reads find
+// checksummed blocks. Reads come from the page cache.
+void BenchBlockIO(const MicroConfig &config,
+                  std::vector<BenchResult> &results) {
+  const char *names[] = {"write_block_seq", "write_block_random",
+                         "read_block_seq", "read_block_random"};
+  std::vector<BenchResult> io;
+  for (const char *name : names) {
+    io.push_back(MakeResult(name, config, true));
+  }
+  std::vector<char> buff(BLOCK_SIZE, 'k');
+
+  for (size_t round = 0; round < config.rounds; ++round) {
+    std::string path = make_temp_db_path();
+    {
+      std::unique_ptr<DiskManager> diskManager =
+          MakeFile(path, config.blocks);
+      std::vector<BlockId> sequential(config.blocks);
+      std::iota(sequential.begin(), sequential.end(), BlockId{0});
+      std::vector<BlockId> shuffled = ShuffledIds(config.blocks, round + 1);
+
+      for (size_t i = 0; i < io.size(); ++i) {
+        const std::vector<BlockId> &ids = i % 2 == 0 ? sequential : shuffled;
+        bool isWrite = i < 2;
+        auto start = Clock::now();
+        for (BlockId id : ids) {
+          uint64_t opStart = NowNanos();
+          if (isWrite) {
+            buff[0] = static_cast<char>(id);
+            diskManager->WriteBlock(id, buff.data());
+          } else {
+            diskManager->ReadBlock(id, buff.data());
+          }
+          io[i].latency.Record(NowNanos() - opStart);
+        }
+        io[i].seconds += SecondsSince(start);
+        io[i].ops += ids.size();
+      }
+    }
+    safe_remove(path);
+  }
+  for (auto &result : io) {
+    results.push_back(std::move(result));
+  }
+}
+
+} // namespace
+
+std::vector<BenchResult> RunMicroBenchmarks(const MicroConfig &config) {
+  std::vector<BenchResult> results;
+  auto report = [&results](size_t from) {
+    for (size_t i = from; i < results.size(); ++i) {
+      std::cerr << "  " << results[i].ToText() << "\n";
+    }
+  };
+  using Bench = void (*)(const MicroConfig &, std::vector<BenchResult> &);
+  for (Bench bench : {BenchHitPath, BenchMissPath, BenchNewBlock,
+                      BenchAllocateBlock, BenchBlockIO}) {
+    size_t from = results.size();
+    bench(config, results);
+    report(from);
+  }
+  return results;
+}
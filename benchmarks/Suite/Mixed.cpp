@@ -0,0 +1,133 @@
+#include "../../src/models/KVEngine/PagedEngine.hpp"
+#include "./Suite.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Long scans of the whole paged table alongside threads updating random
+// keys, with and without multiVersion. With it each scan reads one
+// snapshot; without, whatever each key holds when the scan reaches it.
+// Runs with no updaters give the scan's latency on its own to compare
+// with.
+
+namespace {
+
+std::string KeyFor(uint64_t n) {
+  char key[32];
+  std::snprintf(key, sizeof(key), "row%012llu",
+                static_cast<unsigned long long>(n));
+  return key;
+}
+
+struct UpdaterResult {
+  LatencyHistogram latency;
+};
+
+std::vector<BenchResult> RunMix(const MixedConfig &config, bool multiVersion,
+                                size_t updaters) {
+  std::string path = make_temp_db_path();
+  std::vector<BenchResult> results;
+  {
+    PagedEngineConfig engineConfig;
+    engineConfig.multiVersion = multiVersion;
+    PagedEngine engine(path, engineConfig);
+    for (uint64_t n = 0; n < config.records; ++n) {
+      engine.Put(KeyFor(n), n);
+    }
+
+    std::atomic<bool> stop{false};
+    std::vector<UpdaterResult> updaterResults(updaters);
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < updaters; ++t) {
+      threads.emplace_back([&, t]() {
+        std::mt19937_64 eng(t + 1);
+        std::uniform_int_distribution<uint64_t> pick(0, config.records - 1);
+        LatencyHistogram &latency = updaterResults[t].latency;
+        while (!stop.load(std::memory_order_relaxed)) {
+          std::string key = KeyFor(pick(eng));
+          uint64_t start = NowNanos();
+          engine.Put(key, eng());
+          latency.Record(NowNanos() - start);
+        }
+      });
+    }
+
+    BenchResult scan;
+    scan.name = "mixed_scan";
+    scan.timedEachOp = true;
+    uint64_t keysSeen = 0;
+    size_t versionsPeak = 0;
+    auto begin = std::chrono::steady_clock::now();
+    auto end = begin + std::chrono::duration_cast<std::chrono::nanoseconds>(
+                           std::chrono::duration<double>(config.seconds));
+    // At least one scan, however short the run.
+    do {
+      uint64_t start = NowNanos();
+      engine.Scan("", [&keysSeen](std::string_view, uint64_t) {
+        keysSeen++;
+        return true;
+      });
+      scan.latency.Record(NowNanos() - start);
+      scan.ops++;
+      versionsPeak = std::max(versionsPeak,
+                              engine.GetVersionStore().GetVersionCount());
+    } while (std::chrono::steady_clock::now() < end);
+    stop = true;
+    for (auto &thread : threads) {
+      thread.join();
+    }
+    scan.seconds = std::chrono::duration<double>(
+                       std::chrono::steady_clock::now() - begin)
+                       .count();
+
+    BenchResult update;
+    update.name = "mixed_update";
+    update.timedEachOp = true;
+    update.seconds = scan.seconds;
+    for (const UpdaterResult &result : updaterResults) {
+      update.latency.Merge(result.latency);
+    }
+    update.ops = update.latency.GetCount();
+
+    for (BenchResult *result : {&scan, &update}) {
+      result->params = {{"engine", JsonString("paged")},
+                        {"multiVersion", multiVersion ? "true" : "false"},
+                        {"updaters", JsonNumber(uint64_t{updaters})},
+                        {"records", JsonNumber(uint64_t{config.records})}};
+    }
+    scan.extra.emplace_back(
+        "keysPerScan",
+        JsonNumber(static_cast<double>(keysSeen) /
+                   static_cast<double>(std::max<uint64_t>(scan.ops, 1))));
+    scan.extra.emplace_back("versionsPeak",
+                            JsonNumber(uint64_t{versionsPeak}));
+    results.push_back(std::move(scan));
+    if (updaters > 0) {
+      results.push_back(std::move(update));
+    }
+  }
+  safe_remove(path);
+  return results;
+}
+
+} // namespace
+
+std::vector<BenchResult> RunMixed(const MixedConfig &config) {
+  std::vector<BenchResult> results;
+  for (bool multiVersion : {true, false}) {
+    for (size_t updaters : config.updaters) {
+      for (BenchResult &result : RunMix(config, multiVersion, updaters)) {
+        std::cerr << "  " << result.ToText() << "\n";
+        results.push_back(std::move(result));
+      }
+    }
+  }
+  return results;
+}
@@ -0,0 +1,226 @@
+#include "../../src/types/Constants.hpp"
+#include "./Suite.hpp"
+
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifndef KEYVAL_VERSION
+#define KEYVAL_VERSION "unknown"
+#endif
+
+// The suite behind `meson compile -C <build> bench`: microbenchmarks of the
+// BufferPool and DiskManager calls every engine is built on, YCSB core
+// workloads A-F against the KV engines, and whole-table scans racing point
+// updates (mixed). Progress goes to stderr and one JSON
+// document to stdout or --out, one result per line, so that two versions'
+// documents can be diffed or compared by script.
+
+static void print_usage(const char *program) {
+  std::cerr
+      << "Usage: " << program << " [all|micro|ycsb|mixed] [options]\n"
+      << "  --out FILE            write the JSON here instead of stdout\n"
+      << "  --quick               small sizes, for a smoke run\n"
+      << "  --blocks N            blocks per microbenchmark file\n"
+      << "  --rounds N            timed passes per microbenchmark\n"
+      << "  --records N           records loaded before each workload or\n"
+      << "                        mixed run\n"
+      << "  --operations N        operations per workload run\n"
+      << "  --workloads LETTERS   YCSB workloads to run, from abcdef\n"
+      << "  --distribution NAME   zipfian, uniform or latest for all\n"
+      << "                        workloads (default: each its own)\n"
+      << "  --engines LIST        paged,lsm\n"
+      << "  --threads LIST        thread counts, e.g. 1,4,16\n"
+      << "  --pool-ratios LIST    pool frames per block of the paged\n"
+      << "                        table, e.g. 0.1,1\n"
+      << "  --updaters LIST       mixed: updating threads per run, e.g.\n"
+      << "                        0,1,4\n"
+      << "  --seconds S           mixed: length of each run\n";
+}
+
+static std::vector<std::string> split_list(const std::string &list) {
+  std::vector<std::string> items;
+  std::stringstream stream(list);
+  std::string item;
+  while (std::getline(stream, item, ',')) {
+    if (!item.empty()) {
+      items.push_back(item);
+    }
+  }
+  return items;
+}
+
+static size_t parse_count(const std::string &text) {
+  char *end = nullptr;
+  unsigned long long value = std::strtoull(text.c_str(), &end, 10);
+  if (text.empty() || *end != '\0' || value == 0) {
+    throw std::invalid_argument("expected a positive count: " + text);
+  }
+  return static_cast<size_t>(value);
+}
+
+static double parse_ratio(const std::string &text) {
+  char *end = nullptr;
+  double value = std::strtod(text.c_str(), &end);
+  if (text.empty() || *end != '\0' || !(value > 0)) {
+    throw std::invalid_argument("expected a positive ratio: " + text);
+  }
+  return value;
+}
+
+int main(int argc, char **argv) {
+  std::string mode = "all";
+  std::string outPath;
+  MicroConfig micro;
+  YcsbConfig ycsb;
+  MixedConfig mixed;
+
+  std::vector<std::string> args(argv + 1, argv + argc);
+  if (!args.empty() && args[0].rfind("--", 0) != 0) {
+    mode = args[0];
+    args.erase(args.begin());
+  }
+  if (mode != "all" && mode != "micro" && mode != "ycsb" &&
+      mode != "mixed") {
+    print_usage(argv[0]);
+    return 2;
+  }
+  // --quick first, so options after it still override its sizes.
+  for (const std::string &arg : args) {
+    if (arg == "--quick") {
+      micro.blocks = 1024;
+      micro.rounds = 2;
+      ycsb.records = 10000;
+      ycsb.operations = 10000;
+      ycsb.threads = {1, 2};
+      mixed.records = 10000;
+      mixed.updaters = {0, 2};
+      mixed.seconds = 0.5;
+    }
+  }
+  try {
+    for (size_t i = 0; i < args.size(); ++i) {
+      const std::string &arg = args[i];
+      if (arg == "--quick") {
+        continue;
+      }
+      if (i + 1 == args.size()) {
+        throw std::invalid_argument("missing value or unknown option " + arg);
+      }
+      const std::string &value = args[++i];
+      if (arg == "--out") {
+        outPath = value;
+      } else if (arg == "--blocks") {
+        micro.blocks = parse_count(value);
+      } else if (arg == "--rounds") {
+        micro.rounds = parse_count(value);
+      } else if (arg == "--records") {
+        ycsb.records = parse_count(value);
+        mixed.records = ycsb.records;
+      } else if (arg == "--operations") {
+        ycsb.operations = parse_count(value);
+      } else if (arg == "--workloads") {
+        if (value.find_first_not_of("abcdef") != std::string::npos) {
+          throw std::invalid_argument("unknown workload in " + value);
+        }
+        ycsb.workloads = value;
+      } else if (arg == "--distribution") {
+        if (value == "zipfian") {
+          ycsb.distribution = YcsbDistribution::Zipfian;
+        } else if (value == "uniform") {
+          ycsb.distribution = YcsbDistribution::Uniform;
+        } else if (value == "latest") {
+          ycsb.distribution = YcsbDistribution::Latest;
+        } else {
+          throw std::invalid_argument("unknown distribution " + value);
+        }
+      } else if (arg == "--engines") {
+        ycsb.engines = split_list(value);
+        for (const std::string &engine : ycsb.engines) {
+          if (engine != "paged" && engine != "lsm") {
+            throw std::invalid_argument("unknown engine " + engine);
+          }
+        }
+      } else if (arg == "--threads") {
+        ycsb.threads.clear();
+        for (const std::string &item : split_list(value)) {
+          ycsb.threads.push_back(parse_count(item));
+        }
+      } else if (arg == "--pool-ratios") {
+        ycsb.poolRatios.clear();
+        for (const std::string &item : split_list(value)) {
+          ycsb.poolRatios.push_back(parse_ratio(item));
+        }
+      } else if (arg == "--updaters") {
+        mixed.updaters.clear();
+        for (const std::string &item : split_list(value)) {
+          // 0 is allowed here: the scans alone.
+          mixed.updaters.push_back(item == "0" ? 0 : parse_count(item));
+        }
+      } else if (arg == "--seconds") {
+        mixed.seconds = parse_ratio(value);
+      } else {
+        throw std::invalid_argument("unknown option " + arg);
+      }
+    }
+  } catch (const std::invalid_argument &e) {
+    std::cerr << e.what() << "\n";
+    print_usage(argv[0]);
+    return 2;
+  }
+
+  std::vector<BenchResult> results;
+  if (mode == "all" || mode == "micro") {
+    std::cerr << "Microbenchmarks\n";
+    for (BenchResult &result : RunMicroBenchmarks(micro)) {
+      results.push_back(std::move(result));
+    }
+  }
+  if (mode == "all" || mode == "ycsb") {
+    std::cerr << "YCSB workloads\n";
+    for (BenchResult &result : RunYcsb(ycsb)) {
+      results.push_back(std::move(result));
+    }
+  }
+  if (mode == "all" || mode == "mixed") {
+    std::cerr << "Scans with updates\n";
+    for (BenchResult &result : RunMixed(mixed)) {
+      results.push_back(std::move(result));
+    }
+  }
+
+  auto timestamp = std::chrono::duration_cast<std::chrono::seconds>(
+                       std::chrono::system_clock::now().time_since_epoch())
+                       .count();
+  std::string json =
+      "{\"suite\":\"keyval\",\"version\":" + JsonString(KEYVAL_VERSION) +
+      ",\"timestamp\":" + std::to_string(timestamp) +
+      ",\"blockSize\":" + JsonNumber(uint64_t{BLOCK_SIZE}) +
+      ",\"hardwareThreads\":" +
+      std::to_string(std::thread::hardware_concurrency()) +
+      ",\"results\":[\n";
+  for (size_t i = 0; i < results.size(); ++i) {
+    json += results[i].ToJson() + (i + 1 < results.size() ? ",\n" : "\n");
+  }
+  json += "]}\n";
+
+  if (outPath.empty()) {
+    std::cout << json;
+    return 0;
+  }
+  std::ofstream out(outPath);
+  out << json;
+  if (!out) {
+    std::cerr << "Could not write " << outPath << "\n";
+    return 1;
+  }
+  std::cerr << "Wrote " << results.size() << " results to " << outPath
+            << "\n";
+  return 0;
+}
@@ -0,0 +1,98 @@
+#include "./Suite.hpp"
+
+#include <cmath>
+#include <cstdio>
+
+double BenchResult::OpsPerSec() const {
+  return this->seconds == 0
+             ? 0.0
+             : static_cast<double>(this->ops) / this->seconds;
+}
+
+double BenchResult::NanosPerOp() const {
+  return this->ops == 0 ? 0.0
+                        : this->seconds * 1e9 / static_cast<double>(this->ops);
+}
+
+std::string BenchResult::ToJson() const {
+  std::string json = "{\"name\":";
+  json += JsonString(this->name);
+  json += ",\"params\":{";
+  for (size_t i = 0; i < this->params.size(); ++i) {
+    json += i == 0 ? "" : ",";
+    json += JsonString(this->params[i].first);
+    json += ":";
+    json += this->params[i].second;
+  }
+  json += "},\"ops\":";
+  json += JsonNumber(this->ops);
+  json += ",\"seconds\":";
+  json += JsonNumber(this->seconds);
+  json += ",\"opsPerSec\":";
+  json += JsonNumber(this->OpsPerSec());
+  json += ",\"nsPerOp\":";
+  json += JsonNumber(this->NanosPerOp());
+  if (this->timedEachOp) {
+    json += ",\"latencyNs\":";
+    json += this->latency.ToJson();
+  }
+  for (const auto &[field, value] : this->extra) {
+    json += ",";
+    json += JsonString(field);
+    json += ":";
+    json += value;
+  }
+  return json + "}";
+}
+
+std::string BenchResult::ToText() const {
+  std::string text = this->name;
+  for (const auto &[param, value] : this->params) {
+    std::string plain = value;
+    if (plain.size() >= 2 && plain.front() == '"') {
+      plain = plain.substr(1, plain.size() - 2);
+    }
+    text += " " + param + "=" + plain;
+  }
+  char numbers[128];
+  std::snprintf(numbers, sizeof(numbers), " ops/sec=%.0f ns/op=%.1f",
+                this->OpsPerSec(), this->NanosPerOp());
+  text += numbers;
+  if (this->timedEachOp) {
+    std::snprintf(numbers, sizeof(numbers), " p50=%llu p99=%llu p999=%llu",
+                  static_cast<unsigned long long>(this->latency.Percentile(50)),
+                  static_cast<unsigned long long>(this->latency.Percentile(99)),
+                  static_cast<unsigned long long>(
+                      this->latency.Percentile(99.9)));
+    text += numbers;
+  }
+  return text;
+}
+
+std::string JsonString(const std::string &value) {
+  std::string json = "\"";
+  for (char c : value) {
+    if (c == '"' || c == '\\') {
+      json += '\\';
+      json += c;
+    } else if (static_cast<unsigned char>(c) < 0x20) {
+      char escaped[8];
+      std::snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+      json += escaped;
+    } else {
+      json += c;
+    }
+  }
+  return json + "\"";
+}
+
+std::string JsonNumber(double value) {
+  if (!std::isfinite(value)) {
+    return "null";
+  }
+  char json[32];
+  std::snprintf(json, sizeof(json), "%.9g", value);
+  return json;
+}
+
+std::string JsonNumber(uint64_t value) { return std::to_string(value); }
@@ -0,0 +1,71 @@
+#pragma once
+
+#include "../../src/models/Metrics/LatencyHistogram.hpp"
+#include "../../tests/common/TempPath.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+// One measurement of the suite. `params` and `extra` hold JSON values
+// already rendered (see JsonString), so each benchmark reports whatever
+// describes it without the writer knowing its fields.
+struct BenchResult {
+  std::string name;
+  std::vector<std::pair<std::string, std::string>> params;
+  uint64_t ops = 0;
+  double seconds = 0;
+  // Per-operation latencies, for benchmarks slow enough to time each
+  // operation without the clock skewing them; the rest report the mean
+  // of the whole run only.
+  bool timedEachOp = false;
+  LatencyHistogram latency;
+  std::vector<std::pair<std::string, std::string>> extra;
+
+  double OpsPerSec() const;
+  double NanosPerOp() const;
+  std::string ToJson() const;
+  // One line for the console while the suite runs.
+  std::string ToText() const;
+};
+
+struct MicroConfig {
+  // Blocks in each file the microbenchmarks create.
+  size_t blocks = 16384;
+  // Timed passes over those blocks; each pass is a fresh file or pool.
+  size_t rounds = 5;
+};
+
+enum class YcsbDistribution { Default, Uniform, Zipfian, Latest };
+
+struct YcsbConfig {
+  // Workload letters from "abcdef".
+  std::string workloads = "abcdef";
+  // Default takes each workload's own: latest for D, zipfian otherwise.
+  YcsbDistribution distribution = YcsbDistribution::Default;
+  // Any of "paged" and "lsm"; the pool ratios apply to "paged" only.
+  std::vector<std::string> engines = {"paged"};
+  std::vector<size_t> threads = {1, 4};
+  // Pool frames as a fraction of the blocks the loaded table takes.
+  std::vector<double> poolRatios = {0.1, 1.0};
+  size_t records = 200000;
+  size_t operations = 200000;
+};
+
+struct MixedConfig {
+  size_t records = 200000;
+  // Threads updating random keys while one thread scans the whole table;
+  // 0 times the scans alone.
+  std::vector<size_t> updaters = {0, 1, 4};
+  double seconds = 5;
+};
+
+std::vector<BenchResult> RunMicroBenchmarks(const MicroConfig &config);
+std::vector<BenchResult> RunYcsb(const YcsbConfig &config);
+std::vector<BenchResult> RunMixed(const MixedConfig &config);
+
+std::string JsonString(const std::string &value);
+std::string JsonNumber(double value);
+std::string JsonNumber(uint64_t value);
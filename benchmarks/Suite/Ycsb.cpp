@@ -0,0 +1,337 @@
+#include "../../src/models/KVEngine/PagedEngine.hpp"
+#include "../../src/models/LsmTree/LsmTree.hpp"
+#include "../common/Zipfian.hpp"
+#include "./Suite.hpp"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+enum class Operation { Read, Update, Insert, Scan, ReadModifyWrite };
+constexpr size_t OPERATIONS = 5;
+constexpr const char *OPERATION_NAMES[OPERATIONS] = {
+    "read", "update", "insert", "scan", "readModifyWrite"};
+
+// The core YCSB mixes, as percentages of each operation. Scans are of a
+// uniform 1..MAX_SCAN_LENGTH keys.
+struct Workload {
+  char letter;
+  std::array<unsigned, OPERATIONS> percent;
+  YcsbDistribution distribution;
+};
+
+constexpr size_t MAX_SCAN_LENGTH = 100;
+
+constexpr Workload WORKLOADS[] = {
+    {'a', {50, 50, 0, 0, 0}, YcsbDistribution::Zipfian},
+    {'b', {95, 5, 0, 0, 0}, YcsbDistribution::Zipfian},
+    {'c', {100, 0, 0, 0, 0}, YcsbDistribution::Zipfian},
+    {'d', {95, 0, 5, 0, 0}, YcsbDistribution::Latest},
+    {'e', {0, 0, 5, 95, 0}, YcsbDistribution::Zipfian},
+    {'f', {50, 0, 0, 0, 50}, YcsbDistribution::Zipfian},
+};
+
+const char *DistributionName(YcsbDistribution distribution) {
+  switch (distribution) {
+  case YcsbDistribution::Uniform:
+    return "uniform";
+  case YcsbDistribution::Latest:
+    return "latest";
+  case YcsbDistribution::Zipfian:
+  case YcsbDistribution::Default:
+  default:
+    return "zipfian";
+  }
+}
+
+uint64_t Fnv64(uint64_t value) {
+  uint64_t hash = 0xcbf29ce484222325ULL;
+  for (int i = 0; i < 8; ++i) {
+    hash ^= value & 0xff;
+    hash *= 0x100000001b3ULL;
+    value >>= 8;
+  }
+  return hash;
+}
+
+// Record n's key. Hashed, as YCSB does, so that insertion order is not key
+// order and the most recent records are spread over the whole table.
+std::string KeyFor(uint64_t n) {
+  char key[32];
+  std::snprintf(key, sizeof(key), "user%020llu",
+                static_cast<unsigned long long>(Fnv64(n)));
+  return key;
+}
+
+struct Table {
+  std::string engine;
+  // The loaded table each run starts from a copy of.
+  std::string templatePath;
+  // Blocks of the loaded paged table, which the pool ratios scale.
+  size_t blocks = 0;
+};
+
+std::unique_ptr<KVEngine> OpenEngine(const std::string &engine,
+                                     const std::string &path,
+                                     size_t poolFrames) {
+  if (engine == "lsm") {
+    return std::make_unique<LsmTree>(path);
+  }
+  PagedEngineConfig config;
+  config.poolFrames = poolFrames;
+  return std::make_unique<PagedEngine>(path, config);
+}
+
+Table LoadTable(const std::string &engine, size_t records) {
+  Table table;
+  table.engine = engine;
+  table.templatePath = make_temp_path(engine == "lsm" ? "" : ".db");
+  auto start = std::chrono::steady_clock::now();
+  {
+    std::unique_ptr<KVEngine> kv = OpenEngine(
+        engine, table.templatePath, PagedEngineConfig().poolFrames);
+    for (uint64_t n = 0; n < records; ++n) {
+      kv->Put(KeyFor(n), n);
+    }
+  }
+  double seconds = std::chrono::duration<double>(
+                       std::chrono::steady_clock::now() - start)
+                       .count();
+  if (engine != "lsm") {
+    // Blocks in use, not the file's size: the file grows ahead of them.
+    DiskManager diskManager(table.templatePath);
+    table.blocks =
+        diskManager.GetBlockCount() - diskManager.GetFreeBlockCount();
+  }
+  std::cerr << "  loaded " << records << " records into " << engine << " in "
+            << seconds << " s\n";
+  return table;
+}
+
+void CopyTable(const Table &table, const std::string &path) {
+  if (table.engine == "lsm") {
+    fs::copy(table.templatePath, path, fs::copy_options::recursive);
+    return;
+  }
+  for (const char *suffix : {"", DiskManager::FREE_MAP_SUFFIX,
+                             DiskManager::EXTENT_MAP_SUFFIX}) {
+    std::string from = table.templatePath + suffix;
+    if (fs::exists(from)) {
+      fs::copy_file(from, path + suffix);
+    }
+  }
+}
+
+struct ThreadResult {
+  std::array<LatencyHistogram, OPERATIONS> latency;
+  uint64_t notFound = 0;
+};
+
+// Runs `operations` of `workload` split across `threadCount` threads.
+// Inserts take record numbers from `nextRecord`; the latest distribution
+// favours the records just below it.
+double RunPhase(KVEngine &kv, const Workload &workload,
+                YcsbDistribution distribution, size_t records,
+                std::atomic<uint64_t> &nextRecord, size_t threadCount,
+                size_t operations, uint64_t seed,
+                std::vector<ThreadResult> &threadResults) {
+  threadResults.assign(threadCount, ThreadResult());
+  std::atomic<bool> go{false};
+  std::vector<std::thread> workers;
+  for (size_t t = 0; t < threadCount; ++t) {
+    workers.emplace_back([&, t]() {
+      ThreadResult &result = threadResults[t];
+      std::mt19937_64 eng(seed * 1000 + t);
+      ZipfianGenerator zipfian(records, 0.99, seed * 1000 + t + 500);
+      std::uniform_int_distribution<unsigned> percent(0, 99);
+      std::uniform_int_distribution<size_t> scanLength(1, MAX_SCAN_LENGTH);
+      auto pick = [&]() -> uint64_t {
+        switch (distribution) {
+        case YcsbDistribution::Uniform:
+          return eng() % records;
+        case YcsbDistribution::Latest: {
+          uint64_t newest = nextRecord.load(std::memory_order_relaxed) - 1;
+          return newest - std::min(newest, zipfian.Next());
+        }
+        default:
+          // Scrambled, so the popular records are not neighbours.
+          return Fnv64(zipfian.Next()) % records;
+        }
+      };
+
+      while (!go.load(std::memory_order_acquire)) {
+        std::this_thread::yield();
+      }
+      for (size_t op = t; op < operations; op += threadCount) {
+        unsigned roll = percent(eng);
+        size_t kind = 0;
+        while (roll >= workload.percent[kind]) {
+          roll -= workload.percent[kind];
+          kind++;
+        }
+        uint64_t start = NowNanos();
+        switch (static_cast<Operation>(kind)) {
+        case Operation::Read:
+          if (!kv.Get(KeyFor(pick()))) {
+            result.notFound++;
+          }
+          break;
+        case Operation::Update:
+          kv.Put(KeyFor(pick()), eng());
+          break;
+        case Operation::Insert: {
+          uint64_t n = nextRecord.fetch_add(1, std::memory_order_relaxed);
+          kv.Put(KeyFor(n), n);
+          break;
+        }
+        case Operation::Scan: {
+          size_t length = scanLength(eng);
+          size_t seen = 0;
+          kv.Scan(KeyFor(pick()),
+                  [&seen, length](std::string_view, uint64_t) {
+                    return ++seen < length;
+                  });
+          break;
+        }
+        case Operation::ReadModifyWrite: {
+          std::string key = KeyFor(pick());
+          std::optional<uint64_t> value = kv.Get(key);
+          if (!value) {
+            result.notFound++;
+          }
+          kv.Put(key, value.value_or(0) + 1);
+          break;
+        }
+        }
+        result.latency[kind].Record(NowNanos() - start);
+      }
+    });
+  }
+
+  auto start = std::chrono::steady_clock::now();
+  go.store(true, std::memory_order_release);
+  for (auto &worker : workers) {
+    worker.join();
+  }
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                       start)
+      .count();
+}
+
+BenchResult RunWorkload(const Table &table, const Workload &workload,
+                        const YcsbConfig &config, size_t threadCount,
+                        double poolRatio) {
+  YcsbDistribution distribution = config.distribution;
+  if (distribution == YcsbDistribution::Default) {
+    distribution = workload.distribution;
+  }
+  size_t poolFrames = std::max<size_t>(
+      64, static_cast<size_t>(poolRatio * static_cast<double>(table.blocks)));
+  bool paged = table.engine != "lsm";
+
+  BenchResult result;
+  result.name = std::string("ycsb_") + workload.letter;
+  result.params = {
+      {"engine", JsonString(table.engine)},
+      {"workload", JsonString(std::string(1, workload.letter))},
+      {"distribution", JsonString(DistributionName(distribution))},
+      {"threads", JsonNumber(uint64_t{threadCount})},
+      {"records", JsonNumber(uint64_t{config.records})}};
+  if (paged) {
+    result.params.emplace_back("poolRatio", JsonNumber(poolRatio));
+    result.params.emplace_back("poolFrames", JsonNumber(uint64_t{poolFrames}));
+  }
+  result.timedEachOp = true;
+
+  std::string path = make_temp_path(paged ? ".db" : "");
+  CopyTable(table, path);
+  {
+    std::unique_ptr<KVEngine> kv = OpenEngine(table.engine, path, poolFrames);
+    std::atomic<uint64_t> nextRecord{config.records};
+    std::vector<ThreadResult> threadResults;
+    // A tenth of the run, unrecorded, so the pool starts warm.
+    RunPhase(*kv, workload, distribution, config.records, nextRecord,
+             threadCount, config.operations / 10, 1, threadResults);
+    BufferPoolStats before;
+    if (paged) {
+      before = static_cast<PagedEngine &>(*kv).GetBufferPool().GetStats();
+    }
+    result.seconds =
+        RunPhase(*kv, workload, distribution, config.records, nextRecord,
+                 threadCount, config.operations, 2, threadResults);
+    result.ops = config.operations;
+
+    std::array<LatencyHistogram, OPERATIONS> latency;
+    uint64_t notFound = 0;
+    for (const ThreadResult &threadResult : threadResults) {
+      for (size_t kind = 0; kind < OPERATIONS; ++kind) {
+        latency[kind].Merge(threadResult.latency[kind]);
+        result.latency.Merge(threadResult.latency[kind]);
+      }
+      notFound += threadResult.notFound;
+    }
+    std::string operations = "{";
+    for (size_t kind = 0; kind < OPERATIONS; ++kind) {
+      if (latency[kind].GetCount() == 0) {
+        continue;
+      }
+      if (operations.size() > 1) {
+        operations += ",";
+      }
+      operations += JsonString(OPERATION_NAMES[kind]) + ":" +
+                    latency[kind].ToJson();
+    }
+    result.extra.emplace_back("operations", operations + "}");
+    result.extra.emplace_back("notFound", JsonNumber(notFound));
+    if (paged) {
+      BufferPoolStats after =
+          static_cast<PagedEngine &>(*kv).GetBufferPool().GetStats();
+      auto hits = static_cast<double>(after.hits - before.hits);
+      auto misses = static_cast<double>(after.misses - before.misses);
+      double hitRatio = hits + misses == 0 ? 1.0 : hits / (hits + misses);
+      result.extra.emplace_back("poolHitRatio", JsonNumber(hitRatio));
+    }
+  }
+  safe_remove(path);
+  return result;
+}
+
+} // namespace
+
+std::vector<BenchResult> RunYcsb(const YcsbConfig &config) {
+  std::vector<BenchResult> results;
+  for (const std::string &engine : config.engines) {
+    Table table = LoadTable(engine, config.records);
+    std::vector<double> ratios = config.poolRatios;
+    if (engine == "lsm") {
+      ratios = {0.0};
+    }
+    for (const Workload &workload : WORKLOADS) {
+      if (config.workloads.find(workload.letter) == std::string::npos) {
+        continue;
+      }
+      for (double ratio : ratios) {
+        for (size_t threads : config.threads) {
+          results.push_back(
+              RunWorkload(table, workload, config, threads, ratio));
+          std::cerr << "  " << results.back().ToText() << "\n";
+        }
+      }
+    }
+    safe_remove(table.templatePath);
+  }
+  return results;
+}
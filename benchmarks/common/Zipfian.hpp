@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <random>
+
+// Zipfian integer generator over [0, items) following Gray et al., "Quickly
+// Generating Billion-Record Synthetic Databases" (the YCSB generator). Item 0
+// is the most popular.
+class ZipfianGenerator {
+public:
+  ZipfianGenerator(uint64_t items, double theta = 0.99, uint64_t seed = 1)
+      : items(items), theta(theta), engine(seed), uniform(0.0, 1.0) {
+    this->zetaN = Zeta(items, theta);
+    double zeta2 = Zeta(2, theta);
+    this->alpha = 1.0 / (1.0 - theta);
+    this->eta = (1.0 - std::pow(2.0 / static_cast<double>(items), 1.0 - theta)) /
+                (1.0 - zeta2 / this->zetaN);
+  }
+
+  uint64_t Next() {
+    double u = this->uniform(this->engine);
+    double uz = u * this->zetaN;
+    if (uz < 1.0) {
+      return 0;
+    }
+    if (uz < 1.0 + std::pow(0.5, this->theta)) {
+      return 1;
+    }
+    auto value = static_cast<uint64_t>(
+        static_cast<double>(this->items) *
+        std::pow(this->eta * u - this->eta + 1.0, this->alpha));
+    return value >= this->items ? this->items - 1 : value;
+  }
+
+private:
+  uint64_t items;
+  double theta;
+  double zetaN;
+  double alpha;
+  double eta;
+  std::mt19937_64 engine;
+  std::uniform_real_distribution<double> uniform;
+
+  static double Zeta(uint64_t n, double theta) {
+    double sum = 0.0;
+    for (uint64_t i = 1; i <= n; ++i) {
+      sum += 1.0 / std::pow(static_cast<double>(i), theta);
+    }
+    return sum;
+  }
+};
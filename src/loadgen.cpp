@@ -0,0 +1,271 @@
+#include "./models/Metrics/LatencyHistogram.hpp"
+#include "./models/Server/Client.hpp"
+#include "./models/Server/Server.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Drives a running server and reports latency against throughput. Each
+// step holds a fixed number of requests in flight on every connection
+// (closed loop), so raising the depth raises throughput until the server
+// saturates, and the latency percentiles show what each step costs.
+// Usage: keyval-loadgen [options]; see print_usage.
+
+struct LoadConfig {
+  std::string host = "127.0.0.1";
+  uint16_t port = 7070;
+  std::string unixPath;
+  size_t connections = 4;
+  std::vector<size_t> depths = {1, 4, 16, 64};
+  double seconds = 2.0;
+  size_t keys = 100000;
+  // Percent of requests that are Gets; the rest are Puts.
+  unsigned readPercent = 90;
+  bool preload = true;
+  bool json = false;
+};
+
+static void print_usage(const char *program) {
+  std::cerr
+      << "usage: " << program << " [options]\n"
+      << "  --host H            server host (default 127.0.0.1)\n"
+      << "  --port N            server port (default 7070)\n"
+      << "  --unix PATH         connect to a Unix socket instead\n"
+      << "  --connections N     connections, one thread each (default 4)\n"
+      << "  --depths LIST       requests in flight per connection, one step\n"
+      << "                      each (default 1,4,16,64)\n"
+      << "  --seconds S         measured time per step (default 2)\n"
+      << "  --keys N            keys read and written (default 100000)\n"
+      << "  --reads PERCENT     share of Gets; the rest are Puts (default "
+         "90)\n"
+      << "  --no-preload        skip writing every key first\n"
+      << "  --json              one JSON object per step instead of a "
+         "table\n";
+}
+
+static std::unique_ptr<KVClient> connect(const LoadConfig &config) {
+  if (!config.unixPath.empty()) {
+    return std::make_unique<KVClient>(config.unixPath);
+  }
+  return std::make_unique<KVClient>(config.host, config.port);
+}
+
+static std::string key_for(uint64_t n) {
+  char key[24];
+  std::snprintf(key, sizeof(key), "key%012llu",
+                static_cast<unsigned long long>(n));
+  return key;
+}
+
+static void preload(const LoadConfig &config) {
+  auto client = connect(config);
+  constexpr size_t BATCH = 256;
+  for (size_t first = 0; first < config.keys; first += BATCH) {
+    size_t last = std::min(config.keys, first + BATCH);
+    for (size_t n = first; n < last; ++n) {
+      client->SendPut(key_for(n), n);
+    }
+    for (size_t n = first; n < last; ++n) {
+      KVResponse response = client->Receive();
+      if (response.status == KVStatus::Error) {
+        throw ServerException(response.error);
+      }
+    }
+  }
+}
+
+struct StepResult {
+  uint64_t completed = 0;
+  uint64_t errors = 0;
+  LatencyHistogram latency;
+};
+
+// One connection's share of a step: keeps `depth` requests in flight until
+// `end`, recording those sent after `measureFrom`.
+static void run_connection(const LoadConfig &config, size_t depth,
+                           uint64_t seed,
+                           std::chrono::steady_clock::time_point measureFrom,
+                           std::chrono::steady_clock::time_point end,
+                           StepResult &result) {
+  auto client = connect(config);
+  std::mt19937_64 eng(seed);
+  std::uniform_int_distribution<uint64_t> pickKey(0, config.keys - 1);
+  std::uniform_int_distribution<unsigned> pickOp(0, 99);
+  // Responses come back in order, so the oldest send time is the one the
+  // next response answers.
+  std::deque<std::chrono::steady_clock::time_point> sent;
+  auto send = [&]() {
+    std::string key = key_for(pickKey(eng));
+    if (pickOp(eng) < config.readPercent) {
+      client->SendGet(key);
+    } else {
+      client->SendPut(key, eng());
+    }
+    sent.push_back(std::chrono::steady_clock::now());
+  };
+
+  for (size_t i = 0; i < depth; ++i) {
+    send();
+  }
+  client->Flush();
+  while (true) {
+    KVResponse response = client->Receive();
+    auto now = std::chrono::steady_clock::now();
+    auto started = sent.front();
+    sent.pop_front();
+    if (started >= measureFrom && now < end) {
+      result.latency.Record(static_cast<uint64_t>(
+          std::chrono::duration_cast<std::chrono::nanoseconds>(now - started)
+              .count()));
+      result.completed++;
+      if (response.status == KVStatus::Error) {
+        result.errors++;
+      }
+    }
+    if (now >= end) {
+      break;
+    }
+    send();
+    client->Flush();
+  }
+  while (!sent.empty()) {
+    client->Receive();
+    sent.pop_front();
+  }
+}
+
+static void run_step(const LoadConfig &config, size_t depth) {
+  auto warmUp = std::chrono::milliseconds(200);
+  auto measured = std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::duration<double>(config.seconds));
+  auto measureFrom = std::chrono::steady_clock::now() + warmUp;
+  auto end = measureFrom + measured;
+
+  std::vector<StepResult> results(config.connections);
+  std::vector<std::thread> threads;
+  std::atomic<bool> failed{false};
+  for (size_t c = 0; c < config.connections; ++c) {
+    threads.emplace_back([&, c]() {
+      try {
+        run_connection(config, depth, c + 1, measureFrom, end, results[c]);
+      } catch (const std::exception &e) {
+        std::cerr << "connection " << c << ": " << e.what() << "\n";
+        failed.store(true);
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+
+  StepResult total;
+  for (const StepResult &result : results) {
+    total.completed += result.completed;
+    total.errors += result.errors;
+    total.latency.Merge(result.latency);
+  }
+  double opsPerSec = static_cast<double>(total.completed) / config.seconds;
+  if (config.json) {
+    std::cout << "{\"connections\":" << config.connections
+              << ",\"depth\":" << depth
+              << ",\"opsPerSec\":" << static_cast<uint64_t>(opsPerSec)
+              << ",\"errors\":" << total.errors
+              << ",\"latencyNs\":" << total.latency.ToJson()
+              << (failed ? ",\"failed\":true" : "") << "}\n";
+    return;
+  }
+  char row[160];
+  std::snprintf(row, sizeof(row), "%6zu %6zu %12.0f %10.1f %10.1f %10.1f%s\n",
+                depth, config.connections * depth, opsPerSec,
+                static_cast<double>(total.latency.Percentile(50)) / 1000.0,
+                static_cast<double>(total.latency.Percentile(99)) / 1000.0,
+                static_cast<double>(total.latency.Percentile(99.9)) / 1000.0,
+                failed ? "  (a connection failed)" : "");
+  std::cout << row << std::flush;
+}
+
+int main(int argc, char **argv) {
+  LoadConfig config;
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    if (arg == "--json") {
+      config.json = true;
+      continue;
+    }
+    if (arg == "--no-preload") {
+      config.preload = false;
+      continue;
+    }
+    if (i + 1 == argc) {
+      print_usage(argv[0]);
+      return 2;
+    }
+    std::string value = argv[++i];
+    if (arg == "--host") {
+      config.host = value;
+    } else if (arg == "--port") {
+      config.port =
+          static_cast<uint16_t>(std::strtoul(value.c_str(), nullptr, 10));
+    } else if (arg == "--unix") {
+      config.unixPath = value;
+    } else if (arg == "--connections") {
+      config.connections = std::strtoull(value.c_str(), nullptr, 10);
+    } else if (arg == "--depths") {
+      config.depths.clear();
+      std::stringstream list(value);
+      std::string item;
+      while (std::getline(list, item, ',')) {
+        config.depths.push_back(std::strtoull(item.c_str(), nullptr, 10));
+      }
+    } else if (arg == "--seconds") {
+      config.seconds = std::strtod(value.c_str(), nullptr);
+    } else if (arg == "--keys") {
+      config.keys = std::strtoull(value.c_str(), nullptr, 10);
+    } else if (arg == "--reads") {
+      config.readPercent =
+          static_cast<unsigned>(std::strtoul(value.c_str(), nullptr, 10));
+    } else {
+      print_usage(argv[0]);
+      return 2;
+    }
+  }
+  bool depthsValid = !config.depths.empty() &&
+                     std::find(config.depths.begin(), config.depths.end(),
+                               0) == config.depths.end();
+  if (config.connections == 0 || !depthsValid || config.keys == 0 ||
+      !(config.seconds > 0) || config.readPercent > 100) {
+    print_usage(argv[0]);
+    return 2;
+  }
+
+  try {
+    if (config.preload) {
+      preload(config);
+    }
+    if (!config.json) {
+      std::cout << "connections=" << config.connections
+                << " keys=" << config.keys << " reads=" << config.readPercent
+                << "% seconds/step=" << config.seconds << "\n"
+                << " depth  inflight      ops/sec    p50(us)    p99(us)  "
+                   "p999(us)\n";
+    }
+    for (size_t depth : config.depths) {
+      run_step(config, depth);
+    }
+  } catch (const std::exception &e) {
+    std::cerr << e.what() << "\n";
+    return 1;
+  }
+  return 0;
+}
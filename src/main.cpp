@@ -1,6 +1,90 @@
+#include "./models/KVEngine/KVEngine.hpp"
+#include "./models/Server/Server.hpp"
+
+#include <pthread.h>
+#include <signal.h>
+
+#include <csignal>
+#include <cstdlib>
 #include <iostream>
+#include <memory>
+#include <string>
+
+// Serves a KV table over TCP and, optionally, a Unix socket until SIGINT or
+// SIGTERM, then closes the table cleanly.
+// Usage: app [--engine paged|lsm] [--path P] [--host H] [--port N]
+//            [--unix PATH] [--reactors N]
+static void print_usage(const char *program) {
+  std::cerr << "usage: " << program
+            << " [--engine paged|lsm] [--path P] [--host H] [--port N]"
+               " [--unix PATH] [--reactors N]\n"
+            << "  --path defaults to keyval.db, or keyval-lsm for lsm;\n"
+            << "  an empty --host serves the Unix socket only\n";
+}
+
+int main(int argc, char **argv) {
+  KVEngineType type = KVEngineType::Paged;
+  std::string path;
+  ServerConfig config;
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    if (i + 1 == argc) {
+      print_usage(argv[0]);
+      return 2;
+    }
+    std::string value = argv[++i];
+    if (arg == "--engine" && (value == "paged" || value == "lsm")) {
+      type = value == "lsm" ? KVEngineType::Lsm : KVEngineType::Paged;
+    } else if (arg == "--path") {
+      path = value;
+    } else if (arg == "--host") {
+      config.host = value;
+    } else if (arg == "--port") {
+      config.port = static_cast<uint16_t>(std::strtoul(value.c_str(),
+                                                       nullptr, 10));
+    } else if (arg == "--unix") {
+      config.unixPath = value;
+    } else if (arg == "--reactors") {
+      config.reactors =
+          static_cast<unsigned>(std::strtoul(value.c_str(), nullptr, 10));
+    } else {
+      print_usage(argv[0]);
+      return 2;
+    }
+  }
+  if (path.empty()) {
+    path = type == KVEngineType::Lsm ? "keyval-lsm" : "keyval.db";
+  }
+
+  // Blocked before any thread starts, so every reactor inherits the mask
+  // and the signals wait for sigwait below.
+  sigset_t signals;
+  sigemptyset(&signals);
+  sigaddset(&signals, SIGINT);
+  sigaddset(&signals, SIGTERM);
+  pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+
+  try {
+    std::unique_ptr<KVEngine> engine = KVEngine::Open(type, path);
+    Server server(*engine, config);
+    server.Start();
+    std::cout << "Serving " << path;
+    if (!config.host.empty()) {
+      std::cout << " on " << config.host << ":" << server.GetPort();
+    }
+    if (!config.unixPath.empty()) {
+      std::cout << " on " << config.unixPath;
+    }
+    std::cout << " with " << server.GetReactorCount() << " reactors"
+              << std::endl;
 
-int main() {
-  std::cout << "Hello, World!" << std::endl;
+    int signal = 0;
+    sigwait(&signals, &signal);
+    std::cout << "Shutting down" << std::endl;
+    server.Stop();
+  } catch (const std::exception &e) {
+    std::cerr << e.what() << "\n";
+    return 1;
+  }
   return 0;
 }
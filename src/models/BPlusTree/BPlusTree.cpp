@@ -0,0 +1,634 @@
+#include "./BPlusTree.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace {
+
+constexpr uint32_t META_MAGIC = 0x4b564254; // "KVBT"
+constexpr size_t KEY_SIZE = BPlusTree::MAX_KEY_SIZE;
+
+struct TreeMeta {
+  uint32_t magic;
+  BlockId root;
+};
+
+// Front of the on-block node layout. Keys are stored as `prefix` (shared by
+// every key in the node) plus a per-slot suffix.
+struct NodeHeader {
+  uint8_t isLeaf;
+  uint8_t prefixLength;
+  uint16_t count;
+  // Leaves: right sibling. Inner nodes: child for keys below the first key.
+  BlockId next;
+  uint64_t reserved;
+  char prefix[KEY_SIZE];
+};
+
+// Bytes each slot takes across the arrays that follow the header.
+constexpr size_t SLOT_BYTES =
+    sizeof(uint32_t) + sizeof(uint8_t) + KEY_SIZE + sizeof(uint64_t);
+
+// A node in a pinned block: the header, then one array per slot field,
+// each `capacity` long. `heads` repeats the first bytes of each suffix in
+// a dense array so binary search mostly touches one cache line per probe.
+struct Node {
+  NodeHeader *header;
+  size_t capacity;
+  // First four suffix bytes, big-endian and zero-padded, so comparing heads
+  // as integers orders keys by their leading bytes.
+  uint32_t *heads;
+  uint8_t *suffixLengths;
+  // `capacity` suffixes of KEY_SIZE bytes each.
+  char *suffixes;
+  // Leaves: values. Inner nodes: child for keys >= the key in this slot.
+  uint64_t *values;
+
+  char *SuffixBytes(size_t slot) const {
+    return this->suffixes + slot * KEY_SIZE;
+  }
+};
+
+// Where the values array starts, rounded up so it is 8-byte aligned.
+size_t ValuesOffset(size_t capacity) {
+  size_t end = sizeof(NodeHeader) +
+               capacity * (sizeof(uint32_t) + sizeof(uint8_t) + KEY_SIZE);
+  return (end + alignof(uint64_t) - 1) & ~(alignof(uint64_t) - 1);
+}
+
+// The most slots a node fits in `payloadSize` bytes.
+size_t NodeCapacity(size_t payloadSize) {
+  size_t capacity = (payloadSize - sizeof(NodeHeader)) / SLOT_BYTES;
+  while (ValuesOffset(capacity) + capacity * sizeof(uint64_t) > payloadSize) {
+    capacity--;
+  }
+  return capacity;
+}
+static_assert(sizeof(NodeHeader) + 4 * SLOT_BYTES <=
+                  DiskManager::MIN_PAYLOAD_SIZE,
+              "A B+Tree node must hold a few keys even in the smallest block");
+
+struct Entry {
+  std::string key;
+  uint64_t value;
+};
+
+Node AsNode(Block *block, size_t capacity) {
+  Node node;
+  node.header = reinterpret_cast<NodeHeader *>(block->data);
+  node.capacity = capacity;
+  node.heads = reinterpret_cast<uint32_t *>(block->data + sizeof(NodeHeader));
+  node.suffixLengths = reinterpret_cast<uint8_t *>(node.heads + capacity);
+  node.suffixes = reinterpret_cast<char *>(node.suffixLengths + capacity);
+  node.values =
+      reinterpret_cast<uint64_t *>(block->data + ValuesOffset(capacity));
+  return node;
+}
+
+TreeMeta *AsMeta(Block *block) {
+  return reinterpret_cast<TreeMeta *>(block->data);
+}
+
+// Optimistic readers may see a node mid-update, so every length read from a
+// node is clamped before use; the version check afterwards discards the
+// result.
+size_t CountOf(const Node &node) {
+  return std::min<size_t>(node.header->count, node.capacity);
+}
+
+std::string_view PrefixOf(const Node &node) {
+  return {node.header->prefix,
+          std::min<size_t>(node.header->prefixLength, KEY_SIZE)};
+}
+
+std::string_view SuffixAt(const Node &node, size_t slot) {
+  return {node.SuffixBytes(slot),
+          std::min<size_t>(node.suffixLengths[slot], KEY_SIZE)};
+}
+
+std::string KeyAt(const Node &node, size_t slot) {
+  std::string key(PrefixOf(node));
+  key.append(SuffixAt(node, slot));
+  return key;
+}
+
+uint32_t HeadOf(std::string_view suffix) {
+  uint32_t head = 0;
+  for (size_t i = 0; i < 4; ++i) {
+    head <<= 8;
+    if (i < suffix.size()) {
+      head |= static_cast<unsigned char>(suffix[i]);
+    }
+  }
+  return head;
+}
+
+// First slot whose key is >= `key`.
+size_t LowerBound(const Node &node, std::string_view key) {
+  size_t count = CountOf(node);
+  std::string_view prefix = PrefixOf(node);
+  if (key.substr(0, prefix.size()) != prefix) {
+    return key < prefix ? 0 : count;
+  }
+
+  std::string_view suffix = key.substr(prefix.size());
+  uint32_t head = HeadOf(suffix);
+  size_t low = 0;
+  size_t high = count;
+  while (low < high) {
+    size_t mid = low + (high - low) / 2;
+    uint32_t midHead = node.heads[mid];
+    if (midHead < head ||
+        (midHead == head && SuffixAt(node, mid) < suffix)) {
+      low = mid + 1;
+    } else {
+      high = mid;
+    }
+  }
+  return low;
+}
+
+bool KeyEquals(const Node &node, size_t slot, std::string_view key) {
+  std::string_view prefix = PrefixOf(node);
+  return key.substr(0, prefix.size()) == prefix &&
+         key.substr(prefix.size()) == SuffixAt(node, slot);
+}
+
+BlockId ChildFor(const Node &node, std::string_view key) {
+  size_t slot = LowerBound(node, key);
+  if (slot < CountOf(node) && KeyEquals(node, slot, key)) {
+    slot++;
+  }
+  return slot == 0 ? node.header->next
+                   : static_cast<BlockId>(node.values[slot - 1]);
+}
+
+void SetSlot(const Node &node, size_t slot, std::string_view suffix,
+             uint64_t value) {
+  node.heads[slot] = HeadOf(suffix);
+  node.suffixLengths[slot] = static_cast<uint8_t>(suffix.size());
+  std::memcpy(node.SuffixBytes(slot), suffix.data(), suffix.size());
+  node.values[slot] = value;
+}
+
+void MoveSlots(const Node &node, size_t from, size_t to, size_t count) {
+  std::memmove(&node.heads[to], &node.heads[from],
+               count * sizeof(node.heads[0]));
+  std::memmove(&node.suffixLengths[to], &node.suffixLengths[from],
+               count * sizeof(node.suffixLengths[0]));
+  std::memmove(node.SuffixBytes(to), node.SuffixBytes(from), count * KEY_SIZE);
+  std::memmove(&node.values[to], &node.values[from],
+               count * sizeof(node.values[0]));
+}
+
+std::vector<Entry> EntriesOf(const Node &node) {
+  std::vector<Entry> entries;
+  entries.reserve(CountOf(node) + 1);
+  for (size_t slot = 0; slot < CountOf(node); ++slot) {
+    entries.push_back(Entry{KeyAt(node, slot), node.values[slot]});
+  }
+  return entries;
+}
+
+// Rewrites `node` to hold entries [first, last) of the sorted `entries`,
+// with the longest prefix they share.
+void FillNode(const Node &node, bool isLeaf, BlockId next,
+              const std::vector<Entry> &entries, size_t first, size_t last) {
+  size_t prefixLength = 0;
+  if (first < last) {
+    const std::string &low = entries[first].key;
+    const std::string &high = entries[last - 1].key;
+    size_t limit = std::min(low.size(), high.size());
+    while (prefixLength < limit && low[prefixLength] == high[prefixLength]) {
+      prefixLength++;
+    }
+  }
+
+  NodeHeader *header = node.header;
+  header->isLeaf = isLeaf ? 1 : 0;
+  header->next = next;
+  header->reserved = 0;
+  header->prefixLength = static_cast<uint8_t>(prefixLength);
+  if (prefixLength > 0) {
+    std::memcpy(header->prefix, entries[first].key.data(), prefixLength);
+  }
+  header->count = static_cast<uint16_t>(last - first);
+  for (size_t i = first; i < last; ++i) {
+    std::string_view key = entries[i].key;
+    SetSlot(node, i - first, key.substr(prefixLength), entries[i].value);
+  }
+}
+
+// Inserts or overwrites `key` in a node the caller holds exclusively and
+// that has room for one more slot.
+void UpsertSlot(const Node &node, std::string_view key, uint64_t value) {
+  NodeHeader *header = node.header;
+  size_t slot = LowerBound(node, key);
+  if (slot < header->count && KeyEquals(node, slot, key)) {
+    node.values[slot] = value;
+    return;
+  }
+
+  std::string_view prefix = PrefixOf(node);
+  if (key.substr(0, prefix.size()) != prefix) {
+    // Rare: the key falls outside the node's current prefix, so rebuild
+    // the node with a shorter one.
+    std::vector<Entry> entries = EntriesOf(node);
+    entries.insert(entries.begin() + static_cast<std::ptrdiff_t>(slot),
+                   Entry{std::string(key), value});
+    FillNode(node, header->isLeaf != 0, header->next, entries, 0,
+             entries.size());
+    return;
+  }
+
+  MoveSlots(node, slot, slot + 1, header->count - slot);
+  SetSlot(node, slot, key.substr(prefix.size()), value);
+  header->count++;
+}
+
+bool ReadLockOrRestart(Block *block, uint64_t &version) {
+  version = block->version.load(std::memory_order_acquire);
+  if ((version & 1) != 0) {
+    std::this_thread::yield();
+    return false;
+  }
+  return true;
+}
+
+bool Validate(Block *block, uint64_t version) {
+  std::atomic_thread_fence(std::memory_order_acquire);
+  return block->version.load(std::memory_order_relaxed) == version;
+}
+
+// Takes the node exclusively if nobody changed it since `version` was read.
+// The block latch is held too, so the pool's flusher never copies a node
+// halfway through an update.
+bool UpgradeToWriteLockOrRestart(Block *block, uint64_t version) {
+  if (!block->version.compare_exchange_strong(version, version + 1,
+                                              std::memory_order_acquire)) {
+    return false;
+  }
+  block->WLatch();
+  return true;
+}
+
+void WriteUnlock(Block *block) {
+  block->WUnlatch();
+  block->version.fetch_add(1, std::memory_order_release);
+}
+
+} // namespace
+
+BPlusTree::BPlusTree(BufferPool &pool, BlockId metaBlockId)
+    : pool(pool), metaBlockId(metaBlockId), metaBlock(nullptr),
+      nodeCapacity(NodeCapacity(pool.GetPayloadSize())) {
+  if (metaBlockId != INVALID_BLOCK_ID) {
+    this->metaGuard = this->pool.FetchPage(metaBlockId);
+    this->metaBlock = this->metaGuard.GetBlock();
+    if (AsMeta(this->metaBlock)->magic != META_MAGIC) {
+      throw BPlusTreeException("Block is not a B+Tree meta block: " +
+                               std::to_string(metaBlockId));
+    }
+    return;
+  }
+
+  this->metaGuard = this->pool.NewPage();
+  this->metaBlock = this->metaGuard.GetBlock();
+  this->metaBlockId = this->metaGuard.GetBlockId();
+  PageGuard root = this->pool.NewPage();
+  FillNode(AsNode(root.GetBlock(), this->nodeCapacity), true,
+           INVALID_BLOCK_ID, {}, 0, 0);
+  root.MarkDirty();
+  AsMeta(this->metaBlock)->magic = META_MAGIC;
+  AsMeta(this->metaBlock)->root = root.GetBlockId();
+  this->metaBlock->isDirty = true;
+}
+
+BPlusTree::~BPlusTree() = default;
+
+BlockId BPlusTree::GetMetaBlockId() const { return this->metaBlockId; }
+
+std::optional<uint64_t> BPlusTree::Get(std::string_view key) {
+  std::optional<uint64_t> result;
+  while (!this->TryGet(key, result)) {
+  }
+  return result;
+}
+
+void BPlusTree::Put(std::string_view key, uint64_t value) {
+  if (key.size() > MAX_KEY_SIZE) {
+    throw BPlusTreeException("Key exceeds " + std::to_string(MAX_KEY_SIZE) +
+                             " bytes: " + std::to_string(key.size()));
+  }
+  while (!this->TryPut(key, value)) {
+  }
+}
+
+bool BPlusTree::Delete(std::string_view key) {
+  bool deleted = false;
+  while (!this->TryDelete(key, deleted)) {
+  }
+  return deleted;
+}
+
+void BPlusTree::Scan(
+    std::string_view startKey,
+    const std::function<bool(std::string_view, uint64_t)> &visit) {
+  // After a restart the scan resumes just past the last key it reported.
+  std::string lowKey(startKey);
+  bool inclusive = true;
+  while (!this->TryScan(lowKey, inclusive, visit)) {
+  }
+}
+
+// Starts an optimistic read of node `id`: the pool's frame for it if the
+// pool can hand it out unpinned, otherwise the node pinned in `guard`.
+// Returns nullptr, to restart, while a writer holds the node.
+Block *BPlusTree::ReadNode(BlockId id, PageGuard &guard, uint64_t &version) {
+  Block *block = this->pool.PeekBlock(id, version);
+  if (block != nullptr) {
+    return block;
+  }
+  guard = this->pool.FetchPage(id);
+  if (!ReadLockOrRestart(guard.GetBlock(), version)) {
+    return nullptr;
+  }
+  return guard.GetBlock();
+}
+
+// Optimistically walks from the root to the leaf covering `key`, pinning
+// only nodes the pool cannot hand out unpinned, and those one at a time in
+// `guard`; each node's version check also catches its frame being reused.
+// On success returns the leaf, `leafId`, read at `version`; nullptr means
+// restart.
+Block *BPlusTree::FindLeaf(std::string_view key, PageGuard &guard,
+                           BlockId &leafId, uint64_t &version) {
+  uint64_t metaVersion;
+  if (!ReadLockOrRestart(this->metaBlock, metaVersion)) {
+    return nullptr;
+  }
+  BlockId nodeId = AsMeta(this->metaBlock)->root;
+  if (!Validate(this->metaBlock, metaVersion)) {
+    return nullptr;
+  }
+  Block *node = this->ReadNode(nodeId, guard, version);
+  if (node == nullptr || !Validate(this->metaBlock, metaVersion)) {
+    return nullptr;
+  }
+
+  while (true) {
+    Node current = AsNode(node, this->nodeCapacity);
+    bool isLeaf = current.header->isLeaf != 0;
+    BlockId childId = isLeaf ? INVALID_BLOCK_ID : ChildFor(current, key);
+    if (!Validate(node, version)) {
+      return nullptr;
+    }
+    if (isLeaf) {
+      leafId = nodeId;
+      return node;
+    }
+
+    uint64_t childVersion;
+    Block *child = this->ReadNode(childId, guard, childVersion);
+    if (child == nullptr || !Validate(node, version)) {
+      return nullptr;
+    }
+    node = child;
+    nodeId = childId;
+    version = childVersion;
+  }
+}
+
+// FindLeaf for callers that go on to lock the leaf or follow its sibling
+// link: on success `node` is the pinned leaf and `version` the version it
+// was read at.
+bool BPlusTree::DescendToLeaf(std::string_view key, PageGuard &node,
+                              uint64_t &version) {
+  BlockId leafId;
+  Block *leaf = this->FindLeaf(key, node, leafId, version);
+  if (leaf == nullptr) {
+    return false;
+  }
+  if (node.GetBlock() != leaf) {
+    node = this->pool.FetchPage(leafId);
+    if (node.GetBlock() != leaf || !Validate(leaf, version)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool BPlusTree::TryGet(std::string_view key,
+                       std::optional<uint64_t> &result) {
+  PageGuard guard;
+  BlockId leafId;
+  uint64_t version;
+  Block *leaf = this->FindLeaf(key, guard, leafId, version);
+  if (leaf == nullptr) {
+    return false;
+  }
+
+  Node node = AsNode(leaf, this->nodeCapacity);
+  size_t slot = LowerBound(node, key);
+  bool found = slot < CountOf(node) && KeyEquals(node, slot, key);
+  uint64_t value = found ? node.values[slot] : 0;
+  if (!Validate(leaf, version)) {
+    return false;
+  }
+  result = found ? std::optional<uint64_t>(value) : std::nullopt;
+  return true;
+}
+
+bool BPlusTree::TryPut(std::string_view key, uint64_t value) {
+  // `parent` stays empty while the parent is the meta block.
+  PageGuard parent;
+  Block *parentBlock = this->metaBlock;
+  uint64_t parentVersion;
+  if (!ReadLockOrRestart(parentBlock, parentVersion)) {
+    return false;
+  }
+  BlockId rootId = AsMeta(parentBlock)->root;
+  if (!Validate(parentBlock, parentVersion)) {
+    return false;
+  }
+  PageGuard node = this->pool.FetchPage(rootId);
+  uint64_t version;
+  if (!ReadLockOrRestart(node.GetBlock(), version) ||
+      !Validate(parentBlock, parentVersion)) {
+    return false;
+  }
+
+  while (true) {
+    Node current = AsNode(node.GetBlock(), this->nodeCapacity);
+    bool isLeaf = current.header->isLeaf != 0;
+    bool isFull = current.header->count >= this->nodeCapacity;
+    if (!Validate(node.GetBlock(), version)) {
+      return false;
+    }
+
+    if (isFull) {
+      // Split eagerly, then retry from the root with the new shape.
+      if (!UpgradeToWriteLockOrRestart(parentBlock, parentVersion)) {
+        return false;
+      }
+      if (!UpgradeToWriteLockOrRestart(node.GetBlock(), version)) {
+        WriteUnlock(parentBlock);
+        return false;
+      }
+      try {
+        this->SplitChild(parent, node);
+      } catch (...) {
+        WriteUnlock(node.GetBlock());
+        WriteUnlock(parentBlock);
+        throw;
+      }
+      WriteUnlock(node.GetBlock());
+      WriteUnlock(parentBlock);
+      return false;
+    }
+
+    if (isLeaf) {
+      if (!UpgradeToWriteLockOrRestart(node.GetBlock(), version)) {
+        return false;
+      }
+      if (!Validate(parentBlock, parentVersion)) {
+        WriteUnlock(node.GetBlock());
+        return false;
+      }
+      UpsertSlot(current, key, value);
+      node.MarkDirty();
+      WriteUnlock(node.GetBlock());
+      return true;
+    }
+
+    BlockId childId = ChildFor(current, key);
+    if (!Validate(node.GetBlock(), version)) {
+      return false;
+    }
+    PageGuard child = this->pool.FetchPage(childId);
+    uint64_t childVersion;
+    if (!ReadLockOrRestart(child.GetBlock(), childVersion) ||
+        !Validate(node.GetBlock(), version)) {
+      return false;
+    }
+    parent = std::move(node);
+    parentBlock = parent.GetBlock();
+    parentVersion = version;
+    node = std::move(child);
+    version = childVersion;
+  }
+}
+
+// Splits the full `node` in half. Both it and its parent are write-locked;
+// `parent` is empty when the parent is the meta block.
+void BPlusTree::SplitChild(PageGuard &parent, PageGuard &node) {
+  Node left = AsNode(node.GetBlock(), this->nodeCapacity);
+  bool isLeaf = left.header->isLeaf != 0;
+  std::vector<Entry> entries = EntriesOf(left);
+  size_t mid = entries.size() / 2;
+
+  PageGuard rightNode = this->pool.NewPage();
+  rightNode.MarkDirty();
+  Node right = AsNode(rightNode.GetBlock(), this->nodeCapacity);
+  std::string separator = entries[mid].key;
+
+  if (isLeaf) {
+    // The separator stays in the right leaf as its first key.
+    FillNode(right, true, left.header->next, entries, mid, entries.size());
+    FillNode(left, true, rightNode.GetBlockId(), entries, 0, mid);
+  } else {
+    // The separator moves up; its child becomes the right node's leftmost.
+    FillNode(right, false, static_cast<BlockId>(entries[mid].value), entries,
+             mid + 1, entries.size());
+    FillNode(left, false, left.header->next, entries, 0, mid);
+  }
+  node.MarkDirty();
+
+  if (!parent.IsValid()) {
+    PageGuard rootNode = this->pool.NewPage();
+    rootNode.MarkDirty();
+    std::vector<Entry> rootEntries{Entry{separator, rightNode.GetBlockId()}};
+    FillNode(AsNode(rootNode.GetBlock(), this->nodeCapacity), false,
+             node.GetBlockId(), rootEntries, 0, 1);
+    AsMeta(this->metaBlock)->root = rootNode.GetBlockId();
+    this->metaBlock->isDirty = true;
+  } else {
+    UpsertSlot(AsNode(parent.GetBlock(), this->nodeCapacity), separator,
+               rightNode.GetBlockId());
+    parent.MarkDirty();
+  }
+}
+
+bool BPlusTree::TryDelete(std::string_view key, bool &deleted) {
+  PageGuard leaf;
+  uint64_t version;
+  if (!this->DescendToLeaf(key, leaf, version)) {
+    return false;
+  }
+  if (!UpgradeToWriteLockOrRestart(leaf.GetBlock(), version)) {
+    return false;
+  }
+
+  // Holding the leaf's version since the descent also proves it still
+  // covers `key`: any split that moved keys out of it bumped the version.
+  Node node = AsNode(leaf.GetBlock(), this->nodeCapacity);
+  size_t slot = LowerBound(node, key);
+  deleted = slot < node.header->count && KeyEquals(node, slot, key);
+  if (deleted) {
+    MoveSlots(node, slot + 1, slot, node.header->count - slot - 1);
+    node.header->count--;
+    leaf.MarkDirty();
+  }
+  WriteUnlock(leaf.GetBlock());
+  return true;
+}
+
+bool BPlusTree::TryScan(
+    std::string &lowKey, bool &inclusive,
+    const std::function<bool(std::string_view, uint64_t)> &visit) {
+  PageGuard leaf;
+  uint64_t version;
+  if (!this->DescendToLeaf(lowKey, leaf, version)) {
+    return false;
+  }
+
+  std::vector<Entry> batch;
+  while (true) {
+    Node node = AsNode(leaf.GetBlock(), this->nodeCapacity);
+    size_t slot = LowerBound(node, lowKey);
+    if (!inclusive && slot < CountOf(node) && KeyEquals(node, slot, lowKey)) {
+      slot++;
+    }
+    batch.clear();
+    for (; slot < CountOf(node); ++slot) {
+      batch.push_back(Entry{KeyAt(node, slot), node.values[slot]});
+    }
+    BlockId next = node.header->next;
+    if (!Validate(leaf.GetBlock(), version)) {
+      return false;
+    }
+
+    for (const Entry &entry : batch) {
+      lowKey = entry.key;
+      inclusive = false;
+      if (!visit(entry.key, entry.value)) {
+        return true;
+      }
+    }
+    if (next == INVALID_BLOCK_ID) {
+      return true;
+    }
+
+    PageGuard sibling = this->pool.FetchPage(next);
+    uint64_t siblingVersion;
+    if (!ReadLockOrRestart(sibling.GetBlock(), siblingVersion) ||
+        !Validate(leaf.GetBlock(), version)) {
+      return false;
+    }
+    leaf = std::move(sibling);
+    version = siblingVersion;
+  }
+}
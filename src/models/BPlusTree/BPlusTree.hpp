@@ -0,0 +1,76 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+#include "../../types/Constants.hpp"
+#include "../Block/Block.hpp"
+#include "../BufferPool/BufferPool.hpp"
+#include "../Index/Index.hpp"
+
+class BPlusTreeException : public std::runtime_error {
+public:
+  explicit BPlusTreeException(const std::string &message)
+      : std::runtime_error(message) {}
+};
+
+// Ordered Index. Every node is a Block fetched through the BufferPool, and
+// leaves are chained left to right for range scans.
+//
+// Concurrency is optimistic lock coupling (Leis et al.) on Block::version:
+// readers never latch a node, they validate its version after reading it
+// and restart from the root if a writer got in between. Lookups do not
+// even pin the nodes the pool can hand out unpinned (BufferPool::PeekBlock).
+// Writers lock only the nodes they modify. Full nodes are split on the way
+// down, so a split never has to climb past the parent it already holds.
+//
+// Nodes are not merged: Delete leaves underfull nodes in place. A node holds
+// as many keys as the pool's block payload fits, so larger blocks make
+// wider, shallower trees.
+class BPlusTree : public Index {
+public:
+  // Creates an empty tree in `pool`, or opens the tree whose meta block is
+  // `metaBlockId`. The meta block stays pinned for the tree's lifetime.
+  explicit BPlusTree(BufferPool &pool,
+                     BlockId metaBlockId = INVALID_BLOCK_ID);
+  ~BPlusTree() override;
+
+  BPlusTree(const BPlusTree &) = delete;
+  BPlusTree &operator=(const BPlusTree &) = delete;
+  BPlusTree(BPlusTree &&) = delete;
+  BPlusTree &operator=(BPlusTree &&) = delete;
+
+  BlockId GetMetaBlockId() const override;
+
+  std::optional<uint64_t> Get(std::string_view key) override;
+  void Put(std::string_view key, uint64_t value) override;
+  bool Delete(std::string_view key) override;
+  // Visits keys >= `startKey` in order until `visit` returns false.
+  void Scan(std::string_view startKey,
+            const std::function<bool(std::string_view, uint64_t)> &visit);
+
+private:
+  BufferPool &pool;
+  BlockId metaBlockId;
+  PageGuard metaGuard;
+  Block *metaBlock;
+  // Slots per node, from the pool's payload size.
+  size_t nodeCapacity;
+
+  bool TryGet(std::string_view key, std::optional<uint64_t> &result);
+  bool TryPut(std::string_view key, uint64_t value);
+  bool TryDelete(std::string_view key, bool &deleted);
+  bool TryScan(std::string &lowKey, bool &inclusive,
+               const std::function<bool(std::string_view, uint64_t)> &visit);
+
+  Block *ReadNode(BlockId id, PageGuard &guard, uint64_t &version);
+  Block *FindLeaf(std::string_view key, PageGuard &guard, BlockId &leafId,
+                  uint64_t &version);
+  bool DescendToLeaf(std::string_view key, PageGuard &node,
+                     uint64_t &version);
+  void SplitChild(PageGuard &parent, PageGuard &node);
+};
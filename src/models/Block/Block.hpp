@@ -1,20 +1,52 @@
 #pragma once
 #include "../../types/Constants.hpp"
-#include <cstring>
+#include <atomic>
+#include <shared_mutex>
 
-class Block {
+// Descriptor for one BufferPool frame. The block's bytes live elsewhere:
+// in the pool's frame arena, or in the DiskManager's mapping of the file
+// when the block was served from it. Descriptors are cache-line aligned so
+// pins on neighbouring frames do not share a line.
+class alignas(64) Block {
 public:
-  char data[BLOCK_SIZE];
+  char *data;
   BlockId block_id;
-  int referenceCount;
-  bool isDirty;
+  std::atomic<int> referenceCount;
+  std::atomic<bool> isDirty;
+  // Set while the frame is being filled from disk; pinning threads wait on
+  // it before touching `data`.
+  std::atomic<bool> isLoading;
+  // LSN of the last log record describing a change to `data`. Whoever
+  // modifies the block sets it under the write latch; the pool flushes the
+  // log up to it before writing the block (the write-ahead rule).
+  std::atomic<LSN> pageLSN;
+  // Optimistic latch for index nodes: odd while a writer holds the node,
+  // and while the frame holds no loaded block. Readers remember the value,
+  // read without latching and retry if it has moved. Never reset, so it
+  // keeps counting across frame reuse.
+  std::atomic<uint64_t> version;
+  // Set when the pool writes the block back and clears isDirty, so that at
+  // eviction it still knows `data` changed while the frame held the block.
+  std::atomic<bool> wasCleaned;
 
-  Block() : block_id(0), referenceCount(0), isDirty(false) {
-    std::memset(data, 0, BLOCK_SIZE);
-  }
+  Block()
+      : data(nullptr), block_id(0), referenceCount(0), isDirty(false),
+        isLoading(false), pageLSN(INVALID_LSN), version(0),
+        wasCleaned(false) {}
 
   Block(const Block &) = delete;
   Block &operator=(const Block &) = delete;
   Block(Block &&) = delete;
   Block &operator=(Block &&) = delete;
-};
\ No newline at end of file
+
+  // Reader/writer latch over `data`. The pool only pins frames; threads that
+  // share a block take the latch while they read or modify it, and only
+  // while they hold a pin.
+  void RLatch() { this->latch.lock_shared(); }
+  void RUnlatch() { this->latch.unlock_shared(); }
+  void WLatch() { this->latch.lock(); }
+  void WUnlatch() { this->latch.unlock(); }
+
+private:
+  std::shared_mutex latch;
+};
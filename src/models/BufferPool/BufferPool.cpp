@@ -1,147 +1,899 @@
 #include "./BufferPool.hpp"
+#include <algorithm>
+#include <bit>
 #include <cstring>
+#include <unistd.h>
 
 BufferPool::BufferPool(size_t poolSize,
-                       std::unique_ptr<DiskManager> diskManager)
-    : poolSize(poolSize), diskManager(std::move(diskManager)), pool(poolSize),
-      isFree(poolSize, true) {}
+                       std::unique_ptr<DiskManager> diskManager,
+                       const BufferPoolConfig &config,
+                       LogManager *logManager)
+    : poolSize(poolSize), config(config), diskManager(std::move(diskManager)),
+      logManager(logManager),
+      arena(poolSize, config.hugePageFrames,
+            this->diskManager->GetBlockSize()),
+      pool(poolSize),
+      pageTable(config.shardCount == 0 ? 1 : config.shardCount),
+      frameHintMask(std::bit_ceil(poolSize) * 2 - 1),
+      frameHints(std::make_unique<std::atomic<uint64_t>[]>(frameHintMask + 1)),
+      replacer(Replacer::Create(config.replacerPolicy, poolSize)),
+      freeFrames(poolSize), dirtyHint(0), pagesFlushed(0), dirtyEvictions(0),
+      checkpoints(0), flushRate(0.0), flusherStopping(false),
+      flushRequested(false), prefetchesInFlight(0),
+      fetchTimingMask(config.fetchTimingInterval == 0
+                          ? UINT64_MAX
+                          : std::bit_ceil(config.fetchTimingInterval) - 1) {
+  // Popped from the back, so frame 0 is handed out first. No frame holds a
+  // block yet, so every version starts odd.
+  for (size_t i = 0; i < poolSize; ++i) {
+    this->freeFrames[i] = poolSize - 1 - i;
+    this->pool[i].data = this->arena.Frame(i);
+    this->pool[i].version.store(1, std::memory_order_relaxed);
+  }
+  for (size_t i = 0; i <= this->frameHintMask; ++i) {
+    this->frameHints[i].store(uint64_t{INVALID_BLOCK_ID} << 32,
+                              std::memory_order_relaxed);
+  }
+  this->diskManager->RegisterBuffers(
+      {iovec{this->arena.Data(), this->arena.Size()}});
+
+  if (this->config.backgroundFlush) {
+    this->flusher = std::thread(&BufferPool::FlusherLoop, this);
+  }
+}
+
+BufferPool::~BufferPool() {
+  if (this->flusher.joinable()) {
+    {
+      std::lock_guard<std::mutex> lock(this->flusherMutex);
+      this->flusherStopping = true;
+    }
+    this->flusherWakeup.notify_all();
+    this->flusher.join();
+  }
+  this->WaitForPrefetches();
+  this->FlushAllBlocks();
+}
+
+size_t BufferPool::FramesForMemory(size_t bytes, size_t blockSize) {
+  // Page, descriptor, and roughly a page-table node plus replacer state.
+  size_t frameBytes = blockSize + sizeof(Block) + 64;
+  return bytes / frameBytes;
+}
+
+size_t BufferPool::FramesForPhysicalMemory(double fraction,
+                                           size_t blockSize) {
+  long pages = ::sysconf(_SC_PHYS_PAGES);
+  long pageSize = ::sysconf(_SC_PAGE_SIZE);
+  if (pages <= 0 || pageSize <= 0 || fraction <= 0) {
+    return 0;
+  }
+  double bytes = static_cast<double>(pages) * static_cast<double>(pageSize) *
+                 std::min(fraction, 1.0);
+  return FramesForMemory(static_cast<size_t>(bytes), blockSize);
+}
 
-BufferPool::~BufferPool() { this->FlushAllBlocks(); }
+size_t BufferPool::GetBlockSize() const { return this->arena.FrameSize(); }
+
+size_t BufferPool::GetPayloadSize() const {
+  return this->diskManager->GetPayloadSize();
+}
 
 Block *BufferPool::FetchBlock(BlockId blockId) {
-  auto tableEntry = this->blockTable.find(blockId);
-  if (tableEntry != this->blockTable.end()) {
-    size_t frameId = tableEntry->second;
-    Block *block = &this->pool[frameId];
-    block->referenceCount++;
-    this->RemoveFromEvictionList(frameId);
-    this->evictionList.push_back(frameId);
-    this->evictionListFrameIndices[frameId] = --this->evictionList.end();
-    return block;
+  PageTableShard &shard = this->ShardFor(blockId);
+
+  // Every fetch is counted. A sampled fetch is timed from here, with the
+  // weight of the fetches it stands for; a miss that was not sampled from
+  // when it finds the block missing.
+  PoolCounters *counters = nullptr;
+  uint64_t start = 0;
+  uint64_t weight = 1;
+  if (this->config.metrics) {
+    counters = &this->counters.Local();
+    if ((++counters->fetches & this->fetchTimingMask) == 0) {
+      start = NowNanos();
+      weight = this->fetchTimingMask + 1;
+    }
   }
 
-  size_t frameId = this->FindFreeOrEvictFrame();
-  this->PrepareFrameForReuse(frameId);
-  Block *block = &this->pool[frameId];
-  this->diskManager->ReadBlock(blockId, block->data);
-  block->block_id = blockId;
-  block->referenceCount = 1;
-  block->isDirty = false;
-  this->blockTable[blockId] = frameId;
-  this->MarkFrameInUse(frameId);
-  return block;
+  while (true) {
+    size_t frameId = this->PinIfResident(shard, blockId);
+
+    if (frameId == NO_FRAME) {
+      if (counters != nullptr && start == 0) {
+        start = NowNanos();
+      }
+      std::unique_lock<std::mutex> frameLock(this->frameMutex);
+      std::unique_lock<std::mutex> shardLock(shard.mutex);
+
+      auto tableEntry = shard.blocks.find(blockId);
+      if (tableEntry != shard.blocks.end()) {
+        // Another miss loaded it while we waited for the frame mutex.
+        frameId = tableEntry->second;
+        this->pool[frameId].referenceCount++;
+      } else {
+        frameId = this->FindFreeOrEvictFrame(frameLock, shardLock);
+        if (frameId == NO_FRAME) {
+          // The locks were dropped to write back a victim; look again.
+          continue;
+        }
+        this->PrepareFrameForReuse(frameId);
+        Block *block = &this->pool[frameId];
+        char *mapped = this->diskManager->MappedBlock(blockId);
+        if (mapped != nullptr) {
+          block->data = mapped;
+        }
+        block->block_id = blockId;
+        block->referenceCount = 1;
+        block->isDirty = false;
+        block->isLoading = true;
+        shard.blocks[blockId] = frameId;
+        this->MarkFrameInUse(frameId, blockId);
+        shardLock.unlock();
+        frameLock.unlock();
+
+        try {
+          if (mapped == nullptr) {
+            this->diskManager->ReadBlock(blockId, block->data);
+          } else {
+            // Mapped blocks skip ReadBlock, so verify them here.
+            this->diskManager->VerifyBlock(blockId, mapped);
+          }
+        } catch (...) {
+          this->AbandonFrame(frameId, blockId);
+          throw;
+        }
+        this->MarkFrameReady(frameId);
+        block->isLoading.store(false, std::memory_order_release);
+        block->isLoading.notify_all();
+        this->RecordFetch(counters, false, start, 1);
+        this->ReadAheadIfSequential(blockId);
+        return block;
+      }
+    }
+
+    Block *block = this->CompleteHit(frameId);
+    if (block->block_id == blockId) {
+      this->RecordFetch(counters, true, start, weight);
+      this->ReadAheadIfSequential(blockId);
+      return block;
+    }
+
+    // The thread loading this frame failed; drop our pin and retry the read.
+    block->referenceCount--;
+  }
 }
 
-Block *BufferPool::NewBlock() {
-  BlockId newBlockId = this->diskManager->AllocateBlock();
-  size_t frameId = this->FindFreeOrEvictFrame();
+Block *BufferPool::NewBlock(BlockId hint) {
+  BlockId newBlockId = this->diskManager->AllocateBlock(hint);
+  PageTableShard &shard = this->ShardFor(newBlockId);
+
+  std::unique_lock<std::mutex> frameLock(this->frameMutex);
+  std::unique_lock<std::mutex> shardLock(shard.mutex);
+  // Nothing else maps a block this call just allocated, so there is
+  // nothing to re-check when the locks were dropped for a write-back.
+  size_t frameId = NO_FRAME;
+  while (frameId == NO_FRAME) {
+    frameId = this->FindFreeOrEvictFrame(frameLock, shardLock);
+  }
   this->PrepareFrameForReuse(frameId);
 
+  // Only a brand-new block needs zeroing; a fetched frame is overwritten by
+  // the disk read.
   Block *block = &this->pool[frameId];
+  std::memset(block->data, 0, this->arena.FrameSize());
   block->block_id = newBlockId;
   block->referenceCount = 1;
   block->isDirty = false;
-  this->blockTable[newBlockId] = frameId;
-  this->MarkFrameInUse(frameId);
+  shard.blocks[newBlockId] = frameId;
+  this->MarkFrameInUse(frameId, newBlockId);
+  this->MarkFrameReady(frameId);
   return block;
 }
 
 void BufferPool::ReleaseBlock(BlockId blockId, bool isDirty) {
-  if (this->blockTable.find(blockId) == this->blockTable.end()) {
+  PageTableShard &shard = this->ShardFor(blockId);
+  std::unique_lock<std::mutex> shardLock(shard.mutex);
+
+  auto tableEntry = shard.blocks.find(blockId);
+  if (tableEntry == shard.blocks.end()) {
     throw BufferPoolException("Attempting to release block not in pool: " +
                               std::to_string(blockId));
   }
 
-  size_t frameId = this->blockTable[blockId];
-  Block *block = &this->pool[frameId];
-
-  block->referenceCount--;
-
-  if (block->referenceCount < 0) {
+  size_t frameId = tableEntry->second;
+  if (this->pool[frameId].referenceCount <= 0) {
     throw BufferPoolException("Reference count went negative for block: " +
                               std::to_string(blockId));
   }
+  shardLock.unlock();
 
-  if (isDirty) {
-    block->isDirty = true;
-  }
+  this->UnpinFrame(frameId, isDirty);
 }
 
-void BufferPool::FlushBlock(BlockId blockId) {
-  if (this->blockTable.find(blockId) == this->blockTable.end()) {
-    return;
+void BufferPool::DeleteBlock(BlockId blockId) {
+  PageTableShard &shard = this->ShardFor(blockId);
+  {
+    std::lock_guard<std::mutex> frameLock(this->frameMutex);
+    std::lock_guard<std::mutex> shardLock(shard.mutex);
+    auto tableEntry = shard.blocks.find(blockId);
+    if (tableEntry != shard.blocks.end()) {
+      size_t frameId = tableEntry->second;
+      Block *block = &this->pool[frameId];
+      if (block->referenceCount != 0) {
+        throw BufferPoolException("Attempting to delete pinned block: " +
+                                  std::to_string(blockId));
+      }
+      // Discard any private copy left in the file mapping, or it would
+      // shadow whatever the block holds once it is reused.
+      if (block->data != this->arena.Frame(frameId)) {
+        this->diskManager->DropMappedBlock(blockId);
+      }
+
+      // As with an abandoned load, the frame stays with the replacer and is
+      // recycled as a victim that needs no write.
+      shard.blocks.erase(tableEntry);
+      this->MarkFrameEmpty(frameId);
+      block->data = this->arena.Frame(frameId);
+      block->block_id = INVALID_BLOCK_ID;
+      block->isDirty = false;
+    }
   }
+  this->diskManager->DeallocateBlock(blockId);
+}
+
+PageGuard BufferPool::FetchPage(BlockId blockId) {
+  Block *block = this->FetchBlock(blockId);
+  return PageGuard(this, block, this->FrameOf(block));
+}
+
+ReadPageGuard BufferPool::FetchPageRead(BlockId blockId) {
+  return this->FetchPage(blockId).UpgradeRead();
+}
 
-  size_t frameId = this->blockTable[blockId];
+WritePageGuard BufferPool::FetchPageWrite(BlockId blockId) {
+  return this->FetchPage(blockId).UpgradeWrite();
+}
+
+PageGuard BufferPool::NewPage(BlockId hint) {
+  Block *block = this->NewBlock(hint);
+  return PageGuard(this, block, this->FrameOf(block));
+}
+
+size_t BufferPool::FrameOf(const Block *block) const {
+  return static_cast<size_t>(block - this->pool.data());
+}
+
+// The caller holds a pin on `frameId`, so the frame cannot be remapped
+// under it and no page-table lookup is needed.
+void BufferPool::UnpinFrame(size_t frameId, bool isDirty) {
   Block *block = &this->pool[frameId];
 
-  if (!block->isDirty) {
+  // Mark dirty before unpinning so an evictor never sees an unpinned frame
+  // with unsaved changes.
+  bool becameDirty = isDirty && !block->isDirty.exchange(true);
+  block->referenceCount--;
+
+  if (becameDirty && this->flusher.joinable() &&
+      static_cast<double>(++this->dirtyHint) >
+          this->config.dirtyRatioThreshold *
+              static_cast<double>(this->poolSize)) {
+    {
+      std::lock_guard<std::mutex> lock(this->flusherMutex);
+      this->flushRequested = true;
+    }
+    this->flusherWakeup.notify_one();
+  }
+}
+
+void BufferPool::FlushBlock(BlockId blockId) {
+  PageTableShard &shard = this->ShardFor(blockId);
+  size_t frameId = this->PinIfResident(shard, blockId);
+  if (frameId == NO_FRAME) {
     return;
   }
 
-  this->diskManager->WriteBlock(blockId, block->data);
+  // The pin keeps the frame from being evicted while the write runs outside
+  // the shard lock.
+  Block *block = &this->pool[frameId];
+  try {
+    this->WriteBackPinned(block);
+  } catch (...) {
+    block->referenceCount--;
+    throw;
+  }
+  block->referenceCount--;
+}
 
-  block->isDirty = false;
+bool BufferPool::WriteBackPinned(Block *block) {
+  // As in FlushDirtyFrames, the page is copied under the read latch so a
+  // concurrent writer cannot tear the image written.
+  thread_local std::vector<char> copy;
+  copy.resize(this->arena.FrameSize());
+  block->RLatch();
+  bool wasDirty = !block->isLoading && block->isDirty.exchange(false);
+  LSN pageLSN = block->pageLSN;
+  BlockId blockId = block->block_id;
+  if (wasDirty) {
+    std::memcpy(copy.data(), block->data, copy.size());
+  }
+  block->RUnlatch();
+  if (!wasDirty) {
+    return false;
+  }
+  try {
+    this->FlushLogUpTo(pageLSN);
+    this->diskManager->WriteBlock(blockId, copy.data());
+  } catch (...) {
+    block->isDirty = true;
+    throw;
+  }
+  block->wasCleaned = true;
+  return true;
 }
 
 void BufferPool::FlushAllBlocks() {
-  for (const auto &entry : this->blockTable) {
-    BlockId blockId = entry.first;
+  std::vector<BlockId> blockIds;
+  for (auto &shard : this->pageTable) {
+    std::lock_guard<std::mutex> shardLock(shard.mutex);
+    for (const auto &entry : shard.blocks) {
+      blockIds.push_back(entry.first);
+    }
+  }
+
+  for (BlockId blockId : blockIds) {
     this->FlushBlock(blockId);
   }
 
   this->diskManager->SyncFile();
 }
 
-size_t BufferPool::FindFreeOrEvictFrame() {
-  for (size_t i = 0; i < this->poolSize; ++i) {
-    if (this->isFree[i]) {
-      return i;
+size_t BufferPool::PrefetchBlocks(BlockId first, size_t count) {
+  BlockId blockCount = this->diskManager->GetBlockCount();
+  if (first >= blockCount) {
+    return 0;
+  }
+  BlockId end = static_cast<BlockId>(
+      first + std::min<size_t>(count, blockCount - first));
+
+  std::vector<BlockIORequest> batch;
+  for (BlockId blockId = first; blockId < end; ++blockId) {
+    PageTableShard &shard = this->ShardFor(blockId);
+    std::unique_lock<std::mutex> frameLock(this->frameMutex);
+    std::unique_lock<std::mutex> shardLock(shard.mutex);
+
+    size_t frameId = NO_FRAME;
+    try {
+      while (frameId == NO_FRAME && shard.blocks.count(blockId) == 0) {
+        frameId = this->FindFreeOrEvictFrame(frameLock, shardLock);
+      }
+    } catch (const std::exception &) {
+      // Only a hint: stop at the first frame we cannot get. A victim whose
+      // write failed stays dirty and resurfaces on the next miss.
+      break;
+    }
+    if (frameId == NO_FRAME) {
+      continue;
     }
+    this->PrepareFrameForReuse(frameId);
+
+    // The loader's pin keeps the frame out of eviction until the read
+    // completes; fetches of the block wait on isLoading as for any miss.
+    Block *block = &this->pool[frameId];
+    block->block_id = blockId;
+    block->referenceCount = 1;
+    block->isDirty = false;
+    block->isLoading = true;
+    shard.blocks[blockId] = frameId;
+    this->replacer->RecordPrefetch(frameId, blockId);
+
+    this->prefetchesInFlight++;
+    batch.push_back(BlockIORequest{
+        IOOperation::Read, blockId, block->data,
+        [this, frameId, blockId](int result) {
+          this->CompletePrefetch(frameId, blockId, result);
+        }});
+  }
+
+  if (batch.empty()) {
+    return 0;
+  }
+  size_t issued = batch.size();
+  try {
+    this->diskManager->SubmitBatch(batch);
+  } catch (...) {
+    for (auto &request : batch) {
+      if (request.callback) {
+        request.callback(-EIO);
+      }
+    }
+    throw;
+  }
+  return issued;
+}
+
+void BufferPool::WaitForPrefetches() {
+  for (size_t left = this->prefetchesInFlight.load(); left != 0;
+       left = this->prefetchesInFlight.load()) {
+    this->prefetchesInFlight.wait(left);
   }
+}
 
-  for (auto it = this->evictionList.begin(); it != this->evictionList.end();
-       ++it) {
-    auto frameId = *it;
+size_t BufferPool::Checkpoint() {
+  size_t written = this->FlushDirtyFrames(true);
+  this->diskManager->SyncFile();
+  this->checkpoints++;
+  return written;
+}
+
+BufferPoolFlushStats BufferPool::GetFlushStats() {
+  return BufferPoolFlushStats{this->CountDirtyFrames(), this->pagesFlushed,
+                              this->flushRate, this->dirtyEvictions,
+                              this->checkpoints};
+}
+
+BufferPoolStats BufferPool::GetStats() const {
+  BufferPoolStats stats;
+  this->counters.ForEach([&stats](const PoolCounters &counters) {
+    stats.hits += counters.hits.load(std::memory_order_relaxed);
+    stats.misses += counters.misses.load(std::memory_order_relaxed);
+    stats.cleanEvictions +=
+        counters.cleanEvictions.load(std::memory_order_relaxed);
+    stats.dirtyEvictions +=
+        counters.dirtyEvictions.load(std::memory_order_relaxed);
+    stats.pinWaits += counters.pinWaits.load(std::memory_order_relaxed);
+    stats.pinWaitNanos += counters.pinWaitNanos.load(std::memory_order_relaxed);
+    counters.fetchLatency.AddTo(stats.fetchLatency);
+  });
+  stats.evictions = stats.cleanEvictions + stats.dirtyEvictions;
+  stats.disk = this->diskManager->GetStats();
+  return stats;
+}
+
+std::string BufferPoolStats::ToText() const {
+  return "pool.hits " + std::to_string(this->hits) + "\npool.misses " +
+         std::to_string(this->misses) + "\npool.evictions " +
+         std::to_string(this->evictions) + "\npool.clean_evictions " +
+         std::to_string(this->cleanEvictions) + "\npool.dirty_evictions " +
+         std::to_string(this->dirtyEvictions) + "\npool.pin_waits " +
+         std::to_string(this->pinWaits) + "\npool.pin_wait_ns " +
+         std::to_string(this->pinWaitNanos) + "\npool.fetch_ns " +
+         this->fetchLatency.ToText() + "\n" + this->disk.ToText();
+}
+
+std::string BufferPoolStats::ToJson() const {
+  return "{\"hits\":" + std::to_string(this->hits) +
+         ",\"misses\":" + std::to_string(this->misses) +
+         ",\"evictions\":" + std::to_string(this->evictions) +
+         ",\"cleanEvictions\":" + std::to_string(this->cleanEvictions) +
+         ",\"dirtyEvictions\":" + std::to_string(this->dirtyEvictions) +
+         ",\"pinWaits\":" + std::to_string(this->pinWaits) +
+         ",\"pinWaitNs\":" + std::to_string(this->pinWaitNanos) +
+         ",\"fetchNs\":" + this->fetchLatency.ToJson() +
+         ",\"disk\":" + this->disk.ToJson() + "}";
+}
+
+void BufferPool::ReadAheadIfSequential(BlockId blockId) {
+  if (this->config.readaheadBlocks == 0) {
+    return;
+  }
+
+  // Tracked per thread so concurrent scans neither share a hot cache line
+  // nor break each other's runs.
+  struct Stream {
+    const BufferPool *pool = nullptr;
+    BlockId last = INVALID_BLOCK_ID;
+    size_t run = 0;
+    BlockId windowEnd = 0;
+  };
+  thread_local Stream stream;
+
+  if (stream.pool != this) {
+    stream = Stream{};
+    stream.pool = this;
+  }
+  if (stream.last != INVALID_BLOCK_ID && blockId == stream.last + 1) {
+    stream.run++;
+  } else {
+    stream.run = 1;
+    stream.windowEnd = 0;
+  }
+  stream.last = blockId;
+
+  // Issue the next window once the scan reaches the last block of the
+  // current one, so earlier prefetches are already warm and never compete
+  // with the new cold frames for eviction.
+  if (stream.run < this->config.readaheadTrigger ||
+      blockId + 1 < stream.windowEnd) {
+    return;
+  }
+  size_t window = std::min(this->config.readaheadBlocks,
+                           std::max<size_t>(1, this->poolSize / 4));
+  BlockId first = std::max<BlockId>(blockId + 1, stream.windowEnd);
+  stream.windowEnd = static_cast<BlockId>(blockId + 1 + window);
+  try {
+    this->PrefetchBlocks(first, stream.windowEnd - first);
+  } catch (const std::exception &) {
+    // Readahead must not fail the fetch that triggered it.
+  }
+}
+
+void BufferPool::CompletePrefetch(size_t frameId, BlockId blockId,
+                                  int result) {
+  if (result != 0) {
+    this->AbandonFrame(frameId, blockId);
+  } else {
     Block *block = &this->pool[frameId];
+    this->MarkFrameReady(frameId);
+    block->isLoading.store(false, std::memory_order_release);
+    block->isLoading.notify_all();
+    block->referenceCount--;
+  }
+
+  if (--this->prefetchesInFlight == 0) {
+    this->prefetchesInFlight.notify_all();
+  }
+}
+
+void BufferPool::FlusherLoop() {
+  std::unique_lock<std::mutex> lock(this->flusherMutex);
+  auto lastPass = std::chrono::steady_clock::now();
+
+  while (!this->flusherStopping) {
+    this->flusherWakeup.wait_for(lock, this->config.flushInterval, [this]() {
+      return this->flusherStopping || this->flushRequested;
+    });
+    if (this->flusherStopping) {
+      break;
+    }
+    this->flushRequested = false;
+    lock.unlock();
+
+    size_t written = 0;
+    try {
+      written = this->FlushDirtyFrames(false);
+    } catch (const std::exception &) {
+      // Frames that failed to write stay dirty; the next pass or eviction
+      // retries them.
+    }
+    this->dirtyHint = this->CountDirtyFrames();
+
+    auto now = std::chrono::steady_clock::now();
+    double seconds = std::chrono::duration<double>(now - lastPass).count();
+    this->flushRate = seconds > 0 ? static_cast<double>(written) / seconds : 0;
+    lastPass = now;
+
+    lock.lock();
+  }
+}
+
+size_t BufferPool::FlushDirtyFrames(bool includePinned) {
+  struct Candidate {
+    BlockId blockId;
+    size_t frameId;
+  };
 
-    if (block->referenceCount == 0) {
-      if (block->isDirty) {
-        this->FlushBlock(block->block_id);
+  std::vector<Candidate> candidates;
+  for (auto &shard : this->pageTable) {
+    std::lock_guard<std::mutex> shardLock(shard.mutex);
+    for (const auto &entry : shard.blocks) {
+      const Block &block = this->pool[entry.second];
+      if (block.isDirty && (includePinned || block.referenceCount == 0)) {
+        candidates.push_back(Candidate{entry.first, entry.second});
       }
+    }
+  }
+  std::sort(candidates.begin(), candidates.end(),
+            [](const Candidate &a, const Candidate &b) {
+              return a.blockId < b.blockId;
+            });
+
+  size_t batchSize = std::max<size_t>(1, this->config.flushBatchSize);
+  // Page aligned, so a direct-I/O DiskManager writes it without a bounce.
+  FrameArena staging(batchSize, false, this->arena.FrameSize());
+  size_t written = 0;
+  size_t failed = 0;
+
+  for (size_t start = 0; start < candidates.size(); start += batchSize) {
+    size_t end = std::min(start + batchSize, candidates.size());
+    std::vector<BlockIORequest> batch;
+    LSN batchLSN = INVALID_LSN;
+    std::atomic<size_t> remaining{0};
+    std::atomic<size_t> batchFailures{0};
+
+    for (size_t i = start; i < end; ++i) {
+      BlockId blockId = candidates[i].blockId;
+      size_t frameId = this->PinIfResident(this->ShardFor(blockId), blockId);
+      if (frameId == NO_FRAME) {
+        continue;
+      }
+
+      // Copy under the read latch so a concurrent writer cannot tear the
+      // image, and the DiskManager can stamp the copy in place; the pin is
+      // held until the write completes so a failed write can re-dirty the
+      // frame before it becomes evictable.
+      Block *block = &this->pool[frameId];
+      char *copy = staging.Frame(batch.size());
+      block->RLatch();
+      bool wasDirty = !block->isLoading && block->isDirty.exchange(false);
+      if (wasDirty) {
+        std::memcpy(copy, block->data, this->arena.FrameSize());
+        batchLSN = std::max<LSN>(batchLSN, block->pageLSN);
+        block->wasCleaned = true;
+      }
+      block->RUnlatch();
+      if (!wasDirty) {
+        block->referenceCount--;
+        continue;
+      }
+
+      remaining++;
+      batch.push_back(BlockIORequest{
+          IOOperation::Write, blockId, copy,
+          [block, &remaining, &batchFailures](int result) {
+            if (result != 0) {
+              block->isDirty = true;
+              batchFailures++;
+            }
+            block->referenceCount--;
+            if (--remaining == 0) {
+              remaining.notify_all();
+            }
+          }});
+    }
+
+    if (batch.empty()) {
+      continue;
+    }
+    size_t submitted = batch.size();
+    try {
+      this->FlushLogUpTo(batchLSN);
+      this->diskManager->SubmitBatch(batch);
+    } catch (...) {
+      // The log could not be made durable, or the batch was rejected before
+      // anything was queued: restore every frame.
+      for (auto &request : batch) {
+        if (request.callback) {
+          request.callback(-EIO);
+        }
+      }
+      throw;
+    }
+    for (size_t left = remaining.load(); left != 0; left = remaining.load()) {
+      remaining.wait(left);
+    }
+    written += submitted - batchFailures;
+    failed += batchFailures;
+  }
+
+  this->pagesFlushed += written;
+  if (failed > 0) {
+    throw BufferPoolException("Failed to flush " + std::to_string(failed) +
+                              " dirty blocks");
+  }
+  return written;
+}
+
+size_t BufferPool::CountDirtyFrames() {
+  size_t dirty = 0;
+  for (const auto &block : this->pool) {
+    if (block.isDirty.load(std::memory_order_relaxed)) {
+      dirty++;
+    }
+  }
+  return dirty;
+}
+
+BufferPool::PageTableShard &BufferPool::ShardFor(BlockId blockId) {
+  return this->pageTable[blockId % this->pageTable.size()];
+}
 
-      this->blockTable.erase(block->block_id);
-      this->evictionList.erase(it);
-      this->evictionListFrameIndices.erase(frameId);
-      return frameId;
+Block *BufferPool::PeekBlock(BlockId blockId, uint64_t &version) {
+  uint64_t hint = this->frameHints[blockId & this->frameHintMask].load(
+      std::memory_order_relaxed);
+  if (hint >> 32 != blockId) {
+    return nullptr;
+  }
+  size_t frameId = static_cast<size_t>(hint & UINT32_MAX);
+  Block *block = &this->pool[frameId];
+  version = block->version.load(std::memory_order_acquire);
+  if ((version & 1) != 0 || block->block_id != blockId ||
+      block->data != this->arena.Frame(frameId)) {
+    return nullptr;
+  }
+  return block;
+}
+
+size_t BufferPool::PinIfResident(PageTableShard &shard, BlockId blockId) {
+  std::lock_guard<std::mutex> shardLock(shard.mutex);
+  auto tableEntry = shard.blocks.find(blockId);
+  if (tableEntry == shard.blocks.end()) {
+    return NO_FRAME;
+  }
+  this->pool[tableEntry->second].referenceCount++;
+  return tableEntry->second;
+}
+
+Block *BufferPool::CompleteHit(size_t frameId) {
+  Block *block = &this->pool[frameId];
+  if (block->isLoading.load(std::memory_order_acquire)) {
+    PoolCounters *counters =
+        this->config.metrics ? &this->counters.Local() : nullptr;
+    uint64_t start = counters != nullptr ? NowNanos() : 0;
+    while (block->isLoading.load(std::memory_order_acquire)) {
+      block->isLoading.wait(true, std::memory_order_acquire);
+    }
+    if (counters != nullptr) {
+      BumpCounter(counters->pinWaits);
+      BumpCounter(counters->pinWaitNanos, NowNanos() - start);
     }
   }
 
-  throw BufferPoolException(
-      "Pool full - could not find free space, all blocks are in use");
+  this->replacer->RecordAccess(frameId);
+  return block;
+}
+
+void BufferPool::RecordFetch(PoolCounters *counters, bool isHit,
+                             uint64_t start, uint64_t weight) {
+  if (counters == nullptr) {
+    return;
+  }
+  BumpCounter(isHit ? counters->hits : counters->misses);
+  if (start != 0) {
+    counters->fetchLatency.Record(NowNanos() - start, weight);
+  }
+}
+
+void BufferPool::AbandonFrame(size_t frameId, BlockId blockId) {
+  std::lock_guard<std::mutex> frameLock(this->frameMutex);
+  PageTableShard &shard = this->ShardFor(blockId);
+  std::lock_guard<std::mutex> shardLock(shard.mutex);
+
+  // The frame stays with the replacer and is recycled once every waiter has
+  // dropped its pin.
+  Block *block = &this->pool[frameId];
+  shard.blocks.erase(blockId);
+  block->block_id = INVALID_BLOCK_ID;
+  block->referenceCount--;
+  block->isLoading.store(false, std::memory_order_release);
+  block->isLoading.notify_all();
+}
+
+size_t BufferPool::FindFreeOrEvictFrame(
+    std::unique_lock<std::mutex> &frameLock,
+    std::unique_lock<std::mutex> &shardLock) {
+  if (!this->freeFrames.empty()) {
+    size_t frameId = this->freeFrames.back();
+    this->freeFrames.pop_back();
+    return frameId;
+  }
+
+  // Pins are only taken under the shard mutex, so holding the victim's shard
+  // makes the unpinned check stable until the frame is unmapped.
+  std::unique_lock<std::mutex> victimLock;
+  PageTableShard *victimShard = nullptr;
+  size_t frameId = this->replacer->Evict([&](size_t candidate) {
+    Block *block = &this->pool[candidate];
+    if (block->referenceCount != 0) {
+      return false;
+    }
+    PageTableShard &shard = this->ShardFor(block->block_id);
+    std::unique_lock<std::mutex> lock;
+    if (&shard.mutex != shardLock.mutex()) {
+      lock = std::unique_lock<std::mutex>(shard.mutex);
+    }
+    if (block->referenceCount != 0) {
+      return false;
+    }
+    victimLock = std::move(lock);
+    victimShard = &shard;
+    return true;
+  });
+
+  if (frameId == Replacer::NO_FRAME) {
+    throw BufferPoolException(
+        "Pool full - could not find free space, all blocks are in use");
+  }
+  Block *block = &this->pool[frameId];
+  if (!block->isDirty) {
+    this->UnmapVictim(frameId, *victimShard, false);
+    return frameId;
+  }
+
+  // A dirty victim is pinned, so hits can still use it but no other miss
+  // takes it, and written back with every lock dropped: hits on these
+  // shards and other misses do not wait on the log flush and the write.
+  block->referenceCount++;
+  victimLock = std::unique_lock<std::mutex>();
+  shardLock.unlock();
+  frameLock.unlock();
+  try {
+    this->WriteBackPinned(block);
+  } catch (...) {
+    frameLock.lock();
+    this->replacer->RecordInsert(frameId, block->block_id);
+    block->referenceCount--;
+    throw;
+  }
+  frameLock.lock();
+  shardLock.lock();
+
+  // Unmapped onto the free stack unless a hit still pins it or dirtied it
+  // again. Either way the caller looks its block up again, since another
+  // thread may have loaded it meanwhile.
+  PageTableShard &shard = this->ShardFor(block->block_id);
+  if (&shard.mutex != shardLock.mutex()) {
+    victimLock = std::unique_lock<std::mutex>(shard.mutex);
+  }
+  block->referenceCount--;
+  if (block->referenceCount == 0 && !block->isDirty) {
+    this->UnmapVictim(frameId, shard, true);
+    this->freeFrames.push_back(frameId);
+  } else {
+    this->replacer->RecordInsert(frameId, block->block_id);
+  }
+  return NO_FRAME;
+}
+
+void BufferPool::UnmapVictim(size_t frameId, PageTableShard &shard,
+                             bool wroteBack) {
+  // Writes to a mapped block went to a private copy of its page; drop it
+  // now that the file has the data, or it would shadow the file the next
+  // time the block is mapped.
+  Block *block = &this->pool[frameId];
+  if (block->data != this->arena.Frame(frameId) && block->wasCleaned) {
+    try {
+      this->diskManager->DropMappedBlock(block->block_id);
+    } catch (...) {
+      this->replacer->RecordInsert(frameId, block->block_id);
+      throw;
+    }
+  }
+  if (this->config.metrics) {
+    PoolCounters &counters = this->counters.Local();
+    BumpCounter(wroteBack ? counters.dirtyEvictions
+                          : counters.cleanEvictions);
+  }
+  if (wroteBack) {
+    this->dirtyEvictions++;
+  }
+  shard.blocks.erase(block->block_id);
+  this->MarkFrameEmpty(frameId);
 }
 
 void BufferPool::PrepareFrameForReuse(size_t frameId) {
   Block *block = &this->pool[frameId];
 
-  std::memset(block->data, 0, BLOCK_SIZE);
+  block->data = this->arena.Frame(frameId);
   block->block_id = 0;
   block->referenceCount = 0;
   block->isDirty = false;
+  block->wasCleaned = false;
+  block->pageLSN = INVALID_LSN;
+}
 
-  this->isFree[frameId] = true;
+void BufferPool::FlushLogUpTo(LSN pageLSN) {
+  if (this->logManager != nullptr && pageLSN != INVALID_LSN) {
+    this->logManager->Flush(pageLSN);
+  }
 }
 
-void BufferPool::MarkFrameInUse(size_t frameId) {
-  this->isFree[frameId] = false;
-  this->evictionList.push_back(frameId);
-  this->evictionListFrameIndices[frameId] = --this->evictionList.end();
+void BufferPool::MarkFrameReady(size_t frameId) {
+  Block *block = &this->pool[frameId];
+  this->frameHints[block->block_id & this->frameHintMask].store(
+      uint64_t{block->block_id} << 32 | frameId, std::memory_order_relaxed);
+  block->version.fetch_add(1, std::memory_order_release);
 }
 
-void BufferPool::RemoveFromEvictionList(size_t frameId) {
-  auto posIt = this->evictionListFrameIndices.find(frameId);
-  if (posIt != this->evictionListFrameIndices.end()) {
-    this->evictionList.erase(posIt->second);
-    this->evictionListFrameIndices.erase(posIt);
+void BufferPool::MarkFrameEmpty(size_t frameId) {
+  // A frame whose load failed, or whose block was deleted, is odd already.
+  Block *block = &this->pool[frameId];
+  if ((block->version.load(std::memory_order_relaxed) & 1) == 0) {
+    block->version.fetch_add(1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
   }
 }
+
+void BufferPool::MarkFrameInUse(size_t frameId, BlockId blockId) {
+  this->replacer->RecordInsert(frameId, blockId);
+}
@@ -1,14 +1,24 @@
 #pragma once
 
-#include <list>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
 #include <memory>
+#include <mutex>
 #include <stdexcept>
+#include <thread>
 #include <unordered_map>
 #include <vector>
 
 #include "../../types/Constants.hpp"
 #include "../Block/Block.hpp"
 #include "../DiskManager/DiskManager.hpp"
+#include "../LogManager/LogManager.hpp"
+#include "../Metrics/LatencyHistogram.hpp"
+#include "../Metrics/PerThread.hpp"
+#include "../Replacer/Replacer.hpp"
+#include "./FrameArena.hpp"
+#include "./PageGuard.hpp"
 
 class BufferPoolException : public std::runtime_error {
 public:
@@ -16,9 +26,85 @@ public:
       : std::runtime_error(message) {}
 };
 
+struct BufferPoolConfig {
+  // Number of page-table partitions, each behind its own mutex.
+  size_t shardCount = 16;
+  ReplacerPolicy replacerPolicy = ReplacerPolicy::Clock;
+
+  // Background writer: every flushInterval, or sooner once more than
+  // dirtyRatioThreshold of the frames are dirty, write dirty unpinned frames
+  // in block-id order, flushBatchSize blocks per I/O submission.
+  bool backgroundFlush = false;
+  std::chrono::milliseconds flushInterval{100};
+  double dirtyRatioThreshold = 0.25;
+  size_t flushBatchSize = 64;
+
+  // Readahead: once a thread has fetched readaheadTrigger consecutive block
+  // ids, the pool reads the next readaheadBlocks blocks asynchronously, one
+  // window at a time. Capped at a quarter of the pool; 0 disables it.
+  size_t readaheadBlocks = 0;
+  size_t readaheadTrigger = 4;
+
+  // Ask for transparent huge pages under the frame arena (pools of 2 MiB or
+  // more).
+  bool hugePageFrames = true;
+
+  // Per-thread counters of hits, misses, evictions and pin waits, and a
+  // FetchBlock latency histogram, added up by GetStats. Every fetch is
+  // counted and every miss timed, but only one fetch in
+  // fetchTimingInterval (rounded up to a power of two; 0: none) is
+  // sampled: timed, and if it hit, recorded as that many hit latencies.
+  // The hit path skips the clock.
+  bool metrics = true;
+  size_t fetchTimingInterval = 1024;
+};
+
+struct BufferPoolFlushStats {
+  size_t dirtyPages;
+  // Blocks written by the background writer and by checkpoints.
+  uint64_t pagesFlushed;
+  // pagesFlushed per second over the background writer's last pass.
+  double flushRatePagesPerSec;
+  // Dirty victims written synchronously on the miss path.
+  uint64_t dirtyEvictions;
+  uint64_t checkpoints;
+};
+
+// Totals since the pool was created; `disk` is its DiskManager's.
+struct BufferPoolStats {
+  uint64_t hits = 0;
+  uint64_t misses = 0;
+  uint64_t evictions = 0;
+  uint64_t cleanEvictions = 0;
+  uint64_t dirtyEvictions = 0;
+  // Fetches that found their block still being read in by another thread,
+  // and the time they spent waiting for it.
+  uint64_t pinWaits = 0;
+  uint64_t pinWaitNanos = 0;
+  LatencyHistogram fetchLatency;
+  DiskManagerStats disk;
+
+  // One "pool.<name> <value>" line per field, then the disk's lines.
+  std::string ToText() const;
+  std::string ToJson() const;
+};
+
+// Thread-safe: FetchBlock, NewBlock, ReleaseBlock, the page guards and the
+// flush calls may run concurrently. A hit only takes the mutex of the block's
+// page-table shard; misses are serialized on the frame mutex, but their disk
+// reads, and the write-back of a dirty victim, run outside every pool lock.
+//
+// When the DiskManager uses the Mmap backend, a miss points the frame at the
+// block in the file mapping instead of reading it into the frame's arena
+// slot. Blocks changed through such a frame are written back as usual and
+// their private copy is dropped at eviction.
 class BufferPool {
 public:
-  BufferPool(size_t poolSize, std::unique_ptr<DiskManager> diskManager);
+  // With a `logManager` (not owned, must outlive the pool) every block write
+  // first flushes the log up to the block's pageLSN.
+  BufferPool(size_t poolSize, std::unique_ptr<DiskManager> diskManager,
+             const BufferPoolConfig &config = BufferPoolConfig(),
+             LogManager *logManager = nullptr);
 
   BufferPool(const BufferPool &) = delete;
   BufferPool &operator=(const BufferPool &) = delete;
@@ -27,26 +113,163 @@ public:
 
   ~BufferPool();
 
+  // Frames of `blockSize` bytes that fit in `bytes`, counting each frame's
+  // descriptor and bookkeeping as well as its page. A pool over a
+  // direct-I/O DiskManager is the only cache of the file, so it can be sized
+  // to take the memory the page cache would otherwise use.
+  static size_t FramesForMemory(size_t bytes, size_t blockSize = BLOCK_SIZE);
+  // FramesForMemory over `fraction` of physical memory.
+  static size_t FramesForPhysicalMemory(double fraction,
+                                        size_t blockSize = BLOCK_SIZE);
+  // The DiskManager's block size: the bytes behind every Block's data.
+  size_t GetBlockSize() const;
+  // The bytes of each block page layouts may use: all of it, or with
+  // checksums, those before the trailer the DiskManager stamps on write.
+  size_t GetPayloadSize() const;
+
   Block *FetchBlock(BlockId blockId);
-  Block *NewBlock();
+  // Allocates a zeroed block, reusing the free block nearest `hint` if
+  // there is one.
+  Block *NewBlock(BlockId hint = INVALID_BLOCK_ID);
   void ReleaseBlock(BlockId blockId, bool isDirty);
+  // Discards the block's frame without writing it and frees the block on
+  // disk for reuse. Throws if the block is pinned, which includes the
+  // moment the background writer spends copying it and a miss writing it
+  // back to evict it.
+  void DeleteBlock(BlockId blockId);
+
+  // Guarded FetchBlock/NewBlock: the pin is dropped with the guard, which
+  // knows its frame and so unpins without a page-table lookup. Read and
+  // write guards also hold the block's latch; a write guard marks the block
+  // dirty.
+  PageGuard FetchPage(BlockId blockId);
+  ReadPageGuard FetchPageRead(BlockId blockId);
+  WritePageGuard FetchPageWrite(BlockId blockId);
+  PageGuard NewPage(BlockId hint = INVALID_BLOCK_ID);
+
+  // For readers that validate what they read against Block::version (see
+  // BPlusTree): the resident frame of `blockId` and its version, found
+  // without a lock, a pin or a replacer update. Returns nullptr when the
+  // block is not found that way, or is being written; fetch it instead.
+  // The frame may be reused at any time, which changes its version, so
+  // nothing read from it counts until the version is checked again. Not
+  // counted as a hit.
+  Block *PeekBlock(BlockId blockId, uint64_t &version);
+
+  // Write resident dirty blocks back, each copied under its read latch;
+  // the caller must not hold the latch of a block being flushed.
   void FlushBlock(BlockId blockId);
   void FlushAllBlocks();
 
+  // Hint that blocks [first, first + count) will be fetched soon. Starts
+  // asynchronous reads for those not already resident, into frames the
+  // replacer tracks cold, and returns how many were issued. Ids past the end
+  // of the file are ignored; stops early once no frame can be freed.
+  size_t PrefetchBlocks(BlockId first, size_t count);
+  // Blocks until every read started by PrefetchBlocks or readahead is done.
+  void WaitForPrefetches();
+
+  // Fuzzy checkpoint: writes every block dirty at the time of the call, then
+  // syncs. It holds no pool-wide lock, so fetches and releases keep running;
+  // blocks dirtied after it starts may or may not be included. Returns the
+  // number of blocks written. Must not be called while holding a latch.
+  size_t Checkpoint();
+  BufferPoolFlushStats GetFlushStats();
+  BufferPoolStats GetStats() const;
+
 private:
+  friend class PageGuard;
+
+  static constexpr size_t NO_FRAME = static_cast<size_t>(-1);
+
+  struct alignas(64) PageTableShard {
+    std::mutex mutex;
+    std::unordered_map<BlockId, size_t> blocks;
+  };
+
   size_t poolSize;
+  BufferPoolConfig config;
   std::unique_ptr<DiskManager> diskManager;
+  LogManager *logManager;
 
+  FrameArena arena;
   std::vector<Block> pool;
-  std::unordered_map<BlockId, size_t> blockTable;
+  std::vector<PageTableShard> pageTable;
+  // Lock-free hints for PeekBlock: slot `blockId & frameHintMask` holds the
+  // id of the last block made ready there in its top half and its frame in
+  // the bottom half. A later block overwrites it; PeekBlock then misses.
+  size_t frameHintMask;
+  std::unique_ptr<std::atomic<uint64_t>[]> frameHints;
+
+  // Serializes misses, replacer inserts/evictions and the free-frame stack.
+  // Lock order: frameMutex, then the target shard, then a victim's shard.
+  // Hits never take it; they report to the replacer directly.
+  std::mutex frameMutex;
+  std::unique_ptr<Replacer> replacer;
+  // Frames holding no block: never used yet, or emptied by a miss that
+  // wrote back their dirty block. A miss pops one in O(1) before asking the
+  // replacer for a victim.
+  std::vector<size_t> freeFrames;
+
+  std::atomic<size_t> dirtyHint;
+  std::atomic<uint64_t> pagesFlushed;
+  std::atomic<uint64_t> dirtyEvictions;
+  std::atomic<uint64_t> checkpoints;
+  std::atomic<double> flushRate;
+
+  std::mutex flusherMutex;
+  std::condition_variable flusherWakeup;
+  bool flusherStopping;
+  bool flushRequested;
+  std::thread flusher;
+
+  std::atomic<size_t> prefetchesInFlight;
+
+  // Exact counts; only fetchLatency is sampled, a sampled hit adding the
+  // weight of the fetches it stands for.
+  struct PoolCounters {
+    // This thread's fetches, for sampling; GetStats does not read it.
+    uint64_t fetches = 0;
+    std::atomic<uint64_t> hits{0};
+    std::atomic<uint64_t> misses{0};
+    std::atomic<uint64_t> cleanEvictions{0};
+    std::atomic<uint64_t> dirtyEvictions{0};
+    std::atomic<uint64_t> pinWaits{0};
+    std::atomic<uint64_t> pinWaitNanos{0};
+    LatencyRecorder fetchLatency;
+  };
+  // A fetch is sampled when this thread's count of fetches from the pool
+  // masked with it is 0.
+  uint64_t fetchTimingMask;
+  PerThread<PoolCounters> counters;
+
+  PageTableShard &ShardFor(BlockId blockId);
+  size_t PinIfResident(PageTableShard &shard, BlockId blockId);
+  Block *CompleteHit(size_t frameId);
+  void RecordFetch(PoolCounters *counters, bool isHit, uint64_t start,
+                   uint64_t weight);
+  void AbandonFrame(size_t frameId, BlockId blockId);
+  size_t FrameOf(const Block *block) const;
+  void UnpinFrame(size_t frameId, bool isDirty);
+
+  void ReadAheadIfSequential(BlockId blockId);
+  void CompletePrefetch(size_t frameId, BlockId blockId, int result);
+
+  void FlushLogUpTo(LSN pageLSN);
 
-  std::list<size_t> evictionList;
-  std::unordered_map<size_t, std::list<size_t>::iterator>
-      evictionListFrameIndices;
-  std::vector<bool> isFree;
+  void FlusherLoop();
+  size_t FlushDirtyFrames(bool includePinned);
+  size_t CountDirtyFrames();
 
-  size_t FindFreeOrEvictFrame();
+  bool WriteBackPinned(Block *block);
+  size_t FindFreeOrEvictFrame(std::unique_lock<std::mutex> &frameLock,
+                              std::unique_lock<std::mutex> &shardLock);
+  void UnmapVictim(size_t frameId, PageTableShard &shard, bool wroteBack);
   void PrepareFrameForReuse(size_t frameId);
-  void MarkFrameInUse(size_t frameId);
-  void RemoveFromEvictionList(size_t frameId);
+  // A frame's version is even only while it holds a loaded block: it turns
+  // odd when the frame is unmapped and even again once its next block is
+  // ready, so a PeekBlock reader sees the frame change hands.
+  void MarkFrameReady(size_t frameId);
+  void MarkFrameEmpty(size_t frameId);
+  void MarkFrameInUse(size_t frameId, BlockId blockId);
 };
@@ -0,0 +1,49 @@
+#include "./FrameArena.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <new>
+#include <sys/mman.h>
+
+static size_t RoundUp(size_t value, size_t multiple) {
+  return (value + multiple - 1) / multiple * multiple;
+}
+
+FrameArena::FrameArena(size_t frameCount, bool hugePages, size_t frameSize)
+    : base(nullptr), frameSize(frameSize),
+      size(std::max<size_t>(1, frameCount) * frameSize), hugePages(false) {
+  if (!hugePages || this->size < HUGE_PAGE_SIZE) {
+    void *mapping = ::mmap(nullptr, this->size, PROT_READ | PROT_WRITE,
+                           MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (mapping == MAP_FAILED) {
+      throw std::bad_alloc();
+    }
+    this->base = static_cast<char *>(mapping);
+    return;
+  }
+
+  // mmap only promises page alignment: over-map by one huge page and trim
+  // both ends so the arena starts on a huge-page boundary.
+  this->size = RoundUp(this->size, HUGE_PAGE_SIZE);
+  size_t mappedSize = this->size + HUGE_PAGE_SIZE;
+  void *mapping = ::mmap(nullptr, mappedSize, PROT_READ | PROT_WRITE,
+                         MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (mapping == MAP_FAILED) {
+    throw std::bad_alloc();
+  }
+  char *raw = static_cast<char *>(mapping);
+  char *aligned = reinterpret_cast<char *>(
+      RoundUp(reinterpret_cast<uintptr_t>(raw), HUGE_PAGE_SIZE));
+  if (aligned != raw) {
+    ::munmap(raw, static_cast<size_t>(aligned - raw));
+  }
+  size_t tail = static_cast<size_t>(raw + mappedSize - (aligned + this->size));
+  if (tail != 0) {
+    ::munmap(aligned + this->size, tail);
+  }
+
+  this->base = aligned;
+  this->hugePages = ::madvise(this->base, this->size, MADV_HUGEPAGE) == 0;
+}
+
+FrameArena::~FrameArena() { ::munmap(this->base, this->size); }
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstddef>
+
+#include "../../types/Constants.hpp"
+
+// One anonymous mapping holding every frame's bytes back to back, page
+// aligned, apart from the Block descriptors that track them.
+//
+// Arenas of at least one huge page are aligned to HUGE_PAGE_SIZE and
+// advised MADV_HUGEPAGE, so the kernel can back them with transparent huge
+// pages: a large pool then costs a few TLB entries instead of one per frame.
+class FrameArena {
+public:
+  static constexpr size_t HUGE_PAGE_SIZE = size_t{2} << 20;
+
+  // Throws std::bad_alloc when the mapping fails.
+  FrameArena(size_t frameCount, bool hugePages,
+             size_t frameSize = BLOCK_SIZE);
+  ~FrameArena();
+
+  FrameArena(const FrameArena &) = delete;
+  FrameArena &operator=(const FrameArena &) = delete;
+  FrameArena(FrameArena &&) = delete;
+  FrameArena &operator=(FrameArena &&) = delete;
+
+  char *Frame(size_t frameId) const {
+    return this->base + frameId * this->frameSize;
+  }
+  size_t FrameSize() const { return this->frameSize; }
+  char *Data() const { return this->base; }
+  size_t Size() const { return this->size; }
+  // True when the kernel accepted the huge-page advice; whether it actually
+  // found huge pages is up to its THP settings.
+  bool UsesHugePages() const { return this->hugePages; }
+
+private:
+  char *base;
+  size_t frameSize;
+  size_t size;
+  bool hugePages;
+};
@@ -0,0 +1,115 @@
+#include "./PageGuard.hpp"
+#include "./BufferPool.hpp"
+
+#include <utility>
+
+PageGuard::PageGuard(BufferPool *pool, Block *block, size_t frameId)
+    : pool(pool), block(block), frameId(frameId) {}
+
+PageGuard::PageGuard(PageGuard &&other) noexcept
+    : pool(other.pool), block(other.block), frameId(other.frameId),
+      isDirty(other.isDirty) {
+  other.block = nullptr;
+}
+
+PageGuard &PageGuard::operator=(PageGuard &&other) noexcept {
+  if (this != &other) {
+    this->Drop();
+    this->pool = other.pool;
+    this->block = other.block;
+    this->frameId = other.frameId;
+    this->isDirty = other.isDirty;
+    other.block = nullptr;
+  }
+  return *this;
+}
+
+PageGuard::~PageGuard() { this->Drop(); }
+
+bool PageGuard::IsValid() const { return this->block != nullptr; }
+
+BlockId PageGuard::GetBlockId() const {
+  return this->block != nullptr ? this->block->block_id : INVALID_BLOCK_ID;
+}
+
+Block *PageGuard::GetBlock() const { return this->block; }
+
+std::span<char> PageGuard::GetData() const {
+  return {this->block->data, this->pool->GetPayloadSize()};
+}
+
+void PageGuard::MarkDirty() { this->isDirty = true; }
+
+void PageGuard::Drop() {
+  if (this->block != nullptr) {
+    this->pool->UnpinFrame(this->frameId, this->isDirty);
+    this->block = nullptr;
+    this->isDirty = false;
+  }
+}
+
+ReadPageGuard PageGuard::UpgradeRead() && {
+  this->block->RLatch();
+  return ReadPageGuard(std::move(*this));
+}
+
+WritePageGuard PageGuard::UpgradeWrite() && {
+  this->block->WLatch();
+  return WritePageGuard(std::move(*this));
+}
+
+ReadPageGuard::ReadPageGuard(PageGuard &&guard) : guard(std::move(guard)) {}
+
+ReadPageGuard &ReadPageGuard::operator=(ReadPageGuard &&other) noexcept {
+  if (this != &other) {
+    this->Drop();
+    this->guard = std::move(other.guard);
+  }
+  return *this;
+}
+
+ReadPageGuard::~ReadPageGuard() { this->Drop(); }
+
+bool ReadPageGuard::IsValid() const { return this->guard.IsValid(); }
+
+BlockId ReadPageGuard::GetBlockId() const { return this->guard.GetBlockId(); }
+
+std::span<const char> ReadPageGuard::GetData() const {
+  return this->guard.GetData();
+}
+
+void ReadPageGuard::Drop() {
+  if (this->guard.IsValid()) {
+    this->guard.GetBlock()->RUnlatch();
+    this->guard.Drop();
+  }
+}
+
+WritePageGuard::WritePageGuard(PageGuard &&guard) : guard(std::move(guard)) {
+  this->guard.MarkDirty();
+}
+
+WritePageGuard &WritePageGuard::operator=(WritePageGuard &&other) noexcept {
+  if (this != &other) {
+    this->Drop();
+    this->guard = std::move(other.guard);
+  }
+  return *this;
+}
+
+WritePageGuard::~WritePageGuard() { this->Drop(); }
+
+bool WritePageGuard::IsValid() const { return this->guard.IsValid(); }
+
+BlockId WritePageGuard::GetBlockId() const { return this->guard.GetBlockId(); }
+
+std::span<char> WritePageGuard::GetData() const {
+  return this->guard.GetData();
+}
+
+void WritePageGuard::Drop() {
+  if (this->guard.IsValid()) {
+    this->guard.GetBlock()->WUnlatch();
+    this->guard.Drop();
+  }
+}
@@ -0,0 +1,115 @@
+#pragma once
+
+#include <cstddef>
+#include <span>
+
+#include "../../types/Constants.hpp"
+#include "../Block/Block.hpp"
+
+class BufferPool;
+class ReadPageGuard;
+class WritePageGuard;
+
+// Move-only pin on a BufferPool frame, dropped when the guard goes out of
+// scope. The guard remembers the frame, so unpinning skips the page-table
+// lookup ReleaseBlock needs.
+//
+// A plain PageGuard takes no latch: it suits callers that synchronize on
+// their own (BPlusTree's optimistic versions) or that upgrade it to a
+// ReadPageGuard or WritePageGuard.
+class PageGuard {
+public:
+  PageGuard() = default;
+
+  PageGuard(const PageGuard &) = delete;
+  PageGuard &operator=(const PageGuard &) = delete;
+  PageGuard(PageGuard &&other) noexcept;
+  PageGuard &operator=(PageGuard &&other) noexcept;
+
+  ~PageGuard();
+
+  bool IsValid() const;
+  BlockId GetBlockId() const;
+  Block *GetBlock() const;
+  // The block's payload: every byte but the checksum trailer, if the
+  // DiskManager keeps one.
+  std::span<char> GetData() const;
+  // The page is written back before its frame is reused.
+  void MarkDirty();
+
+  // Unpins now instead of at scope exit; the guard becomes empty.
+  void Drop();
+
+  // Latches the page and hands the pin to the returned guard.
+  ReadPageGuard UpgradeRead() &&;
+  WritePageGuard UpgradeWrite() &&;
+
+private:
+  friend class BufferPool;
+
+  PageGuard(BufferPool *pool, Block *block, size_t frameId);
+
+  BufferPool *pool = nullptr;
+  Block *block = nullptr;
+  size_t frameId = 0;
+  bool isDirty = false;
+};
+
+// Pin plus shared latch: the page can be read but not changed.
+class ReadPageGuard {
+public:
+  ReadPageGuard() = default;
+
+  ReadPageGuard(const ReadPageGuard &) = delete;
+  ReadPageGuard &operator=(const ReadPageGuard &) = delete;
+  ReadPageGuard(ReadPageGuard &&other) noexcept = default;
+  ReadPageGuard &operator=(ReadPageGuard &&other) noexcept;
+
+  ~ReadPageGuard();
+
+  bool IsValid() const;
+  BlockId GetBlockId() const;
+  std::span<const char> GetData() const;
+  template <typename T> const T *As() const {
+    return reinterpret_cast<const T *>(this->guard.GetBlock()->data);
+  }
+
+  void Drop();
+
+private:
+  friend class PageGuard;
+
+  explicit ReadPageGuard(PageGuard &&guard);
+
+  PageGuard guard;
+};
+
+// Pin plus exclusive latch. The page is marked dirty when the guard is
+// dropped.
+class WritePageGuard {
+public:
+  WritePageGuard() = default;
+
+  WritePageGuard(const WritePageGuard &) = delete;
+  WritePageGuard &operator=(const WritePageGuard &) = delete;
+  WritePageGuard(WritePageGuard &&other) noexcept = default;
+  WritePageGuard &operator=(WritePageGuard &&other) noexcept;
+
+  ~WritePageGuard();
+
+  bool IsValid() const;
+  BlockId GetBlockId() const;
+  std::span<char> GetData() const;
+  template <typename T> T *As() const {
+    return reinterpret_cast<T *>(this->guard.GetBlock()->data);
+  }
+
+  void Drop();
+
+private:
+  friend class PageGuard;
+
+  explicit WritePageGuard(PageGuard &&guard);
+
+  PageGuard guard;
+};
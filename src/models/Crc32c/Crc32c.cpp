@@ -0,0 +1,160 @@
+#include "./Crc32c.hpp"
+
+#include <array>
+#include <cstring>
+
+#if defined(__x86_64__)
+#include <nmmintrin.h>
+#endif
+
+namespace {
+
+// Reflected form of 0x1EDC6F41.
+constexpr uint32_t POLYNOMIAL = 0x82F63B78u;
+
+// TABLE[k][b]: the CRC state after byte b followed by k zero bytes, so eight
+// lookups advance the state by a whole 64-bit word.
+using Table = std::array<std::array<uint32_t, 256>, 8>;
+
+constexpr Table MakeTable() {
+  Table table{};
+  for (uint32_t i = 0; i < 256; ++i) {
+    uint32_t crc = i;
+    for (int bit = 0; bit < 8; ++bit) {
+      crc = (crc >> 1) ^ (POLYNOMIAL & (0u - (crc & 1u)));
+    }
+    table[0][i] = crc;
+  }
+  for (size_t k = 1; k < 8; ++k) {
+    for (uint32_t i = 0; i < 256; ++i) {
+      uint32_t previous = table[k - 1][i];
+      table[k][i] = (previous >> 8) ^ table[0][previous & 0xff];
+    }
+  }
+  return table;
+}
+
+constexpr Table TABLE = MakeTable();
+
+// The Extend functions advance a raw CRC state; Compute applies the
+// standard pre- and post-inversion around them.
+uint32_t ExtendSoftware(uint32_t crc, const char *data, size_t length) {
+  const auto *bytes = reinterpret_cast<const unsigned char *>(data);
+  while (length >= 8) {
+    uint64_t word;
+    std::memcpy(&word, bytes, sizeof(word));
+    word ^= crc;
+    crc = TABLE[7][word & 0xff] ^ TABLE[6][(word >> 8) & 0xff] ^
+          TABLE[5][(word >> 16) & 0xff] ^ TABLE[4][(word >> 24) & 0xff] ^
+          TABLE[3][(word >> 32) & 0xff] ^ TABLE[2][(word >> 40) & 0xff] ^
+          TABLE[1][(word >> 48) & 0xff] ^ TABLE[0][word >> 56];
+    bytes += 8;
+    length -= 8;
+  }
+  while (length-- > 0) {
+    crc = (crc >> 8) ^ TABLE[0][(crc ^ *bytes++) & 0xff];
+  }
+  return crc;
+}
+
+#if defined(__x86_64__)
+
+// A 4 KiB block is two rounds of three streams plus a 16-byte tail.
+constexpr size_t STREAM_BYTES = 680;
+
+// Advances a state over STREAM_BYTES zero bytes. Feeding zeros is linear in
+// the state, so four byte-indexed lookups cover every 32-bit state.
+struct ShiftTable {
+  uint32_t entries[4][256];
+
+  uint32_t Shift(uint32_t crc) const {
+    return this->entries[0][crc & 0xff] ^ this->entries[1][(crc >> 8) & 0xff] ^
+           this->entries[2][(crc >> 16) & 0xff] ^ this->entries[3][crc >> 24];
+  }
+};
+
+const ShiftTable &GetShiftTable() {
+  static const ShiftTable table = [] {
+    static const char zeros[STREAM_BYTES] = {};
+    ShiftTable shift{};
+    for (unsigned k = 0; k < 4; ++k) {
+      for (uint32_t i = 0; i < 256; ++i) {
+        shift.entries[k][i] =
+            ExtendSoftware(i << (8 * k), zeros, STREAM_BYTES);
+      }
+    }
+    return shift;
+  }();
+  return table;
+}
+
+__attribute__((target("sse4.2"))) uint32_t
+ExtendHardware(uint32_t crc, const char *data, size_t length) {
+  // crc32 has a latency of three cycles but issues every cycle: three
+  // independent streams keep it busy, and their states are then combined
+  // by shifting each over the bytes that follow it.
+  if (length >= 3 * STREAM_BYTES) {
+    const ShiftTable &shift = GetShiftTable();
+    do {
+      uint64_t a = crc;
+      uint64_t b = 0;
+      uint64_t c = 0;
+      for (size_t i = 0; i < STREAM_BYTES; i += 8) {
+        uint64_t wordA;
+        uint64_t wordB;
+        uint64_t wordC;
+        std::memcpy(&wordA, data + i, sizeof(wordA));
+        std::memcpy(&wordB, data + STREAM_BYTES + i, sizeof(wordB));
+        std::memcpy(&wordC, data + 2 * STREAM_BYTES + i, sizeof(wordC));
+        a = _mm_crc32_u64(a, wordA);
+        b = _mm_crc32_u64(b, wordB);
+        c = _mm_crc32_u64(c, wordC);
+      }
+      crc = shift.Shift(shift.Shift(static_cast<uint32_t>(a)) ^
+                        static_cast<uint32_t>(b)) ^
+            static_cast<uint32_t>(c);
+      data += 3 * STREAM_BYTES;
+      length -= 3 * STREAM_BYTES;
+    } while (length >= 3 * STREAM_BYTES);
+  }
+
+  uint64_t state = crc;
+  while (length >= 8) {
+    uint64_t word;
+    std::memcpy(&word, data, sizeof(word));
+    state = _mm_crc32_u64(state, word);
+    data += 8;
+    length -= 8;
+  }
+  crc = static_cast<uint32_t>(state);
+  while (length-- > 0) {
+    crc = _mm_crc32_u8(crc, static_cast<unsigned char>(*data++));
+  }
+  return crc;
+}
+
+#endif
+
+} // namespace
+
+uint32_t Crc32c::Compute(const char *data, size_t length) {
+#if defined(__x86_64__)
+  if (IsHardwareAccelerated()) {
+    return ~ExtendHardware(~0u, data, length);
+  }
+#endif
+  return ~ExtendSoftware(~0u, data, length);
+}
+
+uint32_t Crc32c::ComputeSoftware(const char *data, size_t length) {
+  return ~ExtendSoftware(~0u, data, length);
+}
+
+bool Crc32c::IsHardwareAccelerated() {
+#if defined(__x86_64__)
+  static const bool hasSse42 = __builtin_cpu_supports("sse4.2");
+  return hasSse42;
+#else
+  return false;
+#endif
+}
@@ -0,0 +1,16 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// CRC-32C (Castagnoli), the checksum behind iSCSI, ext4 metadata and most
+// storage engines. Compute uses the SSE4.2 crc32 instruction when the CPU
+// has it, running three independent streams so the instruction's latency
+// is hidden, and a slicing-by-8 table otherwise.
+class Crc32c {
+public:
+  static uint32_t Compute(const char *data, size_t length);
+  // The table-driven path, whatever the CPU supports.
+  static uint32_t ComputeSoftware(const char *data, size_t length);
+  static bool IsHardwareAccelerated();
+};
@@ -1,123 +1,1436 @@
 #include "./DiskManager.hpp"
-#include <iostream>
-#include <vector>
+#include "../Crc32c/Crc32c.hpp"
+#include "../Lz4/Lz4.hpp"
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <new>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
 
-DiskManager::DiskManager(const std::string &path) : path(path), blockCount(0) {
-  this->db.open(this->path, std::ios::in | std::ios::out | std::ios::binary);
+namespace {
+struct AlignedFree {
+  void operator()(char *data) const {
+    ::operator delete[](data,
+                        std::align_val_t{DiskManager::DIRECT_IO_ALIGNMENT});
+  }
+};
+using AlignedBuffer = std::unique_ptr<char[], AlignedFree>;
+
+AlignedBuffer MakeAlignedBuffer(size_t bytes) {
+  return AlignedBuffer(static_cast<char *>(::operator new[](
+      bytes, std::align_val_t{DiskManager::DIRECT_IO_ALIGNMENT})));
+}
+
+// Per-thread room for one block, regrown when a handle with larger blocks
+// uses it.
+struct ScratchBlock {
+  AlignedBuffer data;
+  size_t size = 0;
+
+  char *Get(size_t bytes) {
+    if (this->size < bytes) {
+      this->data = MakeAlignedBuffer(bytes);
+      this->size = bytes;
+    }
+    return this->data.get();
+  }
+};
+
+// The file header, zero-padded to HEADER_SIZE.
+constexpr char HEADER_MAGIC[8] = {'K', 'E', 'Y', 'V', 'A', 'L', 'D', 'B'};
+constexpr uint32_t HEADER_VERSION = 1;
+struct RawHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t blockSize;
+  uint32_t compression;
+  // 0 in files from before it was recorded, which are all format 1.
+  uint32_t blockFormat;
+  uint32_t blockCount;
+};
+
+// The last TRAILER_SIZE bytes of every block of a checksummed database.
+// The CRC32C covers everything before it, the version and flags included.
+// A trailer of zeros is a block never written, whose other bytes are zeros
+// too.
+struct BlockTrailer {
+  uint16_t version;
+  uint16_t flags;
+  uint32_t crc;
+};
+static_assert(sizeof(BlockTrailer) == DiskManager::TRAILER_SIZE);
+constexpr uint16_t TRAILER_HAS_CRC = 1;
+
+// Extent map entries. Bit 63 marks the block allocated; below it, 17 bits
+// of bytes stored (0 for a block never written, the block size for one
+// stored uncompressed) and 40 bits of first sector, counted from the end
+// of the file header. An extent holds just the sectors its bytes need. 0
+// is an id past the end of the database.
+constexpr size_t SECTOR_SIZE = 512;
+constexpr uint64_t EXTENT_ALLOCATED = uint64_t{1} << 63;
+
+uint64_t ExtentSector(uint64_t entry) {
+  return entry & ((uint64_t{1} << 40) - 1);
+}
+size_t ExtentLength(uint64_t entry) {
+  return static_cast<size_t>(entry >> 40 & 0x1ffff);
+}
+unsigned SectorsFor(size_t length) {
+  return static_cast<unsigned>((length + SECTOR_SIZE - 1) / SECTOR_SIZE);
+}
+unsigned ExtentCapacity(uint64_t entry) {
+  return SectorsFor(ExtentLength(entry));
+}
+uint64_t MakeExtent(uint64_t sector, size_t length) {
+  return EXTENT_ALLOCATED | uint64_t{length} << 40 | sector;
+}
+long long ExtentOffset(uint64_t sector) {
+  return static_cast<long long>(DiskManager::HEADER_SIZE +
+                                sector * SECTOR_SIZE);
+}
+
+// Compresses a block into `packed`. Returns the bytes to store, the whole
+// block when compression would not save a sector; `stored` points at them.
+size_t PackBlock(const char *buff, size_t blockSize, char *packed,
+                 const char *&stored) {
+  size_t length =
+      Lz4::Compress(buff, blockSize, packed, blockSize - SECTOR_SIZE);
+  if (length == 0) {
+    stored = buff;
+    return blockSize;
+  }
+  stored = packed;
+  return length;
+}
+
+// Fills `header` from the bytes at the start of a file; false when they
+// are not a database header this version can read.
+bool ParseHeader(const char *bytes, DatabaseHeader &header) {
+  RawHeader raw;
+  std::memcpy(&raw, bytes, sizeof(raw));
+  if (std::memcmp(raw.magic, HEADER_MAGIC, sizeof(HEADER_MAGIC)) != 0 ||
+      raw.version != HEADER_VERSION ||
+      raw.compression > static_cast<uint32_t>(BlockCompression::Lz4)) {
+    return false;
+  }
+  header.blockSize = raw.blockSize;
+  header.compression = static_cast<BlockCompression>(raw.compression);
+  header.blockFormat =
+      static_cast<uint16_t>(raw.blockFormat == 0 ? 1 : raw.blockFormat);
+  header.blockCount = raw.blockCount;
+  return true;
+}
+
+// Files from before the header start with block 0: 4 KiB blocks, plain
+// and uncompressed, as many as the file holds.
+bool IsHeaderless(const char *bytes, size_t fileSize) {
+  return fileSize % BLOCK_SIZE == 0 &&
+         std::memcmp(bytes, HEADER_MAGIC, sizeof(HEADER_MAGIC)) != 0;
+}
+
+DatabaseHeader HeaderlessHeader(size_t fileSize) {
+  return DatabaseHeader{BLOCK_SIZE, BlockCompression::None,
+                        DiskManager::PLAIN_BLOCK_FORMAT,
+                        static_cast<BlockId>(fileSize / BLOCK_SIZE)};
+}
+} // namespace
+
+DiskManager::DiskManager(const std::string &path,
+                         const DiskManagerConfig &config)
+    : path(path), config(config), blockSize(config.blockSize),
+      dataOffset(HEADER_SIZE), fd(-1), directIO(false), mapping(nullptr),
+      blockCount(0), headerBlockCount(0), fileBlocks(0), freeMapFd(-1),
+      freeBlocks(0), extentMapFd(-1), extentEntries(nullptr), extentTail(0),
+      ioEngineReady(nullptr) {
+  if (this->config.directIO &&
+      this->config.readBackend == DiskReadBackend::Mmap) {
+    this->ThrowIOError("Direct I/O cannot be combined with the mmap backend");
+  }
+  if (this->config.compression != BlockCompression::None &&
+      (this->config.directIO ||
+       this->config.readBackend == DiskReadBackend::Mmap)) {
+    this->ThrowIOError(
+        "Compression cannot be combined with direct I/O or the mmap backend");
+  }
+  if (!std::has_single_bit(this->blockSize) ||
+      this->blockSize < MIN_BLOCK_SIZE || this->blockSize > MAX_BLOCK_SIZE) {
+    this->ThrowIOError("Block size " + std::to_string(this->blockSize) +
+                       " is not a power of two from " +
+                       std::to_string(MIN_BLOCK_SIZE) + " to " +
+                       std::to_string(MAX_BLOCK_SIZE));
+  }
+
+  int flags = O_RDWR | O_CREAT | O_CLOEXEC;
+  if (this->config.directIO) {
+    this->fd = ::open(this->path.c_str(), flags | O_DIRECT, 0644);
+    // EINVAL: the filesystem (tmpfs, for one) has no direct I/O.
+    this->directIO = this->fd >= 0;
+  }
+  if (this->fd < 0) {
+    this->fd = ::open(this->path.c_str(), flags, 0644);
+  }
+  if (this->fd < 0) {
+    this->ThrowIOError("Failed to open database file: " + this->path, errno);
+  }
+
+  struct stat st {};
+  if (::fstat(this->fd, &st) != 0) {
+    int err = errno;
+    this->CloseFiles();
+    this->ThrowIOError("Failed to determine file size with fstat()", err);
+  }
+
+  try {
+    this->OpenHeader(st.st_size);
+  } catch (...) {
+    this->CloseFiles();
+    throw;
+  }
+  BlockId blocks = 0;
+  if (static_cast<size_t>(st.st_size) > this->dataOffset) {
+    blocks = static_cast<BlockId>((static_cast<size_t>(st.st_size) -
+                                   this->dataOffset) /
+                                  this->blockSize);
+  }
+  // The file may run past the header's count by the unused end of an
+  // extent; a count past the file means the file lost its end.
+  BlockId count = std::min(this->headerBlockCount, blocks);
+  if (count < blocks && this->config.compression == BlockCompression::None) {
+    try {
+      count = this->WrittenBlocksEnd(count, blocks);
+    } catch (...) {
+      this->CloseFiles();
+      throw;
+    }
+  }
+  this->blockCount.store(count, std::memory_order_release);
+  this->fileBlocks.store(blocks, std::memory_order_release);
+
+  if (this->config.readBackend == DiskReadBackend::Mmap) {
+    // Mapping past EOF is allowed; MappedBlock only hands out blocks the
+    // file already holds.
+    this->config.mmapWindowBytes -=
+        this->config.mmapWindowBytes % this->blockSize;
+    void *window = ::mmap(nullptr, this->config.mmapWindowBytes,
+                          PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_NORESERVE,
+                          this->fd, 0);
+    if (window == MAP_FAILED) {
+      int err = errno;
+      this->CloseFiles();
+      this->ThrowIOError("Failed to map database file", err);
+    }
+    this->mapping = static_cast<char *>(window);
+  }
 
-  if (!this->db.is_open()) {
-    this->db.clear();
-    this->db.open(this->path, std::ios::out | std::ios::binary);
-    this->db.close();
-    this->db.open(this->path, std::ios::in | std::ios::out | std::ios::binary);
+  try {
+    this->OpenExtentMap();
+    this->LoadFreeMap();
+  } catch (...) {
+    this->CloseFiles();
+    throw;
+  }
+}
 
-    if (!this->db.is_open()) {
-      this->ThrowIOError("Failed to open database file: " + this->path);
+DiskManager::~DiskManager() {
+  this->ioEngine.reset();
+  if (this->fd >= 0) {
+    // Give back the unused end of the last extent and any free blocks
+    // before it, unless another handle has grown the file since. The next
+    // open drops the free-map bits past the new end.
+    BlockId used = this->blockCount;
+    while (used > 0 && this->IsFree(used - 1)) {
+      used--;
     }
+    struct stat st {};
+    if (this->extentEntries != nullptr) {
+      // Dropping the ids from the map is what gives them back.
+      for (BlockId id = used; id < this->blockCount; ++id) {
+        this->extentEntries[id] = 0;
+      }
+    } else if (used < this->fileBlocks && ::fstat(this->fd, &st) == 0 &&
+        st.st_size == this->GetBlockOffset(this->fileBlocks)) {
+      // The header first, so it never counts blocks past the end of the
+      // file.
+      try {
+        this->WriteHeader(used);
+        (void)::ftruncate(this->fd, this->GetBlockOffset(used));
+      } catch (const DiskManagerException &) {
+      }
+    } else {
+      try {
+        this->PersistBlockCount(this->blockCount);
+      } catch (const DiskManagerException &) {
+      }
+    }
+  }
+  this->CloseFiles();
+}
+
+DatabaseHeader DiskManager::ReadHeader(const std::string &path) {
+  int headerFd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (headerFd < 0) {
+    int err = errno;
+    throw DiskManagerException("Failed to open database file: " + path +
+                               " (errno: " + std::to_string(err) + " - " +
+                               std::strerror(err) + ")");
+  }
+  char bytes[sizeof(RawHeader)];
+  ssize_t n = ::pread(headerFd, bytes, sizeof(bytes), 0);
+  struct stat st {};
+  bool sized = ::fstat(headerFd, &st) == 0;
+  ::close(headerFd);
+  DatabaseHeader header{};
+  if (n != static_cast<ssize_t>(sizeof(bytes)) || !sized) {
+    throw DiskManagerException("Not a database file: " + path);
+  }
+  if (IsHeaderless(bytes, static_cast<size_t>(st.st_size))) {
+    return HeaderlessHeader(static_cast<size_t>(st.st_size));
   }
+  if (!ParseHeader(bytes, header)) {
+    throw DiskManagerException("Not a database file: " + path);
+  }
+  return header;
+}
+
+void DiskManager::OpenHeader(off_t fileSize) {
+  if (fileSize == 0) {
+    // A new database: record how its blocks are laid out.
+    this->WriteHeader(0);
+    return;
+  }
+  AlignedBuffer bytes = MakeAlignedBuffer(HEADER_SIZE);
+
+  DatabaseHeader header{};
+  if (static_cast<size_t>(fileSize) < HEADER_SIZE) {
+    this->ThrowIOError("Not a database file: " + this->path);
+  }
+  this->PreadFully(bytes.get(), 0, HEADER_SIZE);
+  if (IsHeaderless(bytes.get(), static_cast<size_t>(fileSize))) {
+    header = HeaderlessHeader(static_cast<size_t>(fileSize));
+    this->dataOffset = 0;
+  } else if (!ParseHeader(bytes.get(), header)) {
+    this->ThrowIOError("Not a database file: " + this->path);
+  }
+  if (header.blockFormat != PLAIN_BLOCK_FORMAT &&
+      header.blockFormat != BLOCK_FORMAT_VERSION) {
+    this->ThrowIOError("Database blocks are in format " +
+                       std::to_string(header.blockFormat) +
+                       "; this build reads formats " +
+                       std::to_string(PLAIN_BLOCK_FORMAT) + " and " +
+                       std::to_string(BLOCK_FORMAT_VERSION));
+  }
+  if (header.blockSize != this->blockSize) {
+    this->ThrowIOError("Database has " + std::to_string(header.blockSize) +
+                       "-byte blocks; open it with that block size");
+  }
+  if (header.compression != this->config.compression) {
+    this->ThrowIOError(header.compression == BlockCompression::None
+                           ? "Database is not compressed; open it without "
+                             "compression"
+                           : "Database is compressed; open it with "
+                             "compression");
+  }
+  // Whatever was asked for: the blocks already have their layout.
+  this->config.checksums = header.blockFormat == BLOCK_FORMAT_VERSION;
+  this->headerBlockCount = header.blockCount;
+}
 
-  this->db.seekg(0, std::ios::end);
+void DiskManager::WriteHeader(BlockId blocks) {
+  this->headerBlockCount = blocks;
+  if (this->dataOffset == 0) {
+    // A file from before the header keeps its layout: its size is its
+    // block count.
+    return;
+  }
+  RawHeader raw{};
+  std::memcpy(raw.magic, HEADER_MAGIC, sizeof(HEADER_MAGIC));
+  raw.version = HEADER_VERSION;
+  raw.blockSize = static_cast<uint32_t>(this->blockSize);
+  raw.compression = static_cast<uint32_t>(this->config.compression);
+  raw.blockFormat =
+      this->config.checksums ? BLOCK_FORMAT_VERSION : PLAIN_BLOCK_FORMAT;
+  raw.blockCount = blocks;
+  thread_local ScratchBlock scratch;
+  char *bytes = scratch.Get(HEADER_SIZE);
+  std::memset(bytes, 0, HEADER_SIZE);
+  std::memcpy(bytes, &raw, sizeof(raw));
+  this->PwriteFully(bytes, 0, HEADER_SIZE);
+}
 
-  std::streampos endPos = this->db.tellg();
-  if (endPos == -1) {
-    this->db.clear();
-    this->ThrowIOError("Failed to determine file size with tellg()");
+void DiskManager::PersistBlockCount(BlockId blocks) {
+  std::lock_guard<std::mutex> lock(this->mutex);
+  if (blocks > this->headerBlockCount && this->extentEntries == nullptr) {
+    this->WriteHeader(blocks);
   }
+}
 
-  this->blockCount = static_cast<long long>(endPos) / BLOCK_SIZE;
+BlockId DiskManager::WrittenBlocksEnd(BlockId from, BlockId to) {
+  // Blocks are read back from the end in runs; new blocks read as zeros,
+  // so the first one that does not is the last one written.
+  constexpr BlockId RUN_BLOCKS = 64;
+  AlignedBuffer run = MakeAlignedBuffer(RUN_BLOCKS * this->blockSize);
+  while (to > from) {
+    BlockId count = std::min(RUN_BLOCKS, to - from);
+    BlockId first = to - count;
+    this->PreadFully(run.get(), this->GetBlockOffset(first),
+                     count * this->blockSize);
+    for (BlockId i = count; i > 0; --i) {
+      const char *block = run.get() + (i - 1) * this->blockSize;
+      if (block[0] != 0 ||
+          std::memcmp(block, block + 1, this->blockSize - 1) != 0) {
+        return first + i;
+      }
+    }
+    to = first;
+  }
+  return from;
 }
 
-DiskManager::~DiskManager() { this->db.close(); }
 void DiskManager::SyncFile() {
+  if (this->extentMapFd >= 0) {
+    this->Fsync(this->extentMapFd, "extent map");
+  }
+  if (this->freeMapFd >= 0) {
+    this->Fsync(this->freeMapFd, "free-space map");
+  }
+  // Synced with the blocks, so every id handed out so far survives a
+  // crash whether or not its block was written.
+  this->PersistBlockCount(this->blockCount.load(std::memory_order_acquire));
+  this->Fsync(this->fd, "database file");
+}
+
+void DiskManager::Fsync(int fileFd, const char *what) {
+  if (this->config.metrics) {
+    BumpCounter(this->counters.Local().fsyncs);
+  }
+  if (::fsync(fileFd) != 0) {
+    this->ThrowIOError(std::string("Failed to fsync ") + what, errno);
+  }
+}
+
+BlockId DiskManager::GetBlockCount() const { return this->blockCount; }
+
+size_t DiskManager::GetBlockSize() const { return this->blockSize; }
+
+size_t DiskManager::GetPayloadSize() const {
+  return this->config.checksums ? this->blockSize - TRAILER_SIZE
+                                : this->blockSize;
+}
+
+size_t DiskManager::GetFreeBlockCount() const { return this->freeBlocks; }
+
+BlockId DiskManager::AllocateBlock(BlockId hint) {
+  if (this->freeBlocks.load(std::memory_order_relaxed) > 0) {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    BlockId id = this->FindFreeBlock(hint);
+    if (id != INVALID_BLOCK_ID) {
+      // Written to the map before the block is handed out, so a process
+      // crash cannot leave it both in use and free. The write is not synced:
+      // after a power loss the claim survives only if SyncFile ran, and
+      // SyncFile syncs the map before the blocks that could refer to it.
+      this->SetFree(id, false);
+      try {
+        this->WriteFreeMapPage(id / (FREE_MAP_PAGE_WORDS * 64));
+      } catch (...) {
+        this->SetFree(id, true);
+        throw;
+      }
+      return id;
+    }
+  }
+  return this->AllocateBlocks(1);
+}
+
+void DiskManager::DeallocateBlock(BlockId id) {
+  if (id >= this->blockCount.load(std::memory_order_acquire)) {
+    this->ThrowIOError("Trying to free unallocated block " +
+                       std::to_string(id));
+  }
   std::lock_guard<std::mutex> lock(this->mutex);
-  this->db.flush();
+  if (this->IsFree(id)) {
+    this->ThrowIOError("Trying to free block " + std::to_string(id) +
+                       " twice");
+  }
+  this->SetFree(id, true);
+  try {
+    this->WriteFreeMapPage(id / (FREE_MAP_PAGE_WORDS * 64));
+  } catch (...) {
+    this->SetFree(id, false);
+    throw;
+  }
+  // The contents are unspecified from here on: zeros where the hole is
+  // punched, else the last write, trailer and all, so either verifies.
+  if (this->extentEntries != nullptr) {
+    this->ReleaseExtent(std::atomic_ref<uint64_t>(this->extentEntries[id])
+                            .exchange(EXTENT_ALLOCATED));
+    return;
+  }
+  // Only space: failure (no hole punching on this filesystem) just keeps
+  // the old bytes until the block is reused.
+  (void)::fallocate(this->fd, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE,
+                    this->GetBlockOffset(id),
+                    static_cast<off_t>(this->blockSize));
+}
+
+BlockId DiskManager::AllocateBlocks(BlockId count) {
+  if (count == 0) {
+    throw DiskManagerException("Trying to allocate zero blocks");
+  }
+  // Ids are only taken once the file holds them, so a failed extension
+  // leaves the count untouched and concurrent readers never see an id past
+  // the end of the file.
+  BlockId first = this->blockCount.load(std::memory_order_relaxed);
+  do {
+    if (first + count > this->fileBlocks.load(std::memory_order_acquire)) {
+      this->GrowFileTo(first + count);
+    }
+  } while (!this->blockCount.compare_exchange_weak(
+      first, first + count, std::memory_order_acq_rel,
+      std::memory_order_relaxed));
+  if (this->extentEntries != nullptr) {
+    // Marked so the ids survive a reopen before the blocks are written.
+    for (BlockId id = first; id < first + count; ++id) {
+      std::atomic_ref<uint64_t>(this->extentEntries[id])
+          .store(EXTENT_ALLOCATED, std::memory_order_relaxed);
+    }
+  }
+  return first;
 }
 
-BlockId DiskManager::AllocateBlock() {
+void DiskManager::GrowFileTo(BlockId blocks) {
   std::lock_guard<std::mutex> lock(this->mutex);
-  BlockId newBlockId = this->blockCount;
-  long long offset = this->GetBlockOffset(newBlockId);
-  this->db.seekp(offset, std::ios::beg);
-  if (this->db.fail()) {
-    this->db.clear();
-    this->ThrowIOError("Failed to seek new block at offset " +
-                       std::to_string(offset));
+  BlockId current = this->fileBlocks.load(std::memory_order_relaxed);
+  if (blocks <= current) {
+    return;
   }
+  BlockId target = std::max<BlockId>(
+      blocks, current + std::max<BlockId>(1, this->config.growthBlocks));
+  // Once per extent, so a reopen after a crash only has the blocks past
+  // the last extent's start to check for ones written.
+  BlockId handedOut = this->blockCount.load(std::memory_order_acquire);
+  if (handedOut > this->headerBlockCount && this->extentEntries == nullptr) {
+    this->WriteHeader(handedOut);
+  }
+  long long offset = this->GetBlockOffset(current);
+  long long length = this->GetBlockOffset(target) - offset;
 
-  std::vector<char> emptyBlock(BLOCK_SIZE, 0);
-  this->db.write(emptyBlock.data(), BLOCK_SIZE);
+  if (this->extentEntries != nullptr) {
+    // Extents are placed as blocks are written; only the map grows.
+    this->GrowEntryFile(this->extentMapFd, target, "extent map");
+    std::memset(this->extentEntries + current, 0,
+                (target - current) * sizeof(uint64_t));
+  } else if (::fallocate(this->fd, 0, offset, length) != 0) {
+    int err = errno;
+    // No fallocate on this filesystem: extend sparsely instead. Holes read
+    // as zeros just the same.
+    if ((err != EOPNOTSUPP && err != ENOSYS) ||
+        ::ftruncate(this->fd, offset + length) != 0) {
+      this->ThrowIOError("Failed to extend database file to " +
+                             std::to_string(target) + " blocks",
+                         err == EOPNOTSUPP || err == ENOSYS ? errno : err);
+    }
+  }
+  this->fileBlocks.store(target, std::memory_order_release);
+}
 
-  if (this->db.fail()) {
-    this->db.clear();
-    this->ThrowIOError("Failed to write new block at offset " +
-                       std::to_string(offset));
+void DiskManager::ReadBlock(BlockId id, char *buff) {
+  this->ValidateRequest(id, buff, IOOperation::Read);
+  if (!this->config.metrics) {
+    this->LoadBlock(id, buff);
+    this->VerifyBlock(id, buff);
+    return;
   }
+  uint64_t start = NowNanos();
+  size_t bytes = this->LoadBlock(id, buff);
+  this->VerifyBlock(id, buff);
+  DiskCounters &counters = this->counters.Local();
+  counters.readLatency.Record(NowNanos() - start);
+  BumpCounter(counters.blocksRead);
+  BumpCounter(counters.bytesRead, bytes);
+}
 
-  this->db.flush();
-  this->blockCount++;
+void DiskManager::WriteBlock(BlockId id, const char *buff) {
+  this->ValidateRequest(id, buff, IOOperation::Write);
+  uint64_t start = this->config.metrics ? NowNanos() : 0;
+  const char *block = buff;
+  if (this->config.checksums) {
+    // Stamped in a copy, so the trailer matches the bytes written even if
+    // the caller's buffer changes under the write.
+    thread_local ScratchBlock scratch;
+    char *stamped = scratch.Get(this->blockSize);
+    std::memcpy(stamped, buff, this->GetPayloadSize());
+    this->StampTrailer(stamped);
+    block = stamped;
+  }
+  size_t bytes = this->StoreBlock(id, block);
+  if (this->config.metrics) {
+    DiskCounters &counters = this->counters.Local();
+    counters.writeLatency.Record(NowNanos() - start);
+    BumpCounter(counters.blocksWritten);
+    BumpCounter(counters.bytesWritten, bytes);
+  }
+}
 
-  return newBlockId;
+char *DiskManager::MappedBlock(BlockId id) {
+  if (this->mapping == nullptr ||
+      id >= this->blockCount.load(std::memory_order_acquire) ||
+      static_cast<size_t>(this->GetBlockOffset(id)) + this->blockSize >
+          this->config.mmapWindowBytes) {
+    return nullptr;
+  }
+  return this->mapping + this->GetBlockOffset(id);
 }
 
-void DiskManager::ReadBlock(BlockId id, char *buff) {
-  std::lock_guard<std::mutex> lock(this->mutex);
-  if (!this->db.is_open()) {
-    this->ThrowIOError("Trying to read from closed DB");
+void DiskManager::DropMappedBlock(BlockId id) {
+  char *block = this->MappedBlock(id);
+  if (block != nullptr &&
+      ::madvise(block, this->blockSize, MADV_DONTNEED) != 0) {
+    this->ThrowIOError("Failed to drop mapped block " + std::to_string(id),
+                       errno);
   }
-  if (buff == nullptr) {
-    this->ThrowIOError("Trying to read into null buffer");
+}
+
+void DiskManager::VerifyBlock(BlockId id, const char *buff) {
+  if (!this->TrailerMatches(buff)) {
+    throw BlockChecksumException("Block " + std::to_string(id) +
+                                     " does not match its checksum"
+                                     "\n in File: " +
+                                     this->path,
+                                 id);
   }
-  if (id >= this->blockCount) {
-    this->ThrowIOError("Trying to read unallocated block " +
-                       std::to_string(id));
+}
+
+bool DiskManager::UsesDirectIO() const { return this->directIO; }
+
+bool DiskManager::UsesCompression() const {
+  return this->extentEntries != nullptr;
+}
+
+DiskManagerStats DiskManager::GetStats() const {
+  DiskManagerStats stats;
+  this->counters.ForEach([&stats](const DiskCounters &counters) {
+    stats.blocksRead += counters.blocksRead.load(std::memory_order_relaxed);
+    stats.blocksWritten +=
+        counters.blocksWritten.load(std::memory_order_relaxed);
+    stats.bytesRead += counters.bytesRead.load(std::memory_order_relaxed);
+    stats.bytesWritten += counters.bytesWritten.load(std::memory_order_relaxed);
+    stats.fsyncs += counters.fsyncs.load(std::memory_order_relaxed);
+    counters.readLatency.AddTo(stats.readLatency);
+    counters.writeLatency.AddTo(stats.writeLatency);
+  });
+  return stats;
+}
+
+std::string DiskManagerStats::ToText() const {
+  return "disk.blocks_read " + std::to_string(this->blocksRead) +
+         "\ndisk.blocks_written " + std::to_string(this->blocksWritten) +
+         "\ndisk.bytes_read " + std::to_string(this->bytesRead) +
+         "\ndisk.bytes_written " + std::to_string(this->bytesWritten) +
+         "\ndisk.fsyncs " + std::to_string(this->fsyncs) +
+         "\ndisk.read_ns " + this->readLatency.ToText() +
+         "\ndisk.write_ns " + this->writeLatency.ToText() + "\n";
+}
+
+std::string DiskManagerStats::ToJson() const {
+  return "{\"blocksRead\":" + std::to_string(this->blocksRead) +
+         ",\"blocksWritten\":" + std::to_string(this->blocksWritten) +
+         ",\"bytesRead\":" + std::to_string(this->bytesRead) +
+         ",\"bytesWritten\":" + std::to_string(this->bytesWritten) +
+         ",\"fsyncs\":" + std::to_string(this->fsyncs) +
+         ",\"readNs\":" + this->readLatency.ToJson() +
+         ",\"writeNs\":" + this->writeLatency.ToJson() + "}";
+}
+
+size_t DiskManager::LoadBlock(BlockId id, char *buff) {
+  if (this->extentEntries == nullptr) {
+    this->PreadFully(buff, this->GetBlockOffset(id), this->blockSize);
+    return this->blockSize;
+  }
+  uint64_t entry = std::atomic_ref<uint64_t>(this->extentEntries[id])
+                       .load(std::memory_order_relaxed);
+  size_t length = ExtentLength(entry);
+  long long offset = ExtentOffset(ExtentSector(entry));
+  if (length == 0) {
+    std::memset(buff, 0, this->blockSize);
+  } else if (length == this->blockSize) {
+    this->PreadFully(buff, offset, length);
+  } else {
+    thread_local ScratchBlock scratch;
+    char *packed = scratch.Get(this->blockSize);
+    this->PreadFully(packed, offset, length);
+    if (Lz4::Decompress(packed, length, buff, this->blockSize) !=
+        this->blockSize) {
+      throw BlockChecksumException("Block " + std::to_string(id) +
+                                       " does not decompress\n in File: " +
+                                       this->path,
+                                   id);
+    }
   }
+  return length;
+}
 
-  long long offset = this->GetBlockOffset(id);
-  this->db.seekg(offset, std::ios::beg);
-  if (this->db.fail()) {
-    this->db.clear();
-    this->ThrowIOError("Failed to seek read block at offset " +
-                       std::to_string(offset));
+size_t DiskManager::StoreBlock(BlockId id, const char *buff) {
+  if (this->extentEntries == nullptr) {
+    this->PwriteFully(buff, this->GetBlockOffset(id), this->blockSize);
+    return this->blockSize;
   }
+  thread_local ScratchBlock scratch;
+  const char *stored;
+  size_t length =
+      PackBlock(buff, this->blockSize, scratch.Get(this->blockSize), stored);
 
-  this->db.read(const_cast<char *>(buff), BLOCK_SIZE);
-  if (this->db.fail()) {
-    this->db.clear();
-    if (this->db.eof()) {
-      this->ThrowIOError("Reached EOF while reading block at offset " +
-                         std::to_string(offset));
-    } else {
+  // Every write goes to a fresh extent: one rewritten in place could still
+  // be taking bytes after an overlapping write of the block had released
+  // it for reuse.
+  uint64_t current = std::atomic_ref<uint64_t>(this->extentEntries[id])
+                         .load(std::memory_order_relaxed);
+  uint64_t entry = MakeExtent(this->ReserveExtent(SectorsFor(length)), length);
+  try {
+    this->PwriteFully(stored, ExtentOffset(ExtentSector(entry)), length);
+  } catch (...) {
+    this->ReleaseExtent(entry);
+    throw;
+  }
+  this->PublishExtent(id, current, entry);
+  return length;
+}
+
+void DiskManager::PublishExtent(BlockId id, uint64_t current,
+                                uint64_t entry) {
+  // Overlapping writes of a block are unordered, as pwrites are: the first
+  // to finish replaces `current`, and a later one finds the entry moved
+  // and gives its own extent back. Either way each extent is released
+  // once.
+  if (std::atomic_ref<uint64_t>(this->extentEntries[id])
+          .compare_exchange_strong(current, entry,
+                                   std::memory_order_relaxed)) {
+    this->ReleaseExtent(current);
+  } else {
+    this->ReleaseExtent(entry);
+  }
+}
+
+uint64_t DiskManager::ReserveExtent(unsigned sectors) {
+  std::lock_guard<std::mutex> lock(this->extentMutex);
+  // The smallest free extent that fits, split if larger, before growing
+  // the file.
+  for (unsigned size = sectors; size < this->freeExtents.size(); ++size) {
+    std::vector<uint64_t> &free = this->freeExtents[size];
+    if (!free.empty()) {
+      uint64_t sector = free.back();
+      free.pop_back();
+      if (size > sectors) {
+        this->freeExtents[size - sectors].push_back(sector + sectors);
+      }
+      return sector;
+    }
+  }
+  uint64_t sector = this->extentTail;
+  this->extentTail += sectors;
+  return sector;
+}
+
+void DiskManager::ReleaseExtent(uint64_t entry) {
+  unsigned capacity = ExtentCapacity(entry);
+  if (capacity != 0) {
+    std::lock_guard<std::mutex> lock(this->extentMutex);
+    this->freeExtents[capacity].push_back(ExtentSector(entry));
+  }
+}
+
+bool DiskManager::NeedsBounce(const char *buff) const {
+  return this->directIO &&
+         reinterpret_cast<uintptr_t>(buff) % DIRECT_IO_ALIGNMENT != 0;
+}
+
+bool DiskManager::DisableDirectIO() {
+  if (!this->directIO.exchange(false)) {
+    return false;
+  }
+  int flags = ::fcntl(this->fd, F_GETFL);
+  return flags >= 0 && ::fcntl(this->fd, F_SETFL, flags & ~O_DIRECT) == 0;
+}
+
+std::vector<BlockId> DiskManager::Scrub(unsigned threads) {
+  if (threads == 0) {
+    threads = std::max(1u, std::thread::hardware_concurrency());
+  }
+  // Workers claim runs of blocks from a shared cursor and read each run
+  // with one pread.
+  constexpr BlockId RUN_BLOCKS = 64;
+  BlockId blocks = this->blockCount.load(std::memory_order_acquire);
+  std::atomic<uint64_t> cursor(0);
+  std::vector<std::vector<BlockId>> mismatched(threads);
+  std::vector<std::exception_ptr> errors(threads);
+  // A block that does not decompress counts as a mismatch.
+  auto matches = [this](BlockId id, char *block, bool load) {
+    if (load) {
+      try {
+        this->LoadBlock(id, block);
+      } catch (const BlockChecksumException &) {
+        return false;
+      }
+    }
+    return this->TrailerMatches(block);
+  };
+
+  auto scan = [&](unsigned worker) {
+    try {
+      AlignedBuffer run = MakeAlignedBuffer(RUN_BLOCKS * this->blockSize);
+      while (true) {
+        uint64_t first = cursor.fetch_add(RUN_BLOCKS);
+        if (first >= blocks) {
+          return;
+        }
+        BlockId count = static_cast<BlockId>(
+            std::min<uint64_t>(RUN_BLOCKS, blocks - first));
+        if (this->extentEntries == nullptr) {
+          this->PreadFully(run.get(),
+                           this->GetBlockOffset(static_cast<BlockId>(first)),
+                           count * this->blockSize);
+        }
+        for (BlockId i = 0; i < count; ++i) {
+          BlockId id = static_cast<BlockId>(first + i);
+          char *block = run.get() + i * this->blockSize;
+          // A write landing during the read can tear it, so only a block
+          // that fails twice is reported.
+          if (!matches(id, block, this->extentEntries != nullptr) &&
+              !matches(id, block, true)) {
+            mismatched[worker].push_back(id);
+          }
+        }
+      }
+    } catch (...) {
+      errors[worker] = std::current_exception();
+    }
+  };
+
+  std::vector<std::thread> workers;
+  for (unsigned worker = 1; worker < threads; ++worker) {
+    workers.emplace_back(scan, worker);
+  }
+  scan(0);
+  for (auto &worker : workers) {
+    worker.join();
+  }
+
+  for (const auto &error : errors) {
+    if (error) {
+      std::rethrow_exception(error);
+    }
+  }
+  std::vector<BlockId> result;
+  for (const auto &ids : mismatched) {
+    result.insert(result.end(), ids.begin(), ids.end());
+  }
+  std::sort(result.begin(), result.end());
+  return result;
+}
+
+void DiskManager::OpenExtentMap() {
+  // The header has already checked the mode matches the database.
+  if (this->config.compression == BlockCompression::None) {
+    return;
+  }
+
+  std::string extentMapPath = this->path + EXTENT_MAP_SUFFIX;
+  this->extentMapFd = ::open(extentMapPath.c_str(), O_RDWR | O_CLOEXEC);
+  if (this->extentMapFd < 0 && errno == ENOENT) {
+    if (this->blockCount != 0) {
+      this->ThrowIOError("Extent map is missing: " + extentMapPath);
+    }
+    this->extentMapFd =
+        ::open(extentMapPath.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+  }
+  struct stat st {};
+  if (this->extentMapFd < 0 || ::fstat(this->extentMapFd, &st) != 0) {
+    this->ThrowIOError("Failed to open extent map: " + extentMapPath, errno);
+  }
+  BlockId entries = static_cast<BlockId>(st.st_size / sizeof(uint64_t));
+  this->extentEntries =
+      this->MapEntryFile(this->extentMapFd, entries, "extent map");
+
+  // The map outlives the data file's size as a record of the ids: the
+  // database ends at the last allocated entry.
+  BlockId blocks = entries;
+  while (blocks > 0 && this->extentEntries[blocks - 1] == 0) {
+    blocks--;
+  }
+  this->blockCount = blocks;
+  this->fileBlocks = entries;
+
+  // Everything between live extents is free.
+  std::vector<std::pair<uint64_t, unsigned>> live;
+  for (BlockId id = 0; id < blocks; ++id) {
+    uint64_t entry = this->extentEntries[id];
+    if (ExtentCapacity(entry) != 0) {
+      live.emplace_back(ExtentSector(entry), ExtentCapacity(entry));
+    }
+  }
+  std::sort(live.begin(), live.end());
+  unsigned sectorsPerBlock = SectorsFor(this->blockSize);
+  this->freeExtents.assign(sectorsPerBlock + 1, {});
+  for (const auto &[sector, capacity] : live) {
+    while (this->extentTail < sector) {
+      unsigned size = static_cast<unsigned>(std::min<uint64_t>(
+          sectorsPerBlock, sector - this->extentTail));
+      this->freeExtents[size].push_back(this->extentTail);
+      this->extentTail += size;
+    }
+    this->extentTail = std::max(this->extentTail, sector + capacity);
+  }
+}
+
+uint64_t *DiskManager::MapEntryFile(int entryFd, BlockId blocks,
+                                    const char *name) {
+  this->GrowEntryFile(entryFd, blocks, name);
+  void *window = ::mmap(nullptr, ENTRY_WINDOW_BYTES, PROT_READ | PROT_WRITE,
+                        MAP_SHARED | MAP_NORESERVE, entryFd, 0);
+  if (window == MAP_FAILED) {
+    this->ThrowIOError(std::string("Failed to map ") + name, errno);
+  }
+  return static_cast<uint64_t *>(window);
+}
+
+void DiskManager::GrowEntryFile(int entryFd, BlockId blocks,
+                                const char *name) {
+  if (entryFd < 0) {
+    return;
+  }
+  // Only ever grows: another handle on the file may have the entries
+  // mapped, and touching a truncated page would kill it with SIGBUS.
+  struct stat st {};
+  off_t size = static_cast<off_t>(blocks * sizeof(uint64_t));
+  if (::fstat(entryFd, &st) != 0 ||
+      (st.st_size < size && ::ftruncate(entryFd, size) != 0)) {
+    this->ThrowIOError(std::string("Failed to resize ") + name + " to " +
+                           std::to_string(blocks) + " blocks",
+                       errno);
+  }
+}
+
+void DiskManager::StampTrailer(char *block) const {
+  BlockTrailer trailer{BLOCK_FORMAT_VERSION, TRAILER_HAS_CRC, 0};
+  char *at = block + this->GetPayloadSize();
+  std::memcpy(at, &trailer, sizeof(trailer));
+  trailer.crc = Crc32c::Compute(block, this->blockSize - sizeof(uint32_t));
+  std::memcpy(at + offsetof(BlockTrailer, crc), &trailer.crc,
+              sizeof(trailer.crc));
+}
+
+bool DiskManager::TrailerMatches(const char *block) const {
+  if (!this->config.checksums) {
+    return true;
+  }
+  BlockTrailer trailer;
+  std::memcpy(&trailer, block + this->GetPayloadSize(), sizeof(trailer));
+  if (trailer.version == 0) {
+    // New, or punched out when freed; anything but zeros is a first write
+    // that tore.
+    return trailer.flags == 0 && trailer.crc == 0 && block[0] == 0 &&
+           std::memcmp(block, block + 1, this->GetPayloadSize() - 1) == 0;
+  }
+  // A block of another format version fails too.
+  return trailer.version == BLOCK_FORMAT_VERSION &&
+         ((trailer.flags & TRAILER_HAS_CRC) == 0 ||
+          trailer.crc ==
+              Crc32c::Compute(block, this->blockSize - sizeof(uint32_t)));
+}
+
+void DiskManager::LoadFreeMap() {
+  // Created with the first freed block; until then nothing is free.
+  std::string freeMapPath = this->path + FREE_MAP_SUFFIX;
+  this->freeMapFd = ::open(freeMapPath.c_str(), O_RDWR | O_CLOEXEC);
+  if (this->freeMapFd < 0) {
+    if (errno == ENOENT) {
+      return;
+    }
+    this->ThrowIOError("Failed to open free-space map: " + freeMapPath,
+                       errno);
+  }
+  struct stat st {};
+  if (::fstat(this->freeMapFd, &st) != 0) {
+    this->ThrowIOError("Failed to determine free-space map size", errno);
+  }
+
+  size_t pages = static_cast<size_t>(st.st_size) / BLOCK_SIZE;
+  this->freeMap.assign(pages * FREE_MAP_PAGE_WORDS, 0);
+  char *bytes = reinterpret_cast<char *>(this->freeMap.data());
+  size_t total = pages * BLOCK_SIZE;
+  for (size_t done = 0; done < total;) {
+    ssize_t n = ::pread(this->freeMapFd, bytes + done, total - done,
+                        static_cast<off_t>(done));
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n <= 0) {
+      this->ThrowIOError("Failed to read free-space map", n < 0 ? errno : 0);
+    }
+    done += static_cast<size_t>(n);
+  }
+
+  // Bits past the end of the file are left over from blocks trimmed on
+  // close; clear them so the ids are not handed out as free later.
+  BlockId blocks = this->blockCount;
+  size_t free = 0;
+  std::vector<size_t> stalePages;
+  for (size_t word = 0; word < this->freeMap.size(); ++word) {
+    uint64_t &bits = this->freeMap[word];
+    uint64_t first = static_cast<uint64_t>(word) * 64;
+    uint64_t valid = ~uint64_t{0};
+    if (first >= blocks) {
+      valid = 0;
+    } else if (first + 64 > blocks) {
+      valid >>= first + 64 - blocks;
+    }
+    if ((bits & ~valid) != 0) {
+      bits &= valid;
+      size_t page = word / FREE_MAP_PAGE_WORDS;
+      if (stalePages.empty() || stalePages.back() != page) {
+        stalePages.push_back(page);
+      }
+    }
+    free += static_cast<size_t>(std::popcount(bits));
+  }
+  for (size_t page : stalePages) {
+    this->WriteFreeMapPage(page);
+  }
+  this->freeBlocks = free;
+}
+
+bool DiskManager::IsFree(BlockId id) const {
+  size_t word = id / 64;
+  return word < this->freeMap.size() &&
+         (this->freeMap[word] >> (id % 64) & 1) != 0;
+}
+
+void DiskManager::SetFree(BlockId id, bool isFree) {
+  size_t word = id / 64;
+  if (word >= this->freeMap.size()) {
+    size_t pages = word / FREE_MAP_PAGE_WORDS + 1;
+    this->freeMap.resize(pages * FREE_MAP_PAGE_WORDS, 0);
+  }
+  uint64_t bit = uint64_t{1} << (id % 64);
+  if (isFree) {
+    this->freeMap[word] |= bit;
+    this->freeBlocks++;
+  } else {
+    this->freeMap[word] &= ~bit;
+    this->freeBlocks--;
+  }
+}
+
+BlockId DiskManager::FindFreeBlock(BlockId hint) const {
+  size_t words = this->freeMap.size();
+  if (words == 0) {
+    return INVALID_BLOCK_ID;
+  }
+  if (hint >= this->blockCount.load(std::memory_order_relaxed)) {
+    hint = 0;
+  }
+
+  // The hint's own word first, above the hint and then below it; then
+  // whole words at growing distance on either side.
+  size_t home = hint / 64;
+  unsigned bit = hint % 64;
+  uint64_t bits = this->freeMap[home];
+  uint64_t above = bits & (~uint64_t{0} << bit);
+  if (above != 0) {
+    return static_cast<BlockId>(home * 64 + std::countr_zero(above));
+  }
+  uint64_t below = bits & ~(~uint64_t{0} << bit);
+  if (below != 0) {
+    return static_cast<BlockId>(home * 64 + 63 - std::countl_zero(below));
+  }
+  for (size_t distance = 1; distance < words; ++distance) {
+    bool inRange = false;
+    if (home + distance < words) {
+      inRange = true;
+      uint64_t next = this->freeMap[home + distance];
+      if (next != 0) {
+        return static_cast<BlockId>((home + distance) * 64 +
+                                    std::countr_zero(next));
+      }
+    }
+    if (distance <= home) {
+      inRange = true;
+      uint64_t previous = this->freeMap[home - distance];
+      if (previous != 0) {
+        return static_cast<BlockId>((home - distance) * 64 + 63 -
+                                    std::countl_zero(previous));
+      }
+    }
+    if (!inRange) {
+      break;
+    }
+  }
+  return INVALID_BLOCK_ID;
+}
+
+void DiskManager::WriteFreeMapPage(size_t page) {
+  if (this->freeMapFd < 0) {
+    std::string freeMapPath = this->path + FREE_MAP_SUFFIX;
+    this->freeMapFd =
+        ::open(freeMapPath.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (this->freeMapFd < 0) {
+      this->ThrowIOError("Failed to create free-space map: " + freeMapPath,
+                         errno);
+    }
+  }
+  const char *bytes = reinterpret_cast<const char *>(
+      this->freeMap.data() + page * FREE_MAP_PAGE_WORDS);
+  off_t offset = static_cast<off_t>(page * BLOCK_SIZE);
+  for (size_t done = 0; done < BLOCK_SIZE;) {
+    ssize_t n = ::pwrite(this->freeMapFd, bytes + done, BLOCK_SIZE - done,
+                         offset + static_cast<off_t>(done));
+    if (n < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      this->ThrowIOError("Failed to write free-space map page " +
+                             std::to_string(page),
+                         errno);
+    }
+    done += static_cast<size_t>(n);
+  }
+}
+
+void DiskManager::CloseFiles() {
+  if (this->mapping != nullptr) {
+    ::munmap(this->mapping, this->config.mmapWindowBytes);
+    this->mapping = nullptr;
+  }
+  if (this->extentEntries != nullptr) {
+    ::munmap(this->extentEntries, ENTRY_WINDOW_BYTES);
+    this->extentEntries = nullptr;
+  }
+  if (this->extentMapFd >= 0) {
+    ::close(this->extentMapFd);
+    this->extentMapFd = -1;
+  }
+  if (this->freeMapFd >= 0) {
+    ::close(this->freeMapFd);
+    this->freeMapFd = -1;
+  }
+  if (this->fd >= 0) {
+    ::close(this->fd);
+    this->fd = -1;
+  }
+}
+
+void DiskManager::PreadFully(char *buff, long long offset, size_t length) {
+  if (this->NeedsBounce(buff)) {
+    thread_local ScratchBlock scratch;
+    char *bounce = scratch.Get(this->blockSize);
+    for (size_t done = 0; done < length; done += this->blockSize) {
+      this->PreadFully(bounce, offset + static_cast<long long>(done),
+                       this->blockSize);
+      std::memcpy(buff + done, bounce, this->blockSize);
+    }
+    return;
+  }
+
+  size_t done = 0;
+  while (done < length) {
+    ssize_t n = ::pread(this->fd, buff + done, length - done,
+                        static_cast<off_t>(offset + done));
+    if (n < 0) {
+      if (errno == EINTR ||
+          (errno == EINVAL && this->directIO && this->DisableDirectIO())) {
+        continue;
+      }
       this->ThrowIOError("Failed to read block at offset " +
+                             std::to_string(offset),
+                         errno);
+    }
+    if (n == 0) {
+      this->ThrowIOError("Reached EOF while reading block at offset " +
                          std::to_string(offset));
     }
+    done += static_cast<size_t>(n);
   }
 }
 
-void DiskManager::WriteBlock(BlockId id, const char *buff) {
-  std::lock_guard<std::mutex> lock(this->mutex);
-  if (!this->db.is_open()) {
-    this->ThrowIOError("Trying to write to closed DB");
+void DiskManager::PwriteFully(const char *buff, long long offset,
+                              size_t length) {
+  if (this->NeedsBounce(buff)) {
+    thread_local ScratchBlock scratch;
+    char *bounce = scratch.Get(this->blockSize);
+    for (size_t done = 0; done < length; done += this->blockSize) {
+      std::memcpy(bounce, buff + done, this->blockSize);
+      this->PwriteFully(bounce, offset + static_cast<long long>(done),
+                        this->blockSize);
+    }
+    return;
+  }
+
+  size_t done = 0;
+  while (done < length) {
+    ssize_t n = ::pwrite(this->fd, buff + done, length - done,
+                         static_cast<off_t>(offset + done));
+    if (n < 0) {
+      if (errno == EINTR ||
+          (errno == EINVAL && this->directIO && this->DisableDirectIO())) {
+        continue;
+      }
+      this->ThrowIOError("Failed to write block at offset " +
+                             std::to_string(offset),
+                         errno);
+    }
+    done += static_cast<size_t>(n);
+  }
+}
+
+void DiskManager::ValidateRequest(BlockId id, const char *buff,
+                                  IOOperation op) {
+  bool isRead = op == IOOperation::Read;
+  if (this->fd < 0) {
+    this->ThrowIOError(isRead ? "Trying to read from closed DB"
+                              : "Trying to write to closed DB");
   }
   if (buff == nullptr) {
-    this->ThrowIOError("Trying to write from null buffer");
+    this->ThrowIOError(isRead ? "Trying to read into null buffer"
+                              : "Trying to write from null buffer");
   }
-  if (id >= this->blockCount) {
-    this->ThrowIOError("Trying to write unallocated block " +
-                       std::to_string(id));
+  if (id >= this->blockCount.load(std::memory_order_acquire)) {
+    this->ThrowIOError(std::string(isRead ? "Trying to read"
+                                          : "Trying to write") +
+                       " unallocated block " + std::to_string(id));
   }
+}
 
-  long long offset = this->GetBlockOffset(id);
-  this->db.seekp(offset, std::ios::beg);
-  if (this->db.fail()) {
-    this->db.clear();
-    this->ThrowIOError("Failed to seek write block at offset " +
-                       std::to_string(offset));
+IOEngine &DiskManager::GetIOEngine() {
+  IOEngine *engine = this->ioEngineReady.load(std::memory_order_acquire);
+  if (engine != nullptr) {
+    return *engine;
   }
 
-  this->db.write(buff, BLOCK_SIZE);
-  if (this->db.fail()) {
-    this->db.clear();
-    this->ThrowIOError("Failed to write block at offset " +
-                       std::to_string(offset));
+  std::lock_guard<std::mutex> lock(this->ioEngineMutex);
+  if (!this->ioEngine) {
+    try {
+      this->ioEngine =
+          this->config.ioEngineFactory
+              ? this->config.ioEngineFactory(this->fd)
+              : IOEngine::Create(this->fd, this->config.ioEngine,
+                                 this->config.ioQueueDepth,
+                                 this->config.ioWorkerThreads);
+    } catch (const IOEngineException &e) {
+      this->ThrowIOError(std::string("Failed to start I/O engine: ") +
+                         e.what());
+    }
+    if (!this->registeredBuffers.empty()) {
+      this->ioEngine->RegisterBuffers(this->registeredBuffers);
+    }
+    this->ioEngineReady.store(this->ioEngine.get(), std::memory_order_release);
+  }
+  return *this->ioEngine;
+}
+
+bool DiskManager::RegisterBuffers(const std::vector<iovec> &buffers) {
+  std::lock_guard<std::mutex> lock(this->ioEngineMutex);
+  this->registeredBuffers = buffers;
+  if (this->ioEngine) {
+    return this->ioEngine->RegisterBuffers(buffers);
+  }
+  return true;
+}
+
+const char *DiskManager::IOEngineName() { return this->GetIOEngine().Name(); }
+
+IORequest DiskManager::PrepareRequest(const BlockIORequest &request) {
+  char *buffer = request.buffer;
+  IOCallback callback = request.callback;
+  if (request.op == IOOperation::Write && this->config.checksums) {
+    // Stamped where it is: the caller keeps the buffer still until the
+    // write completes, so the trailer matches the bytes written, and a
+    // registered frame is still written as a fixed buffer.
+    this->StampTrailer(buffer);
+  } else if (this->config.checksums) {
+    callback = [this, buffer, callback = std::move(callback)](int result) {
+      if (result == 0 && !this->TrailerMatches(buffer)) {
+        result = -EBADMSG;
+      }
+      if (callback) {
+        callback(result);
+      }
+    };
+  }
+  long long offset = this->GetBlockOffset(request.id);
+  size_t length = this->blockSize;
+  if (this->extentEntries != nullptr) {
+    // Wraps the checksum callback too: the map is only updated once the
+    // extent is written, and reads are verified once decompressed.
+    BlockId id = request.id;
+    uint64_t current = std::atomic_ref<uint64_t>(this->extentEntries[id])
+                           .load(std::memory_order_relaxed);
+    std::shared_ptr<char[]> packed =
+        MakeAlignedBuffer(this->blockSize);
+    if (request.op == IOOperation::Write) {
+      const char *stored;
+      length = PackBlock(buffer, this->blockSize, packed.get(), stored);
+      uint64_t entry =
+          MakeExtent(this->ReserveExtent(SectorsFor(length)), length);
+      callback = [this, id, current, entry, packed,
+                  callback = std::move(callback)](int result) {
+        if (result == 0) {
+          this->PublishExtent(id, current, entry);
+        } else {
+          this->ReleaseExtent(entry);
+        }
+        if (callback) {
+          callback(result);
+        }
+      };
+      buffer = const_cast<char *>(stored);
+      offset = ExtentOffset(ExtentSector(entry));
+    } else {
+      length = ExtentLength(current);
+      offset = ExtentOffset(ExtentSector(current));
+      if (length != this->blockSize) {
+        // A never-written block is a zero-length read, so it still
+        // completes on an engine thread.
+        callback = [packed, buffer, length, blockSize = this->blockSize,
+                    callback = std::move(callback)](int result) {
+          if (result == 0) {
+            if (length == 0) {
+              std::memset(buffer, 0, blockSize);
+            } else if (Lz4::Decompress(packed.get(), length, buffer,
+                                       blockSize) != blockSize) {
+              result = -EBADMSG;
+            }
+          }
+          if (callback) {
+            callback(result);
+          }
+        };
+        buffer = packed.get();
+      }
+    }
+  }
+  // Wraps the checksum callback, so reads are verified in the caller's
+  // buffer once the bounce copy has landed.
+  if (this->NeedsBounce(buffer)) {
+    std::shared_ptr<char[]> bounce = MakeAlignedBuffer(this->blockSize);
+    if (request.op == IOOperation::Write) {
+      std::memcpy(bounce.get(), buffer, this->blockSize);
+      callback = [bounce, callback = std::move(callback)](int result) {
+        if (callback) {
+          callback(result);
+        }
+      };
+    } else {
+      callback = [bounce, buffer, blockSize = this->blockSize,
+                  callback = std::move(callback)](int result) {
+        if (result == 0) {
+          std::memcpy(buffer, bounce.get(), blockSize);
+        }
+        if (callback) {
+          callback(result);
+        }
+      };
+    }
+    buffer = bounce.get();
+  }
+  return IORequest{request.op, offset, buffer, length, std::move(callback)};
+}
+
+void DiskManager::SubmitBatch(std::vector<BlockIORequest> &requests) {
+  for (const auto &request : requests) {
+    this->ValidateRequest(request.id, request.buffer, request.op);
   }
+  IOEngine &engine = this->GetIOEngine();
+
+  // From here on every request completes through its callback, so one is
+  // only taken out of `requests` once its I/O request is in the batch.
+  std::vector<IORequest> batch;
+  size_t next = 0;
+  try {
+    batch.reserve(requests.size());
+    for (; next < requests.size(); ++next) {
+      batch.push_back(this->PrepareRequest(requests[next]));
+      requests[next].callback = nullptr;
+    }
+  } catch (...) {
+    // Out of memory or extents: undo what the batch holds through its own
+    // callbacks, and fail the requests not reached.
+    for (auto &request : batch) {
+      if (request.callback) {
+        request.callback(-EIO);
+      }
+    }
+    for (; next < requests.size(); ++next) {
+      IOCallback callback = std::move(requests[next].callback);
+      requests[next].callback = nullptr;
+      if (callback) {
+        callback(-EIO);
+      }
+    }
+    return;
+  }
+
+  if (this->config.metrics) {
+    DiskCounters &counters = this->counters.Local();
+    for (const auto &request : batch) {
+      bool isRead = request.op == IOOperation::Read;
+      BumpCounter(isRead ? counters.blocksRead : counters.blocksWritten);
+      BumpCounter(isRead ? counters.bytesRead : counters.bytesWritten,
+                  request.length);
+    }
+  }
+  try {
+    engine.Submit(batch);
+  } catch (...) {
+    // Engines report refused submissions through the callbacks, but one
+    // that throws leaves the callbacks of requests it did not take.
+    for (auto &request : batch) {
+      if (request.callback) {
+        request.callback(-EIO);
+      }
+    }
+  }
+}
+
+std::future<void> DiskManager::SubmitSingle(IOOperation op, BlockId id,
+                                            char *buff) {
+  auto promise = std::make_shared<std::promise<void>>();
+  std::future<void> future = promise->get_future();
+  std::string where = " at offset " + std::to_string(this->GetBlockOffset(id)) +
+                      "\n in File: " + this->path;
+
+  std::vector<BlockIORequest> requests;
+  requests.push_back(BlockIORequest{
+      op, id, buff, [promise, op, id, where](int result) {
+        if (result == 0) {
+          promise->set_value();
+          return;
+        }
+        if (result == -EBADMSG && op == IOOperation::Read) {
+          promise->set_exception(
+              std::make_exception_ptr(BlockChecksumException(
+                  "Block " + std::to_string(id) +
+                      " does not match its checksum" + where,
+                  id)));
+          return;
+        }
+        std::string verb = op == IOOperation::Read ? "read" : "write";
+        promise->set_exception(std::make_exception_ptr(DiskManagerException(
+            "Failed to " + verb + " block" + where + " (errno: " +
+            std::to_string(-result) + " - " + std::strerror(-result) + ")")));
+      }});
+  this->SubmitBatch(requests);
+  return future;
+}
+
+std::future<void> DiskManager::ReadBlockAsync(BlockId id, char *buff) {
+  return this->SubmitSingle(IOOperation::Read, id, buff);
+}
+
+std::future<void> DiskManager::WriteBlockAsync(BlockId id, char *buff) {
+  return this->SubmitSingle(IOOperation::Write, id, buff);
 }
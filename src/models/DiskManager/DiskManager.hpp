@@ -1,10 +1,18 @@
 #pragma once
 #include "../../types/Constants.hpp"
+#include "../IOEngine/IOEngine.hpp"
+#include "../Metrics/LatencyHistogram.hpp"
+#include "../Metrics/PerThread.hpp"
+#include <atomic>
+#include <cerrno>
 #include <cstring>
-#include <fstream>
+#include <functional>
+#include <future>
+#include <memory>
 #include <mutex>
 #include <stdexcept>
 #include <string>
+#include <vector>
 
 class DiskManagerException : public std::runtime_error {
 public:
@@ -12,42 +20,352 @@ public:
       : std::runtime_error(message) {}
 };
 
+// A block whose bytes do not match the checksum in its trailer: a torn
+// write, or corruption on the way to or on the disk.
+class BlockChecksumException : public DiskManagerException {
+public:
+  BlockChecksumException(const std::string &message, BlockId blockId)
+      : DiskManagerException(message), blockId(blockId) {}
+
+  BlockId GetBlockId() const { return this->blockId; }
+
+private:
+  BlockId blockId;
+};
+
+enum class DiskReadBackend { Pread, Mmap };
+
+enum class BlockCompression { None, Lz4 };
+
+struct DiskManagerConfig {
+  // Backend for the *Async APIs. Auto prefers io_uring and falls back to a
+  // thread pool when the kernel refuses it.
+  IOEngineKind ioEngine = IOEngineKind::Auto;
+  unsigned ioQueueDepth = 256;
+  unsigned ioWorkerThreads = 4;
+  // When set, builds the engine in place of ioEngine, from the database's
+  // descriptor; lets tests stand in an engine that fails.
+  std::function<std::unique_ptr<IOEngine>(int fd)> ioEngineFactory;
+
+  // Mmap also maps the first mmapWindowBytes of the file, so MappedBlock can
+  // hand out blocks in place and a BufferPool miss skips the copy into a
+  // frame. The window is reserved address space, not memory.
+  DiskReadBackend readBackend = DiskReadBackend::Pread;
+  size_t mmapWindowBytes = size_t{16} << 30;
+
+  // Opens the file O_DIRECT, so blocks skip the page cache and are cached
+  // once, by the BufferPool. Buffers not aligned to DIRECT_IO_ALIGNMENT are
+  // bounced through an aligned copy. Falls back to buffered I/O when the
+  // filesystem refuses O_DIRECT. Cannot be combined with the Mmap backend.
+  bool directIO = false;
+
+  // The file grows by at least this many blocks at a time, so allocation
+  // rarely touches the file. Blocks past the last allocated one are
+  // trimmed on close.
+  BlockId growthBlocks = 1024;
+
+  // Ends every block in a TRAILER_SIZE-byte trailer holding the block
+  // format version and a CRC32C of the block, stamped on every write and
+  // verified on every read; callers then own only the first
+  // GetPayloadSize() bytes of each block. Off, blocks are the caller's
+  // bytes, whole. Fixed when the database is created and recorded in its
+  // header: an existing database opens the way it was created.
+  bool checksums = false;
+
+  // Lz4 stores each block compressed, in an extent of 512-byte sectors
+  // anywhere in the file, and keeps a `.map` file next to the database
+  // from block ids to extents. Callers still see whole blocks:
+  // blocks are compressed as they are written and decompressed as they
+  // are read. Fixed when the database is created; cannot be combined with
+  // the mmap backend or direct I/O, and only one handle may have the file
+  // open at a time.
+  BlockCompression compression = BlockCompression::None;
+
+  // Bytes per block: a power of two from MIN_BLOCK_SIZE to MAX_BLOCK_SIZE.
+  // Fixed when the database is created and recorded in its header; opening
+  // it with another size throws.
+  size_t blockSize = BLOCK_SIZE;
+
+  // Count blocks, bytes and fsyncs and time ReadBlock and WriteBlock, per
+  // thread; GetStats adds them up.
+  bool metrics = true;
+};
+
+// Totals since the DiskManager was opened. Bytes are those moved to and
+// from the file, so in compressed mode they are the compressed sizes.
+// Blocks and bytes include SubmitBatch requests, counted as submitted;
+// the latencies cover the synchronous ReadBlock and WriteBlock.
+struct DiskManagerStats {
+  uint64_t blocksRead = 0;
+  uint64_t blocksWritten = 0;
+  uint64_t bytesRead = 0;
+  uint64_t bytesWritten = 0;
+  uint64_t fsyncs = 0;
+  LatencyHistogram readLatency;
+  LatencyHistogram writeLatency;
+
+  // One "disk.<name> <value>" line per field.
+  std::string ToText() const;
+  std::string ToJson() const;
+};
+
+// What the header at the start of every database file records.
+struct DatabaseHeader {
+  size_t blockSize;
+  BlockCompression compression;
+  // PLAIN_BLOCK_FORMAT, or BLOCK_FORMAT_VERSION for checksummed blocks.
+  uint16_t blockFormat;
+  // Ids handed out as of the last file growth, SyncFile or close. A file
+  // reopened after a crash keeps the blocks past it up to the last one
+  // written, so the unused end of its last extent is not counted as
+  // allocated. 0 in compressed mode, where the extent map records the ids
+  // instead.
+  BlockId blockCount;
+};
+
+struct BlockIORequest {
+  IOOperation op;
+  BlockId id;
+  char *buffer;
+  IOCallback callback;
+};
+
 class DiskManager {
 public:
-  explicit DiskManager(const std::string &path);
+  static constexpr size_t DIRECT_IO_ALIGNMENT = 4096;
+  // Recorded in the header and in every block's trailer; bump when the
+  // layout of the trailer changes.
+  static constexpr uint16_t BLOCK_FORMAT_VERSION = 2;
+  // Recorded for databases without checksums: blocks with no trailer.
+  // Format 1 databases once kept checksums in a `.crc` file, now ignored.
+  static constexpr uint16_t PLAIN_BLOCK_FORMAT = 1;
+  static constexpr size_t TRAILER_SIZE = 8;
+  static constexpr size_t MIN_BLOCK_SIZE = 4096;
+  // The least payload any block has, for layouts checked at compile time.
+  static constexpr size_t MIN_PAYLOAD_SIZE = MIN_BLOCK_SIZE - TRAILER_SIZE;
+  static constexpr size_t MAX_BLOCK_SIZE = 65536;
+  // The file header; block 0 starts right after it, so blocks stay aligned
+  // for direct I/O and the mmap backend at every block size. A file from
+  // before the header, whose blocks start at offset 0, opens as a plain,
+  // uncompressed database of 4 KiB blocks and never gets one.
+  static constexpr size_t HEADER_SIZE = 4096;
+  // Side files kept beside the database file: the free-space map, and the
+  // extent map of a compressed database.
+  static constexpr const char *FREE_MAP_SUFFIX = ".fsm";
+  static constexpr const char *EXTENT_MAP_SUFFIX = ".map";
+
+  explicit DiskManager(const std::string &path,
+                       const DiskManagerConfig &config = DiskManagerConfig());
   ~DiskManager();
 
+  // Reads the header of an existing database, so it can be opened with the
+  // configuration it was created with. A file from before the header
+  // reads as one.
+  static DatabaseHeader ReadHeader(const std::string &path);
+
+  DiskManager(const DiskManager &) = delete;
+  DiskManager &operator=(const DiskManager &) = delete;
+  DiskManager(DiskManager &&) = delete;
+  DiskManager &operator=(DiskManager &&) = delete;
+
+  // Syncs the extent and free-space maps, then the blocks, so a block that
+  // is durable is never durably recorded as free.
   void SyncFile();
+  // Throws BlockChecksumException if the block read does not match its
+  // checksum.
   void ReadBlock(BlockId id, char *buff);
+  // With checksums, writes the block's payload from `buff` and a trailer
+  // computed from a copy of it, so the checksum always matches the bytes
+  // written; the last TRAILER_SIZE bytes of `buff` are ignored.
   void WriteBlock(BlockId id, const char *buff);
-  BlockId AllocateBlock();
+  // Reuses the free block nearest `hint` (the lowest free block without a
+  // hint) and otherwise takes a new id. New ids come from an atomic counter;
+  // the file is only extended, with fallocate, when they run past its
+  // current extent. New blocks read as zeros; reused ones have unspecified
+  // contents. Claiming a free block writes the free-space map at once, but
+  // only SyncFile makes the claim survive a power loss.
+  BlockId AllocateBlock(BlockId hint = INVALID_BLOCK_ID);
+  // Allocates `count` consecutive new blocks and returns the first id. Free
+  // blocks are not reused.
+  BlockId AllocateBlocks(BlockId count);
+  // Records `id` as free in the free-space map and punches it out of the
+  // file where the filesystem allows; in compressed mode its extent is
+  // reused instead. Throws if `id` is unallocated or already free. Does not
+  // check that nothing still reads the block.
+  void DeallocateBlock(BlockId id);
+  BlockId GetBlockCount() const;
+  size_t GetFreeBlockCount() const;
+  size_t GetBlockSize() const;
+  // The bytes of each block callers own: the block size, less the trailer
+  // when the database has checksums.
+  size_t GetPayloadSize() const;
+
+  // With the Mmap backend: the block's bytes in a private, copy-on-write
+  // mapping of the file. Until written through the pointer they track the
+  // file, including later WriteBlock calls; once written they are a private
+  // copy until DropMappedBlock. Returns nullptr for unallocated blocks,
+  // blocks past the window, or with the Pread backend.
+  char *MappedBlock(BlockId id);
+  // Discards any private copy of the block, so the mapping shows the file
+  // again.
+  void DropMappedBlock(BlockId id);
+  // Checks bytes read some other way, such as through MappedBlock, against
+  // their trailer. Throws BlockChecksumException on a mismatch.
+  void VerifyBlock(BlockId id, const char *buff);
+  // Reads every allocated block on `threads` threads (0: one per core) and
+  // returns, in order, the ids that fail their checksum. A block that fails
+  // is read again before it is reported, in case a write was under way.
+  // Throws on I/O errors.
+  std::vector<BlockId> Scrub(unsigned threads = 0);
+
+  std::future<void> ReadBlockAsync(BlockId id, char *buff);
+  // With checksums, an async write stamps the trailer into the last
+  // TRAILER_SIZE bytes of its buffer, which must not change until the write
+  // completes.
+  std::future<void> WriteBlockAsync(BlockId id, char *buff);
+  // Validates and submits every request as one batch. If validation fails,
+  // or the I/O engine cannot start, it throws, nothing is queued and the
+  // callbacks are left in `requests`. Otherwise every callback runs exactly
+  // once: on an I/O engine thread, or, for a request that could not be
+  // queued, on this thread with an error before SubmitBatch returns. Reads
+  // that fail their checksum complete with -EBADMSG; writes stamp their
+  // buffers as WriteBlockAsync does.
+  void SubmitBatch(std::vector<BlockIORequest> &requests);
+  // Registers long-lived buffers (BufferPool frames) with the I/O engine.
+  // Applied lazily when the engine starts; returns false if the engine is
+  // already running and refused them.
+  bool RegisterBuffers(const std::vector<iovec> &buffers);
+  const char *IOEngineName();
+  // False when directIO was not asked for or the filesystem refused it.
+  bool UsesDirectIO() const;
+  bool UsesCompression() const;
+  DiskManagerStats GetStats() const;
 
 private:
   std::string path;
-  std::fstream db;
-  BlockId blockCount;
+  DiskManagerConfig config;
+  size_t blockSize;
+  // Where block 0 starts: HEADER_SIZE, or 0 in a file from before the
+  // header.
+  size_t dataOffset;
+  int fd;
+  std::atomic<bool> directIO;
+  char *mapping;
+  std::atomic<BlockId> blockCount;
+  // The block count last written to the header; guarded by mutex.
+  BlockId headerBlockCount;
+  // Blocks the file holds: blockCount plus the unused part of the last
+  // extent. In compressed mode, the entries the `.map` file holds.
+  std::atomic<BlockId> fileBlocks;
+  // Serializes file growth and the free-space map; reads and writes use
+  // positional I/O and never share a file cursor.
   mutable std::mutex mutex;
 
+  // Free-space map: bit i is set while block i is free. Cached whole in
+  // memory and written through, one BLOCK_SIZE page at a time whatever the
+  // block size, to the `.fsm` file next to the database, created by the
+  // first free.
+  static constexpr size_t FREE_MAP_PAGE_WORDS = BLOCK_SIZE / sizeof(uint64_t);
+  int freeMapFd;
+  std::vector<uint64_t> freeMap;
+  std::atomic<size_t> freeBlocks;
+
+  // The `.map` file holds one uint64_t entry per block and is mapped
+  // shared over a window covering every BlockId, so the mapping never
+  // moves as the file grows.
+  static constexpr size_t ENTRY_WINDOW_BYTES =
+      (size_t{1} << 32) * sizeof(uint64_t);
+
+  // Compressed mode only: where each block is stored (see the encoding in
+  // DiskManager.cpp), sized like fileBlocks. Free extents are kept by size
+  // in sectors, and extentTail is the first sector past every extent.
+  int extentMapFd;
+  uint64_t *extentEntries;
+  std::mutex extentMutex;
+  std::vector<std::vector<uint64_t>> freeExtents;
+  uint64_t extentTail;
+
+  std::mutex ioEngineMutex;
+  std::atomic<IOEngine *> ioEngineReady;
+  std::unique_ptr<IOEngine> ioEngine;
+  std::vector<iovec> registeredBuffers;
+
+  struct DiskCounters {
+    std::atomic<uint64_t> blocksRead{0};
+    std::atomic<uint64_t> blocksWritten{0};
+    std::atomic<uint64_t> bytesRead{0};
+    std::atomic<uint64_t> bytesWritten{0};
+    std::atomic<uint64_t> fsyncs{0};
+    LatencyRecorder readLatency;
+    LatencyRecorder writeLatency;
+  };
+  PerThread<DiskCounters> counters;
+
+  IOEngine &GetIOEngine();
+  void ValidateRequest(BlockId id, const char *buff, IOOperation op);
+  std::future<void> SubmitSingle(IOOperation op, BlockId id, char *buff);
+  // The engine request for a validated block request: writes are stamped
+  // in place, and the callback is wrapped with the checksum, extent and
+  // bounce-buffer steps.
+  IORequest PrepareRequest(const BlockIORequest &request);
+
   long long GetBlockOffset(BlockId id) {
-    return static_cast<long long>(id) * BLOCK_SIZE;
+    return static_cast<long long>(this->dataOffset +
+                                  size_t{id} * this->blockSize);
   }
 
-  std::string GetStreamErrorInfo() {
-    std::string info = " (bad: " + std::to_string(this->db.bad()) +
-                       ", eof: " + std::to_string(this->db.eof()) +
-                       ", fail: " + std::to_string(this->db.fail());
-    if (errno != 0) {
-      info +=
-          ", errno: " + std::to_string(errno) + " - " + std::strerror(errno);
+  void OpenHeader(off_t fileSize);
+  void WriteHeader(BlockId blocks);
+  // Records in the header that ids below `blocks` are taken, unless it
+  // already says so.
+  void PersistBlockCount(BlockId blocks);
+  // The end of the written blocks in [from, to): one past the last block
+  // that is not all zeros, or `from`.
+  BlockId WrittenBlocksEnd(BlockId from, BlockId to);
+  void GrowFileTo(BlockId blocks);
+  uint64_t *MapEntryFile(int entryFd, BlockId blocks, const char *name);
+  void GrowEntryFile(int entryFd, BlockId blocks, const char *name);
+  void OpenExtentMap();
+  // Read or write a block's stored form: the block itself, or in
+  // compressed mode its extent. Return the bytes moved.
+  size_t LoadBlock(BlockId id, char *buff);
+  size_t StoreBlock(BlockId id, const char *buff);
+  void Fsync(int fileFd, const char *what);
+  uint64_t ReserveExtent(unsigned sectors);
+  void ReleaseExtent(uint64_t entry);
+  // Points block `id` at `entry`, freshly written, unless the map no
+  // longer holds `current`; releases whichever extent lost.
+  void PublishExtent(BlockId id, uint64_t current, uint64_t entry);
+  // Fills in the trailer of a whole block about to be written.
+  void StampTrailer(char *block) const;
+  bool TrailerMatches(const char *block) const;
+  void LoadFreeMap();
+  bool IsFree(BlockId id) const;
+  void SetFree(BlockId id, bool isFree);
+  BlockId FindFreeBlock(BlockId hint) const;
+  void WriteFreeMapPage(size_t page);
+  void CloseFiles();
+  // With direct I/O, `length` must be a multiple of the block size:
+  // unaligned buffers are bounced a block at a time.
+  void PreadFully(char *buff, long long offset, size_t length);
+  void PwriteFully(const char *buff, long long offset, size_t length);
+  bool NeedsBounce(const char *buff) const;
+  // Called when an aligned direct read or write still fails with EINVAL:
+  // the filesystem takes O_DIRECT at open but not at I/O time. Returns
+  // false if direct I/O was already off.
+  bool DisableDirectIO();
+
+  std::string GetErrnoInfo(int err) {
+    std::string info = " (fd: " + std::to_string(this->fd);
+    if (err != 0) {
+      info += ", errno: " + std::to_string(err) + " - " + std::strerror(err);
     }
     info += ")";
     return info;
   }
 
-  void ThrowIOError(const std::string &message) {
-    std::string errorInfo = GetStreamErrorInfo();
-    this->db.clear();
-    throw DiskManagerException(message + errorInfo +
+  void ThrowIOError(const std::string &message, int err = 0) {
+    throw DiskManagerException(message + this->GetErrnoInfo(err) +
                                "\n in File: " + this->path);
   }
 };
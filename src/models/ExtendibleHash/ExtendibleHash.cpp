@@ -0,0 +1,412 @@
+#include "./ExtendibleHash.hpp"
+#include "../../types/HashKey.hpp"
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <mutex>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace {
+
+constexpr uint32_t META_MAGIC = 0x4b564548; // "KVEH"
+constexpr size_t KEY_SIZE = ExtendibleHash::MAX_KEY_SIZE;
+constexpr size_t NOT_FOUND = static_cast<size_t>(-1);
+// Directory slots in the smallest block, which needs the most pages.
+constexpr size_t MIN_DIRECTORY_SLOTS =
+    DiskManager::MIN_PAYLOAD_SIZE / sizeof(BlockId);
+constexpr size_t MAX_DIRECTORY_PAGES =
+    ((size_t{1} << ExtendibleHash::MAX_GLOBAL_DEPTH) + MIN_DIRECTORY_SLOTS -
+     1) /
+    MIN_DIRECTORY_SLOTS;
+
+struct HashMeta {
+  uint32_t magic;
+  uint32_t globalDepth;
+  BlockId directoryPages[MAX_DIRECTORY_PAGES];
+};
+static_assert(sizeof(HashMeta) <= DiskManager::MIN_PAYLOAD_SIZE,
+              "Hash meta block must fit in a block");
+
+// The fields between a bucket's fingerprints and its other slot arrays.
+struct BucketHeader {
+  uint16_t count;
+  uint8_t localDepth;
+  uint8_t reserved[5];
+};
+
+// Bytes each slot takes across the bucket's arrays.
+constexpr size_t SLOT_BYTES =
+    sizeof(uint8_t) + sizeof(uint8_t) + sizeof(uint64_t) + KEY_SIZE;
+
+// A bucket in a pinned block: `capacity` fingerprints, the header, then
+// key lengths, values and keys, `capacity` of each. Live entries are
+// packed at the front, so a probe only scans the first `count`
+// fingerprints.
+struct Bucket {
+  size_t capacity;
+  uint8_t *fingerprints;
+  BucketHeader *header;
+  uint8_t *keyLengths;
+  uint64_t *values;
+  // `capacity` keys of KEY_SIZE bytes each.
+  char *keys;
+
+  char *KeyBytes(size_t slot) const { return this->keys + slot * KEY_SIZE; }
+};
+
+// The most slots a bucket fits in `payloadSize` bytes, as a multiple of 16
+// so the fingerprint scan loads whole SSE2 registers and the values array
+// stays 8-byte aligned.
+size_t BucketCapacity(size_t payloadSize) {
+  return (payloadSize - sizeof(BucketHeader)) / SLOT_BYTES / 16 * 16;
+}
+static_assert(sizeof(BucketHeader) + 16 * SLOT_BYTES <=
+                  DiskManager::MIN_PAYLOAD_SIZE,
+              "A hash bucket must hold 16 keys even in the smallest block");
+
+Bucket AsBucket(char *data, size_t capacity) {
+  Bucket bucket;
+  bucket.capacity = capacity;
+  bucket.fingerprints = reinterpret_cast<uint8_t *>(data);
+  bucket.header = reinterpret_cast<BucketHeader *>(data + capacity);
+  bucket.keyLengths = reinterpret_cast<uint8_t *>(bucket.header + 1);
+  bucket.values = reinterpret_cast<uint64_t *>(bucket.keyLengths + capacity);
+  bucket.keys = reinterpret_cast<char *>(bucket.values + capacity);
+  return bucket;
+}
+
+HashMeta *AsMeta(Block *block) {
+  return reinterpret_cast<HashMeta *>(block->data);
+}
+
+size_t PagesFor(size_t slots, size_t slotsPerPage) {
+  return (slots + slotsPerPage - 1) / slotsPerPage;
+}
+
+uint8_t FingerprintOf(uint64_t hash) {
+  return static_cast<uint8_t>(hash >> 56);
+}
+
+bool KeyEquals(const Bucket &bucket, size_t slot, std::string_view key) {
+  return bucket.keyLengths[slot] == key.size() &&
+         (key.empty() ||
+          std::memcmp(bucket.KeyBytes(slot), key.data(), key.size()) == 0);
+}
+
+size_t FindSlot(const Bucket &bucket, std::string_view key,
+                uint8_t fingerprint) {
+  size_t count = std::min<size_t>(bucket.header->count, bucket.capacity);
+#if defined(__SSE2__)
+  const __m128i needle = _mm_set1_epi8(static_cast<char>(fingerprint));
+  for (size_t base = 0; base < count; base += 16) {
+    __m128i group = _mm_loadu_si128(
+        reinterpret_cast<const __m128i *>(bucket.fingerprints + base));
+    unsigned mask = static_cast<unsigned>(
+        _mm_movemask_epi8(_mm_cmpeq_epi8(group, needle)));
+    if (count - base < 16) {
+      mask &= (1u << (count - base)) - 1;
+    }
+    while (mask != 0) {
+      size_t slot = base + static_cast<size_t>(std::countr_zero(mask));
+      if (KeyEquals(bucket, slot, key)) {
+        return slot;
+      }
+      mask &= mask - 1;
+    }
+  }
+#else
+  for (size_t slot = 0; slot < count; ++slot) {
+    if (bucket.fingerprints[slot] == fingerprint &&
+        KeyEquals(bucket, slot, key)) {
+      return slot;
+    }
+  }
+#endif
+  return NOT_FOUND;
+}
+
+void SetSlot(const Bucket &bucket, size_t slot, std::string_view key,
+             uint8_t fingerprint, uint64_t value) {
+  bucket.fingerprints[slot] = fingerprint;
+  bucket.keyLengths[slot] = static_cast<uint8_t>(key.size());
+  if (!key.empty()) {
+    std::memcpy(bucket.KeyBytes(slot), key.data(), key.size());
+  }
+  bucket.values[slot] = value;
+}
+
+void CopySlot(const Bucket &from, size_t fromSlot, const Bucket &to,
+              size_t toSlot) {
+  to.fingerprints[toSlot] = from.fingerprints[fromSlot];
+  to.keyLengths[toSlot] = from.keyLengths[fromSlot];
+  std::memcpy(to.KeyBytes(toSlot), from.KeyBytes(fromSlot), KEY_SIZE);
+  to.values[toSlot] = from.values[fromSlot];
+}
+
+void InitBucket(const Bucket &bucket, uint8_t localDepth) {
+  bucket.header->count = 0;
+  bucket.header->localDepth = localDepth;
+}
+
+} // namespace
+
+ExtendibleHash::ExtendibleHash(BufferPool &pool, BlockId metaBlockId)
+    : pool(pool), metaBlockId(metaBlockId), metaBlock(nullptr),
+      globalDepth(0),
+      bucketCapacity(BucketCapacity(pool.GetPayloadSize())),
+      directorySlots(pool.GetPayloadSize() / sizeof(BlockId)) {
+  if (metaBlockId != INVALID_BLOCK_ID) {
+    this->metaGuard = this->pool.FetchPage(metaBlockId);
+    this->metaBlock = this->metaGuard.GetBlock();
+    HashMeta *meta = AsMeta(this->metaBlock);
+    if (meta->magic != META_MAGIC || meta->globalDepth > MAX_GLOBAL_DEPTH) {
+      throw ExtendibleHashException("Block is not a hash meta block: " +
+                                    std::to_string(metaBlockId));
+    }
+    this->globalDepth = meta->globalDepth;
+    size_t slots = size_t{1} << this->globalDepth;
+    this->directory.resize(slots);
+    this->directoryPages.assign(
+        meta->directoryPages,
+        meta->directoryPages + PagesFor(slots, this->directorySlots));
+    for (size_t page = 0; page < this->directoryPages.size(); ++page) {
+      size_t first = page * this->directorySlots;
+      size_t count = std::min(this->directorySlots, slots - first);
+      ReadPageGuard guard =
+          this->pool.FetchPageRead(this->directoryPages[page]);
+      std::memcpy(this->directory.data() + first, guard.GetData().data(),
+                  count * sizeof(BlockId));
+    }
+    return;
+  }
+
+  this->metaGuard = this->pool.NewPage();
+  this->metaBlock = this->metaGuard.GetBlock();
+  this->metaBlockId = this->metaGuard.GetBlockId();
+
+  WritePageGuard bucket = this->pool.NewPage().UpgradeWrite();
+  InitBucket(AsBucket(bucket.GetData().data(), this->bucketCapacity), 0);
+  this->directory.push_back(bucket.GetBlockId());
+  bucket.Drop();
+
+  this->directoryPages.push_back(this->pool.NewPage().GetBlockId());
+  this->WriteDirectoryPage(0);
+  AsMeta(this->metaBlock)->magic = META_MAGIC;
+  this->WriteMeta();
+}
+
+ExtendibleHash::~ExtendibleHash() = default;
+
+BlockId ExtendibleHash::GetMetaBlockId() const { return this->metaBlockId; }
+
+uint32_t ExtendibleHash::GetGlobalDepth() {
+  std::shared_lock<std::shared_mutex> lock(this->directoryLatch);
+  return this->globalDepth;
+}
+
+std::optional<uint64_t> ExtendibleHash::Get(std::string_view key) {
+  uint64_t hash = HashKey(key);
+  std::shared_lock<std::shared_mutex> lock(this->directoryLatch);
+  ReadPageGuard guard = this->pool.FetchPageRead(
+      this->directory[hash & (this->directory.size() - 1)]);
+  // Only read through, so the view may drop the guard's const.
+  Bucket bucket = AsBucket(const_cast<char *>(guard.GetData().data()),
+                           this->bucketCapacity);
+  size_t slot = FindSlot(bucket, key, FingerprintOf(hash));
+  if (slot == NOT_FOUND) {
+    return std::nullopt;
+  }
+  return bucket.values[slot];
+}
+
+void ExtendibleHash::Put(std::string_view key, uint64_t value) {
+  if (key.size() > MAX_KEY_SIZE) {
+    throw ExtendibleHashException("Key exceeds " +
+                                  std::to_string(MAX_KEY_SIZE) +
+                                  " bytes: " + std::to_string(key.size()));
+  }
+  uint64_t hash = HashKey(key);
+  while (!this->TryPut(key, hash, value)) {
+    this->SplitBucket(hash);
+  }
+}
+
+bool ExtendibleHash::Delete(std::string_view key) {
+  uint64_t hash = HashKey(key);
+  std::shared_lock<std::shared_mutex> lock(this->directoryLatch);
+  WritePageGuard guard = this->pool.FetchPageWrite(
+      this->directory[hash & (this->directory.size() - 1)]);
+  Bucket bucket = AsBucket(guard.GetData().data(), this->bucketCapacity);
+  size_t slot = FindSlot(bucket, key, FingerprintOf(hash));
+  if (slot == NOT_FOUND) {
+    return false;
+  }
+  // Keep live entries packed: the last one fills the hole.
+  size_t last = bucket.header->count - 1u;
+  if (slot != last) {
+    CopySlot(bucket, last, bucket, slot);
+  }
+  bucket.header->count--;
+  return true;
+}
+
+bool ExtendibleHash::TryPut(std::string_view key, uint64_t hash,
+                            uint64_t value) {
+  std::shared_lock<std::shared_mutex> lock(this->directoryLatch);
+  WritePageGuard guard = this->pool.FetchPageWrite(
+      this->directory[hash & (this->directory.size() - 1)]);
+  Bucket bucket = AsBucket(guard.GetData().data(), this->bucketCapacity);
+  uint8_t fingerprint = FingerprintOf(hash);
+  size_t slot = FindSlot(bucket, key, fingerprint);
+  if (slot != NOT_FOUND) {
+    bucket.values[slot] = value;
+    return true;
+  }
+  if (bucket.header->count >= bucket.capacity) {
+    return false;
+  }
+  SetSlot(bucket, bucket.header->count, key, fingerprint, value);
+  bucket.header->count++;
+  return true;
+}
+
+// Splits the bucket `hash` maps to, unless another writer already made room
+// in it. Entries whose hash has bit `localDepth` set move to a new bucket,
+// and the directory slots that carry that bit are pointed at it.
+//
+// The new bucket is allocated and the old one pinned under the shared
+// latch, so the exclusive section only copies entries in memory. A split
+// that got there first shows as a different bucket or local depth, and the
+// new block is freed again.
+void ExtendibleHash::SplitBucket(uint64_t hash) {
+  PageGuard oldPin;
+  uint8_t depth;
+  {
+    std::shared_lock<std::shared_mutex> lock(this->directoryLatch);
+    oldPin = this->pool.FetchPage(
+        this->directory[hash & (this->directory.size() - 1)]);
+    Block *block = oldPin.GetBlock();
+    block->RLatch();
+    Bucket bucket = AsBucket(block->data, this->bucketCapacity);
+    bool full = bucket.header->count >= bucket.capacity;
+    depth = bucket.header->localDepth;
+    block->RUnlatch();
+    if (!full) {
+      return;
+    }
+    if (depth >= this->globalDepth && this->globalDepth >= MAX_GLOBAL_DEPTH) {
+      throw ExtendibleHashException(
+          "Hash directory is at its maximum depth of " +
+          std::to_string(MAX_GLOBAL_DEPTH));
+    }
+  }
+  WritePageGuard newGuard =
+      this->pool.NewPage(oldPin.GetBlockId()).UpgradeWrite();
+  Bucket newBucket =
+      AsBucket(newGuard.GetData().data(), this->bucketCapacity);
+  InitBucket(newBucket, static_cast<uint8_t>(depth + 1));
+  BlockId newId = newGuard.GetBlockId();
+
+  std::unique_lock<std::shared_mutex> lock(this->directoryLatch);
+  BlockId oldId = this->directory[hash & (this->directory.size() - 1)];
+  WritePageGuard oldGuard;
+  if (oldId == oldPin.GetBlockId()) {
+    oldGuard = this->pool.FetchPageWrite(oldId);
+  }
+  Bucket oldBucket{};
+  if (oldGuard.IsValid()) {
+    oldBucket = AsBucket(oldGuard.GetData().data(), this->bucketCapacity);
+  }
+  // The directory only grows, so the depth check above may no longer hold.
+  if (!oldGuard.IsValid() || oldBucket.header->localDepth != depth ||
+      oldBucket.header->count < oldBucket.capacity ||
+      (depth >= this->globalDepth &&
+       this->globalDepth >= MAX_GLOBAL_DEPTH)) {
+    oldGuard.Drop();
+    lock.unlock();
+    newGuard.Drop();
+    this->pool.DeleteBlock(newId);
+    return;
+  }
+  if (depth >= this->globalDepth) {
+    this->DoubleDirectory();
+  }
+
+  BucketHeader *oldHeader = oldBucket.header;
+  uint64_t bit = uint64_t{1} << depth;
+  oldHeader->localDepth = static_cast<uint8_t>(depth + 1);
+  size_t kept = 0;
+  for (size_t slot = 0; slot < oldHeader->count; ++slot) {
+    std::string_view key(oldBucket.KeyBytes(slot), oldBucket.keyLengths[slot]);
+    if ((HashKey(key) & bit) != 0) {
+      CopySlot(oldBucket, slot, newBucket, newBucket.header->count);
+      newBucket.header->count++;
+    } else {
+      if (kept != slot) {
+        CopySlot(oldBucket, slot, oldBucket, kept);
+      }
+      kept++;
+    }
+  }
+  oldHeader->count = static_cast<uint16_t>(kept);
+  newGuard.Drop();
+  oldGuard.Drop();
+
+  size_t lastPage = static_cast<size_t>(-1);
+  for (size_t slot = (hash & (bit - 1)) | bit; slot < this->directory.size();
+       slot += bit << 1) {
+    this->directory[slot] = newId;
+    if (slot / this->directorySlots != lastPage) {
+      lastPage = slot / this->directorySlots;
+      this->WriteDirectoryPage(lastPage);
+    }
+  }
+}
+
+// Doubles the directory: the new upper half mirrors the lower half, so every
+// bucket keeps its keys and gains twice the slots.
+void ExtendibleHash::DoubleDirectory() {
+  size_t oldSize = this->directory.size();
+  size_t newSize = oldSize * 2;
+  size_t pages = PagesFor(newSize, this->directorySlots);
+  while (this->directoryPages.size() < pages) {
+    this->directoryPages.push_back(this->pool.NewPage().GetBlockId());
+  }
+
+  this->directory.resize(newSize);
+  std::copy(this->directory.begin(),
+            this->directory.begin() + static_cast<std::ptrdiff_t>(oldSize),
+            this->directory.begin() + static_cast<std::ptrdiff_t>(oldSize));
+  this->globalDepth++;
+  for (size_t page = oldSize / this->directorySlots; page < pages; ++page) {
+    this->WriteDirectoryPage(page);
+  }
+  this->WriteMeta();
+}
+
+void ExtendibleHash::WriteDirectoryPage(size_t page) {
+  size_t first = page * this->directorySlots;
+  size_t count =
+      std::min(this->directorySlots, this->directory.size() - first);
+  WritePageGuard guard =
+      this->pool.FetchPageWrite(this->directoryPages[page]);
+  std::memcpy(guard.GetData().data(), this->directory.data() + first,
+              count * sizeof(BlockId));
+}
+
+void ExtendibleHash::WriteMeta() {
+  HashMeta *meta = AsMeta(this->metaBlock);
+  this->metaBlock->WLatch();
+  meta->globalDepth = this->globalDepth;
+  std::copy(this->directoryPages.begin(),
+            this->directoryPages.begin() +
+                static_cast<std::ptrdiff_t>(PagesFor(
+                    this->directory.size(), this->directorySlots)),
+            meta->directoryPages);
+  this->metaBlock->WUnlatch();
+  this->metaBlock->isDirty = true;
+}
+
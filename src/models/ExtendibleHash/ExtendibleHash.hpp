@@ -0,0 +1,84 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <shared_mutex>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "../../types/Constants.hpp"
+#include "../Block/Block.hpp"
+#include "../BufferPool/BufferPool.hpp"
+#include "../Index/Index.hpp"
+
+class ExtendibleHashException : public std::runtime_error {
+public:
+  explicit ExtendibleHashException(const std::string &message)
+      : std::runtime_error(message) {}
+};
+
+// Unordered Index for point lookups. The low globalDepth bits of a key's
+// hash pick a directory slot, the slot names a bucket block, and the bucket
+// holds the key: one block fetch per operation.
+//
+// A full bucket splits on its own, moving about half its keys to one new
+// bucket; the directory doubles only when the splitting bucket is already
+// as deep as the directory, and doubling copies block ids, never keys.
+// Each bucket keeps a dense array of one-byte fingerprints (the hash's top
+// byte) so a probe compares 16 fingerprints per instruction and reads a
+// full key only on a fingerprint match. Buckets and directory pages hold as
+// many entries as the pool's block payload fits.
+//
+// The directory is cached in memory and written through to directory
+// blocks listed in the meta block, which stays pinned for the table's
+// lifetime. Operations share a directory latch; a split takes it
+// exclusively, but only after allocating its new bucket and pinning the
+// old one. Buckets are not merged: Delete leaves them in place.
+class ExtendibleHash : public Index {
+public:
+  // Caps the directory at 2^19 slots, which fits its block list in the
+  // meta block.
+  static constexpr uint32_t MAX_GLOBAL_DEPTH = 19;
+
+  // Creates an empty table in `pool`, or opens the table whose meta block is
+  // `metaBlockId`.
+  explicit ExtendibleHash(BufferPool &pool,
+                          BlockId metaBlockId = INVALID_BLOCK_ID);
+  ~ExtendibleHash() override;
+
+  ExtendibleHash(const ExtendibleHash &) = delete;
+  ExtendibleHash &operator=(const ExtendibleHash &) = delete;
+  ExtendibleHash(ExtendibleHash &&) = delete;
+  ExtendibleHash &operator=(ExtendibleHash &&) = delete;
+
+  BlockId GetMetaBlockId() const override;
+  uint32_t GetGlobalDepth();
+
+  std::optional<uint64_t> Get(std::string_view key) override;
+  void Put(std::string_view key, uint64_t value) override;
+  bool Delete(std::string_view key) override;
+
+private:
+  BufferPool &pool;
+  BlockId metaBlockId;
+  PageGuard metaGuard;
+  Block *metaBlock;
+
+  std::shared_mutex directoryLatch;
+  // 2^globalDepth bucket ids, indexed by the low bits of a key's hash.
+  std::vector<BlockId> directory;
+  std::vector<BlockId> directoryPages;
+  uint32_t globalDepth;
+  // Slots per bucket and per directory page, from the pool's payload size.
+  size_t bucketCapacity;
+  size_t directorySlots;
+
+  // Returns false when the key's bucket is full and has to split first.
+  bool TryPut(std::string_view key, uint64_t hash, uint64_t value);
+  void SplitBucket(uint64_t hash);
+  void DoubleDirectory();
+  void WriteDirectoryPage(size_t page);
+  void WriteMeta();
+};
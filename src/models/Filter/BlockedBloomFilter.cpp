@@ -0,0 +1,147 @@
+#include "./BlockedBloomFilter.hpp"
+#include "../../types/HashKey.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+namespace {
+
+// One per 64-bit word of a block (the salts of Parquet's split-block
+// filter). Word i gets bit (hash * SALTS[i]) >> 26 of the low 32 hash bits.
+constexpr uint32_t SALTS[8] = {0x47b6137bu, 0x44974d91u, 0x8824ad5bu,
+                               0xa2b7289du, 0x705495c7u, 0x2df1424bu,
+                               0x9efc4947u, 0x5c6bfb31u};
+
+uint64_t ProbeMask(uint32_t hash, int word) {
+  return uint64_t{1} << ((hash * SALTS[word]) >> 26);
+}
+
+bool TestPortable(const uint64_t *words, uint32_t hash) {
+  for (int word = 0; word < 8; ++word) {
+    uint64_t mask = ProbeMask(hash, word);
+    uint64_t bits = __atomic_load_n(&words[word], __ATOMIC_RELAXED);
+    if ((bits & mask) != mask) {
+      return false;
+    }
+  }
+  return true;
+}
+
+#if defined(__x86_64__)
+
+__attribute__((target("avx2"))) bool TestSimd(const uint64_t *words,
+                                              uint32_t hash) {
+  const __m256i salts = _mm256_setr_epi32(
+      static_cast<int>(SALTS[0]), static_cast<int>(SALTS[1]),
+      static_cast<int>(SALTS[2]), static_cast<int>(SALTS[3]),
+      static_cast<int>(SALTS[4]), static_cast<int>(SALTS[5]),
+      static_cast<int>(SALTS[6]), static_cast<int>(SALTS[7]));
+  __m256i shifts = _mm256_srli_epi32(
+      _mm256_mullo_epi32(_mm256_set1_epi32(static_cast<int>(hash)), salts),
+      26);
+  const __m256i one = _mm256_set1_epi64x(1);
+  __m256i low = _mm256_sllv_epi64(
+      one, _mm256_cvtepu32_epi64(_mm256_castsi256_si128(shifts)));
+  __m256i high = _mm256_sllv_epi64(
+      one, _mm256_cvtepu32_epi64(_mm256_extracti128_si256(shifts, 1)));
+  const auto *lanes = reinterpret_cast<const __m256i *>(words);
+  // testc: every bit of the mask is set in the block.
+  return _mm256_testc_si256(_mm256_load_si256(lanes), low) &&
+         _mm256_testc_si256(_mm256_load_si256(lanes + 1), high);
+}
+
+#endif
+
+} // namespace
+
+BlockedBloomFilter::BlockedBloomFilter(size_t capacity, size_t bitsPerKey)
+    : count(0), capacity(capacity) {
+  if (bitsPerKey == 0) {
+    throw FilterException("Bloom filter needs at least one bit per key");
+  }
+  size_t bits = std::max<size_t>(capacity, 1) * bitsPerKey;
+  this->blocks.resize((bits + 511) / 512, FilterBlock{});
+}
+
+KeyFilterType BlockedBloomFilter::GetType() const {
+  return KeyFilterType::Bloom;
+}
+
+bool BlockedBloomFilter::Add(std::string_view key) {
+  uint64_t hash = HashKey(key);
+  FilterBlock &block = this->blocks[this->BlockIndex(hash)];
+  for (int word = 0; word < 8; ++word) {
+    __atomic_fetch_or(&block.words[word],
+                      ProbeMask(static_cast<uint32_t>(hash), word),
+                      __ATOMIC_RELAXED);
+  }
+  this->count.fetch_add(1, std::memory_order_relaxed);
+  return true;
+}
+
+bool BlockedBloomFilter::MayContain(std::string_view key) const {
+  uint64_t hash = HashKey(key);
+  const FilterBlock &block = this->blocks[this->BlockIndex(hash)];
+#if defined(__x86_64__)
+  if (IsSimdAccelerated()) {
+    return TestSimd(block.words, static_cast<uint32_t>(hash));
+  }
+#endif
+  return TestPortable(block.words, static_cast<uint32_t>(hash));
+}
+
+bool BlockedBloomFilter::MayContainPortable(std::string_view key) const {
+  uint64_t hash = HashKey(key);
+  return TestPortable(this->blocks[this->BlockIndex(hash)].words,
+                      static_cast<uint32_t>(hash));
+}
+
+bool BlockedBloomFilter::SupportsRemove() const { return false; }
+
+void BlockedBloomFilter::Remove(std::string_view) {
+  throw FilterException("Bloom filters cannot remove keys");
+}
+
+size_t BlockedBloomFilter::GetCount() const {
+  return this->count.load(std::memory_order_relaxed);
+}
+
+size_t BlockedBloomFilter::GetCapacity() const { return this->capacity; }
+
+std::span<const char> BlockedBloomFilter::GetBytes() const {
+  return {reinterpret_cast<const char *>(this->blocks.data()),
+          this->blocks.size() * sizeof(FilterBlock)};
+}
+
+void BlockedBloomFilter::SetBytes(std::span<const char> bytes,
+                                  size_t count) {
+  if (bytes.size() != this->blocks.size() * sizeof(FilterBlock)) {
+    throw FilterException("Bloom filter size mismatch: " +
+                          std::to_string(bytes.size()) + " bytes");
+  }
+  std::memcpy(this->blocks.data(), bytes.data(), bytes.size());
+  this->count.store(count, std::memory_order_relaxed);
+}
+
+bool BlockedBloomFilter::IsSimdAccelerated() {
+#if defined(__x86_64__)
+  static const bool hasAvx2 = __builtin_cpu_supports("avx2");
+  return hasAvx2;
+#else
+  return false;
+#endif
+}
+
+size_t BlockedBloomFilter::GetBlockCount() const {
+  return this->blocks.size();
+}
+
+size_t BlockedBloomFilter::BlockIndex(uint64_t hash) const {
+  // The high half picks the block (multiply-shift rather than a modulo);
+  // the low half picks the bits within it.
+  return static_cast<size_t>(((hash >> 32) * this->blocks.size()) >> 32);
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "./KeyFilter.hpp"
+
+// Bloom filter split into 64-byte blocks, one cache line each. A key hashes
+// to one block and sets one bit in each of the block's eight 64-bit words,
+// so a lookup costs a single cache miss however many bits it probes. The
+// eight bit positions come from multiplying the key's hash by eight odd
+// constants: with AVX2 that is one vector multiply, and the test is two
+// 256-bit loads against the probe masks. CPUs without AVX2 take a portable
+// path that probes the same bits.
+//
+// Lookups read blocks while Add may be setting bits in them. Bits are only
+// ever set, so a racing lookup sees the key as either added or not.
+class BlockedBloomFilter : public KeyFilter {
+public:
+  BlockedBloomFilter(size_t capacity, size_t bitsPerKey);
+
+  KeyFilterType GetType() const override;
+  bool Add(std::string_view key) override;
+  bool MayContain(std::string_view key) const override;
+  bool SupportsRemove() const override;
+  void Remove(std::string_view key) override;
+  size_t GetCount() const override;
+  size_t GetCapacity() const override;
+  std::span<const char> GetBytes() const override;
+
+  // MayContain without the AVX2 path, whatever the CPU supports.
+  bool MayContainPortable(std::string_view key) const;
+  static bool IsSimdAccelerated();
+  size_t GetBlockCount() const;
+
+protected:
+  void SetBytes(std::span<const char> bytes, size_t count) override;
+
+private:
+  struct alignas(64) FilterBlock {
+    uint64_t words[8];
+  };
+
+  std::vector<FilterBlock> blocks;
+  std::atomic<size_t> count;
+  size_t capacity;
+
+  size_t BlockIndex(uint64_t hash) const;
+};
@@ -0,0 +1,229 @@
+#include "./CuckooFilter.hpp"
+#include "../../types/HashKey.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+
+namespace {
+
+constexpr uint64_t LOW_LANE_BITS = 0x0001000100010001ull;
+constexpr uint64_t HIGH_LANE_BITS = 0x8000800080008000ull;
+constexpr uint64_t VICTIM_PRESENT = uint64_t{1} << 63;
+// Fraction of slots filled before inserts start failing, in percent; the
+// table is sized so `capacity` keys stay below it.
+constexpr size_t TARGET_LOAD = 95;
+
+// Whether any 16-bit lane of `word` is zero.
+bool HasZeroLane(uint64_t word) {
+  return ((word - LOW_LANE_BITS) & ~word & HIGH_LANE_BITS) != 0;
+}
+
+bool BucketHolds(uint64_t bucket, uint16_t fingerprint) {
+  return HasZeroLane(bucket ^ (fingerprint * LOW_LANE_BITS));
+}
+
+uint16_t Lane(uint64_t bucket, int slot) {
+  return static_cast<uint16_t>(bucket >> (16 * slot));
+}
+
+uint64_t WithLane(uint64_t bucket, int slot, uint16_t fingerprint) {
+  uint64_t shift = 16 * static_cast<uint64_t>(slot);
+  return (bucket & ~(uint64_t{0xffff} << shift)) |
+         (uint64_t{fingerprint} << shift);
+}
+
+// Fingerprints come from the top 16 bits and the bucket from the low ones;
+// 0 marks an empty slot, so no fingerprint may be 0.
+uint16_t FingerprintOf(uint64_t hash) {
+  auto fingerprint = static_cast<uint16_t>(hash >> 48);
+  return fingerprint == 0 ? 1 : fingerprint;
+}
+
+} // namespace
+
+CuckooFilter::CuckooFilter(size_t capacity)
+    : sequence(0), count(0), capacity(capacity),
+      random(std::random_device{}()) {
+  size_t slots = (capacity * 100 + TARGET_LOAD - 1) / TARGET_LOAD;
+  size_t buckets = std::bit_ceil(std::max<size_t>(
+      (slots + SLOTS - 1) / SLOTS, 2));
+  this->table = std::vector<std::atomic<uint64_t>>(buckets + 1);
+  this->bucketMask = buckets - 1;
+}
+
+KeyFilterType CuckooFilter::GetType() const { return KeyFilterType::Cuckoo; }
+
+bool CuckooFilter::Add(std::string_view key) {
+  uint64_t hash = HashKey(key);
+  uint16_t fingerprint = FingerprintOf(hash);
+  size_t bucket = hash & this->bucketMask;
+  size_t alt = this->AltBucket(bucket, fingerprint);
+
+  std::lock_guard<std::mutex> lock(this->writeMutex);
+  if ((this->table.back().load(std::memory_order_relaxed) &
+       VICTIM_PRESENT) != 0) {
+    return false;
+  }
+  if (this->InsertIntoBucket(bucket, fingerprint) ||
+      this->InsertIntoBucket(alt, fingerprint)) {
+    this->count.fetch_add(1, std::memory_order_relaxed);
+    return true;
+  }
+
+  // Odd while fingerprints are on the move.
+  uint64_t seq = this->sequence.load(std::memory_order_relaxed);
+  this->sequence.store(seq + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+
+  size_t at = this->random() % 2 == 0 ? bucket : alt;
+  bool placed = false;
+  for (int kick = 0; kick < MAX_KICKS && !placed; ++kick) {
+    int slot = static_cast<int>(this->random() % SLOTS);
+    uint64_t word = this->table[at].load(std::memory_order_relaxed);
+    uint16_t evicted = Lane(word, slot);
+    this->table[at].store(WithLane(word, slot, fingerprint),
+                          std::memory_order_relaxed);
+    fingerprint = evicted;
+    at = this->AltBucket(at, fingerprint);
+    placed = this->InsertIntoBucket(at, fingerprint);
+  }
+  if (!placed) {
+    this->table.back().store(VICTIM_PRESENT | uint64_t{at} << 16 |
+                                 fingerprint,
+                             std::memory_order_relaxed);
+  }
+
+  this->sequence.store(seq + 2, std::memory_order_release);
+  this->count.fetch_add(1, std::memory_order_relaxed);
+  return true;
+}
+
+bool CuckooFilter::MayContain(std::string_view key) const {
+  uint64_t hash = HashKey(key);
+  uint16_t fingerprint = FingerprintOf(hash);
+  size_t bucket = hash & this->bucketMask;
+  size_t alt = this->AltBucket(bucket, fingerprint);
+  while (true) {
+    uint64_t seq = this->sequence.load(std::memory_order_acquire);
+    // A fingerprint seen is an answer even mid-move; only "absent" needs a
+    // quiet table.
+    if (this->Find(bucket, alt, fingerprint)) {
+      return true;
+    }
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if ((seq & 1) == 0 &&
+        this->sequence.load(std::memory_order_relaxed) == seq) {
+      return false;
+    }
+  }
+}
+
+bool CuckooFilter::SupportsRemove() const { return true; }
+
+void CuckooFilter::Remove(std::string_view key) {
+  uint64_t hash = HashKey(key);
+  uint16_t fingerprint = FingerprintOf(hash);
+  size_t bucket = hash & this->bucketMask;
+  size_t alt = this->AltBucket(bucket, fingerprint);
+
+  std::lock_guard<std::mutex> lock(this->writeMutex);
+  std::atomic<uint64_t> &victimSlot = this->table.back();
+  uint64_t victim = victimSlot.load(std::memory_order_relaxed);
+  if (this->RemoveFromBucket(bucket, fingerprint) ||
+      this->RemoveFromBucket(alt, fingerprint)) {
+    this->count.fetch_sub(1, std::memory_order_relaxed);
+    // The freed slot may be the victim's way back in.
+    if ((victim & VICTIM_PRESENT) != 0) {
+      auto victimFingerprint = static_cast<uint16_t>(victim);
+      size_t victimBucket = (victim >> 16) & this->bucketMask;
+      if (this->InsertIntoBucket(victimBucket, victimFingerprint) ||
+          this->InsertIntoBucket(
+              this->AltBucket(victimBucket, victimFingerprint),
+              victimFingerprint)) {
+        victimSlot.store(0, std::memory_order_relaxed);
+      }
+    }
+    return;
+  }
+  size_t victimBucket = (victim >> 16) & this->bucketMask;
+  if ((victim & VICTIM_PRESENT) != 0 &&
+      static_cast<uint16_t>(victim) == fingerprint &&
+      (victimBucket == bucket || victimBucket == alt)) {
+    victimSlot.store(0, std::memory_order_relaxed);
+    this->count.fetch_sub(1, std::memory_order_relaxed);
+  }
+}
+
+size_t CuckooFilter::GetCount() const {
+  return this->count.load(std::memory_order_relaxed);
+}
+
+size_t CuckooFilter::GetCapacity() const { return this->capacity; }
+
+std::span<const char> CuckooFilter::GetBytes() const {
+  static_assert(sizeof(std::atomic<uint64_t>) == sizeof(uint64_t));
+  return {reinterpret_cast<const char *>(this->table.data()),
+          this->table.size() * sizeof(uint64_t)};
+}
+
+void CuckooFilter::SetBytes(std::span<const char> bytes, size_t count) {
+  if (bytes.size() != this->table.size() * sizeof(uint64_t)) {
+    throw FilterException("Cuckoo filter size mismatch: " +
+                          std::to_string(bytes.size()) + " bytes");
+  }
+  std::lock_guard<std::mutex> lock(this->writeMutex);
+  for (size_t i = 0; i < this->table.size(); ++i) {
+    uint64_t word;
+    std::memcpy(&word, bytes.data() + i * sizeof(word), sizeof(word));
+    this->table[i].store(word, std::memory_order_relaxed);
+  }
+  this->count.store(count, std::memory_order_relaxed);
+}
+
+size_t CuckooFilter::GetBucketCount() const { return this->bucketMask + 1; }
+
+size_t CuckooFilter::AltBucket(size_t bucket, uint16_t fingerprint) const {
+  // XOR with a hash of the fingerprint: applying it twice gives `bucket`
+  // back.
+  return (bucket ^ (fingerprint * 0x5bd1e995ull)) & this->bucketMask;
+}
+
+bool CuckooFilter::Find(size_t bucket, size_t alt,
+                        uint16_t fingerprint) const {
+  if (BucketHolds(this->table[bucket].load(std::memory_order_relaxed),
+                  fingerprint) ||
+      BucketHolds(this->table[alt].load(std::memory_order_relaxed),
+                  fingerprint)) {
+    return true;
+  }
+  uint64_t victim = this->table.back().load(std::memory_order_relaxed);
+  size_t victimBucket = (victim >> 16) & this->bucketMask;
+  return (victim & VICTIM_PRESENT) != 0 &&
+         static_cast<uint16_t>(victim) == fingerprint &&
+         (victimBucket == bucket || victimBucket == alt);
+}
+
+bool CuckooFilter::InsertIntoBucket(size_t bucket, uint16_t fingerprint) {
+  uint64_t word = this->table[bucket].load(std::memory_order_relaxed);
+  for (int slot = 0; slot < SLOTS; ++slot) {
+    if (Lane(word, slot) == 0) {
+      this->table[bucket].store(WithLane(word, slot, fingerprint),
+                                std::memory_order_release);
+      return true;
+    }
+  }
+  return false;
+}
+
+bool CuckooFilter::RemoveFromBucket(size_t bucket, uint16_t fingerprint) {
+  uint64_t word = this->table[bucket].load(std::memory_order_relaxed);
+  for (int slot = 0; slot < SLOTS; ++slot) {
+    if (Lane(word, slot) == fingerprint) {
+      this->table[bucket].store(WithLane(word, slot, 0),
+                                std::memory_order_release);
+      return true;
+    }
+  }
+  return false;
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <random>
+#include <vector>
+
+#include "./KeyFilter.hpp"
+
+// Cuckoo filter (Fan et al.): buckets of four 16-bit key fingerprints, and
+// two candidate buckets per key. The second is the first XOR a hash of the
+// fingerprint, so either can be found from the other without the key, and
+// a key is removed by clearing its fingerprint. A bucket is one 64-bit
+// word, matched against a fingerprint with a few SWAR instructions.
+//
+// An insert that finds both buckets full evicts a fingerprint to its other
+// bucket, and so on for up to MAX_KICKS moves. A lookup running meanwhile
+// could miss a fingerprint in flight, so writers are serialized and bump a
+// sequence count around each eviction chain, and a lookup that finds
+// nothing while one ran retries. Inserts and removals that touch a single
+// bucket are one atomic store and never make lookups retry. A chain that
+// ends without a free slot keeps its last fingerprint aside as the victim;
+// from then on the filter is full and Add fails until a Remove makes room.
+class CuckooFilter : public KeyFilter {
+public:
+  explicit CuckooFilter(size_t capacity);
+
+  KeyFilterType GetType() const override;
+  bool Add(std::string_view key) override;
+  bool MayContain(std::string_view key) const override;
+  bool SupportsRemove() const override;
+  void Remove(std::string_view key) override;
+  size_t GetCount() const override;
+  size_t GetCapacity() const override;
+  std::span<const char> GetBytes() const override;
+
+  size_t GetBucketCount() const;
+
+protected:
+  void SetBytes(std::span<const char> bytes, size_t count) override;
+
+private:
+  static constexpr int SLOTS = 4;
+  static constexpr int MAX_KICKS = 500;
+
+  // The buckets, then the victim: bit 63 set when present, the bucket it
+  // belongs to in bits 16-47 and its fingerprint in bits 0-15.
+  std::vector<std::atomic<uint64_t>> table;
+  size_t bucketMask;
+  std::atomic<uint64_t> sequence;
+  std::atomic<size_t> count;
+  size_t capacity;
+  std::mutex writeMutex;
+  std::minstd_rand random;
+
+  size_t AltBucket(size_t bucket, uint16_t fingerprint) const;
+  bool Find(size_t bucket, size_t alt, uint16_t fingerprint) const;
+  // Single-bucket changes. Callers hold writeMutex.
+  bool InsertIntoBucket(size_t bucket, uint16_t fingerprint);
+  bool RemoveFromBucket(size_t bucket, uint16_t fingerprint);
+};
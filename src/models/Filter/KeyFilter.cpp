@@ -0,0 +1,175 @@
+#include "./KeyFilter.hpp"
+#include "../BufferPool/BufferPool.hpp"
+#include "../Crc32c/Crc32c.hpp"
+#include "./BlockedBloomFilter.hpp"
+#include "./CuckooFilter.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+namespace {
+
+constexpr uint64_t FILTER_MAGIC = 0x5245544c4946564bull; // "KVFILTER"
+constexpr uint32_t FILTER_VERSION = 1;
+
+struct FilterHeader {
+  uint64_t magic;
+  uint32_t version;
+  uint8_t type;
+  // Set by Save, cleared by MarkStale.
+  uint8_t current;
+  uint16_t reserved;
+  uint64_t count;
+  uint64_t bytes;
+  uint32_t checksum;
+  BlockId firstBlock;
+  // 0 in headers saved before it was recorded: the configured capacity.
+  uint64_t capacity;
+};
+
+// Each data block starts with the id of the next one; the filter's bytes
+// fill the rest.
+struct DataBlock {
+  BlockId next;
+  uint32_t reserved;
+};
+
+size_t PayloadPerBlock(BufferPool &pool) {
+  return pool.GetPayloadSize() - sizeof(DataBlock);
+}
+
+void CheckHeader(const FilterHeader *header, BlockId headerId) {
+  if (header->magic != FILTER_MAGIC || header->version != FILTER_VERSION) {
+    throw FilterException("Block is not a filter header: " +
+                          std::to_string(headerId));
+  }
+}
+
+} // namespace
+
+std::unique_ptr<KeyFilter> KeyFilter::Create(const KeyFilterConfig &config) {
+  switch (config.type) {
+  case KeyFilterType::Bloom:
+    return std::make_unique<BlockedBloomFilter>(config.capacity,
+                                                config.bloomBitsPerKey);
+  case KeyFilterType::Cuckoo:
+    return std::make_unique<CuckooFilter>(config.capacity);
+  case KeyFilterType::None:
+  default:
+    return nullptr;
+  }
+}
+
+BlockId KeyFilter::CreatePages(BufferPool &pool) {
+  PageGuard page = pool.NewPage();
+  auto *header = reinterpret_cast<FilterHeader *>(page.GetData().data());
+  *header = FilterHeader{};
+  header->magic = FILTER_MAGIC;
+  header->version = FILTER_VERSION;
+  header->firstBlock = INVALID_BLOCK_ID;
+  page.MarkDirty();
+  return page.GetBlockId();
+}
+
+void KeyFilter::Save(const KeyFilter &filter, BufferPool &pool,
+                     BlockId headerId) {
+  std::span<const char> bytes = filter.GetBytes();
+  size_t payload = PayloadPerBlock(pool);
+  WritePageGuard headerPage = pool.FetchPageWrite(headerId);
+  FilterHeader *header = headerPage.As<FilterHeader>();
+  CheckHeader(header, headerId);
+
+  // Rewrite the existing chain in place, extending it as needed. `link` is
+  // the id that points at the block being written, in the header or in
+  // the block before it (which `previous` keeps latched).
+  BlockId *link = &header->firstBlock;
+  WritePageGuard previous;
+  BlockId next = header->firstBlock;
+  for (size_t offset = 0; offset < bytes.size(); offset += payload) {
+    WritePageGuard page;
+    if (next != INVALID_BLOCK_ID) {
+      page = pool.FetchPageWrite(next);
+      next = page.As<DataBlock>()->next;
+    } else {
+      page = pool.NewPage(headerId).UpgradeWrite();
+      page.As<DataBlock>()->next = INVALID_BLOCK_ID;
+    }
+    *link = page.GetBlockId();
+    size_t length = std::min(payload, bytes.size() - offset);
+    std::memcpy(page.GetData().data() + sizeof(DataBlock),
+                bytes.data() + offset, length);
+    link = &page.As<DataBlock>()->next;
+    previous = std::move(page);
+  }
+  *link = INVALID_BLOCK_ID;
+  previous.Drop();
+
+  // Blocks past the end of a shrunken filter go back to the free list.
+  while (next != INVALID_BLOCK_ID) {
+    BlockId after;
+    {
+      ReadPageGuard page = pool.FetchPageRead(next);
+      after = page.As<DataBlock>()->next;
+    }
+    pool.DeleteBlock(next);
+    next = after;
+  }
+
+  header->type = static_cast<uint8_t>(filter.GetType());
+  header->count = filter.GetCount();
+  header->bytes = bytes.size();
+  header->checksum = Crc32c::Compute(bytes.data(), bytes.size());
+  header->capacity = filter.GetCapacity();
+  header->current = 1;
+}
+
+std::unique_ptr<KeyFilter> KeyFilter::Load(BufferPool &pool, BlockId headerId,
+                                           const KeyFilterConfig &config) {
+  if (config.type == KeyFilterType::None) {
+    return nullptr;
+  }
+  ReadPageGuard headerPage = pool.FetchPageRead(headerId);
+  const FilterHeader *header = headerPage.As<FilterHeader>();
+  CheckHeader(header, headerId);
+  KeyFilterConfig saved = config;
+  saved.capacity = std::max<size_t>(config.capacity, header->capacity);
+  std::unique_ptr<KeyFilter> filter = Create(saved);
+  // The table's size follows from the configuration, so a filter saved
+  // with another one shows up as a size mismatch.
+  std::span<const char> expected = filter->GetBytes();
+  if (header->current == 0 ||
+      header->type != static_cast<uint8_t>(config.type) ||
+      header->bytes != expected.size()) {
+    return nullptr;
+  }
+
+  std::vector<char> bytes;
+  bytes.reserve(header->bytes);
+  size_t payload = PayloadPerBlock(pool);
+  BlockId next = header->firstBlock;
+  while (bytes.size() < header->bytes) {
+    if (next == INVALID_BLOCK_ID) {
+      return nullptr;
+    }
+    ReadPageGuard page = pool.FetchPageRead(next);
+    size_t length = std::min<size_t>(payload, header->bytes - bytes.size());
+    const char *data = page.GetData().data() + sizeof(DataBlock);
+    bytes.insert(bytes.end(), data, data + length);
+    next = page.As<DataBlock>()->next;
+  }
+  if (Crc32c::Compute(bytes.data(), bytes.size()) != header->checksum) {
+    return nullptr;
+  }
+  filter->SetBytes(bytes, header->count);
+  return filter;
+}
+
+void KeyFilter::MarkStale(BufferPool &pool, BlockId headerId) {
+  {
+    WritePageGuard page = pool.FetchPageWrite(headerId);
+    CheckHeader(page.As<FilterHeader>(), headerId);
+    page.As<FilterHeader>()->current = 0;
+  }
+  pool.FlushBlock(headerId);
+}
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+#include "../../types/Constants.hpp"
+
+class BufferPool;
+
+class FilterException : public std::runtime_error {
+public:
+  explicit FilterException(const std::string &message)
+      : std::runtime_error(message) {}
+};
+
+enum class KeyFilterType : uint8_t { None, Bloom, Cuckoo };
+
+struct KeyFilterConfig {
+  KeyFilterType type = KeyFilterType::Cuckoo;
+  // Keys the filter is sized for. A Bloom filter past it answers "maybe"
+  // more often; a cuckoo filter refuses keys once it is full.
+  size_t capacity = size_t{1} << 20;
+  size_t bloomBitsPerKey = 10;
+};
+
+// Approximate set of keys: MayContain never answers false for a key that
+// was added (and, where supported, not removed since), and rarely answers
+// true for one that was not. Lets a lookup for an absent key stop before it
+// touches the index.
+//
+// Add, Remove and MayContain are safe to call concurrently; Add and Remove
+// of the same key must not race each other.
+class KeyFilter {
+public:
+  virtual ~KeyFilter() = default;
+
+  virtual KeyFilterType GetType() const = 0;
+  // False when the filter is full; the key may then be reported absent.
+  virtual bool Add(std::string_view key) = 0;
+  virtual bool MayContain(std::string_view key) const = 0;
+  virtual bool SupportsRemove() const = 0;
+  // Undoes one Add of `key`. Throws if the filter cannot remove.
+  virtual void Remove(std::string_view key) = 0;
+  // Keys added and not removed, counting repeats.
+  virtual size_t GetCount() const = 0;
+  // The capacity the filter was created with.
+  virtual size_t GetCapacity() const = 0;
+
+  // The filter's table, which Save and Load copy as is.
+  virtual std::span<const char> GetBytes() const = 0;
+
+  static std::unique_ptr<KeyFilter> Create(const KeyFilterConfig &config);
+
+  // Persistence in BufferPool pages. A filter lives in a header block and
+  // a chain of data blocks hanging off it; the header records whether the
+  // chain matches the index. Call MarkStale before changing the index and
+  // Save once it is consistent again, so a crash in between leaves a
+  // filter that Load refuses rather than one that misses keys.
+
+  // Allocates an empty, stale header block and returns its id.
+  static BlockId CreatePages(BufferPool &pool);
+  // Writes `filter` into the chain of `headerId`, growing or shrinking the
+  // chain to fit, and marks it current.
+  static void Save(const KeyFilter &filter, BufferPool &pool,
+                   BlockId headerId);
+  // The saved filter, or nullptr if the pages are stale, damaged or were
+  // saved with a configuration other than `config`. A filter saved with a
+  // larger capacity, as one rebuilt to fit more keys is, keeps it.
+  static std::unique_ptr<KeyFilter>
+  Load(BufferPool &pool, BlockId headerId, const KeyFilterConfig &config);
+  // Marks the pages stale and writes the header through to disk.
+  static void MarkStale(BufferPool &pool, BlockId headerId);
+
+protected:
+  // Overwrites the table with `bytes` from GetBytes of an equally
+  // configured filter holding `count` keys.
+  virtual void SetBytes(std::span<const char> bytes, size_t count) = 0;
+};
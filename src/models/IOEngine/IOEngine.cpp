@@ -0,0 +1,435 @@
+#include "./IOEngine.hpp"
+
+#include <cerrno>
+#include <cstring>
+#include <unistd.h>
+
+#ifdef KEYVAL_HAVE_IO_URING
+#include <algorithm>
+#include <atomic>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#endif
+
+namespace {
+
+// Completes (the rest of) a request with blocking positional I/O.
+int RunSync(int fd, IOOperation op, long long offset, char *buffer,
+            size_t length, size_t done) {
+  while (done < length) {
+    ssize_t n =
+        op == IOOperation::Read
+            ? ::pread(fd, buffer + done, length - done,
+                      static_cast<off_t>(offset + done))
+            : ::pwrite(fd, buffer + done, length - done,
+                       static_cast<off_t>(offset + done));
+    if (n < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return -errno;
+    }
+    if (n == 0) {
+      return -EIO;
+    }
+    done += static_cast<size_t>(n);
+  }
+  return 0;
+}
+
+void InvokeCallback(const IOCallback &callback, int result) {
+  if (!callback) {
+    return;
+  }
+  try {
+    callback(result);
+  } catch (...) {
+    // Callbacks run on engine threads; an escaping exception would
+    // terminate the process, so it is dropped here.
+  }
+}
+
+} // namespace
+
+std::unique_ptr<IOEngine> IOEngine::Create(int fd, IOEngineKind kind,
+                                           unsigned queueDepth,
+                                           unsigned workerThreads) {
+#ifdef KEYVAL_HAVE_IO_URING
+  if (kind == IOEngineKind::IoUring) {
+    return std::make_unique<UringIOEngine>(fd, queueDepth);
+  }
+  if (kind == IOEngineKind::Auto) {
+    try {
+      return std::make_unique<UringIOEngine>(fd, queueDepth);
+    } catch (const IOEngineException &) {
+      // io_uring disabled by the kernel or a seccomp policy.
+    }
+  }
+#else
+  (void)queueDepth;
+  if (kind == IOEngineKind::IoUring) {
+    throw IOEngineException("io_uring support was not compiled in");
+  }
+#endif
+  return std::make_unique<ThreadPoolIOEngine>(fd, workerThreads);
+}
+
+ThreadPoolIOEngine::ThreadPoolIOEngine(int fd, unsigned workerThreads)
+    : fd(fd), stopping(false) {
+  if (workerThreads == 0) {
+    workerThreads = 1;
+  }
+  for (unsigned i = 0; i < workerThreads; ++i) {
+    this->workers.emplace_back(&ThreadPoolIOEngine::WorkerLoop, this);
+  }
+}
+
+ThreadPoolIOEngine::~ThreadPoolIOEngine() {
+  {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    this->stopping = true;
+  }
+  this->cv.notify_all();
+  for (auto &worker : this->workers) {
+    worker.join();
+  }
+}
+
+void ThreadPoolIOEngine::Submit(std::vector<IORequest> &requests) {
+  {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    for (auto &request : requests) {
+      this->queue.push_back(std::move(request));
+    }
+  }
+  this->cv.notify_all();
+}
+
+void ThreadPoolIOEngine::WorkerLoop() {
+  while (true) {
+    IORequest request;
+    {
+      std::unique_lock<std::mutex> lock(this->mutex);
+      this->cv.wait(lock,
+                    [this]() { return this->stopping || !this->queue.empty(); });
+      if (this->queue.empty()) {
+        return;
+      }
+      request = std::move(this->queue.front());
+      this->queue.pop_front();
+    }
+
+    int result = RunSync(this->fd, request.op, request.offset, request.buffer,
+                         request.length, 0);
+    InvokeCallback(request.callback, result);
+  }
+}
+
+#ifdef KEYVAL_HAVE_IO_URING
+
+namespace {
+
+template <typename T> T *RingField(void *ring, unsigned offset) {
+  return reinterpret_cast<T *>(static_cast<char *>(ring) + offset);
+}
+
+unsigned LoadAcquire(unsigned *field) {
+  return std::atomic_ref<unsigned>(*field).load(std::memory_order_acquire);
+}
+
+void StoreRelease(unsigned *field, unsigned value) {
+  std::atomic_ref<unsigned>(*field).store(value, std::memory_order_release);
+}
+
+// A registered buffer may span at most 1GB.
+constexpr size_t MAX_REGISTERED_BUFFER = 1UL << 30;
+
+} // namespace
+
+UringIOEngine::UringIOEngine(int fd, unsigned queueDepth)
+    : fd(fd), ringFd(-1), entries(0), sqRing(MAP_FAILED), cqRing(MAP_FAILED),
+      sqes(MAP_FAILED), sqRingSize(0), cqRingSize(0), sqesSize(0),
+      sqHead(nullptr), sqTail(nullptr), sqMask(nullptr), sqArray(nullptr),
+      cqHead(nullptr), cqTail(nullptr), cqMask(nullptr), cqes(nullptr),
+      inFlight(0) {
+  io_uring_params params{};
+  this->ringFd = static_cast<int>(
+      ::syscall(__NR_io_uring_setup, queueDepth == 0 ? 1 : queueDepth,
+                &params));
+  if (this->ringFd < 0) {
+    throw IOEngineException(std::string("io_uring_setup failed: ") +
+                            std::strerror(errno));
+  }
+
+  this->entries = params.sq_entries;
+  this->sqRingSize =
+      params.sq_off.array + params.sq_entries * sizeof(unsigned);
+  this->cqRingSize =
+      params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+  bool singleMmap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+  if (singleMmap) {
+    this->sqRingSize = this->cqRingSize =
+        std::max(this->sqRingSize, this->cqRingSize);
+  }
+
+  this->sqRing = ::mmap(nullptr, this->sqRingSize, PROT_READ | PROT_WRITE,
+                        MAP_SHARED | MAP_POPULATE, this->ringFd,
+                        IORING_OFF_SQ_RING);
+  this->cqRing = singleMmap ? this->sqRing
+                            : ::mmap(nullptr, this->cqRingSize,
+                                     PROT_READ | PROT_WRITE,
+                                     MAP_SHARED | MAP_POPULATE, this->ringFd,
+                                     IORING_OFF_CQ_RING);
+  this->sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+  this->sqes = ::mmap(nullptr, this->sqesSize, PROT_READ | PROT_WRITE,
+                      MAP_SHARED | MAP_POPULATE, this->ringFd,
+                      IORING_OFF_SQES);
+  if (this->sqRing == MAP_FAILED || this->cqRing == MAP_FAILED ||
+      this->sqes == MAP_FAILED) {
+    int err = errno;
+    if (this->sqes != MAP_FAILED) {
+      ::munmap(this->sqes, this->sqesSize);
+    }
+    if (this->cqRing != MAP_FAILED && this->cqRing != this->sqRing) {
+      ::munmap(this->cqRing, this->cqRingSize);
+    }
+    if (this->sqRing != MAP_FAILED) {
+      ::munmap(this->sqRing, this->sqRingSize);
+    }
+    ::close(this->ringFd);
+    throw IOEngineException(std::string("io_uring mmap failed: ") +
+                            std::strerror(err));
+  }
+
+  this->sqHead = RingField<unsigned>(this->sqRing, params.sq_off.head);
+  this->sqTail = RingField<unsigned>(this->sqRing, params.sq_off.tail);
+  this->sqMask = RingField<unsigned>(this->sqRing, params.sq_off.ring_mask);
+  this->sqArray = RingField<unsigned>(this->sqRing, params.sq_off.array);
+  this->cqHead = RingField<unsigned>(this->cqRing, params.cq_off.head);
+  this->cqTail = RingField<unsigned>(this->cqRing, params.cq_off.tail);
+  this->cqMask = RingField<unsigned>(this->cqRing, params.cq_off.ring_mask);
+  this->cqes = RingField<io_uring_cqe>(this->cqRing, params.cq_off.cqes);
+
+  this->reaper = std::thread(&UringIOEngine::ReaperLoop, this);
+}
+
+UringIOEngine::~UringIOEngine() {
+  {
+    std::unique_lock<std::mutex> lock(this->submitMutex);
+    this->slotsFreed.wait(lock, [this]() { return this->inFlight == 0; });
+
+    // A NOP with user_data 0 tells the reaper to exit once it is reaped.
+    unsigned tail = *this->sqTail;
+    unsigned index = tail & *this->sqMask;
+    auto *sqe = &static_cast<io_uring_sqe *>(this->sqes)[index];
+    std::memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode = IORING_OP_NOP;
+    this->sqArray[index] = index;
+    StoreRelease(this->sqTail, tail + 1);
+    while (this->Enter(1, 0, 0) < 0 && errno == EINTR) {
+    }
+  }
+  this->reaper.join();
+
+  ::munmap(this->sqes, this->sqesSize);
+  if (this->cqRing != this->sqRing) {
+    ::munmap(this->cqRing, this->cqRingSize);
+  }
+  ::munmap(this->sqRing, this->sqRingSize);
+  ::close(this->ringFd);
+}
+
+int UringIOEngine::Enter(unsigned toSubmit, unsigned minComplete,
+                         unsigned flags) {
+  return static_cast<int>(::syscall(__NR_io_uring_enter, this->ringFd,
+                                    toSubmit, minComplete, flags, nullptr, 0));
+}
+
+void UringIOEngine::Submit(std::vector<IORequest> &requests) {
+  std::vector<std::unique_ptr<IORequest>> failed;
+  int error = 0;
+  {
+    std::unique_lock<std::mutex> lock(this->submitMutex);
+    size_t next = 0;
+    while (next < requests.size() && error == 0) {
+      this->slotsFreed.wait(
+          lock, [this]() { return this->inFlight < this->entries; });
+
+      unsigned tail = *this->sqTail;
+      unsigned head = LoadAcquire(this->sqHead);
+      unsigned queued = 0;
+      while (next < requests.size() && this->inFlight < this->entries &&
+             tail - head < this->entries) {
+        auto *request = new IORequest(std::move(requests[next]));
+        const RegisteredBuffer *fixed =
+            this->FindRegistered(request->buffer, request->length);
+
+        unsigned index = tail & *this->sqMask;
+        auto *sqe = &static_cast<io_uring_sqe *>(this->sqes)[index];
+        std::memset(sqe, 0, sizeof(*sqe));
+        if (request->op == IOOperation::Read) {
+          sqe->opcode = fixed ? IORING_OP_READ_FIXED : IORING_OP_READ;
+        } else {
+          sqe->opcode = fixed ? IORING_OP_WRITE_FIXED : IORING_OP_WRITE;
+        }
+        sqe->fd = this->fd;
+        sqe->off = static_cast<__u64>(request->offset);
+        sqe->addr = reinterpret_cast<__u64>(request->buffer);
+        sqe->len = static_cast<__u32>(request->length);
+        sqe->user_data = reinterpret_cast<__u64>(request);
+        if (fixed) {
+          sqe->buf_index = static_cast<__u16>(fixed->index);
+        }
+        this->sqArray[index] = index;
+
+        ++tail;
+        ++queued;
+        ++next;
+        ++this->inFlight;
+      }
+      StoreRelease(this->sqTail, tail);
+
+      // One io_uring_enter per batch of SQEs.
+      while (queued > 0) {
+        int submitted = this->Enter(queued, 0, 0);
+        if (submitted >= 0) {
+          queued -= static_cast<unsigned>(submitted);
+          continue;
+        }
+        if (errno == EINTR || errno == EAGAIN || errno == EBUSY) {
+          continue;
+        }
+        error = errno;
+        // The kernel only reads the tail inside io_uring_enter, which this
+        // lock serializes, so the SQEs it has not consumed can be taken
+        // back; the ones it has will complete through the reaper.
+        unsigned consumed = LoadAcquire(this->sqHead);
+        for (unsigned i = consumed; i != tail; ++i) {
+          auto &sqe = static_cast<io_uring_sqe *>(
+              this->sqes)[this->sqArray[i & *this->sqMask]];
+          failed.emplace_back(reinterpret_cast<IORequest *>(sqe.user_data));
+        }
+        StoreRelease(this->sqTail, consumed);
+        this->inFlight -= tail - consumed;
+        break;
+      }
+    }
+    for (; next < requests.size(); ++next) {
+      failed.push_back(std::make_unique<IORequest>(std::move(requests[next])));
+    }
+  }
+
+  if (!failed.empty()) {
+    this->slotsFreed.notify_all();
+    for (const auto &request : failed) {
+      InvokeCallback(request->callback, -error);
+    }
+  }
+}
+
+void UringIOEngine::ReaperLoop() {
+  bool exitRequested = false;
+  while (!exitRequested) {
+    unsigned head = *this->cqHead;
+    unsigned tail = LoadAcquire(this->cqTail);
+    if (head == tail) {
+      this->Enter(0, 1, IORING_ENTER_GETEVENTS);
+      continue;
+    }
+
+    unsigned completed = 0;
+    for (; head != tail; ++head) {
+      auto &cqe = static_cast<io_uring_cqe *>(
+          this->cqes)[head & *this->cqMask];
+      auto *request = reinterpret_cast<IORequest *>(cqe.user_data);
+      if (request == nullptr) {
+        exitRequested = true;
+        continue;
+      }
+      this->Complete(request, cqe.res);
+      ++completed;
+    }
+    StoreRelease(this->cqHead, head);
+
+    if (completed > 0) {
+      std::lock_guard<std::mutex> lock(this->submitMutex);
+      this->inFlight -= completed;
+    }
+    this->slotsFreed.notify_all();
+  }
+}
+
+void UringIOEngine::Complete(IORequest *request, int result) {
+  std::unique_ptr<IORequest> owned(request);
+  if (result >= 0 && static_cast<size_t>(result) < request->length) {
+    // Short transfer: finish the remainder synchronously.
+    result = RunSync(this->fd, request->op, request->offset, request->buffer,
+                     request->length, static_cast<size_t>(result));
+  } else if (result > 0) {
+    result = 0;
+  }
+  InvokeCallback(request->callback, result);
+}
+
+bool UringIOEngine::RegisterBuffers(const std::vector<iovec> &buffers) {
+  std::unique_lock<std::mutex> lock(this->submitMutex);
+  this->slotsFreed.wait(lock, [this]() { return this->inFlight == 0; });
+
+  if (!this->registered.empty()) {
+    ::syscall(__NR_io_uring_register, this->ringFd,
+              IORING_UNREGISTER_BUFFERS, nullptr, 0);
+    this->registered.clear();
+  }
+
+  std::vector<iovec> chunks;
+  for (const auto &buffer : buffers) {
+    char *base = static_cast<char *>(buffer.iov_base);
+    size_t remaining = buffer.iov_len;
+    while (remaining > 0) {
+      size_t length = std::min(remaining, MAX_REGISTERED_BUFFER);
+      chunks.push_back(iovec{base, length});
+      base += length;
+      remaining -= length;
+    }
+  }
+  if (chunks.empty()) {
+    return false;
+  }
+
+  long rc = ::syscall(__NR_io_uring_register, this->ringFd,
+                      IORING_REGISTER_BUFFERS, chunks.data(),
+                      static_cast<unsigned>(chunks.size()));
+  if (rc < 0) {
+    return false;
+  }
+
+  for (unsigned i = 0; i < chunks.size(); ++i) {
+    this->registered.push_back(RegisteredBuffer{
+        static_cast<const char *>(chunks[i].iov_base), chunks[i].iov_len, i});
+  }
+  std::sort(this->registered.begin(), this->registered.end(),
+            [](const RegisteredBuffer &a, const RegisteredBuffer &b) {
+              return a.base < b.base;
+            });
+  return true;
+}
+
+const UringIOEngine::RegisteredBuffer *
+UringIOEngine::FindRegistered(const char *buffer, size_t length) const {
+  auto it = std::upper_bound(
+      this->registered.begin(), this->registered.end(), buffer,
+      [](const char *value, const RegisteredBuffer &entry) {
+        return value < entry.base;
+      });
+  if (it == this->registered.begin()) {
+    return nullptr;
+  }
+  --it;
+  if (buffer + length <= it->base + it->length) {
+    return &*it;
+  }
+  return nullptr;
+}
+
+#endif
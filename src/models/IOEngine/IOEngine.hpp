@@ -0,0 +1,136 @@
+#pragma once
+
+#include <sys/uio.h>
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+class IOEngineException : public std::runtime_error {
+public:
+  explicit IOEngineException(const std::string &message)
+      : std::runtime_error(message) {}
+};
+
+enum class IOOperation { Read, Write };
+
+enum class IOEngineKind { Auto, IoUring, ThreadPool };
+
+// Invoked exactly once per request: from an engine-owned thread, or, for a
+// request the engine could not queue, from the thread in Submit before it
+// returns. `result` is 0 on success or a negative errno value.
+using IOCallback = std::function<void(int result)>;
+
+struct IORequest {
+  IOOperation op;
+  long long offset;
+  char *buffer;
+  size_t length;
+  IOCallback callback;
+};
+
+class IOEngine {
+public:
+  virtual ~IOEngine() = default;
+
+  // Queues every request in `requests` with as few syscalls as the backend
+  // allows. Blocks only while the engine is at its queue depth. Does not
+  // throw when the kernel refuses a submission: the requests it did not
+  // take are completed with the error instead.
+  virtual void Submit(std::vector<IORequest> &requests) = 0;
+
+  // Pins long-lived buffers (e.g. BufferPool frames) with the kernel so
+  // requests that fall inside them skip per-I/O page mapping. Returns false
+  // when the backend does not support it or the kernel refuses.
+  virtual bool RegisterBuffers(const std::vector<iovec> &buffers) = 0;
+
+  virtual const char *Name() const = 0;
+
+  static std::unique_ptr<IOEngine> Create(int fd, IOEngineKind kind,
+                                          unsigned queueDepth,
+                                          unsigned workerThreads);
+};
+
+class ThreadPoolIOEngine : public IOEngine {
+public:
+  ThreadPoolIOEngine(int fd, unsigned workerThreads);
+  ~ThreadPoolIOEngine() override;
+
+  ThreadPoolIOEngine(const ThreadPoolIOEngine &) = delete;
+  ThreadPoolIOEngine &operator=(const ThreadPoolIOEngine &) = delete;
+
+  void Submit(std::vector<IORequest> &requests) override;
+  bool RegisterBuffers(const std::vector<iovec> &) override { return false; }
+  const char *Name() const override { return "threadpool"; }
+
+private:
+  int fd;
+  bool stopping;
+  std::mutex mutex;
+  std::condition_variable cv;
+  std::deque<IORequest> queue;
+  std::vector<std::thread> workers;
+
+  void WorkerLoop();
+};
+
+#ifdef KEYVAL_HAVE_IO_URING
+class UringIOEngine : public IOEngine {
+public:
+  UringIOEngine(int fd, unsigned queueDepth);
+  ~UringIOEngine() override;
+
+  UringIOEngine(const UringIOEngine &) = delete;
+  UringIOEngine &operator=(const UringIOEngine &) = delete;
+
+  void Submit(std::vector<IORequest> &requests) override;
+  bool RegisterBuffers(const std::vector<iovec> &buffers) override;
+  const char *Name() const override { return "io_uring"; }
+
+private:
+  struct RegisteredBuffer {
+    const char *base;
+    size_t length;
+    unsigned index;
+  };
+
+  int fd;
+  int ringFd;
+  unsigned entries;
+
+  void *sqRing;
+  void *cqRing;
+  void *sqes;
+  size_t sqRingSize;
+  size_t cqRingSize;
+  size_t sqesSize;
+
+  unsigned *sqHead;
+  unsigned *sqTail;
+  unsigned *sqMask;
+  unsigned *sqArray;
+  unsigned *cqHead;
+  unsigned *cqTail;
+  unsigned *cqMask;
+  void *cqes;
+
+  std::mutex submitMutex;
+  std::condition_variable slotsFreed;
+  unsigned inFlight;
+  std::vector<RegisteredBuffer> registered;
+
+  std::thread reaper;
+
+  void ReaperLoop();
+  void Complete(IORequest *request, int result);
+  int Enter(unsigned toSubmit, unsigned minComplete, unsigned flags);
+  const RegisteredBuffer *FindRegistered(const char *buffer,
+                                         size_t length) const;
+};
+#endif
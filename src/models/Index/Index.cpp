@@ -0,0 +1,14 @@
+#include "./Index.hpp"
+#include "../BPlusTree/BPlusTree.hpp"
+#include "../ExtendibleHash/ExtendibleHash.hpp"
+
+std::unique_ptr<Index> Index::Create(IndexType type, BufferPool &pool,
+                                     BlockId metaBlockId) {
+  switch (type) {
+  case IndexType::ExtendibleHash:
+    return std::make_unique<ExtendibleHash>(pool, metaBlockId);
+  case IndexType::BPlusTree:
+  default:
+    return std::make_unique<BPlusTree>(pool, metaBlockId);
+  }
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string_view>
+
+#include "../../types/Constants.hpp"
+
+class BufferPool;
+
+enum class IndexType { BPlusTree, ExtendibleHash };
+
+// Disk-resident map from keys of up to MAX_KEY_SIZE bytes to 64-bit values,
+// kept in BufferPool blocks. BPlusTree keeps keys ordered and adds range
+// scans; ExtendibleHash answers point lookups with a single block fetch.
+//
+// Every operation is safe to call concurrently.
+class Index {
+public:
+  static constexpr size_t MAX_KEY_SIZE = 32;
+
+  virtual ~Index() = default;
+
+  // Block the index can be reopened from.
+  virtual BlockId GetMetaBlockId() const = 0;
+
+  virtual std::optional<uint64_t> Get(std::string_view key) = 0;
+  // Inserts `key`, or overwrites its value if it is already present.
+  virtual void Put(std::string_view key, uint64_t value) = 0;
+  virtual bool Delete(std::string_view key) = 0;
+
+  // Creates an empty index of `type` in `pool`, or opens the one whose meta
+  // block is `metaBlockId`.
+  static std::unique_ptr<Index> Create(IndexType type, BufferPool &pool,
+                                       BlockId metaBlockId = INVALID_BLOCK_ID);
+};
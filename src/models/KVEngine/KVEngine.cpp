@@ -0,0 +1,14 @@
+#include "./KVEngine.hpp"
+#include "../LsmTree/LsmTree.hpp"
+#include "./PagedEngine.hpp"
+
+std::unique_ptr<KVEngine> KVEngine::Open(KVEngineType type,
+                                         const std::string &path) {
+  switch (type) {
+  case KVEngineType::Lsm:
+    return std::make_unique<LsmTree>(path);
+  case KVEngineType::Paged:
+  default:
+    return std::make_unique<PagedEngine>(path);
+  }
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+#include "../Index/Index.hpp"
+
+class KVEngineException : public std::runtime_error {
+public:
+  explicit KVEngineException(const std::string &message)
+      : std::runtime_error(message) {}
+};
+
+enum class KVEngineType { Paged, Lsm };
+
+// An ordered table from keys of up to MAX_KEY_SIZE bytes to 64-bit values,
+// whichever engine stores it. The paged engine updates a BPlusTree in
+// BufferPool blocks in place; the LSM engine appends to a memtable and
+// writes sorted, immutable files, trading read work for sequential writes.
+// Pick per table with Open.
+//
+// Every operation is safe to call concurrently.
+class KVEngine {
+public:
+  static constexpr size_t MAX_KEY_SIZE = Index::MAX_KEY_SIZE;
+
+  virtual ~KVEngine() = default;
+
+  virtual std::optional<uint64_t> Get(std::string_view key) = 0;
+  // Inserts `key`, or overwrites its value if it is already present.
+  virtual void Put(std::string_view key, uint64_t value) = 0;
+  // Returns whether the key was present.
+  virtual bool Delete(std::string_view key) = 0;
+  // Visits keys >= `startKey` in order until `visit` returns false.
+  virtual void
+  Scan(std::string_view startKey,
+       const std::function<bool(std::string_view, uint64_t)> &visit) = 0;
+
+  // Opens the table at `path` with the default configuration of `type`,
+  // creating it if needed: a database file for Paged, a directory for Lsm.
+  static std::unique_ptr<KVEngine> Open(KVEngineType type,
+                                        const std::string &path);
+};
@@ -0,0 +1,404 @@
+#include "./PagedEngine.hpp"
+#include "../../types/HashKey.hpp"
+
+#include <algorithm>
+
+namespace {
+
+constexpr uint64_t ENGINE_MAGIC = 0x4445474150564bull; // "KVPAGED"
+
+// The file's first block.
+struct EngineMeta {
+  uint64_t magic;
+  BlockId treeMetaBlock;
+  BlockId filterHeaderBlock;
+};
+
+} // namespace
+
+PagedEngine::PagedEngine(const std::string &path,
+                         const PagedEngineConfig &config)
+    : filter(nullptr), filterConfig(config.filter),
+      filterHeaderId(INVALID_BLOCK_ID), filterInUse(false),
+      multiVersion(config.multiVersion),
+      collectEveryWrites(std::max<size_t>(config.collectEveryWrites, 1)) {
+  auto diskManager = std::make_unique<DiskManager>(path, config.disk);
+  bool exists = diskManager->GetBlockCount() > 0;
+  this->pool = std::make_unique<BufferPool>(
+      config.poolFrames, std::move(diskManager), config.pool);
+
+  if (exists) {
+    ReadPageGuard meta = this->pool->FetchPageRead(0);
+    const auto *engineMeta = meta.As<EngineMeta>();
+    if (engineMeta->magic != ENGINE_MAGIC) {
+      throw KVEngineException("Not a paged engine file: " + path);
+    }
+    this->tree = std::make_unique<BPlusTree>(*this->pool,
+                                             engineMeta->treeMetaBlock);
+    this->filterHeaderId = engineMeta->filterHeaderBlock;
+  } else {
+    PageGuard meta = this->pool->NewPage();
+    this->tree = std::make_unique<BPlusTree>(*this->pool);
+    this->filterHeaderId = KeyFilter::CreatePages(*this->pool);
+    *reinterpret_cast<EngineMeta *>(meta.GetData().data()) = EngineMeta{
+        ENGINE_MAGIC, this->tree->GetMetaBlockId(), this->filterHeaderId};
+    meta.MarkDirty();
+  }
+
+  if (config.filter.type != KeyFilterType::None) {
+    std::unique_ptr<KeyFilter> saved =
+        KeyFilter::Load(*this->pool, this->filterHeaderId, config.filter);
+    if (saved != nullptr) {
+      this->InstallFilter(std::move(saved));
+    } else {
+      this->RebuildFilter(config.filter.capacity);
+    }
+  }
+  // From here on the tree changes; until Save the pages must not be
+  // trusted.
+  KeyFilter::MarkStale(*this->pool, this->filterHeaderId);
+}
+
+PagedEngine::~PagedEngine() {
+  if (this->multiVersion) {
+    // No snapshot is open any more, so every deleted key leaves the tree.
+    try {
+      this->CollectVersions();
+    } catch (const std::runtime_error &) {
+    }
+  }
+  KeyFilter *filter = this->FilterInUse();
+  if (filter != nullptr) {
+    try {
+      KeyFilter::Save(*filter, *this->pool, this->filterHeaderId);
+    } catch (const std::runtime_error &) {
+      // The pages stay stale and the next open rebuilds the filter.
+    }
+  }
+  // The tree unpins its meta block before the pool flushes and closes.
+  this->tree.reset();
+  this->pool.reset();
+}
+
+std::optional<uint64_t> PagedEngine::Get(std::string_view key) {
+  if (this->multiVersion) {
+    return this->GetAt(key, this->oracle.GetReadTimestamp());
+  }
+  KeyFilter *filter = this->FilterInUse();
+  if (filter != nullptr && !filter->MayContain(key)) {
+    return std::nullopt;
+  }
+  return this->tree->Get(key);
+}
+
+void PagedEngine::Put(std::string_view key, uint64_t value) {
+  if (this->multiVersion) {
+    this->PutVersioned(key, value);
+    return;
+  }
+  KeyFilter *filter = this->filter.load(std::memory_order_acquire);
+  if (filter == nullptr) {
+    this->tree->Put(key, value);
+    return;
+  }
+  if (!filter->SupportsRemove()) {
+    filter->Add(key);
+    this->tree->Put(key, value);
+    return;
+  }
+
+  // Added before the tree sees the key, so a concurrent Get that finds the
+  // key in the tree also finds it in the filter. The lock is taken while
+  // a full filter waits to be replaced too, so the rebuild sees every key.
+  bool full;
+  {
+    std::lock_guard<std::mutex> lock(this->LockFor(key));
+    filter = this->FilterInUse();
+    if (filter != nullptr &&
+        (!filter->MayContain(key) || !this->tree->Get(key)) &&
+        !filter->Add(key)) {
+      this->filterInUse = false;
+      filter = nullptr;
+    }
+    full = filter == nullptr;
+    this->tree->Put(key, value);
+  }
+  if (full) {
+    this->GrowFilter();
+  }
+}
+
+bool PagedEngine::Delete(std::string_view key) {
+  if (this->multiVersion) {
+    return this->DeleteVersioned(key);
+  }
+  KeyFilter *filter = this->FilterInUse();
+  if (filter != nullptr && !filter->MayContain(key)) {
+    return false;
+  }
+  filter = this->filter.load(std::memory_order_acquire);
+  if (filter == nullptr || !filter->SupportsRemove()) {
+    return this->tree->Delete(key);
+  }
+
+  std::lock_guard<std::mutex> lock(this->LockFor(key));
+  bool deleted = this->tree->Delete(key);
+  filter = this->FilterInUse();
+  if (deleted && filter != nullptr) {
+    filter->Remove(key);
+  }
+  return deleted;
+}
+
+void PagedEngine::Scan(
+    std::string_view startKey,
+    const std::function<bool(std::string_view, uint64_t)> &visit) {
+  if (!this->multiVersion) {
+    this->tree->Scan(startKey, visit);
+    return;
+  }
+  Snapshot snapshot = this->oracle.OpenSnapshot();
+  this->ScanAt(startKey, visit, snapshot.GetTimestamp());
+}
+
+Snapshot PagedEngine::OpenSnapshot() {
+  if (!this->multiVersion) {
+    throw KVEngineException("Snapshots need multiVersion");
+  }
+  return this->oracle.OpenSnapshot();
+}
+
+std::optional<uint64_t> PagedEngine::Get(std::string_view key,
+                                         const Snapshot &snapshot) {
+  if (!snapshot.IsValid()) {
+    throw KVEngineException("Snapshot is not open");
+  }
+  return this->GetAt(key, snapshot.GetTimestamp());
+}
+
+void PagedEngine::Scan(
+    std::string_view startKey,
+    const std::function<bool(std::string_view, uint64_t)> &visit,
+    const Snapshot &snapshot) {
+  if (!snapshot.IsValid()) {
+    throw KVEngineException("Snapshot is not open");
+  }
+  this->ScanAt(startKey, visit, snapshot.GetTimestamp());
+}
+
+void PagedEngine::CollectVersions() {
+  std::lock_guard<std::mutex> lock(this->collectMutex);
+  uint64_t oldest = this->oracle.GetOldestActive();
+  if (oldest == this->lastCollectedBelow) {
+    // Every version replaced at or before it is already gone, and later
+    // writes all replaced theirs after it.
+    return;
+  }
+  for (const std::string &key : this->versions.Collect(oldest)) {
+    std::lock_guard<std::mutex> keyLock(this->LockFor(key));
+    // A write may have brought the key back since.
+    if (this->versions.Prune(key, oldest) ==
+        VersionStore::PruneResult::Tombstone) {
+      this->PurgeKey(key);
+    }
+  }
+  this->lastCollectedBelow = oldest;
+}
+
+BufferPool &PagedEngine::GetBufferPool() { return *this->pool; }
+
+const KeyFilter *PagedEngine::GetFilter() const { return this->FilterInUse(); }
+
+const VersionStore &PagedEngine::GetVersionStore() const {
+  return this->versions;
+}
+
+KeyFilter *PagedEngine::FilterInUse() const {
+  return this->filterInUse.load(std::memory_order_acquire)
+             ? this->filter.load(std::memory_order_acquire)
+             : nullptr;
+}
+
+void PagedEngine::InstallFilter(std::unique_ptr<KeyFilter> filter) {
+  this->filter.store(filter.get(), std::memory_order_release);
+  this->filters.push_back(std::move(filter));
+  this->filterInUse.store(true, std::memory_order_release);
+}
+
+void PagedEngine::RebuildFilter(size_t capacity) {
+  size_t keys = 0;
+  this->tree->Scan("", [&keys](std::string_view, uint64_t) {
+    keys++;
+    return true;
+  });
+  KeyFilterConfig config = this->filterConfig;
+  config.capacity = std::max(capacity, 2 * keys);
+  while (true) {
+    std::unique_ptr<KeyFilter> filter = KeyFilter::Create(config);
+    bool full = false;
+    this->tree->Scan("", [&](std::string_view key, uint64_t) {
+      full = !filter->Add(key);
+      return !full;
+    });
+    if (!full) {
+      this->InstallFilter(std::move(filter));
+      return;
+    }
+    // Keys crowded into too few cuckoo buckets; spread them wider.
+    config.capacity *= 2;
+  }
+}
+
+void PagedEngine::GrowFilter() {
+  std::lock_guard<std::mutex> growLock(this->growMutex);
+  if (this->filterInUse.load(std::memory_order_acquire)) {
+    // Another writer got here first.
+    return;
+  }
+  // With every key lock held no write can run, so the new filter covers
+  // exactly the keys in the tree.
+  std::array<std::unique_lock<std::mutex>, LOCK_STRIPES> locks;
+  for (size_t stripe = 0; stripe < LOCK_STRIPES; ++stripe) {
+    locks[stripe] = std::unique_lock<std::mutex>(this->keyLocks[stripe]);
+  }
+  this->RebuildFilter(
+      2 * this->filter.load(std::memory_order_relaxed)->GetCapacity());
+}
+
+std::mutex &PagedEngine::LockFor(std::string_view key) {
+  return this->keyLocks[HashKey(key) % LOCK_STRIPES];
+}
+
+void PagedEngine::PutVersioned(std::string_view key, uint64_t value) {
+  // Checked before the store records a version the tree would refuse.
+  if (key.size() > MAX_KEY_SIZE) {
+    throw KVEngineException("Key exceeds " + std::to_string(MAX_KEY_SIZE) +
+                            " bytes: " + std::to_string(key.size()));
+  }
+  bool full;
+  {
+    std::lock_guard<std::mutex> lock(this->LockFor(key));
+    std::optional<uint64_t> stored = this->tree->Get(key);
+    std::optional<uint64_t> before = stored;
+    this->versions.Latest(key, before);
+    // A key is in the filter for as long as it is in the tree, deleted or
+    // not.
+    KeyFilter *filter = this->FilterInUse();
+    if (filter != nullptr && !filter->SupportsRemove()) {
+      filter->Add(key);
+    } else if (filter != nullptr && !stored && !filter->Add(key)) {
+      this->filterInUse = false;
+      filter = nullptr;
+    }
+    full = filter == nullptr &&
+           this->filter.load(std::memory_order_relaxed) != nullptr;
+    this->Commit(key, before, value,
+                        [&]() { this->tree->Put(key, value); });
+  }
+  if (full) {
+    this->GrowFilter();
+  }
+  this->AfterVersionedWrite();
+}
+
+bool PagedEngine::DeleteVersioned(std::string_view key) {
+  KeyFilter *filter = this->FilterInUse();
+  if (filter != nullptr && !filter->MayContain(key)) {
+    return false;
+  }
+  {
+    std::lock_guard<std::mutex> lock(this->LockFor(key));
+    std::optional<uint64_t> before = this->tree->Get(key);
+    this->versions.Latest(key, before);
+    if (!before) {
+      return false;
+    }
+    // The key stays in the tree; PurgeKey takes it out once no snapshot
+    // can see it, which Commit finds at once when none is open.
+    this->Commit(key, before, std::nullopt, []() {});
+  }
+  this->AfterVersionedWrite();
+  return true;
+}
+
+std::optional<uint64_t> PagedEngine::GetAt(std::string_view key,
+                                           uint64_t timestamp) {
+  // Deleted keys stay in the filter until they leave the tree, so it never
+  // hides a version a snapshot can see.
+  KeyFilter *filter = this->FilterInUse();
+  if (filter != nullptr && !filter->MayContain(key)) {
+    return std::nullopt;
+  }
+  while (true) {
+    uint64_t purgeVersion = this->versions.BeginRead(key);
+    std::optional<uint64_t> value = this->tree->Get(key);
+    this->versions.Resolve(key, timestamp, value);
+    if (this->versions.ValidateRead(key, purgeVersion)) {
+      return value;
+    }
+  }
+}
+
+void PagedEngine::ScanAt(
+    std::string_view startKey,
+    const std::function<bool(std::string_view, uint64_t)> &visit,
+    uint64_t timestamp) {
+  // After a purge the scan resumes at the key it had not yet reported.
+  std::string lowKey(startKey);
+  bool restart = true;
+  while (restart) {
+    restart = false;
+    VersionStore::PurgeVersions purgeVersions = this->versions.BeginScan();
+    this->tree->Scan(lowKey, [&](std::string_view key, uint64_t stored) {
+      std::optional<uint64_t> value = stored;
+      this->versions.Resolve(key, timestamp, value);
+      if (!this->versions.ValidateScan(key, purgeVersions)) {
+        lowKey = key;
+        restart = true;
+        return false;
+      }
+      return !value || visit(key, *value);
+    });
+  }
+}
+
+void PagedEngine::Commit(std::string_view key,
+                         std::optional<uint64_t> before,
+                         std::optional<uint64_t> after,
+                         const std::function<void()> &apply) {
+  this->versions.Record(key, before, after);
+  try {
+    apply();
+  } catch (...) {
+    this->versions.Rollback(key);
+    throw;
+  }
+  uint64_t timestamp = this->versions.Commit(key, this->oracle);
+
+  // With no snapshot older than the write, nothing needs the version it
+  // replaced.
+  uint64_t oldest = this->oracle.GetOldestActive();
+  if (oldest >= timestamp && this->versions.Prune(key, oldest) ==
+                                 VersionStore::PruneResult::Tombstone) {
+    this->PurgeKey(key);
+  }
+}
+
+void PagedEngine::AfterVersionedWrite() {
+  size_t writes =
+      this->versionedWrites.fetch_add(1, std::memory_order_relaxed) + 1;
+  if (writes % this->collectEveryWrites == 0 &&
+      this->versions.GetChainCount() > 0) {
+    this->CollectVersions();
+  }
+}
+
+void PagedEngine::PurgeKey(std::string_view key) {
+  this->versions.Purge(key, [&]() {
+    KeyFilter *filter = this->FilterInUse();
+    if (this->tree->Delete(key) && filter != nullptr &&
+        filter->SupportsRemove()) {
+      filter->Remove(key);
+    }
+  });
+}
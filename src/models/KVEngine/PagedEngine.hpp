@@ -0,0 +1,156 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "../BPlusTree/BPlusTree.hpp"
+#include "../BufferPool/BufferPool.hpp"
+#include "../DiskManager/DiskManager.hpp"
+#include "../Filter/KeyFilter.hpp"
+#include "../Mvcc/TimestampOracle.hpp"
+#include "../Mvcc/VersionStore.hpp"
+#include "./KVEngine.hpp"
+
+struct PagedEngineConfig {
+  size_t poolFrames = 4096;
+  // Every page the engine lays out fits the pool's payload, so new files
+  // get checksummed blocks unless this turns them off.
+  DiskManagerConfig disk = [] {
+    DiskManagerConfig disk;
+    disk.checksums = true;
+    return disk;
+  }();
+  BufferPoolConfig pool;
+  // Checked before the tree, so most lookups of absent keys never fetch an
+  // index page. A Bloom filter keeps the bits of deleted keys; a cuckoo
+  // filter drops them, and Put looks a key up first when the filter cannot
+  // rule it out, so that each key is in the filter once.
+  KeyFilterConfig filter;
+  // Keeps the versions a write replaces while an open snapshot may read
+  // them, so snapshots and scans see the table as of one moment. Off,
+  // reads see each key as it is when they reach it.
+  bool multiVersion = true;
+  // Writes between passes of CollectVersions while versions are kept.
+  size_t collectEveryWrites = 4096;
+};
+
+// KVEngine over a BPlusTree in its own database file. The file's first
+// block names the tree's meta block and the filter's pages, so reopening
+// the file finds both. Changes reach the file as the pool writes blocks
+// back, and all of them on close.
+//
+// The filter is saved on close and loaded on open. It is marked stale
+// while the engine is open, so after a crash, or when the configuration
+// asks for another filter, it is rebuilt from the tree instead, with room
+// for twice the keys the tree holds. A cuckoo filter that fills up is
+// rebuilt at twice its capacity, with every write held off while the tree
+// is scanned; lookups skip the filter meanwhile.
+//
+// With multiVersion, each write is stamped with a commit timestamp from a
+// TimestampOracle once the tree has it, and the version it replaces stays
+// in a VersionStore while an open snapshot is older than the write.
+// Reads take no block latches and no key locks: they read the tree
+// optimistically and let the store roll the value back to their
+// timestamp, so a long Scan runs alongside updates without holding them
+// up or seeing any that came after it started. A Delete with an older
+// snapshot open leaves the key in the tree, hidden by the store, until no
+// snapshot can see it. The versions live in memory only.
+class PagedEngine : public KVEngine {
+public:
+  explicit PagedEngine(const std::string &path,
+                       const PagedEngineConfig &config = PagedEngineConfig());
+  ~PagedEngine() override;
+
+  PagedEngine(const PagedEngine &) = delete;
+  PagedEngine &operator=(const PagedEngine &) = delete;
+  PagedEngine(PagedEngine &&) = delete;
+  PagedEngine &operator=(PagedEngine &&) = delete;
+
+  std::optional<uint64_t> Get(std::string_view key) override;
+  void Put(std::string_view key, uint64_t value) override;
+  bool Delete(std::string_view key) override;
+  void Scan(std::string_view startKey,
+            const std::function<bool(std::string_view, uint64_t)> &visit)
+      override;
+
+  // Reads the table as of when the snapshot was opened. Needs
+  // multiVersion. Scan without one reads through a snapshot of its own.
+  Snapshot OpenSnapshot();
+  std::optional<uint64_t> Get(std::string_view key,
+                              const Snapshot &snapshot);
+  void Scan(std::string_view startKey,
+            const std::function<bool(std::string_view, uint64_t)> &visit,
+            const Snapshot &snapshot);
+  // Drops the versions no open snapshot can read and removes keys deleted
+  // before the oldest of them. Runs every collectEveryWrites writes while
+  // the store holds versions, and on close.
+  void CollectVersions();
+
+  BufferPool &GetBufferPool();
+  // The filter lookups consult, or nullptr when there is none in use.
+  const KeyFilter *GetFilter() const;
+  const VersionStore &GetVersionStore() const;
+
+private:
+  static constexpr size_t LOCK_STRIPES = 64;
+
+  std::unique_ptr<BufferPool> pool;
+  std::unique_ptr<BPlusTree> tree;
+  // The filter in use, and every filter it replaced: a lookup may still be
+  // reading an older one, so they are all kept until close. Each is twice
+  // the size of the one before, so together they take less than the
+  // current one again.
+  std::vector<std::unique_ptr<KeyFilter>> filters;
+  std::atomic<KeyFilter *> filter;
+  KeyFilterConfig filterConfig;
+  BlockId filterHeaderId;
+  std::atomic<bool> filterInUse;
+  // Held while a full filter is replaced.
+  std::mutex growMutex;
+  // Keep a key's tree update and filter update together when the filter
+  // removes keys, so the filter never lacks a key the tree holds.
+  // With multiVersion, every write holds its key's lock.
+  std::array<std::mutex, LOCK_STRIPES> keyLocks;
+
+  bool multiVersion;
+  size_t collectEveryWrites;
+  TimestampOracle oracle;
+  VersionStore versions;
+  std::atomic<size_t> versionedWrites{0};
+  std::mutex collectMutex;
+  // The oldest active timestamp the last collection ran at.
+  uint64_t lastCollectedBelow = 0;
+
+  // The filter to consult, or nullptr when none is in use.
+  KeyFilter *FilterInUse() const;
+  void InstallFilter(std::unique_ptr<KeyFilter> filter);
+  // Builds a filter of the tree's keys with room for at least `capacity`
+  // keys, larger if they do not fit. No write may run meanwhile.
+  void RebuildFilter(size_t capacity);
+  // Replaces a filter that filled up, once the writer that found it full
+  // has let go of its key's lock.
+  void GrowFilter();
+  std::mutex &LockFor(std::string_view key);
+
+  void PutVersioned(std::string_view key, uint64_t value);
+  bool DeleteVersioned(std::string_view key);
+  std::optional<uint64_t> GetAt(std::string_view key, uint64_t timestamp);
+  void ScanAt(std::string_view startKey,
+              const std::function<bool(std::string_view, uint64_t)> &visit,
+              uint64_t timestamp);
+  // Commits a write of `key` from `before` to `after`, with `apply`
+  // changing the tree, and drops the replaced version at once if no
+  // snapshot needs it. The key's lock is held.
+  void Commit(std::string_view key, std::optional<uint64_t> before,
+              std::optional<uint64_t> after,
+              const std::function<void()> &apply);
+  void AfterVersionedWrite();
+  // Removes a deleted key from the tree and the filter. The key's lock is
+  // held.
+  void PurgeKey(std::string_view key);
+};
@@ -0,0 +1,245 @@
+#include "./LogManager.hpp"
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+
+LogManager::LogManager(const std::string &path, const LogManagerConfig &config)
+    : path(path), config(config), fd(-1), appendStart(0), nextLSN(0),
+      flushedLSN(0), syncInProgress(false), syncCount(0) {
+  this->fd = ::open(this->path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+  if (this->fd < 0) {
+    this->ThrowIOError("Failed to open log file: " + this->path, errno);
+  }
+
+  try {
+    LSN end = this->ScanRecords(nullptr);
+    struct stat st {};
+    if (::fstat(this->fd, &st) != 0) {
+      this->ThrowIOError("Failed to determine log size with fstat()", errno);
+    }
+    // Drop a torn tail so new records follow the last intact one.
+    if (static_cast<LSN>(st.st_size) != end) {
+      if (::ftruncate(this->fd, static_cast<off_t>(end)) != 0 ||
+          ::fdatasync(this->fd) != 0) {
+        this->ThrowIOError("Failed to truncate torn log tail", errno);
+      }
+    }
+    this->appendStart = end;
+    this->nextLSN = end;
+    this->flushedLSN = end;
+  } catch (...) {
+    ::close(this->fd);
+    this->fd = -1;
+    throw;
+  }
+}
+
+LogManager::~LogManager() {
+  try {
+    this->Flush(this->GetNextLSN());
+  } catch (const LogManagerException &) {
+    // Nothing to report to from a destructor; unflushed records are lost,
+    // exactly as in a crash.
+  }
+  if (this->fd >= 0) {
+    ::close(this->fd);
+  }
+}
+
+LSN LogManager::Append(const char *record, size_t length) {
+  if (record == nullptr && length != 0) {
+    throw LogManagerException("Trying to append from null buffer");
+  }
+  if (length > UINT32_MAX - HEADER_SIZE) {
+    throw LogManagerException("Log record too large: " +
+                              std::to_string(length) + " bytes");
+  }
+
+  char header[HEADER_SIZE];
+  uint32_t size = static_cast<uint32_t>(length);
+  std::memcpy(header, &size, sizeof(size));
+  uint32_t checksum = Checksum(header, record, length);
+  std::memcpy(header + sizeof(size), &checksum, sizeof(checksum));
+
+  std::lock_guard<std::mutex> lock(this->mutex);
+  this->appendBuffer.insert(this->appendBuffer.end(), header,
+                            header + HEADER_SIZE);
+  this->appendBuffer.insert(this->appendBuffer.end(), record, record + length);
+  this->nextLSN += HEADER_SIZE + length;
+  return this->nextLSN;
+}
+
+void LogManager::Flush(LSN lsn) {
+  if (this->flushedLSN.load(std::memory_order_acquire) >= lsn) {
+    return;
+  }
+
+  std::unique_lock<std::mutex> lock(this->mutex);
+  if (lsn > this->nextLSN) {
+    throw LogManagerException("Trying to flush past the end of the log: LSN " +
+                              std::to_string(lsn));
+  }
+
+  while (this->flushedLSN.load(std::memory_order_relaxed) < lsn) {
+    if (!this->failure.empty()) {
+      throw LogManagerException(this->failure);
+    }
+    if (this->syncInProgress) {
+      this->syncDone.wait(lock);
+      continue;
+    }
+
+    // Leader: take everything appended so far, including records of
+    // followers still waiting behind us.
+    this->syncInProgress = true;
+    if (this->config.groupCommitDelay.count() > 0) {
+      lock.unlock();
+      std::this_thread::sleep_for(this->config.groupCommitDelay);
+      lock.lock();
+    }
+    std::swap(this->appendBuffer, this->writeBuffer);
+    LSN start = this->appendStart;
+    LSN end = this->nextLSN;
+    this->appendStart = end;
+    lock.unlock();
+
+    std::string error;
+    try {
+      this->WriteFully(this->writeBuffer.data(), this->writeBuffer.size(),
+                       start);
+      if (::fdatasync(this->fd) != 0) {
+        this->ThrowIOError("Failed to fdatasync log file", errno);
+      }
+    } catch (const LogManagerException &e) {
+      error = e.what();
+    }
+    this->syncCount++;
+
+    lock.lock();
+    this->writeBuffer.clear();
+    this->syncInProgress = false;
+    if (error.empty()) {
+      this->flushedLSN.store(end, std::memory_order_release);
+    } else {
+      // The batch is gone and later records would land after a hole.
+      this->failure = error;
+    }
+    this->syncDone.notify_all();
+  }
+}
+
+LSN LogManager::Commit(const char *record, size_t length) {
+  LSN lsn = this->Append(record, length);
+  this->Flush(lsn);
+  return lsn;
+}
+
+LSN LogManager::GetFlushedLSN() const {
+  return this->flushedLSN.load(std::memory_order_acquire);
+}
+
+LSN LogManager::GetNextLSN() {
+  std::lock_guard<std::mutex> lock(this->mutex);
+  return this->nextLSN;
+}
+
+uint64_t LogManager::GetSyncCount() const { return this->syncCount; }
+
+void LogManager::ReadRecords(
+    const std::function<void(LSN, const char *, size_t)> &visit) {
+  LSN durable = this->GetFlushedLSN();
+  this->ScanRecords([&](LSN lsn, const char *payload, size_t length) {
+    if (lsn <= durable) {
+      visit(lsn, payload, length);
+    }
+  });
+}
+
+LSN LogManager::ScanRecords(
+    const std::function<void(LSN, const char *, size_t)> &visit) {
+  struct stat st {};
+  if (::fstat(this->fd, &st) != 0) {
+    this->ThrowIOError("Failed to determine log size with fstat()", errno);
+  }
+  LSN size = static_cast<LSN>(st.st_size);
+
+  LSN offset = 0;
+  std::vector<char> payload;
+  char header[HEADER_SIZE];
+
+  while (this->ReadFully(header, HEADER_SIZE, offset)) {
+    uint32_t length;
+    uint32_t checksum;
+    std::memcpy(&length, header, sizeof(length));
+    std::memcpy(&checksum, header + sizeof(length), sizeof(checksum));
+
+    // A torn length field can claim anything; never trust it past EOF.
+    if (length > size - offset - HEADER_SIZE) {
+      break;
+    }
+    payload.resize(length);
+    if (!this->ReadFully(payload.data(), length, offset + HEADER_SIZE) ||
+        Checksum(header, payload.data(), length) != checksum) {
+      break;
+    }
+    offset += HEADER_SIZE + length;
+    if (visit) {
+      visit(offset, payload.data(), length);
+    }
+  }
+  return offset;
+}
+
+uint32_t LogManager::Checksum(const char *header, const char *payload,
+                              size_t length) {
+  // FNV-1a over the length field and the payload.
+  uint32_t hash = 2166136261u;
+  auto mix = [&hash](const char *data, size_t size) {
+    for (size_t i = 0; i < size; ++i) {
+      hash ^= static_cast<unsigned char>(data[i]);
+      hash *= 16777619u;
+    }
+  };
+  mix(header, sizeof(uint32_t));
+  mix(payload, length);
+  return hash;
+}
+
+void LogManager::WriteFully(const char *buff, size_t length, LSN offset) {
+  size_t done = 0;
+  while (done < length) {
+    ssize_t n = ::pwrite(this->fd, buff + done, length - done,
+                         static_cast<off_t>(offset + done));
+    if (n < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      this->ThrowIOError("Failed to write log at offset " +
+                             std::to_string(offset),
+                         errno);
+    }
+    done += static_cast<size_t>(n);
+  }
+}
+
+bool LogManager::ReadFully(char *buff, size_t length, LSN offset) {
+  size_t done = 0;
+  while (done < length) {
+    ssize_t n = ::pread(this->fd, buff + done, length - done,
+                        static_cast<off_t>(offset + done));
+    if (n < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      this->ThrowIOError("Failed to read log at offset " +
+                             std::to_string(offset),
+                         errno);
+    }
+    if (n == 0) {
+      return false;
+    }
+    done += static_cast<size_t>(n);
+  }
+  return true;
+}
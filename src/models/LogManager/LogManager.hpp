@@ -0,0 +1,103 @@
+#pragma once
+#include "../../types/Constants.hpp"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <functional>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+class LogManagerException : public std::runtime_error {
+public:
+  explicit LogManagerException(const std::string &message)
+      : std::runtime_error(message) {}
+};
+
+struct LogManagerConfig {
+  // How long a group-commit leader waits for more records before it syncs.
+  // With 0 a batch holds whatever was appended while the previous sync ran.
+  std::chrono::microseconds groupCommitDelay{0};
+};
+
+// Append-only write-ahead log. A record is stored as [uint32 length]
+// [uint32 checksum][payload] and its LSN is the file offset just past it.
+//
+// Append only copies into memory. Flush(lsn) makes the log durable up to
+// `lsn` with group commit: the first caller that finds no sync running
+// becomes the leader, writes everything appended so far and issues a single
+// fdatasync; callers arriving meanwhile wait for it and either find their
+// record covered or elect the next leader. N concurrent commits therefore
+// cost far fewer than N syncs.
+class LogManager {
+public:
+  explicit LogManager(const std::string &path,
+                      const LogManagerConfig &config = LogManagerConfig());
+  ~LogManager();
+
+  LogManager(const LogManager &) = delete;
+  LogManager &operator=(const LogManager &) = delete;
+  LogManager(LogManager &&) = delete;
+  LogManager &operator=(LogManager &&) = delete;
+
+  LSN Append(const char *record, size_t length);
+  // Returns once every record with an LSN up to `lsn` is on stable storage.
+  // A failed log write is sticky: it and every later Flush throw.
+  void Flush(LSN lsn);
+  // Append followed by Flush of the new record.
+  LSN Commit(const char *record, size_t length);
+
+  LSN GetFlushedLSN() const;
+  LSN GetNextLSN();
+  uint64_t GetSyncCount() const;
+
+  // Visits every durable record in log order, for recovery.
+  void ReadRecords(
+      const std::function<void(LSN, const char *, size_t)> &visit);
+
+private:
+  static constexpr size_t HEADER_SIZE = 2 * sizeof(uint32_t);
+
+  std::string path;
+  LogManagerConfig config;
+  int fd;
+
+  std::mutex mutex;
+  std::condition_variable syncDone;
+  // Records appended since the last leader took its batch, starting at file
+  // offset `appendStart`. The leader swaps it with `writeBuffer` so both
+  // keep their capacity.
+  std::vector<char> appendBuffer;
+  std::vector<char> writeBuffer;
+  LSN appendStart;
+  LSN nextLSN;
+  std::atomic<LSN> flushedLSN;
+  bool syncInProgress;
+  std::string failure;
+  std::atomic<uint64_t> syncCount;
+
+  // Walks the records from the start of the file and returns the offset
+  // past the last intact one; a torn or corrupt tail ends the walk.
+  LSN ScanRecords(
+      const std::function<void(LSN, const char *, size_t)> &visit);
+  static uint32_t Checksum(const char *header, const char *payload,
+                           size_t length);
+  void WriteFully(const char *buff, size_t length, LSN offset);
+  bool ReadFully(char *buff, size_t length, LSN offset);
+
+  std::string GetErrnoInfo(int err) {
+    std::string info = " (fd: " + std::to_string(this->fd);
+    if (err != 0) {
+      info += ", errno: " + std::to_string(err) + " - " + std::strerror(err);
+    }
+    info += ")";
+    return info;
+  }
+
+  void ThrowIOError(const std::string &message, int err = 0) {
+    throw LogManagerException(message + this->GetErrnoInfo(err) +
+                              "\n in File: " + this->path);
+  }
+};
@@ -0,0 +1,1004 @@
+#include "./LsmTree.hpp"
+#include "../Crc32c/Crc32c.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+constexpr uint64_t MANIFEST_MAGIC = 0x54534546494e414dull; // "MANIFEST"
+constexpr uint32_t MANIFEST_VERSION = 1;
+// A log record is [uint8 tombstone][uint64 value][key].
+constexpr size_t RECORD_HEADER = 1 + sizeof(uint64_t);
+
+[[noreturn]] void ThrowIOError(const std::string &message,
+                               const std::string &path, int err) {
+  throw LsmTreeException(message + " (errno: " + std::to_string(err) +
+                         " - " + std::strerror(err) + ")\n in File: " + path);
+}
+
+template <typename T> void AppendPod(std::string &out, T value) {
+  out.append(reinterpret_cast<const char *>(&value), sizeof(T));
+}
+
+void AppendKey(std::string &out, const std::string &key) {
+  AppendPod(out, static_cast<uint8_t>(key.size()));
+  out.append(key);
+}
+
+// Reads MANIFEST fields in order, failing once it runs past the end.
+class ManifestReader {
+public:
+  ManifestReader(std::string_view data, const std::string &path)
+      : data(data), path(path), position(0) {}
+
+  template <typename T> T Read() {
+    if (sizeof(T) > this->data.size() - this->position) {
+      this->Fail();
+    }
+    T value;
+    std::memcpy(&value, this->data.data() + this->position, sizeof(T));
+    this->position += sizeof(T);
+    return value;
+  }
+
+  std::string ReadKey() {
+    size_t size = this->Read<uint8_t>();
+    if (size > this->data.size() - this->position) {
+      this->Fail();
+    }
+    std::string key(this->data.substr(this->position, size));
+    this->position += size;
+    return key;
+  }
+
+  bool AtEnd() const { return this->position == this->data.size(); }
+
+  [[noreturn]] void Fail() const {
+    throw LsmTreeException("Corrupt manifest\n in File: " + this->path);
+  }
+
+private:
+  std::string_view data;
+  const std::string &path;
+  size_t position;
+};
+
+void WriteFileFully(const std::string &path, const std::string &data) {
+  int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC,
+                  0644);
+  if (fd < 0) {
+    ThrowIOError("Failed to create file", path, errno);
+  }
+  size_t done = 0;
+  while (done < data.size()) {
+    ssize_t written = ::write(fd, data.data() + done, data.size() - done);
+    if (written < 0 && errno == EINTR) {
+      continue;
+    }
+    if (written <= 0) {
+      int err = written < 0 ? errno : EIO;
+      ::close(fd);
+      ThrowIOError("Failed to write file", path, err);
+    }
+    done += static_cast<size_t>(written);
+  }
+  if (::fdatasync(fd) != 0) {
+    int err = errno;
+    ::close(fd);
+    ThrowIOError("Failed to sync file", path, err);
+  }
+  ::close(fd);
+}
+
+// Makes renames and unlinks in `directory` durable.
+void SyncDirectory(const std::string &directory) {
+  int fd = ::open(directory.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+  if (fd < 0) {
+    ThrowIOError("Failed to open directory", directory, errno);
+  }
+  if (::fsync(fd) != 0) {
+    int err = errno;
+    ::close(fd);
+    ThrowIOError("Failed to sync directory", directory, err);
+  }
+  ::close(fd);
+}
+
+// One sorted input of a scan or compaction, holding each key once.
+class Source {
+public:
+  virtual ~Source() = default;
+  virtual bool Valid() const = 0;
+  virtual void SeekToFirst() = 0;
+  virtual void Seek(std::string_view key) = 0;
+  virtual void Next() = 0;
+  virtual std::string_view Key() const = 0;
+  virtual uint64_t Value() const = 0;
+  virtual bool IsTombstone() const = 0;
+};
+
+// A Memtable or an SSTable, kept alive for as long as it is read.
+template <typename T> class IteratorSource : public Source {
+public:
+  explicit IteratorSource(std::shared_ptr<const T> owner)
+      : owner(std::move(owner)), iterator(*this->owner) {}
+
+  bool Valid() const override { return this->iterator.Valid(); }
+  void SeekToFirst() override { this->iterator.SeekToFirst(); }
+  void Seek(std::string_view key) override { this->iterator.Seek(key); }
+  void Next() override { this->iterator.Next(); }
+  std::string_view Key() const override { return this->iterator.Key(); }
+  uint64_t Value() const override { return this->iterator.Value(); }
+  bool IsTombstone() const override { return this->iterator.IsTombstone(); }
+
+private:
+  std::shared_ptr<const T> owner;
+  typename T::Iterator iterator;
+};
+
+// The tables of one level below 0: sorted and disjoint, so they read as one
+// run, opening each table only when the run reaches it.
+class LevelSource : public Source {
+public:
+  struct Table {
+    std::string largest;
+    std::shared_ptr<const SSTable> table;
+  };
+
+  explicit LevelSource(std::vector<Table> tables)
+      : tables(std::move(tables)), position(0) {}
+
+  bool Valid() const override {
+    return this->iterator != nullptr && this->iterator->Valid();
+  }
+  void SeekToFirst() override {
+    this->Open(0);
+    if (this->iterator != nullptr) {
+      this->iterator->SeekToFirst();
+    }
+    this->SkipFinished();
+  }
+  void Seek(std::string_view key) override {
+    auto it = std::lower_bound(
+        this->tables.begin(), this->tables.end(), key,
+        [](const Table &table, std::string_view k) {
+          return table.largest < k;
+        });
+    this->Open(static_cast<size_t>(it - this->tables.begin()));
+    if (this->iterator != nullptr) {
+      this->iterator->Seek(key);
+    }
+    this->SkipFinished();
+  }
+  void Next() override {
+    this->iterator->Next();
+    this->SkipFinished();
+  }
+  std::string_view Key() const override { return this->iterator->Key(); }
+  uint64_t Value() const override { return this->iterator->Value(); }
+  bool IsTombstone() const override { return this->iterator->IsTombstone(); }
+
+private:
+  std::vector<Table> tables;
+  size_t position;
+  std::unique_ptr<IteratorSource<SSTable>> iterator;
+
+  void Open(size_t table) {
+    this->position = table;
+    this->iterator.reset();
+    if (table < this->tables.size()) {
+      this->iterator = std::make_unique<IteratorSource<SSTable>>(
+          this->tables[table].table);
+    }
+  }
+  void SkipFinished() {
+    while (this->iterator != nullptr && !this->iterator->Valid()) {
+      this->Open(this->position + 1);
+      if (this->iterator != nullptr) {
+        this->iterator->SeekToFirst();
+      }
+    }
+  }
+};
+
+// Merges sources into one run holding the newest version of each key.
+// Sources are listed newest first: where several hold a key, the first
+// one's version wins and the others are skipped.
+class MergingIterator {
+public:
+  explicit MergingIterator(std::vector<std::unique_ptr<Source>> sources)
+      : sources(std::move(sources)), current(nullptr) {}
+
+  bool Valid() const { return this->current != nullptr; }
+  void SeekToFirst() {
+    for (auto &source : this->sources) {
+      source->SeekToFirst();
+    }
+    this->FindSmallest();
+  }
+  void Seek(std::string_view key) {
+    for (auto &source : this->sources) {
+      source->Seek(key);
+    }
+    this->FindSmallest();
+  }
+  void Next() {
+    for (auto &source : this->sources) {
+      if (source->Valid() && source->Key() == this->key) {
+        source->Next();
+      }
+    }
+    this->FindSmallest();
+  }
+
+  std::string_view Key() const { return this->key; }
+  uint64_t Value() const { return this->current->Value(); }
+  bool IsTombstone() const { return this->current->IsTombstone(); }
+
+private:
+  std::vector<std::unique_ptr<Source>> sources;
+  Source *current;
+  // A copy, since advancing the sources may release what Key() viewed.
+  std::string key;
+
+  void FindSmallest() {
+    this->current = nullptr;
+    for (auto &source : this->sources) {
+      if (source->Valid() &&
+          (this->current == nullptr || source->Key() < this->current->Key())) {
+        this->current = source.get();
+      }
+    }
+    if (this->current != nullptr) {
+      this->key.assign(this->current->Key());
+    }
+  }
+};
+
+bool Overlaps(const std::string &smallest, const std::string &largest,
+              std::string_view begin, std::string_view end) {
+  return !(largest < begin || end < smallest);
+}
+
+} // namespace
+
+LsmTree::LsmTree(const std::string &directory, const LsmTreeConfig &config)
+    : directory(directory), config(config), stopping(false),
+      backgroundBusy(false), nextFileNumber(1), logNumber(0),
+      immutableLogNumber(0), writesStalled(false), bytesIngested(0),
+      stats() {
+  if (config.memtableBytes == 0 || config.targetFileBytes == 0 ||
+      config.l0CompactionTrigger == 0 ||
+      config.l0StopTrigger < config.l0CompactionTrigger ||
+      config.levelBaseBytes == 0 || config.levelMultiplier < 2) {
+    throw LsmTreeException("Invalid LSM tree configuration");
+  }
+  if (::mkdir(directory.c_str(), 0755) != 0 && errno != EEXIST) {
+    ThrowIOError("Failed to create LSM tree directory", directory, errno);
+  }
+  this->Recover();
+  this->background = std::thread(&LsmTree::BackgroundLoop, this);
+}
+
+LsmTree::~LsmTree() {
+  try {
+    this->Flush();
+  } catch (const std::runtime_error &) {
+    // The log still holds whatever did not reach a table; the next open
+    // replays it.
+  }
+  {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    this->stopping = true;
+  }
+  this->backgroundWork.notify_all();
+  this->background.join();
+}
+
+std::optional<uint64_t> LsmTree::Get(std::string_view key) {
+  std::shared_ptr<Memtable> active;
+  std::shared_ptr<Memtable> frozen;
+  std::shared_ptr<const Version> version;
+  {
+    std::shared_lock<std::shared_mutex> state(this->stateMutex);
+    active = this->memtable;
+    frozen = this->immutable;
+    version = this->current;
+  }
+
+  uint64_t value = 0;
+  bool tombstone = false;
+  auto found = [&]() -> std::optional<uint64_t> {
+    if (tombstone) {
+      return std::nullopt;
+    }
+    return value;
+  };
+  if (active->Get(key, value, tombstone) ||
+      (frozen != nullptr && frozen->Get(key, value, tombstone))) {
+    return found();
+  }
+  for (const TablePtr &file : version->levels[0]) {
+    if (Overlaps(file->smallest, file->largest, key, key) &&
+        file->table->Get(key, value, tombstone)) {
+      return found();
+    }
+  }
+  for (size_t level = 1; level < LEVELS; ++level) {
+    const auto &files = version->levels[level];
+    auto it = std::lower_bound(files.begin(), files.end(), key,
+                               [](const TablePtr &file, std::string_view k) {
+                                 return file->largest < k;
+                               });
+    if (it != files.end() && (*it)->smallest <= key &&
+        (*it)->table->Get(key, value, tombstone)) {
+      return found();
+    }
+  }
+  return std::nullopt;
+}
+
+void LsmTree::Put(std::string_view key, uint64_t value) {
+  this->Write(key, value, false);
+}
+
+bool LsmTree::Delete(std::string_view key) {
+  CheckKey(key);
+  bool present = this->Get(key).has_value();
+  this->Write(key, 0, true);
+  return present;
+}
+
+void LsmTree::Scan(
+    std::string_view startKey,
+    const std::function<bool(std::string_view, uint64_t)> &visit) {
+  std::vector<std::unique_ptr<Source>> sources;
+  std::shared_ptr<const Version> version;
+  {
+    std::shared_lock<std::shared_mutex> state(this->stateMutex);
+    sources.push_back(
+        std::make_unique<IteratorSource<Memtable>>(this->memtable));
+    if (this->immutable != nullptr) {
+      sources.push_back(
+          std::make_unique<IteratorSource<Memtable>>(this->immutable));
+    }
+    version = this->current;
+  }
+  for (const TablePtr &file : version->levels[0]) {
+    sources.push_back(std::make_unique<IteratorSource<SSTable>>(file->table));
+  }
+  for (size_t level = 1; level < LEVELS; ++level) {
+    if (version->levels[level].empty()) {
+      continue;
+    }
+    std::vector<LevelSource::Table> tables;
+    for (const TablePtr &file : version->levels[level]) {
+      tables.push_back({file->largest, file->table});
+    }
+    sources.push_back(std::make_unique<LevelSource>(std::move(tables)));
+  }
+
+  MergingIterator merged(std::move(sources));
+  for (merged.Seek(startKey); merged.Valid(); merged.Next()) {
+    if (!merged.IsTombstone() && !visit(merged.Key(), merged.Value())) {
+      return;
+    }
+  }
+}
+
+void LsmTree::Flush() {
+  std::unique_lock<std::mutex> lock(this->mutex);
+  auto drained = [this] {
+    return !this->backgroundError.empty() || this->immutable == nullptr;
+  };
+  this->backgroundDone.wait(lock, drained);
+  this->CheckBackgroundError();
+  if (!this->memtable->IsEmpty()) {
+    this->FreezeMemtable();
+    this->backgroundDone.wait(lock, drained);
+    this->CheckBackgroundError();
+  }
+}
+
+void LsmTree::WaitForCompactions() {
+  std::unique_lock<std::mutex> lock(this->mutex);
+  this->backgroundDone.wait(lock, [this] {
+    Compaction compaction;
+    return !this->backgroundError.empty() ||
+           (!this->backgroundBusy && this->immutable == nullptr &&
+            !this->PickCompaction(compaction));
+  });
+  this->CheckBackgroundError();
+}
+
+LsmTreeStats LsmTree::GetStats() {
+  std::lock_guard<std::mutex> lock(this->mutex);
+  LsmTreeStats snapshot = this->stats;
+  snapshot.bytesIngested = this->bytesIngested.load(std::memory_order_relaxed);
+  snapshot.filesPerLevel.clear();
+  snapshot.bytesPerLevel.clear();
+  for (const auto &files : this->current->levels) {
+    snapshot.filesPerLevel.push_back(files.size());
+    snapshot.bytesPerLevel.push_back(LevelBytes(files));
+  }
+  return snapshot;
+}
+
+void LsmTree::Write(std::string_view key, uint64_t value, bool tombstone) {
+  CheckKey(key);
+  char record[RECORD_HEADER + MAX_KEY_SIZE];
+  record[0] = static_cast<char>(tombstone);
+  std::memcpy(record + 1, &value, sizeof(value));
+  if (!key.empty()) {
+    std::memcpy(record + RECORD_HEADER, key.data(), key.size());
+  }
+  size_t length = RECORD_HEADER + key.size();
+
+  while (true) {
+    {
+      std::shared_lock<std::shared_mutex> state(this->stateMutex);
+      if (!this->writesStalled.load(std::memory_order_relaxed) &&
+          this->memtable->ApproximateBytes() < this->config.memtableBytes) {
+        // The log serializes LSNs, so they order versions of a key the
+        // same way the log does.
+        LSN lsn = this->config.syncWrites ? this->log->Commit(record, length)
+                                          : this->log->Append(record, length);
+        this->memtable->Add(lsn, key, value, tombstone);
+        break;
+      }
+    }
+    this->MakeRoomForWrite();
+  }
+  this->bytesIngested.fetch_add(key.size() + sizeof(value),
+                                std::memory_order_relaxed);
+}
+
+void LsmTree::MakeRoomForWrite() {
+  std::unique_lock<std::mutex> lock(this->mutex);
+  while (true) {
+    this->CheckBackgroundError();
+    if (this->writesStalled.load(std::memory_order_relaxed)) {
+      this->backgroundDone.wait(lock);
+    } else if (this->memtable->ApproximateBytes() <
+               this->config.memtableBytes) {
+      return;
+    } else if (this->immutable != nullptr) {
+      this->backgroundDone.wait(lock);
+    } else {
+      this->FreezeMemtable();
+      return;
+    }
+  }
+}
+
+void LsmTree::FreezeMemtable() {
+  uint64_t number = this->nextFileNumber++;
+  auto newLog = std::make_unique<LogManager>(this->FilePath(number, ".log"));
+  {
+    // Waits out every writer still adding to the old memtable.
+    std::unique_lock<std::shared_mutex> state(this->stateMutex);
+    this->immutable = std::move(this->memtable);
+    this->immutableLog = std::move(this->log);
+    this->immutableLogNumber = this->logNumber;
+    this->memtable = std::make_shared<Memtable>();
+    this->log = std::move(newLog);
+    this->logNumber = number;
+  }
+  this->backgroundWork.notify_one();
+}
+
+void LsmTree::CheckBackgroundError() const {
+  if (!this->backgroundError.empty()) {
+    throw LsmTreeException("Background flush or compaction failed: " +
+                           this->backgroundError);
+  }
+}
+
+void LsmTree::BackgroundLoop() {
+  std::unique_lock<std::mutex> lock(this->mutex);
+  while (true) {
+    Compaction compaction;
+    bool flush = false;
+    bool compact = false;
+    if (this->backgroundError.empty()) {
+      flush = this->immutable != nullptr;
+      compact = !flush && !this->stopping && this->PickCompaction(compaction);
+    }
+    if (!flush && !compact) {
+      this->backgroundBusy = false;
+      this->backgroundDone.notify_all();
+      if (this->stopping) {
+        return;
+      }
+      this->backgroundWork.wait(lock);
+      continue;
+    }
+
+    this->backgroundBusy = true;
+    lock.unlock();
+    std::string error;
+    try {
+      if (flush) {
+        this->FlushImmutable();
+      } else {
+        this->RunCompaction(compaction);
+      }
+    } catch (const std::exception &e) {
+      error = e.what();
+    }
+    lock.lock();
+    if (!error.empty()) {
+      this->backgroundError = error;
+    }
+    this->backgroundDone.notify_all();
+  }
+}
+
+void LsmTree::FlushImmutable() {
+  std::shared_ptr<Memtable> table;
+  uint64_t number;
+  uint64_t flushedLog;
+  {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    table = this->immutable;
+    number = this->nextFileNumber++;
+    flushedLog = this->immutableLogNumber;
+  }
+
+  std::shared_ptr<TableFile> file;
+  if (!table->IsEmpty()) {
+    file = this->WriteTable(*table, number);
+  }
+
+  std::unique_ptr<LogManager> retiredLog;
+  {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    auto version = std::make_shared<Version>(*this->current);
+    if (file != nullptr) {
+      version->levels[0].insert(version->levels[0].begin(), file);
+    }
+    this->WriteManifest(*version, this->logNumber);
+    {
+      std::unique_lock<std::shared_mutex> state(this->stateMutex);
+      this->current = std::move(version);
+      this->immutable.reset();
+      retiredLog = std::move(this->immutableLog);
+    }
+    this->UpdateStall();
+    if (file != nullptr) {
+      this->stats.flushes++;
+      this->stats.bytesFlushed += file->bytes;
+    }
+  }
+  retiredLog.reset();
+  ::unlink(this->FilePath(flushedLog, ".log").c_str());
+}
+
+bool LsmTree::PickCompaction(Compaction &compaction) const {
+  const Version &version = *this->current;
+  if (version.levels[0].size() >= this->config.l0CompactionTrigger) {
+    compaction.level = 0;
+    compaction.inputs = version.levels[0];
+  } else {
+    // The level furthest over its budget; the last level has none.
+    size_t level = 0;
+    double best = 1.0;
+    for (size_t l = 1; l + 1 < LEVELS; ++l) {
+      double score = static_cast<double>(LevelBytes(version.levels[l])) /
+                     static_cast<double>(this->MaxBytesForLevel(l));
+      if (score >= best) {
+        best = score;
+        level = l;
+      }
+    }
+    if (level == 0) {
+      return false;
+    }
+    // Take the table after the last one compacted from this level, so
+    // every key range gets its turn.
+    const auto &files = version.levels[level];
+    auto it = std::find_if(files.begin(), files.end(),
+                           [&](const TablePtr &file) {
+                             return file->largest >
+                                    this->compactPointers[level];
+                           });
+    if (it == files.end()) {
+      it = files.begin();
+    }
+    compaction.level = level;
+    compaction.inputs = {*it};
+  }
+
+  std::string_view smallest = compaction.inputs.front()->smallest;
+  std::string_view largest = compaction.inputs.front()->largest;
+  for (const TablePtr &file : compaction.inputs) {
+    smallest = std::min<std::string_view>(smallest, file->smallest);
+    largest = std::max<std::string_view>(largest, file->largest);
+  }
+  compaction.outputLevelInputs.clear();
+  for (const TablePtr &file : version.levels[compaction.level + 1]) {
+    if (Overlaps(file->smallest, file->largest, smallest, largest)) {
+      compaction.outputLevelInputs.push_back(file);
+    }
+  }
+  return true;
+}
+
+void LsmTree::RunCompaction(const Compaction &compaction) {
+  size_t level = compaction.level;
+  size_t outputLevel = level + 1;
+  const auto &inputs = compaction.inputs;
+  const auto &overlapped = compaction.outputLevelInputs;
+  auto removeInputs = [&](Version &version) {
+    auto isInput = [&](const TablePtr &file) {
+      return std::find(inputs.begin(), inputs.end(), file) != inputs.end() ||
+             std::find(overlapped.begin(), overlapped.end(), file) !=
+                 overlapped.end();
+    };
+    std::erase_if(version.levels[level], isInput);
+    std::erase_if(version.levels[outputLevel], isInput);
+  };
+  auto byKey = [](const TablePtr &a, const TablePtr &b) {
+    return a->smallest < b->smallest;
+  };
+
+  // Nothing to merge with: the table changes level without being rewritten.
+  if (inputs.size() == 1 && overlapped.empty()) {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    auto version = std::make_shared<Version>(*this->current);
+    removeInputs(*version);
+    auto &files = version->levels[outputLevel];
+    files.insert(std::upper_bound(files.begin(), files.end(), inputs.front(),
+                                  byKey),
+                 inputs.front());
+    this->compactPointers[level] = inputs.front()->largest;
+    this->InstallVersion(std::move(version));
+    this->stats.trivialMoves++;
+    return;
+  }
+
+  std::shared_ptr<const Version> base;
+  {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    base = this->current;
+  }
+  std::string smallest = inputs.front()->smallest;
+  std::string largest = inputs.front()->largest;
+  for (const auto *files : {&inputs, &overlapped}) {
+    for (const TablePtr &file : *files) {
+      smallest = std::min(smallest, file->smallest);
+      largest = std::max(largest, file->largest);
+    }
+  }
+  // A tombstone still hides older versions until no deeper level could
+  // hold one.
+  bool dropTombstones = true;
+  for (size_t deeper = outputLevel + 1; deeper < LEVELS; ++deeper) {
+    for (const TablePtr &file : base->levels[deeper]) {
+      if (Overlaps(file->smallest, file->largest, smallest, largest)) {
+        dropTombstones = false;
+      }
+    }
+  }
+
+  // Level-0 inputs are newest first, and all of them are newer than the
+  // tables of the level below.
+  std::vector<std::unique_ptr<Source>> sources;
+  for (const TablePtr &file : inputs) {
+    sources.push_back(std::make_unique<IteratorSource<SSTable>>(file->table));
+  }
+  if (!overlapped.empty()) {
+    std::vector<LevelSource::Table> tables;
+    for (const TablePtr &file : overlapped) {
+      tables.push_back({file->largest, file->table});
+    }
+    sources.push_back(std::make_unique<LevelSource>(std::move(tables)));
+  }
+  MergingIterator merged(std::move(sources));
+
+  std::vector<TablePtr> outputs;
+  std::unique_ptr<SSTableWriter> writer;
+  uint64_t number = 0;
+  uint64_t bytesWritten = 0;
+  auto finishTable = [&] {
+    uint64_t bytes = writer->Finish();
+    auto table = std::make_shared<SSTable>(this->FilePath(number, ".sst"));
+    outputs.push_back(std::make_shared<TableFile>(
+        TableFile{number, bytes, writer->GetSmallestKey(),
+                  writer->GetLargestKey(), std::move(table)}));
+    bytesWritten += bytes;
+    writer.reset();
+  };
+  try {
+    for (merged.SeekToFirst(); merged.Valid(); merged.Next()) {
+      if (merged.IsTombstone() && dropTombstones) {
+        continue;
+      }
+      if (writer == nullptr) {
+        {
+          std::lock_guard<std::mutex> lock(this->mutex);
+          number = this->nextFileNumber++;
+        }
+        writer = std::make_unique<SSTableWriter>(
+            this->FilePath(number, ".sst"), this->config.bloomBitsPerKey);
+      }
+      writer->Add(merged.Key(), merged.Value(), merged.IsTombstone());
+      if (writer->GetFileBytes() >= this->config.targetFileBytes) {
+        finishTable();
+      }
+    }
+    if (writer != nullptr) {
+      finishTable();
+    }
+  } catch (...) {
+    for (const TablePtr &output : outputs) {
+      output->table->MarkObsolete();
+    }
+    throw;
+  }
+
+  std::lock_guard<std::mutex> lock(this->mutex);
+  auto version = std::make_shared<Version>(*this->current);
+  removeInputs(*version);
+  auto &files = version->levels[outputLevel];
+  files.insert(files.end(), outputs.begin(), outputs.end());
+  std::sort(files.begin(), files.end(), byKey);
+  if (level > 0) {
+    this->compactPointers[level] = inputs.back()->largest;
+  }
+  this->InstallVersion(std::move(version));
+  this->stats.compactions++;
+  this->stats.bytesCompacted += bytesWritten;
+  // Readers still holding the old version keep the files until they
+  // finish.
+  for (const auto *files : {&inputs, &overlapped}) {
+    for (const TablePtr &file : *files) {
+      file->table->MarkObsolete();
+    }
+  }
+}
+
+void LsmTree::InstallVersion(std::shared_ptr<const Version> version) {
+  this->WriteManifest(*version, this->immutable != nullptr
+                                    ? this->immutableLogNumber
+                                    : this->logNumber);
+  {
+    std::unique_lock<std::shared_mutex> state(this->stateMutex);
+    this->current = std::move(version);
+  }
+  this->UpdateStall();
+}
+
+void LsmTree::UpdateStall() {
+  this->writesStalled.store(this->current->levels[0].size() >=
+                                this->config.l0StopTrigger,
+                            std::memory_order_relaxed);
+}
+
+void LsmTree::Recover() {
+  auto version = std::make_shared<Version>();
+  this->ReadManifest(*version);
+  std::vector<uint64_t> liveTables;
+  for (const auto &files : version->levels) {
+    for (const TablePtr &file : files) {
+      liveTables.push_back(file->number);
+    }
+  }
+
+  // Tables the MANIFEST does not list are left from a flush or compaction
+  // that did not finish; logs before its oldest log are already in tables.
+  std::vector<uint64_t> logs;
+  DIR *dir = ::opendir(this->directory.c_str());
+  if (dir == nullptr) {
+    ThrowIOError("Failed to open LSM tree directory", this->directory, errno);
+  }
+  while (struct dirent *entry = ::readdir(dir)) {
+    std::string name = entry->d_name;
+    char *end = nullptr;
+    uint64_t number = std::strtoull(name.c_str(), &end, 10);
+    std::string_view extension = end;
+    if (end == name.c_str() || (extension != ".sst" && extension != ".log")) {
+      if (name == "MANIFEST.tmp") {
+        ::unlink((this->directory + "/" + name).c_str());
+      }
+      continue;
+    }
+    this->nextFileNumber = std::max(this->nextFileNumber, number + 1);
+    if (extension == ".log" && number >= this->logNumber) {
+      logs.push_back(number);
+    } else if (extension == ".log" ||
+               std::find(liveTables.begin(), liveTables.end(), number) ==
+                   liveTables.end()) {
+      ::unlink((this->directory + "/" + name).c_str());
+    }
+  }
+  ::closedir(dir);
+  std::sort(logs.begin(), logs.end());
+
+  // Logs are replayed oldest first, so a running count orders versions.
+  Memtable replayed;
+  uint64_t sequence = 0;
+  for (uint64_t number : logs) {
+    std::string path = this->FilePath(number, ".log");
+    LogManager log(path);
+    log.ReadRecords([&](LSN, const char *record, size_t length) {
+      if (length < RECORD_HEADER || length > RECORD_HEADER + MAX_KEY_SIZE) {
+        throw LsmTreeException("Corrupt log record\n in File: " + path);
+      }
+      uint64_t value;
+      std::memcpy(&value, record + 1, sizeof(value));
+      replayed.Add(++sequence,
+                   std::string_view(record + RECORD_HEADER,
+                                    length - RECORD_HEADER),
+                   value, record[0] != 0);
+    });
+  }
+  if (!replayed.IsEmpty()) {
+    auto file = this->WriteTable(replayed, this->nextFileNumber++);
+    version->levels[0].insert(version->levels[0].begin(), file);
+    this->stats.flushes++;
+    this->stats.bytesFlushed += file->bytes;
+  }
+
+  this->logNumber = this->nextFileNumber++;
+  this->log = std::make_unique<LogManager>(this->FilePath(this->logNumber,
+                                                          ".log"));
+  this->memtable = std::make_shared<Memtable>();
+  this->WriteManifest(*version, this->logNumber);
+  this->current = std::move(version);
+  this->UpdateStall();
+  for (uint64_t number : logs) {
+    ::unlink(this->FilePath(number, ".log").c_str());
+  }
+}
+
+bool LsmTree::ReadManifest(Version &version) {
+  std::string path = this->directory + "/MANIFEST";
+  int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    if (errno == ENOENT) {
+      return false;
+    }
+    ThrowIOError("Failed to open manifest", path, errno);
+  }
+  std::string data;
+  char buff[4096];
+  while (true) {
+    ssize_t n = ::read(fd, buff, sizeof(buff));
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n < 0) {
+      int err = errno;
+      ::close(fd);
+      ThrowIOError("Failed to read manifest", path, err);
+    }
+    if (n == 0) {
+      break;
+    }
+    data.append(buff, static_cast<size_t>(n));
+  }
+  ::close(fd);
+
+  uint32_t checksum;
+  if (data.size() < sizeof(checksum)) {
+    throw LsmTreeException("Corrupt manifest\n in File: " + path);
+  }
+  size_t bodySize = data.size() - sizeof(checksum);
+  std::memcpy(&checksum, data.data() + bodySize, sizeof(checksum));
+  if (Crc32c::Compute(data.data(), bodySize) != checksum) {
+    throw LsmTreeException("Manifest checksum mismatch\n in File: " + path);
+  }
+
+  ManifestReader reader(std::string_view(data).substr(0, bodySize), path);
+  if (reader.Read<uint64_t>() != MANIFEST_MAGIC ||
+      reader.Read<uint32_t>() != MANIFEST_VERSION) {
+    reader.Fail();
+  }
+  reader.Read<uint32_t>();
+  this->nextFileNumber = reader.Read<uint64_t>();
+  this->logNumber = reader.Read<uint64_t>();
+  uint32_t fileCount = reader.Read<uint32_t>();
+  for (uint32_t i = 0; i < fileCount; ++i) {
+    auto file = std::make_shared<TableFile>();
+    size_t level = reader.Read<uint8_t>();
+    file->number = reader.Read<uint64_t>();
+    file->bytes = reader.Read<uint64_t>();
+    file->smallest = reader.ReadKey();
+    file->largest = reader.ReadKey();
+    if (level >= LEVELS) {
+      reader.Fail();
+    }
+    file->table =
+        std::make_shared<SSTable>(this->FilePath(file->number, ".sst"));
+    version.levels[level].push_back(std::move(file));
+  }
+  if (!reader.AtEnd()) {
+    reader.Fail();
+  }
+  return true;
+}
+
+void LsmTree::WriteManifest(const Version &version, uint64_t oldestLog) {
+  std::string data;
+  AppendPod(data, MANIFEST_MAGIC);
+  AppendPod(data, MANIFEST_VERSION);
+  AppendPod(data, uint32_t{0});
+  AppendPod(data, this->nextFileNumber);
+  AppendPod(data, oldestLog);
+  uint32_t fileCount = 0;
+  for (const auto &files : version.levels) {
+    fileCount += static_cast<uint32_t>(files.size());
+  }
+  AppendPod(data, fileCount);
+  for (size_t level = 0; level < LEVELS; ++level) {
+    for (const TablePtr &file : version.levels[level]) {
+      AppendPod(data, static_cast<uint8_t>(level));
+      AppendPod(data, file->number);
+      AppendPod(data, file->bytes);
+      AppendKey(data, file->smallest);
+      AppendKey(data, file->largest);
+    }
+  }
+  AppendPod(data, Crc32c::Compute(data.data(), data.size()));
+
+  // Written beside the old one and renamed over it, so a crash leaves one
+  // or the other whole.
+  std::string path = this->directory + "/MANIFEST";
+  WriteFileFully(path + ".tmp", data);
+  if (::rename((path + ".tmp").c_str(), path.c_str()) != 0) {
+    ThrowIOError("Failed to replace manifest", path, errno);
+  }
+  SyncDirectory(this->directory);
+}
+
+std::shared_ptr<LsmTree::TableFile>
+LsmTree::WriteTable(const Memtable &table, uint64_t number) {
+  std::string path = this->FilePath(number, ".sst");
+  SSTableWriter writer(path, this->config.bloomBitsPerKey);
+  Memtable::Iterator it(table);
+  for (it.SeekToFirst(); it.Valid(); it.Next()) {
+    writer.Add(it.Key(), it.Value(), it.IsTombstone());
+  }
+  uint64_t bytes = writer.Finish();
+  return std::make_shared<TableFile>(
+      TableFile{number, bytes, writer.GetSmallestKey(),
+                writer.GetLargestKey(), std::make_shared<SSTable>(path)});
+}
+
+std::string LsmTree::FilePath(uint64_t number, const char *extension) const {
+  char name[32];
+  std::snprintf(name, sizeof(name), "/%06llu%s",
+                static_cast<unsigned long long>(number), extension);
+  return this->directory + name;
+}
+
+uint64_t LsmTree::MaxBytesForLevel(size_t level) const {
+  uint64_t bytes = this->config.levelBaseBytes;
+  for (size_t l = 1; l < level; ++l) {
+    bytes *= this->config.levelMultiplier;
+  }
+  return bytes;
+}
+
+uint64_t LsmTree::LevelBytes(const std::vector<TablePtr> &tables) {
+  uint64_t bytes = 0;
+  for (const TablePtr &file : tables) {
+    bytes += file->bytes;
+  }
+  return bytes;
+}
+
+void LsmTree::CheckKey(std::string_view key) {
+  if (key.size() > MAX_KEY_SIZE) {
+    throw LsmTreeException("Key exceeds " + std::to_string(MAX_KEY_SIZE) +
+                           " bytes: " + std::to_string(key.size()));
+  }
+}
@@ -0,0 +1,178 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../KVEngine/KVEngine.hpp"
+#include "../LogManager/LogManager.hpp"
+#include "./Memtable.hpp"
+#include "./SSTable.hpp"
+
+class LsmTreeException : public std::runtime_error {
+public:
+  explicit LsmTreeException(const std::string &message)
+      : std::runtime_error(message) {}
+};
+
+struct LsmTreeConfig {
+  // The memtable is frozen and written out as a level-0 table once it holds
+  // this many bytes.
+  size_t memtableBytes = size_t{4} << 20;
+  // Compaction splits its output into tables of about this size.
+  uint64_t targetFileBytes = uint64_t{2} << 20;
+  // Level-0 tables overlap, so every lookup checks each of them. They are
+  // compacted into level 1 once there are l0CompactionTrigger of them, and
+  // writes wait for that at l0StopTrigger.
+  size_t l0CompactionTrigger = 4;
+  size_t l0StopTrigger = 12;
+  // Level 1 holds up to levelBaseBytes, and each deeper level
+  // levelMultiplier times the one above it.
+  uint64_t levelBaseBytes = uint64_t{10} << 20;
+  unsigned levelMultiplier = 10;
+  // Bloom filter size in every table; 0 leaves tables without one.
+  size_t bloomBitsPerKey = 10;
+  // Put and Delete return once their log record is durable, with group
+  // commit across concurrent writers. Otherwise records reach the log when
+  // another write syncs, when the memtable is frozen, or on close.
+  bool syncWrites = false;
+};
+
+struct LsmTreeStats {
+  uint64_t bytesIngested;
+  uint64_t flushes;
+  uint64_t bytesFlushed;
+  uint64_t compactions;
+  uint64_t trivialMoves;
+  uint64_t bytesCompacted;
+  std::vector<size_t> filesPerLevel;
+  std::vector<uint64_t> bytesPerLevel;
+};
+
+// Log-structured merge tree in a directory of its own. Writes go to a
+// write-ahead log (a LogManager per memtable) and a lock-free Memtable;
+// full memtables are written out sequentially as level-0 SSTables, and a
+// background thread merges tables down through levels of growing size
+// (leveled compaction: below level 0 the tables of a level never overlap).
+// A MANIFEST file lists the live tables and is replaced atomically after
+// every flush and compaction.
+//
+// Lookups check the memtables, then level 0 newest first, then one table
+// per deeper level. Delete reads before it writes its tombstone, so two
+// concurrent Deletes of a key may both report it present.
+class LsmTree : public KVEngine {
+public:
+  static constexpr size_t LEVELS = 7;
+
+  explicit LsmTree(const std::string &directory,
+                   const LsmTreeConfig &config = LsmTreeConfig());
+  // Writes the memtable out and stops the compaction thread.
+  ~LsmTree() override;
+
+  LsmTree(const LsmTree &) = delete;
+  LsmTree &operator=(const LsmTree &) = delete;
+  LsmTree(LsmTree &&) = delete;
+  LsmTree &operator=(LsmTree &&) = delete;
+
+  std::optional<uint64_t> Get(std::string_view key) override;
+  void Put(std::string_view key, uint64_t value) override;
+  bool Delete(std::string_view key) override;
+  void Scan(std::string_view startKey,
+            const std::function<bool(std::string_view, uint64_t)> &visit)
+      override;
+
+  // Freezes the memtable and returns once it is in a level-0 table.
+  void Flush();
+  // Returns once no flush or compaction is left to do.
+  void WaitForCompactions();
+  LsmTreeStats GetStats();
+
+private:
+  struct TableFile {
+    uint64_t number;
+    uint64_t bytes;
+    std::string smallest;
+    std::string largest;
+    std::shared_ptr<SSTable> table;
+  };
+  using TablePtr = std::shared_ptr<const TableFile>;
+
+  // The live tables at one moment. Installed whole by flushes and
+  // compactions, so readers holding one keep its files open while they
+  // use them. Level 0 is newest first; deeper levels are sorted by key.
+  struct Version {
+    std::array<std::vector<TablePtr>, LEVELS> levels;
+  };
+
+  struct Compaction {
+    size_t level;
+    std::vector<TablePtr> inputs;
+    std::vector<TablePtr> outputLevelInputs;
+  };
+
+  std::string directory;
+  LsmTreeConfig config;
+
+  // Guards the pointers below, which every read and write copies; the
+  // memtable itself needs no lock.
+  std::shared_mutex stateMutex;
+  std::shared_ptr<Memtable> memtable;
+  std::unique_ptr<LogManager> log;
+  std::shared_ptr<Memtable> immutable;
+  std::unique_ptr<LogManager> immutableLog;
+  std::shared_ptr<const Version> current;
+
+  // Serializes freezing, installing versions and the background thread's
+  // bookkeeping. Lock order: mutex, then stateMutex.
+  std::mutex mutex;
+  std::condition_variable backgroundWork;
+  std::condition_variable backgroundDone;
+  std::thread background;
+  bool stopping;
+  bool backgroundBusy;
+  std::string backgroundError;
+  uint64_t nextFileNumber;
+  uint64_t logNumber;
+  uint64_t immutableLogNumber;
+  std::array<std::string, LEVELS> compactPointers;
+  std::atomic<bool> writesStalled;
+  std::atomic<uint64_t> bytesIngested;
+  LsmTreeStats stats;
+
+  void Write(std::string_view key, uint64_t value, bool tombstone);
+  // Freezes a full memtable, or waits while the previous one or level 0
+  // is still being written out.
+  void MakeRoomForWrite();
+  // Swaps in an empty memtable and log. Callers hold `mutex`.
+  void FreezeMemtable();
+  void CheckBackgroundError() const;
+  void BackgroundLoop();
+  void FlushImmutable();
+  bool PickCompaction(Compaction &compaction) const;
+  void RunCompaction(const Compaction &compaction);
+  // Records `version` in the MANIFEST and makes it current. Callers hold
+  // `mutex`.
+  void InstallVersion(std::shared_ptr<const Version> version);
+  void UpdateStall();
+
+  void Recover();
+  // Fills `version` from the MANIFEST; false if there is none yet.
+  bool ReadManifest(Version &version);
+  // `oldestLog` is the first log whose records are not all in tables.
+  void WriteManifest(const Version &version, uint64_t oldestLog);
+  std::shared_ptr<TableFile> WriteTable(const Memtable &table,
+                                        uint64_t number);
+  std::string FilePath(uint64_t number, const char *extension) const;
+  uint64_t MaxBytesForLevel(size_t level) const;
+  static uint64_t LevelBytes(const std::vector<TablePtr> &tables);
+  static void CheckKey(std::string_view key);
+};
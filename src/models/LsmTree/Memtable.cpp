@@ -0,0 +1,186 @@
+#include "./Memtable.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <new>
+#include <random>
+
+// A node is one allocation: this header, `height` next pointers, then the
+// key bytes.
+struct Memtable::Node {
+  uint64_t sequence;
+  uint64_t value;
+  uint32_t keySize;
+  bool tombstone;
+  int height;
+
+  std::atomic<Node *> *Next() {
+    return reinterpret_cast<std::atomic<Node *> *>(this + 1);
+  }
+  const std::atomic<Node *> *Next() const {
+    return reinterpret_cast<const std::atomic<Node *> *>(this + 1);
+  }
+  std::string_view Key() const {
+    return {reinterpret_cast<const char *>(this->Next() + this->height),
+            this->keySize};
+  }
+
+  static size_t SizeFor(int height, size_t keySize) {
+    return sizeof(Node) + height * sizeof(std::atomic<Node *>) + keySize;
+  }
+};
+
+Memtable::Memtable()
+    : head(NewNode(0, {}, 0, false, MAX_HEIGHT)), maxHeight(1), bytes(0) {}
+
+Memtable::~Memtable() {
+  Node *node = this->head;
+  while (node != nullptr) {
+    Node *next = node->Next()[0].load(std::memory_order_relaxed);
+    ::operator delete(node);
+    node = next;
+  }
+}
+
+Memtable::Node *Memtable::NewNode(uint64_t sequence, std::string_view key,
+                                  uint64_t value, bool tombstone,
+                                  int height) {
+  void *memory = ::operator new(Node::SizeFor(height, key.size()));
+  Node *node = new (memory) Node{sequence, value,
+                                 static_cast<uint32_t>(key.size()),
+                                 tombstone, height};
+  for (int level = 0; level < height; ++level) {
+    new (&node->Next()[level]) std::atomic<Node *>(nullptr);
+  }
+  if (!key.empty()) {
+    std::memcpy(reinterpret_cast<char *>(node->Next() + height), key.data(),
+                key.size());
+  }
+  return node;
+}
+
+bool Memtable::IsBefore(const Node *node, std::string_view key,
+                        uint64_t sequence) {
+  int order = node->Key().compare(key);
+  return order < 0 || (order == 0 && node->sequence > sequence);
+}
+
+int Memtable::RandomHeight() {
+  // Each level holds a quarter of the one below.
+  thread_local std::minstd_rand eng(std::random_device{}());
+  int height = 1;
+  while (height < MAX_HEIGHT && eng() % 4 == 0) {
+    height++;
+  }
+  return height;
+}
+
+void Memtable::Add(uint64_t sequence, std::string_view key, uint64_t value,
+                   bool tombstone) {
+  int height = RandomHeight();
+  Node *node = NewNode(sequence, key, value, tombstone, height);
+  int top = this->maxHeight.load(std::memory_order_relaxed);
+  while (height > top && !this->maxHeight.compare_exchange_weak(
+                             top, height, std::memory_order_relaxed)) {
+  }
+
+  // Where the node goes on each of its levels, found top down.
+  Node *prev[MAX_HEIGHT];
+  Node *next[MAX_HEIGHT];
+  Node *at = this->head;
+  for (int level = std::max(top, height) - 1; level >= 0; --level) {
+    Node *after = at->Next()[level].load(std::memory_order_acquire);
+    while (after != nullptr && IsBefore(after, key, sequence)) {
+      at = after;
+      after = at->Next()[level].load(std::memory_order_acquire);
+    }
+    if (level < height) {
+      prev[level] = at;
+      next[level] = after;
+    }
+  }
+
+  for (int level = 0; level < height; ++level) {
+    while (true) {
+      node->Next()[level].store(next[level], std::memory_order_relaxed);
+      if (prev[level]->Next()[level].compare_exchange_strong(
+              next[level], node, std::memory_order_release,
+              std::memory_order_acquire)) {
+        break;
+      }
+      // Another node was linked in between; walk on from `prev`, which
+      // still precedes this one since nodes never leave the list.
+      Node *after = next[level];
+      while (after != nullptr && IsBefore(after, key, sequence)) {
+        prev[level] = after;
+        after = after->Next()[level].load(std::memory_order_acquire);
+      }
+      next[level] = after;
+    }
+  }
+  this->bytes.fetch_add(Node::SizeFor(height, key.size()),
+                        std::memory_order_relaxed);
+}
+
+const Memtable::Node *
+Memtable::FindGreaterOrEqual(std::string_view key, uint64_t sequence) const {
+  const Node *at = this->head;
+  for (int level = this->maxHeight.load(std::memory_order_relaxed) - 1;
+       level >= 0; --level) {
+    const Node *after = at->Next()[level].load(std::memory_order_acquire);
+    while (after != nullptr && IsBefore(after, key, sequence)) {
+      at = after;
+      after = at->Next()[level].load(std::memory_order_acquire);
+    }
+    if (level == 0) {
+      return after;
+    }
+  }
+  return nullptr;
+}
+
+bool Memtable::Get(std::string_view key, uint64_t &value,
+                   bool &tombstone) const {
+  const Node *node = this->FindGreaterOrEqual(key, UINT64_MAX);
+  if (node == nullptr || node->Key() != key) {
+    return false;
+  }
+  value = node->value;
+  tombstone = node->tombstone;
+  return true;
+}
+
+size_t Memtable::ApproximateBytes() const {
+  return this->bytes.load(std::memory_order_relaxed);
+}
+
+bool Memtable::IsEmpty() const {
+  return this->head->Next()[0].load(std::memory_order_acquire) == nullptr;
+}
+
+Memtable::Iterator::Iterator(const Memtable &memtable)
+    : memtable(memtable), node(nullptr) {}
+
+bool Memtable::Iterator::Valid() const { return this->node != nullptr; }
+
+void Memtable::Iterator::SeekToFirst() {
+  this->node = this->memtable.head->Next()[0].load(std::memory_order_acquire);
+}
+
+void Memtable::Iterator::Seek(std::string_view key) {
+  this->node = this->memtable.FindGreaterOrEqual(key, UINT64_MAX);
+}
+
+void Memtable::Iterator::Next() {
+  // Older versions of the key follow it directly.
+  std::string_view key = this->node->Key();
+  do {
+    this->node = this->node->Next()[0].load(std::memory_order_acquire);
+  } while (this->node != nullptr && this->node->Key() == key);
+}
+
+std::string_view Memtable::Iterator::Key() const { return this->node->Key(); }
+
+uint64_t Memtable::Iterator::Value() const { return this->node->value; }
+
+bool Memtable::Iterator::IsTombstone() const { return this->node->tombstone; }
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+// The LSM tree's in-memory write buffer: an insert-only, lock-free skiplist
+// ordered by key, then newest version first. Put and Delete both insert a
+// new version; a node is linked in with compare-and-swap one level at a
+// time, bottom first, so it is in the list as soon as level 0 points at it
+// and is fully built before anyone can reach it. Nothing is unlinked until
+// the memtable is destroyed, so readers and iterators never block and never
+// see a node disappear.
+class Memtable {
+  struct Node;
+
+public:
+  Memtable();
+  ~Memtable();
+
+  Memtable(const Memtable &) = delete;
+  Memtable &operator=(const Memtable &) = delete;
+  Memtable(Memtable &&) = delete;
+  Memtable &operator=(Memtable &&) = delete;
+
+  // `sequence` orders versions of the same key, the highest winning;
+  // callers never reuse one.
+  void Add(uint64_t sequence, std::string_view key, uint64_t value,
+           bool tombstone);
+  // Finds the newest version of `key`. Returns false when the memtable has
+  // none; otherwise `tombstone` tells whether it is a deletion.
+  bool Get(std::string_view key, uint64_t &value, bool &tombstone) const;
+
+  // Bytes of nodes allocated so far.
+  size_t ApproximateBytes() const;
+  bool IsEmpty() const;
+
+  // Walks the newest version of each key in order. Entries added while it
+  // runs may or may not be seen.
+  class Iterator {
+  public:
+    explicit Iterator(const Memtable &memtable);
+
+    bool Valid() const;
+    void SeekToFirst();
+    void Seek(std::string_view key);
+    void Next();
+
+    std::string_view Key() const;
+    uint64_t Value() const;
+    bool IsTombstone() const;
+
+  private:
+    const Memtable &memtable;
+    const Node *node;
+  };
+
+private:
+  static constexpr int MAX_HEIGHT = 12;
+
+  Node *head;
+  std::atomic<int> maxHeight;
+  std::atomic<size_t> bytes;
+
+  static Node *NewNode(uint64_t sequence, std::string_view key,
+                       uint64_t value, bool tombstone, int height);
+  static int RandomHeight();
+  // Whether `node` comes before (key, sequence): keys ascending, and the
+  // newest version of a key first.
+  static bool IsBefore(const Node *node, std::string_view key,
+                       uint64_t sequence);
+  // The first node at or after (key, sequence) in list order.
+  const Node *FindGreaterOrEqual(std::string_view key,
+                                 uint64_t sequence) const;
+};
@@ -0,0 +1,438 @@
+#include "./SSTable.hpp"
+#include "../../types/Constants.hpp"
+#include "../../types/HashKey.hpp"
+#include "../Crc32c/Crc32c.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+constexpr uint64_t TABLE_MAGIC = 0x4c4241545353564bull; // "KVSSTABL"
+constexpr uint32_t TABLE_VERSION = 1;
+// Pending bytes are written once this many have built up.
+constexpr size_t WRITE_CHUNK = size_t{1} << 20;
+
+struct Footer {
+  uint64_t indexOffset;
+  uint64_t indexSize;
+  uint64_t filterOffset;
+  uint64_t filterSize;
+  uint64_t entryCount;
+  uint32_t indexChecksum;
+  uint32_t filterChecksum;
+  uint32_t version;
+  uint32_t reserved;
+  uint64_t magic;
+};
+
+[[noreturn]] void ThrowIOError(const std::string &message,
+                               const std::string &path, int err) {
+  throw SSTableException(message + " (errno: " + std::to_string(err) +
+                         " - " + std::strerror(err) + ")\n in File: " + path);
+}
+
+template <typename T> void AppendPod(std::vector<char> &out, T value) {
+  const char *bytes = reinterpret_cast<const char *>(&value);
+  out.insert(out.end(), bytes, bytes + sizeof(T));
+}
+
+void AppendKey(std::vector<char> &out, std::string_view key) {
+  out.push_back(static_cast<char>(key.size()));
+  out.insert(out.end(), key.begin(), key.end());
+}
+
+// Decodes the entry at `position` and moves past it; false when it runs
+// past `size`.
+bool DecodeEntry(const char *data, size_t size, size_t &position,
+                 std::string_view &key, uint64_t &value, bool &tombstone) {
+  if (position >= size) {
+    return false;
+  }
+  size_t keySize = static_cast<uint8_t>(data[position]);
+  if (size - position < 1 + keySize + 1 + sizeof(uint64_t)) {
+    return false;
+  }
+  key = std::string_view(data + position + 1, keySize);
+  tombstone = data[position + 1 + keySize] != 0;
+  std::memcpy(&value, data + position + 2 + keySize, sizeof(value));
+  position += 2 + keySize + sizeof(value);
+  return true;
+}
+
+// The Bloom filter's probes: double hashing, the second hash being the
+// first rotated, as in LevelDB.
+unsigned ProbesFor(size_t bitsPerKey) {
+  // ln 2 bits per key per probe minimizes false positives.
+  return std::clamp<unsigned>(static_cast<unsigned>(bitsPerKey * 69 / 100),
+                              1, 30);
+}
+
+template <typename Visit>
+void ForEachProbe(uint64_t hash, size_t bits, unsigned probes, Visit visit) {
+  uint64_t delta = hash >> 33 | hash << 31;
+  for (unsigned i = 0; i < probes; ++i) {
+    visit(static_cast<size_t>(hash % bits));
+    hash += delta;
+  }
+}
+
+} // namespace
+
+SSTableWriter::SSTableWriter(const std::string &path, size_t bloomBitsPerKey)
+    : path(path), fd(-1), bloomBitsPerKey(bloomBitsPerKey), finished(false),
+      offset(0), entryCount(0) {
+  this->fd = ::open(this->path.c_str(),
+                    O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  if (this->fd < 0) {
+    ThrowIOError("Failed to create table", this->path, errno);
+  }
+  this->pending.reserve(WRITE_CHUNK);
+  this->block.reserve(2 * BLOCK_SIZE);
+}
+
+SSTableWriter::~SSTableWriter() {
+  if (this->fd >= 0) {
+    ::close(this->fd);
+  }
+  if (!this->finished) {
+    ::unlink(this->path.c_str());
+  }
+}
+
+void SSTableWriter::Add(std::string_view key, uint64_t value,
+                        bool tombstone) {
+  if (key.size() > UINT8_MAX) {
+    throw SSTableException("Key too long for a table: " +
+                           std::to_string(key.size()) + " bytes");
+  }
+  if (this->entryCount > 0 && key <= std::string_view(this->largestKey)) {
+    throw SSTableException("Table keys must be added in increasing order");
+  }
+  if (this->entryCount == 0) {
+    this->smallestKey = key;
+  }
+  this->largestKey = key;
+  this->entryCount++;
+  if (this->bloomBitsPerKey > 0) {
+    this->keyHashes.push_back(HashKey(key));
+  }
+
+  AppendKey(this->block, key);
+  this->block.push_back(static_cast<char>(tombstone ? 1 : 0));
+  AppendPod(this->block, value);
+  if (this->block.size() >= BLOCK_SIZE) {
+    this->FinishBlock();
+  }
+}
+
+void SSTableWriter::FinishBlock() {
+  if (this->block.empty()) {
+    return;
+  }
+  AppendKey(this->index, this->largestKey);
+  AppendPod(this->index, this->offset);
+  AppendPod(this->index, static_cast<uint32_t>(this->block.size()));
+  uint32_t crc = Crc32c::Compute(this->block.data(), this->block.size());
+  this->Append(this->block.data(), this->block.size());
+  this->Append(reinterpret_cast<const char *>(&crc), sizeof(crc));
+  this->block.clear();
+}
+
+void SSTableWriter::Append(const char *data, size_t length) {
+  this->pending.insert(this->pending.end(), data, data + length);
+  this->offset += length;
+  if (this->pending.size() >= WRITE_CHUNK) {
+    this->WritePending();
+  }
+}
+
+void SSTableWriter::WritePending() {
+  size_t done = 0;
+  while (done < this->pending.size()) {
+    ssize_t n = ::write(this->fd, this->pending.data() + done,
+                        this->pending.size() - done);
+    if (n < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      ThrowIOError("Failed to write table", this->path, errno);
+    }
+    done += static_cast<size_t>(n);
+  }
+  this->pending.clear();
+}
+
+uint64_t SSTableWriter::Finish() {
+  this->FinishBlock();
+
+  std::vector<char> filter;
+  if (this->bloomBitsPerKey > 0 && !this->keyHashes.empty()) {
+    size_t bits = std::max<size_t>(
+        64, this->keyHashes.size() * this->bloomBitsPerKey);
+    bits = (bits + 7) / 8 * 8;
+    filter.assign(bits / 8, 0);
+    unsigned probes = ProbesFor(this->bloomBitsPerKey);
+    for (uint64_t hash : this->keyHashes) {
+      ForEachProbe(hash, bits, probes, [&](size_t bit) {
+        filter[bit / 8] = static_cast<char>(filter[bit / 8] | 1 << bit % 8);
+      });
+    }
+    filter.push_back(static_cast<char>(probes));
+  }
+
+  Footer footer{};
+  footer.indexOffset = this->offset;
+  footer.indexSize = this->index.size();
+  footer.filterOffset = this->offset + this->index.size();
+  footer.filterSize = filter.size();
+  footer.entryCount = this->entryCount;
+  footer.indexChecksum =
+      Crc32c::Compute(this->index.data(), this->index.size());
+  footer.filterChecksum = Crc32c::Compute(filter.data(), filter.size());
+  footer.version = TABLE_VERSION;
+  footer.magic = TABLE_MAGIC;
+  this->Append(this->index.data(), this->index.size());
+  this->Append(filter.data(), filter.size());
+  this->Append(reinterpret_cast<const char *>(&footer), sizeof(footer));
+  this->WritePending();
+
+  if (::fdatasync(this->fd) != 0) {
+    ThrowIOError("Failed to sync table", this->path, errno);
+  }
+  ::close(this->fd);
+  this->fd = -1;
+  this->finished = true;
+  return this->offset;
+}
+
+uint64_t SSTableWriter::GetFileBytes() const {
+  return this->offset + this->block.size();
+}
+
+size_t SSTableWriter::GetEntryCount() const { return this->entryCount; }
+
+const std::string &SSTableWriter::GetSmallestKey() const {
+  return this->smallestKey;
+}
+
+const std::string &SSTableWriter::GetLargestKey() const {
+  return this->largestKey;
+}
+
+SSTable::SSTable(const std::string &path)
+    : path(path), fd(-1), fileBytes(0), entryCount(0), filterProbes(0),
+      obsolete(false) {
+  this->fd = ::open(this->path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (this->fd < 0) {
+    ThrowIOError("Failed to open table", this->path, errno);
+  }
+  try {
+    struct stat st {};
+    if (::fstat(this->fd, &st) != 0) {
+      ThrowIOError("Failed to determine table size", this->path, errno);
+    }
+    this->fileBytes = static_cast<uint64_t>(st.st_size);
+    Footer footer;
+    if (this->fileBytes < sizeof(footer)) {
+      this->ThrowCorrupt("no footer");
+    }
+    uint64_t metaEnd = this->fileBytes - sizeof(footer);
+    this->PreadFully(reinterpret_cast<char *>(&footer), sizeof(footer),
+                     metaEnd);
+    if (footer.magic != TABLE_MAGIC || footer.version != TABLE_VERSION ||
+        footer.indexOffset > metaEnd ||
+        footer.indexSize > metaEnd - footer.indexOffset ||
+        footer.filterOffset != footer.indexOffset + footer.indexSize ||
+        footer.filterSize != metaEnd - footer.filterOffset) {
+      this->ThrowCorrupt("bad footer");
+    }
+    this->entryCount = static_cast<size_t>(footer.entryCount);
+
+    std::vector<char> index(footer.indexSize);
+    this->PreadFully(index.data(), index.size(), footer.indexOffset);
+    if (Crc32c::Compute(index.data(), index.size()) != footer.indexChecksum) {
+      this->ThrowCorrupt("index checksum");
+    }
+    for (size_t position = 0; position < index.size();) {
+      size_t keySize = static_cast<uint8_t>(index[position]);
+      size_t entrySize = 1 + keySize + sizeof(uint64_t) + sizeof(uint32_t);
+      if (index.size() - position < entrySize) {
+        this->ThrowCorrupt("truncated index");
+      }
+      IndexEntry entry;
+      entry.lastKey.assign(index.data() + position + 1, keySize);
+      std::memcpy(&entry.offset, index.data() + position + 1 + keySize,
+                  sizeof(entry.offset));
+      std::memcpy(&entry.size,
+                  index.data() + position + 1 + keySize + sizeof(uint64_t),
+                  sizeof(entry.size));
+      if (entry.offset > footer.indexOffset ||
+          entry.size + sizeof(uint32_t) > footer.indexOffset - entry.offset) {
+        this->ThrowCorrupt("index entry out of range");
+      }
+      this->index.push_back(std::move(entry));
+      position += entrySize;
+    }
+
+    this->filter.resize(footer.filterSize);
+    this->PreadFully(reinterpret_cast<char *>(this->filter.data()),
+                     this->filter.size(), footer.filterOffset);
+    if (Crc32c::Compute(reinterpret_cast<const char *>(this->filter.data()),
+                        this->filter.size()) != footer.filterChecksum) {
+      this->ThrowCorrupt("filter checksum");
+    }
+    if (!this->filter.empty()) {
+      this->filterProbes = this->filter.back();
+      this->filter.pop_back();
+    }
+  } catch (...) {
+    ::close(this->fd);
+    throw;
+  }
+}
+
+SSTable::~SSTable() {
+  ::close(this->fd);
+  if (this->obsolete) {
+    ::unlink(this->path.c_str());
+  }
+}
+
+bool SSTable::MayContain(std::string_view key) const {
+  if (this->filter.empty()) {
+    return true;
+  }
+  size_t bits = this->filter.size() * 8;
+  bool present = true;
+  ForEachProbe(HashKey(key), bits, this->filterProbes, [&](size_t bit) {
+    present = present && (this->filter[bit / 8] >> bit % 8 & 1) != 0;
+  });
+  return present;
+}
+
+bool SSTable::Get(std::string_view key, uint64_t &value,
+                  bool &tombstone) const {
+  if (!this->MayContain(key)) {
+    return false;
+  }
+  size_t block = this->FindBlock(key);
+  if (block == this->index.size()) {
+    return false;
+  }
+  thread_local std::vector<char> data;
+  this->ReadBlock(block, data);
+  std::string_view entryKey;
+  for (size_t position = 0; position < data.size();) {
+    if (!DecodeEntry(data.data(), data.size(), position, entryKey, value,
+                     tombstone)) {
+      this->ThrowCorrupt("truncated entry");
+    }
+    if (entryKey >= key) {
+      return entryKey == key;
+    }
+  }
+  return false;
+}
+
+uint64_t SSTable::GetFileBytes() const { return this->fileBytes; }
+
+size_t SSTable::GetEntryCount() const { return this->entryCount; }
+
+const std::string &SSTable::GetPath() const { return this->path; }
+
+void SSTable::MarkObsolete() { this->obsolete = true; }
+
+size_t SSTable::FindBlock(std::string_view key) const {
+  auto it = std::lower_bound(
+      this->index.begin(), this->index.end(), key,
+      [](const IndexEntry &entry, std::string_view target) {
+        return std::string_view(entry.lastKey) < target;
+      });
+  return static_cast<size_t>(it - this->index.begin());
+}
+
+void SSTable::ReadBlock(size_t block, std::vector<char> &data) const {
+  const IndexEntry &entry = this->index[block];
+  data.resize(entry.size + sizeof(uint32_t));
+  this->PreadFully(data.data(), data.size(), entry.offset);
+  uint32_t crc;
+  std::memcpy(&crc, data.data() + entry.size, sizeof(crc));
+  data.resize(entry.size);
+  if (Crc32c::Compute(data.data(), data.size()) != crc) {
+    this->ThrowCorrupt("block " + std::to_string(block) + " checksum");
+  }
+}
+
+void SSTable::PreadFully(char *buff, size_t length, uint64_t offset) const {
+  size_t done = 0;
+  while (done < length) {
+    ssize_t n = ::pread(this->fd, buff + done, length - done,
+                        static_cast<off_t>(offset + done));
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n < 0) {
+      ThrowIOError("Failed to read table", this->path, errno);
+    }
+    if (n == 0) {
+      this->ThrowCorrupt("truncated file");
+    }
+    done += static_cast<size_t>(n);
+  }
+}
+
+SSTable::Iterator::Iterator(const SSTable &table)
+    : table(table), blockIndex(table.index.size()), position(0), value(0),
+      tombstone(false) {}
+
+bool SSTable::Iterator::Valid() const {
+  return this->blockIndex < this->table.index.size();
+}
+
+void SSTable::Iterator::SeekToFirst() {
+  this->LoadBlock(0);
+  this->Decode();
+}
+
+void SSTable::Iterator::Seek(std::string_view key) {
+  this->LoadBlock(this->table.FindBlock(key));
+  this->Decode();
+  while (this->Valid() && this->key < key) {
+    this->Decode();
+  }
+}
+
+void SSTable::Iterator::Next() { this->Decode(); }
+
+std::string_view SSTable::Iterator::Key() const { return this->key; }
+
+uint64_t SSTable::Iterator::Value() const { return this->value; }
+
+bool SSTable::Iterator::IsTombstone() const { return this->tombstone; }
+
+void SSTable::Iterator::LoadBlock(size_t block) {
+  this->blockIndex = block;
+  this->position = 0;
+  this->data.clear();
+  if (block < this->table.index.size()) {
+    this->table.ReadBlock(block, this->data);
+  }
+}
+
+void SSTable::Iterator::Decode() {
+  while (this->Valid()) {
+    if (this->position < this->data.size()) {
+      if (!DecodeEntry(this->data.data(), this->data.size(), this->position,
+                       this->key, this->value, this->tombstone)) {
+        this->table.ThrowCorrupt("truncated entry");
+      }
+      return;
+    }
+    this->LoadBlock(this->blockIndex + 1);
+  }
+}
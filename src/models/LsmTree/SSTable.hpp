@@ -0,0 +1,150 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+class SSTableException : public std::runtime_error {
+public:
+  explicit SSTableException(const std::string &message)
+      : std::runtime_error(message) {}
+};
+
+// An immutable sorted table file, written front to back in one pass:
+//
+//   [data block]... [block index] [Bloom filter] [footer]
+//
+// Data blocks hold about BLOCK_SIZE bytes of entries ([uint8 key size][key]
+// [uint8 tombstone][uint64 value]) followed by their CRC32C. The index
+// holds each block's last key, offset and size, so a lookup reads at most
+// one block, and the filter lets it skip tables that do not hold the key.
+class SSTableWriter {
+public:
+  // Creates the file at `path`. `bloomBitsPerKey` sizes the filter; 0
+  // writes none.
+  SSTableWriter(const std::string &path, size_t bloomBitsPerKey);
+  // Removes the file if Finish was not reached.
+  ~SSTableWriter();
+
+  SSTableWriter(const SSTableWriter &) = delete;
+  SSTableWriter &operator=(const SSTableWriter &) = delete;
+  SSTableWriter(SSTableWriter &&) = delete;
+  SSTableWriter &operator=(SSTableWriter &&) = delete;
+
+  // Keys must be added in strictly increasing order.
+  void Add(std::string_view key, uint64_t value, bool tombstone);
+  // Writes the index, filter and footer and syncs the file. Returns its
+  // size.
+  uint64_t Finish();
+
+  // Bytes written so far, counting the unfinished block.
+  uint64_t GetFileBytes() const;
+  size_t GetEntryCount() const;
+  const std::string &GetSmallestKey() const;
+  const std::string &GetLargestKey() const;
+
+private:
+  std::string path;
+  int fd;
+  size_t bloomBitsPerKey;
+  bool finished;
+
+  // Bytes not yet handed to write(), sent in large sequential chunks.
+  std::vector<char> pending;
+  uint64_t offset;
+  std::vector<char> block;
+  std::vector<char> index;
+  std::vector<uint64_t> keyHashes;
+  std::string smallestKey;
+  std::string largestKey;
+  size_t entryCount;
+
+  void FinishBlock();
+  void Append(const char *data, size_t length);
+  void WritePending();
+};
+
+class SSTable {
+public:
+  // Opens a finished table, reading its index and filter into memory.
+  explicit SSTable(const std::string &path);
+  // Deletes the file if MarkObsolete was called.
+  ~SSTable();
+
+  SSTable(const SSTable &) = delete;
+  SSTable &operator=(const SSTable &) = delete;
+  SSTable(SSTable &&) = delete;
+  SSTable &operator=(SSTable &&) = delete;
+
+  // Looks `key` up. Returns false when the table does not hold it;
+  // otherwise `tombstone` tells whether it is a deletion.
+  bool Get(std::string_view key, uint64_t &value, bool &tombstone) const;
+  // False only when the table certainly does not hold `key`.
+  bool MayContain(std::string_view key) const;
+
+  uint64_t GetFileBytes() const;
+  size_t GetEntryCount() const;
+  const std::string &GetPath() const;
+  // Compaction has replaced the table: the file goes once the last reader
+  // drops it.
+  void MarkObsolete();
+
+  // Reads the table block by block, in key order.
+  class Iterator {
+  public:
+    explicit Iterator(const SSTable &table);
+
+    bool Valid() const;
+    void SeekToFirst();
+    void Seek(std::string_view key);
+    void Next();
+
+    std::string_view Key() const;
+    uint64_t Value() const;
+    bool IsTombstone() const;
+
+  private:
+    const SSTable &table;
+    size_t blockIndex;
+    std::vector<char> data;
+    size_t position;
+    std::string_view key;
+    uint64_t value;
+    bool tombstone;
+
+    void LoadBlock(size_t block);
+    // Decodes the entry at `position`, moving to later blocks as each ends.
+    void Decode();
+  };
+
+private:
+  struct IndexEntry {
+    std::string lastKey;
+    uint64_t offset;
+    uint32_t size;
+  };
+
+  std::string path;
+  int fd;
+  uint64_t fileBytes;
+  size_t entryCount;
+  std::vector<IndexEntry> index;
+  std::vector<uint8_t> filter;
+  unsigned filterProbes;
+  std::atomic<bool> obsolete;
+
+  // The first block whose last key is >= `key`; index.size() if none.
+  size_t FindBlock(std::string_view key) const;
+  // Reads a data block without its checksum, which it verifies.
+  void ReadBlock(size_t block, std::vector<char> &data) const;
+  void PreadFully(char *buff, size_t length, uint64_t offset) const;
+
+  [[noreturn]] void ThrowCorrupt(const std::string &what) const {
+    throw SSTableException("Corrupt table (" + what + ")\n in File: " +
+                           this->path);
+  }
+};
@@ -0,0 +1,247 @@
+#include "./Lz4.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <cstring>
+
+namespace {
+
+constexpr size_t MIN_MATCH = 4;
+// The format ends every block with at least LAST_LITERALS literals, and no
+// match may start within MATCH_FIND_LIMIT bytes of the end.
+constexpr size_t LAST_LITERALS = 5;
+constexpr size_t MATCH_FIND_LIMIT = 12;
+constexpr unsigned HASH_BITS = 12;
+
+uint32_t Read32(const unsigned char *bytes) {
+  uint32_t value;
+  std::memcpy(&value, bytes, sizeof(value));
+  return value;
+}
+
+uint64_t Read64(const unsigned char *bytes) {
+  uint64_t value;
+  std::memcpy(&value, bytes, sizeof(value));
+  return value;
+}
+
+uint32_t Hash(uint32_t sequence) {
+  return (sequence * 2654435761u) >> (32 - HASH_BITS);
+}
+
+// Copies 8 bytes at a time and may write up to 7 bytes past `length`, and
+// read as far past `source`: callers check there is room. Overlapping
+// copies work when `dest` is at least 8 bytes past `source`, since each
+// step then reads only bytes already written.
+void WildCopy(unsigned char *dest, const unsigned char *source,
+              size_t length) {
+  unsigned char *end = dest + length;
+  do {
+    std::memcpy(dest, source, 8);
+    dest += 8;
+    source += 8;
+  } while (dest < end);
+}
+
+// A length past a saturated 4-bit token field: 255s, then the remainder.
+void WriteLength(unsigned char *&out, size_t length) {
+  while (length >= 255) {
+    *out++ = 255;
+    length -= 255;
+  }
+  *out++ = static_cast<unsigned char>(length);
+}
+
+bool ReadLength(const unsigned char *&in, const unsigned char *end,
+                size_t &length) {
+  unsigned char byte;
+  do {
+    if (in == end) {
+      return false;
+    }
+    byte = *in++;
+    length += byte;
+  } while (byte == 255);
+  return true;
+}
+
+// Emits a token, its literals and, unless matchLength is 0 (the final
+// sequence), a back reference. Returns false when `out` would overflow.
+bool WriteSequence(unsigned char *&out, const unsigned char *outEnd,
+                   const unsigned char *literals, size_t literalLength,
+                   size_t offset, size_t matchLength) {
+  size_t needed = 1 + literalLength + literalLength / 255 + 1;
+  if (matchLength != 0) {
+    needed += 2 + matchLength / 255 + 1;
+  }
+  if (needed > static_cast<size_t>(outEnd - out)) {
+    return false;
+  }
+
+  unsigned char *token = out++;
+  *token = static_cast<unsigned char>(std::min<size_t>(literalLength, 15) << 4);
+  if (literalLength >= 15) {
+    WriteLength(out, literalLength - 15);
+  }
+  std::memcpy(out, literals, literalLength);
+  out += literalLength;
+  if (matchLength == 0) {
+    return true;
+  }
+
+  *out++ = static_cast<unsigned char>(offset & 0xff);
+  *out++ = static_cast<unsigned char>(offset >> 8);
+  size_t code = matchLength - MIN_MATCH;
+  *token |= static_cast<unsigned char>(std::min<size_t>(code, 15));
+  if (code >= 15) {
+    WriteLength(out, code - 15);
+  }
+  return true;
+}
+
+} // namespace
+
+size_t Lz4::Compress(const char *source, size_t length, char *dest,
+                     size_t capacity) {
+  if (length > MAX_INPUT_SIZE) {
+    return 0;
+  }
+  const auto *in = reinterpret_cast<const unsigned char *>(source);
+  auto *out = reinterpret_cast<unsigned char *>(dest);
+  const unsigned char *outEnd = out + capacity;
+  size_t anchor = 0;
+
+  if (length > MATCH_FIND_LIMIT) {
+    // Last position each 4-byte sequence was seen at; a stale or colliding
+    // slot is caught by comparing the bytes.
+    uint16_t table[size_t{1} << HASH_BITS] = {};
+    size_t matchStartLimit = length - MATCH_FIND_LIMIT;
+    size_t matchEndLimit = length - LAST_LITERALS;
+    size_t position = 1;
+    size_t misses = 0;
+
+    while (position < matchStartLimit) {
+      uint32_t sequence = Read32(in + position);
+      uint32_t slot = Hash(sequence);
+      size_t candidate = table[slot];
+      table[slot] = static_cast<uint16_t>(position);
+      if (Read32(in + candidate) != sequence) {
+        // Step faster through data that keeps missing, as LZ4 does.
+        position += 1 + (misses++ >> 6);
+        continue;
+      }
+      misses = 0;
+
+      size_t start = position;
+      while (start > anchor && candidate > 0 &&
+             in[start - 1] == in[candidate - 1]) {
+        start--;
+        candidate--;
+      }
+      // Extend a word at a time: the first differing byte is the lowest set
+      // byte of the XOR.
+      size_t end = position + MIN_MATCH;
+      size_t distance = start - candidate;
+      while (end + 8 <= matchEndLimit) {
+        uint64_t diff = Read64(in + end) ^ Read64(in + end - distance);
+        if (diff != 0) {
+          end += static_cast<size_t>(std::countr_zero(diff)) / 8;
+          break;
+        }
+        end += 8;
+      }
+      if (end + 8 > matchEndLimit) {
+        while (end < matchEndLimit && in[end] == in[end - distance]) {
+          end++;
+        }
+      }
+
+      if (!WriteSequence(out, outEnd, in + anchor, start - anchor,
+                         start - candidate, end - start)) {
+        return 0;
+      }
+      anchor = position = end;
+      if (position < matchStartLimit) {
+        table[Hash(Read32(in + position - 2))] =
+            static_cast<uint16_t>(position - 2);
+      }
+    }
+  }
+
+  if (!WriteSequence(out, outEnd, in + anchor, length - anchor, 0, 0)) {
+    return 0;
+  }
+  return static_cast<size_t>(out - reinterpret_cast<unsigned char *>(dest));
+}
+
+size_t Lz4::Decompress(const char *source, size_t length, char *dest,
+                       size_t capacity) {
+  const auto *in = reinterpret_cast<const unsigned char *>(source);
+  const unsigned char *inEnd = in + length;
+  auto *outStart = reinterpret_cast<unsigned char *>(dest);
+  unsigned char *out = outStart;
+  const unsigned char *outEnd = out + capacity;
+
+  while (true) {
+    if (in == inEnd) {
+      return 0;
+    }
+    unsigned token = *in++;
+
+    size_t literalLength = token >> 4;
+    if (literalLength == 15 && !ReadLength(in, inEnd, literalLength)) {
+      return 0;
+    }
+    if (literalLength > static_cast<size_t>(inEnd - in) ||
+        literalLength > static_cast<size_t>(outEnd - out)) {
+      return 0;
+    }
+    if (literalLength + 8 <= static_cast<size_t>(inEnd - in) &&
+        literalLength + 8 <= static_cast<size_t>(outEnd - out)) {
+      WildCopy(out, in, literalLength);
+    } else {
+      std::memcpy(out, in, literalLength);
+    }
+    in += literalLength;
+    out += literalLength;
+    if (in == inEnd) {
+      return static_cast<size_t>(out - outStart);
+    }
+
+    if (inEnd - in < 2) {
+      return 0;
+    }
+    size_t offset = in[0] | static_cast<size_t>(in[1]) << 8;
+    in += 2;
+    if (offset == 0 || offset > static_cast<size_t>(out - outStart)) {
+      return 0;
+    }
+    size_t matchLength = token & 15;
+    if (matchLength == 15 && !ReadLength(in, inEnd, matchLength)) {
+      return 0;
+    }
+    matchLength += MIN_MATCH;
+    if (matchLength > static_cast<size_t>(outEnd - out)) {
+      return 0;
+    }
+
+    if (offset >= 8 &&
+        matchLength + 8 <= static_cast<size_t>(outEnd - out)) {
+      WildCopy(out, out - offset, matchLength);
+      out += matchLength;
+      continue;
+    }
+    // An overlapping match repeats the last `offset` bytes. Copy one period,
+    // then keep doubling: every copy reads only bytes already written.
+    size_t done = std::min(matchLength, offset);
+    std::memcpy(out, out - offset, done);
+    while (done < matchLength) {
+      size_t period = done - done % offset;
+      size_t chunk = std::min(period, matchLength - done);
+      std::memcpy(out + done, out + done - period, chunk);
+      done += chunk;
+    }
+    out += matchLength;
+  }
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <cstddef>
+
+// A self-contained LZ4 block-format codec: byte-aligned literal runs and
+// back references found through a small hash table, so compression costs a
+// few cycles per byte and decompression is mostly memcpy. Output is
+// readable by any LZ4 block decoder. Inputs are limited to MAX_INPUT_SIZE
+// bytes, which keeps match positions in 16 bits; that covers the largest
+// block DiskManager supports.
+class Lz4 {
+public:
+  static constexpr size_t MAX_INPUT_SIZE = 65536;
+
+  // Compresses `length` bytes of `source` into `dest`. Returns the
+  // compressed size, or 0 when it would not fit in `capacity` bytes; the
+  // caller then stores the input as is.
+  static size_t Compress(const char *source, size_t length, char *dest,
+                         size_t capacity);
+  // Decompresses `length` bytes of `source` into `dest`. Returns the
+  // decompressed size, or 0 when the input is malformed or the output
+  // would not fit in `capacity` bytes. Never reads or writes out of bounds.
+  static size_t Decompress(const char *source, size_t length, char *dest,
+                           size_t capacity);
+};
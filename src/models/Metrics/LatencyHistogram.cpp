@@ -0,0 +1,129 @@
+#include "./LatencyHistogram.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstdio>
+
+namespace {
+
+constexpr uint64_t SUB_BUCKETS = uint64_t{1}
+                               << LatencyHistogram::SUB_BUCKET_BITS;
+
+} // namespace
+
+size_t LatencyHistogram::BucketFor(uint64_t value) {
+  if (value < SUB_BUCKETS) {
+    return static_cast<size_t>(value);
+  }
+  int exponent = std::bit_width(value) - 1;
+  if (exponent > MAX_EXPONENT) {
+    return BUCKETS - 1;
+  }
+  // The top SUB_BUCKET_BITS + 1 bits of the value: its leading 1 picks the
+  // power of two, the bits after it the sub-bucket.
+  int shift = exponent - SUB_BUCKET_BITS;
+  return static_cast<size_t>(shift + 1) * SUB_BUCKETS +
+         ((value >> shift) & (SUB_BUCKETS - 1));
+}
+
+uint64_t LatencyHistogram::BucketUpperBound(size_t bucket) {
+  if (bucket < SUB_BUCKETS) {
+    return bucket;
+  }
+  int shift = static_cast<int>(bucket / SUB_BUCKETS) - 1;
+  uint64_t lower = (SUB_BUCKETS + bucket % SUB_BUCKETS) << shift;
+  return lower + (uint64_t{1} << shift) - 1;
+}
+
+void LatencyHistogram::Record(uint64_t value, uint64_t count) {
+  this->buckets[BucketFor(value)] += count;
+  this->count += count;
+  this->sum += value * count;
+  this->max = std::max(this->max, value);
+}
+
+void LatencyHistogram::Merge(const LatencyHistogram &other) {
+  for (size_t i = 0; i < BUCKETS; ++i) {
+    this->buckets[i] += other.buckets[i];
+  }
+  this->count += other.count;
+  this->sum += other.sum;
+  this->max = std::max(this->max, other.max);
+}
+
+uint64_t LatencyHistogram::GetCount() const { return this->count; }
+
+double LatencyHistogram::GetMean() const {
+  return this->count == 0 ? 0.0
+                          : static_cast<double>(this->sum) /
+                                static_cast<double>(this->count);
+}
+
+uint64_t LatencyHistogram::GetMax() const { return this->max; }
+
+uint64_t LatencyHistogram::Percentile(double percentile) const {
+  if (this->count == 0) {
+    return 0;
+  }
+  double clamped = std::clamp(percentile, 0.0, 100.0);
+  auto rank = static_cast<uint64_t>(
+      std::ceil(clamped / 100.0 * static_cast<double>(this->count)));
+  rank = std::max<uint64_t>(rank, 1);
+  uint64_t seen = 0;
+  for (size_t i = 0; i < BUCKETS; ++i) {
+    seen += this->buckets[i];
+    if (seen >= rank) {
+      return std::min(BucketUpperBound(i), this->max);
+    }
+  }
+  return this->max;
+}
+
+uint64_t LatencyHistogram::GetBucketCount(size_t bucket) const {
+  return this->buckets[bucket];
+}
+
+std::string LatencyHistogram::ToText() const {
+  char text[192];
+  std::snprintf(text, sizeof(text),
+                "count=%llu mean=%.1f p50=%llu p99=%llu p999=%llu max=%llu",
+                static_cast<unsigned long long>(this->count), this->GetMean(),
+                static_cast<unsigned long long>(this->Percentile(50)),
+                static_cast<unsigned long long>(this->Percentile(99)),
+                static_cast<unsigned long long>(this->Percentile(99.9)),
+                static_cast<unsigned long long>(this->max));
+  return text;
+}
+
+std::string LatencyHistogram::ToJson() const {
+  char json[192];
+  std::snprintf(json, sizeof(json),
+                "{\"count\":%llu,\"mean\":%.1f,\"p50\":%llu,\"p99\":%llu,"
+                "\"p999\":%llu,\"max\":%llu}",
+                static_cast<unsigned long long>(this->count), this->GetMean(),
+                static_cast<unsigned long long>(this->Percentile(50)),
+                static_cast<unsigned long long>(this->Percentile(99)),
+                static_cast<unsigned long long>(this->Percentile(99.9)),
+                static_cast<unsigned long long>(this->max));
+  return json;
+}
+
+void LatencyRecorder::Record(uint64_t value, uint64_t count) {
+  BumpCounter(this->buckets[LatencyHistogram::BucketFor(value)], count);
+  BumpCounter(this->count, count);
+  BumpCounter(this->sum, value * count);
+  if (value > this->max.load(std::memory_order_relaxed)) {
+    this->max.store(value, std::memory_order_relaxed);
+  }
+}
+
+void LatencyRecorder::AddTo(LatencyHistogram &histogram) const {
+  for (size_t i = 0; i < LatencyHistogram::BUCKETS; ++i) {
+    histogram.buckets[i] += this->buckets[i].load(std::memory_order_relaxed);
+  }
+  histogram.count += this->count.load(std::memory_order_relaxed);
+  histogram.sum += this->sum.load(std::memory_order_relaxed);
+  histogram.max =
+      std::max(histogram.max, this->max.load(std::memory_order_relaxed));
+}
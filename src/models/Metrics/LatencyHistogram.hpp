@@ -0,0 +1,83 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// HDR-style latency histogram over nanoseconds: values below 16 have a
+// bucket each, and every power of two above that is split into 16 linear
+// sub-buckets, so a recorded value is reported within 1/16 of itself.
+// Values past 2^MAX_EXPONENT ns (about 69 s) land in the last bucket.
+//
+// A plain value: what GetStats hands out, built by merging the
+// LatencyRecorders of every thread.
+class LatencyHistogram {
+public:
+  static constexpr int SUB_BUCKET_BITS = 4;
+  static constexpr int MAX_EXPONENT = 36;
+  static constexpr size_t BUCKETS =
+      static_cast<size_t>(MAX_EXPONENT - SUB_BUCKET_BITS + 2)
+      << SUB_BUCKET_BITS;
+
+  static size_t BucketFor(uint64_t value);
+  // The largest value that falls in `bucket`.
+  static uint64_t BucketUpperBound(size_t bucket);
+
+  void Record(uint64_t value, uint64_t count = 1);
+  void Merge(const LatencyHistogram &other);
+
+  uint64_t GetCount() const;
+  double GetMean() const;
+  uint64_t GetMax() const;
+  // The smallest recorded value that `percentile` percent of the values
+  // are at or below, to the histogram's precision. 0 when empty.
+  uint64_t Percentile(double percentile) const;
+  uint64_t GetBucketCount(size_t bucket) const;
+
+  // "count=... mean=... p50=... p99=... p999=... max=..." and the same
+  // fields as a JSON object.
+  std::string ToText() const;
+  std::string ToJson() const;
+
+private:
+  std::array<uint64_t, BUCKETS> buckets{};
+  uint64_t count = 0;
+  uint64_t sum = 0;
+  uint64_t max = 0;
+
+  friend class LatencyRecorder;
+};
+
+// The recording side of a LatencyHistogram, for one writer thread at a
+// time (see PerThread): counters are bumped with a plain load and store,
+// and read while the writer runs without tearing.
+class LatencyRecorder {
+public:
+  // `count` records the value that many times: a sampled measurement can
+  // stand for the events that were not timed.
+  void Record(uint64_t value, uint64_t count = 1);
+  void AddTo(LatencyHistogram &histogram) const;
+
+private:
+  std::array<std::atomic<uint64_t>, LatencyHistogram::BUCKETS> buckets{};
+  std::atomic<uint64_t> count{0};
+  std::atomic<uint64_t> sum{0};
+  std::atomic<uint64_t> max{0};
+};
+
+// Adds to a counter only its owning thread writes, without a locked
+// instruction.
+inline void BumpCounter(std::atomic<uint64_t> &counter, uint64_t n = 1) {
+  counter.store(counter.load(std::memory_order_relaxed) + n,
+                std::memory_order_relaxed);
+}
+
+inline uint64_t NowNanos() {
+  return static_cast<uint64_t>(
+      std::chrono::duration_cast<std::chrono::nanoseconds>(
+          std::chrono::steady_clock::now().time_since_epoch())
+          .count());
+}
@@ -0,0 +1,140 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+// Unique across all PerThread instances, so a thread's cached slot is never
+// mistaken for one of a later instance at the same address.
+inline uint64_t NextPerThreadOwnerId() {
+  static std::atomic<uint64_t> nextId{1};
+  return nextId.fetch_add(1, std::memory_order_relaxed);
+}
+
+// One T per thread that uses it, each on its own cache lines. Local() hands
+// the calling thread its slot, which no other thread writes while the
+// thread holds it, so counters in it need no locked instructions (see
+// BumpCounter); ForEach reads every slot to aggregate them. A slot outlives
+// its thread and is handed to the next thread that needs one, so its
+// counts are never lost.
+//
+// Each thread caches the slots of the last CACHED_OWNERS instances it used;
+// the first is found with one compare, in thread-local storage that needs
+// no construction check.
+template <typename T> class PerThread {
+public:
+  PerThread() : id(NextPerThreadOwnerId()) {}
+
+  PerThread(const PerThread &) = delete;
+  PerThread &operator=(const PerThread &) = delete;
+  PerThread(PerThread &&) = delete;
+  PerThread &operator=(PerThread &&) = delete;
+
+  T &Local() {
+    if (fastCache[0].owner == this->id) {
+      return *fastCache[0].value;
+    }
+    return this->LocalSlow();
+  }
+
+  // Visits every slot, including those of threads that have exited. Runs
+  // alongside writers, so what it sees of each slot may be a little stale.
+  template <typename Visit> void ForEach(Visit visit) const {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    for (const auto &slot : this->slots) {
+      visit(static_cast<const T &>(slot->value));
+    }
+  }
+
+private:
+  static constexpr size_t CACHED_OWNERS = 4;
+
+  struct alignas(64) Slot {
+    T value;
+    std::atomic<bool> claimed{false};
+  };
+
+  struct Entry {
+    uint64_t owner = 0;
+    std::shared_ptr<Slot> slot;
+  };
+
+  // The same entries as the thread's Cache, without ownership, so the
+  // array is trivially destructible and its thread_local costs no guard.
+  struct FastEntry {
+    uint64_t owner;
+    T *value;
+  };
+  static thread_local std::array<FastEntry, CACHED_OWNERS> fastCache;
+
+  // Shared ownership lets a thread outlive the instance and vice versa.
+  struct Cache {
+    std::array<Entry, CACHED_OWNERS> entries;
+
+    ~Cache() {
+      for (auto &entry : this->entries) {
+        if (entry.slot != nullptr) {
+          entry.slot->claimed.store(false, std::memory_order_release);
+        }
+      }
+    }
+  };
+
+  uint64_t id;
+  mutable std::mutex mutex;
+  std::vector<std::shared_ptr<Slot>> slots;
+
+  static Cache &LocalCache() {
+    thread_local Cache cache;
+    return cache;
+  }
+
+  T &LocalSlow() {
+    Cache &cache = LocalCache();
+    for (size_t i = 1; i < CACHED_OWNERS; ++i) {
+      if (cache.entries[i].owner == this->id) {
+        std::swap(cache.entries[0], cache.entries[i]);
+        std::swap(fastCache[0], fastCache[i]);
+        return cache.entries[0].slot->value;
+      }
+    }
+
+    std::shared_ptr<Slot> slot;
+    {
+      std::lock_guard<std::mutex> lock(this->mutex);
+      for (const auto &candidate : this->slots) {
+        if (!candidate->claimed.load(std::memory_order_acquire)) {
+          slot = candidate;
+          break;
+        }
+      }
+      if (slot == nullptr) {
+        slot = std::make_shared<Slot>();
+        this->slots.push_back(slot);
+      }
+      slot->claimed.store(true, std::memory_order_relaxed);
+    }
+
+    // The least recently used entry makes room and gives up its slot.
+    Entry &evicted = cache.entries[CACHED_OWNERS - 1];
+    if (evicted.slot != nullptr) {
+      evicted.slot->claimed.store(false, std::memory_order_release);
+    }
+    for (size_t i = CACHED_OWNERS - 1; i > 0; --i) {
+      cache.entries[i] = std::move(cache.entries[i - 1]);
+      fastCache[i] = fastCache[i - 1];
+    }
+    cache.entries[0] = Entry{this->id, std::move(slot)};
+    fastCache[0] = FastEntry{this->id, &cache.entries[0].slot->value};
+    return *fastCache[0].value;
+  }
+};
+
+template <typename T>
+thread_local std::array<typename PerThread<T>::FastEntry,
+                        PerThread<T>::CACHED_OWNERS>
+    PerThread<T>::fastCache{};
@@ -0,0 +1,79 @@
+#include "./TimestampOracle.hpp"
+
+#include <utility>
+
+Snapshot::Snapshot(TimestampOracle *oracle, uint64_t timestamp)
+    : oracle(oracle), timestamp(timestamp) {}
+
+Snapshot::~Snapshot() { this->Release(); }
+
+Snapshot::Snapshot(Snapshot &&other) noexcept
+    : oracle(std::exchange(other.oracle, nullptr)),
+      timestamp(other.timestamp) {}
+
+Snapshot &Snapshot::operator=(Snapshot &&other) noexcept {
+  if (this != &other) {
+    this->Release();
+    this->oracle = std::exchange(other.oracle, nullptr);
+    this->timestamp = other.timestamp;
+  }
+  return *this;
+}
+
+uint64_t Snapshot::GetTimestamp() const { return this->timestamp; }
+
+bool Snapshot::IsValid() const { return this->oracle != nullptr; }
+
+void Snapshot::Release() {
+  if (this->oracle != nullptr) {
+    this->oracle->Unregister(this->timestamp);
+    this->oracle = nullptr;
+  }
+}
+
+uint64_t TimestampOracle::Commit() {
+  // Sequentially consistent with the count in OpenSnapshot: a writer that
+  // then finds no snapshot open knows any snapshot still opening reads
+  // this time or a later one.
+  return this->clock.fetch_add(1, std::memory_order_seq_cst) + 1;
+}
+
+uint64_t TimestampOracle::GetReadTimestamp() const {
+  return this->clock.load(std::memory_order_acquire);
+}
+
+Snapshot TimestampOracle::OpenSnapshot() {
+  // Counted before the time is read; see Commit.
+  this->activeCount.fetch_add(1, std::memory_order_seq_cst);
+  std::lock_guard<std::mutex> lock(this->snapshotMutex);
+  uint64_t timestamp = this->clock.load(std::memory_order_seq_cst);
+  this->snapshots[timestamp]++;
+  return Snapshot(this, timestamp);
+}
+
+uint64_t TimestampOracle::GetOldestActive() const {
+  // Every write checks this after its commit, so the common case of no
+  // open snapshot takes no lock.
+  if (this->activeCount.load(std::memory_order_seq_cst) == 0) {
+    return this->GetReadTimestamp();
+  }
+  std::lock_guard<std::mutex> lock(this->snapshotMutex);
+  if (this->snapshots.empty()) {
+    // One is opening, and will read the current timestamp or later.
+    return this->GetReadTimestamp();
+  }
+  return this->snapshots.begin()->first;
+}
+
+size_t TimestampOracle::GetActiveSnapshotCount() const {
+  return this->activeCount.load(std::memory_order_relaxed);
+}
+
+void TimestampOracle::Unregister(uint64_t timestamp) {
+  std::lock_guard<std::mutex> lock(this->snapshotMutex);
+  auto it = this->snapshots.find(timestamp);
+  if (it != this->snapshots.end() && --it->second == 0) {
+    this->snapshots.erase(it);
+  }
+  this->activeCount.fetch_sub(1, std::memory_order_seq_cst);
+}
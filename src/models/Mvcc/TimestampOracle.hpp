@@ -0,0 +1,74 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <mutex>
+
+class TimestampOracle;
+
+// A registered read timestamp. While it lives, the versions it can see are
+// kept; reads through it see every write committed at or before it and
+// none after. Move-only.
+class Snapshot {
+public:
+  Snapshot() = default;
+  ~Snapshot();
+
+  Snapshot(const Snapshot &) = delete;
+  Snapshot &operator=(const Snapshot &) = delete;
+  Snapshot(Snapshot &&other) noexcept;
+  Snapshot &operator=(Snapshot &&other) noexcept;
+
+  uint64_t GetTimestamp() const;
+  bool IsValid() const;
+  // Unregisters early; the snapshot is invalid afterwards.
+  void Release();
+
+private:
+  friend class TimestampOracle;
+  Snapshot(TimestampOracle *oracle, uint64_t timestamp);
+
+  TimestampOracle *oracle = nullptr;
+  uint64_t timestamp = 0;
+};
+
+// One clock for commits and snapshots. A write is stamped with Commit only
+// once its change is in place, and under a lock its readers also take (see
+// VersionStore::Commit), so a snapshot opened at or after the stamp sees
+// the whole change and one opened before sees none of it. No write waits
+// for another to finish.
+//
+// Timestamps live in memory only; they start over when a table is opened.
+class TimestampOracle {
+public:
+  TimestampOracle() = default;
+
+  TimestampOracle(const TimestampOracle &) = delete;
+  TimestampOracle &operator=(const TimestampOracle &) = delete;
+  TimestampOracle(TimestampOracle &&) = delete;
+  TimestampOracle &operator=(TimestampOracle &&) = delete;
+
+  // Advances the clock and returns the new time.
+  uint64_t Commit();
+  uint64_t GetReadTimestamp() const;
+
+  // Registers the current read timestamp until the snapshot is released.
+  Snapshot OpenSnapshot();
+  // The oldest timestamp any reader may still read at: the oldest open
+  // snapshot's, or the read timestamp when there is none. Versions
+  // replaced at or before it are no longer needed.
+  uint64_t GetOldestActive() const;
+  size_t GetActiveSnapshotCount() const;
+
+private:
+  friend class Snapshot;
+
+  std::atomic<uint64_t> clock{0};
+  mutable std::mutex snapshotMutex;
+  // Open snapshots by timestamp, with how many share each.
+  std::map<uint64_t, size_t> snapshots;
+  std::atomic<size_t> activeCount{0};
+
+  void Unregister(uint64_t timestamp);
+};
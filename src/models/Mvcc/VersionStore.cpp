@@ -0,0 +1,261 @@
+#include "./VersionStore.hpp"
+#include "../../types/HashKey.hpp"
+
+#include <algorithm>
+#include <thread>
+
+size_t VersionStore::KeyHash::operator()(std::string_view key) const {
+  return static_cast<size_t>(HashKey(key));
+}
+
+size_t VersionStore::StripeIndex(std::string_view key) {
+  // The top bits, so stripes do not follow the buckets of the maps inside
+  // them.
+  return static_cast<size_t>(HashKey(key) >> 58) % STRIPES;
+}
+
+VersionStore::Stripe &VersionStore::StripeFor(std::string_view key) {
+  return this->stripes[StripeIndex(key)];
+}
+
+const VersionStore::Stripe &
+VersionStore::StripeFor(std::string_view key) const {
+  return this->stripes[StripeIndex(key)];
+}
+
+uint64_t VersionStore::BeginRead(std::string_view key) const {
+  const Stripe &stripe = this->StripeFor(key);
+  while (true) {
+    uint64_t version = stripe.purgeVersion.load(std::memory_order_acquire);
+    if ((version & 1) == 0) {
+      return version;
+    }
+    std::this_thread::yield();
+  }
+}
+
+bool VersionStore::ValidateRead(std::string_view key,
+                                uint64_t version) const {
+  std::atomic_thread_fence(std::memory_order_acquire);
+  return this->StripeFor(key).purgeVersion.load(std::memory_order_relaxed) ==
+         version;
+}
+
+VersionStore::PurgeVersions VersionStore::BeginScan() const {
+  PurgeVersions versions;
+  // Taken first, so a purge that starts during the loop below shows up as
+  // a change to it.
+  versions.total = this->purgeTotal.load(std::memory_order_acquire);
+  for (size_t i = 0; i < STRIPES; ++i) {
+    while (true) {
+      versions.stripes[i] =
+          this->stripes[i].purgeVersion.load(std::memory_order_acquire);
+      if ((versions.stripes[i] & 1) == 0) {
+        break;
+      }
+      std::this_thread::yield();
+    }
+  }
+  return versions;
+}
+
+bool VersionStore::ValidateScan(std::string_view key,
+                                const PurgeVersions &versions) const {
+  std::atomic_thread_fence(std::memory_order_acquire);
+  if (this->purgeTotal.load(std::memory_order_relaxed) == versions.total) {
+    return true;
+  }
+  return this->ValidateRead(key, versions.stripes[StripeIndex(key)]);
+}
+
+void VersionStore::Resolve(std::string_view key, uint64_t timestamp,
+                           std::optional<uint64_t> &value) const {
+  if (this->chainTotal.load(std::memory_order_acquire) == 0) {
+    return;
+  }
+  const Stripe &stripe = this->StripeFor(key);
+  if (stripe.chainCount.load(std::memory_order_acquire) == 0) {
+    return;
+  }
+  std::shared_lock<std::shared_mutex> lock(stripe.mutex);
+  auto it = stripe.chains.find(key);
+  if (it == stripe.chains.end()) {
+    return;
+  }
+  const Chain &chain = it->second;
+  value = chain.newest;
+  for (auto version = chain.versions.rbegin();
+       version != chain.versions.rend() && version->timestamp > timestamp;
+       ++version) {
+    value = version->before;
+  }
+}
+
+bool VersionStore::Latest(std::string_view key,
+                          std::optional<uint64_t> &value) const {
+  const Stripe &stripe = this->StripeFor(key);
+  if (stripe.chainCount.load(std::memory_order_acquire) == 0) {
+    return false;
+  }
+  std::shared_lock<std::shared_mutex> lock(stripe.mutex);
+  auto it = stripe.chains.find(key);
+  if (it == stripe.chains.end()) {
+    return false;
+  }
+  value = it->second.newest;
+  return true;
+}
+
+void VersionStore::Record(std::string_view key,
+                          std::optional<uint64_t> before,
+                          std::optional<uint64_t> after) {
+  Stripe &stripe = this->StripeFor(key);
+  std::unique_lock<std::shared_mutex> lock(stripe.mutex);
+  auto it = stripe.chains.find(key);
+  if (it == stripe.chains.end()) {
+    it = stripe.chains.emplace(std::string(key), Chain{}).first;
+    // Published before the index changes, for readers that skip the lock.
+    stripe.chainCount.fetch_add(1, std::memory_order_release);
+    this->chainTotal.fetch_add(1, std::memory_order_release);
+  }
+  it->second.versions.push_back(Version{PENDING, before});
+  it->second.newest = after;
+  stripe.versionCount.fetch_add(1, std::memory_order_relaxed);
+}
+
+uint64_t VersionStore::Commit(std::string_view key,
+                              TimestampOracle &oracle) {
+  Stripe &stripe = this->StripeFor(key);
+  std::unique_lock<std::shared_mutex> lock(stripe.mutex);
+  uint64_t timestamp = oracle.Commit();
+  auto it = stripe.chains.find(key);
+  if (it != stripe.chains.end() && !it->second.versions.empty()) {
+    it->second.versions.back().timestamp = timestamp;
+  }
+  return timestamp;
+}
+
+void VersionStore::Rollback(std::string_view key) {
+  Stripe &stripe = this->StripeFor(key);
+  std::unique_lock<std::shared_mutex> lock(stripe.mutex);
+  auto it = stripe.chains.find(key);
+  if (it == stripe.chains.end() || it->second.versions.empty() ||
+      it->second.versions.back().timestamp != PENDING) {
+    return;
+  }
+  Chain &chain = it->second;
+  chain.newest = chain.versions.back().before;
+  chain.versions.pop_back();
+  stripe.versionCount.fetch_sub(1, std::memory_order_relaxed);
+  if (chain.versions.empty()) {
+    // Nothing else changed the index while the caller held the key, so
+    // it matches the chain's newest version again.
+    stripe.chains.erase(it);
+    this->EraseChain(stripe);
+  }
+}
+
+void VersionStore::EraseChain(Stripe &stripe) {
+  stripe.chainCount.fetch_sub(1, std::memory_order_relaxed);
+  this->chainTotal.fetch_sub(1, std::memory_order_relaxed);
+}
+
+VersionStore::PruneResult VersionStore::PruneChain(Stripe &stripe,
+                                                   Chain &chain,
+                                                   uint64_t oldest) {
+  // Readers at `oldest` or later stop before any version replaced at or
+  // before it.
+  auto firstKept = std::find_if(
+      chain.versions.begin(), chain.versions.end(),
+      [oldest](const Version &version) { return version.timestamp > oldest; });
+  size_t dropped =
+      static_cast<size_t>(firstKept - chain.versions.begin());
+  if (dropped > 0) {
+    chain.versions.erase(chain.versions.begin(), firstKept);
+    stripe.versionCount.fetch_sub(dropped, std::memory_order_relaxed);
+  }
+  if (!chain.versions.empty()) {
+    return PruneResult::Kept;
+  }
+  return chain.newest.has_value() ? PruneResult::Dropped
+                                  : PruneResult::Tombstone;
+}
+
+VersionStore::PruneResult VersionStore::Prune(std::string_view key,
+                                              uint64_t oldest) {
+  Stripe &stripe = this->StripeFor(key);
+  std::unique_lock<std::shared_mutex> lock(stripe.mutex);
+  auto it = stripe.chains.find(key);
+  if (it == stripe.chains.end()) {
+    return PruneResult::Kept;
+  }
+  PruneResult result = PruneChain(stripe, it->second, oldest);
+  if (result == PruneResult::Dropped) {
+    stripe.chains.erase(it);
+    this->EraseChain(stripe);
+  }
+  return result;
+}
+
+void VersionStore::Purge(std::string_view key,
+                         const std::function<void()> &remove) {
+  Stripe &stripe = this->StripeFor(key);
+  std::lock_guard<std::mutex> purgeLock(stripe.purgeMutex);
+  stripe.purgeVersion.fetch_add(1, std::memory_order_seq_cst);
+  // After the stripe's, so a scan that sees this sees the stripe odd.
+  this->purgeTotal.fetch_add(1, std::memory_order_seq_cst);
+  try {
+    remove();
+  } catch (...) {
+    stripe.purgeVersion.fetch_add(1, std::memory_order_seq_cst);
+    throw;
+  }
+  {
+    std::unique_lock<std::shared_mutex> lock(stripe.mutex);
+    auto it = stripe.chains.find(key);
+    if (it != stripe.chains.end()) {
+      stripe.chains.erase(it);
+      this->EraseChain(stripe);
+    }
+  }
+  stripe.purgeVersion.fetch_add(1, std::memory_order_seq_cst);
+}
+
+std::vector<std::string> VersionStore::Collect(uint64_t oldest) {
+  std::vector<std::string> tombstones;
+  for (Stripe &stripe : this->stripes) {
+    if (stripe.chainCount.load(std::memory_order_acquire) == 0) {
+      continue;
+    }
+    std::unique_lock<std::shared_mutex> lock(stripe.mutex);
+    for (auto it = stripe.chains.begin(); it != stripe.chains.end();) {
+      PruneResult result = PruneChain(stripe, it->second, oldest);
+      if (result == PruneResult::Dropped) {
+        it = stripe.chains.erase(it);
+        this->EraseChain(stripe);
+        continue;
+      }
+      if (result == PruneResult::Tombstone) {
+        tombstones.push_back(it->first);
+      }
+      ++it;
+    }
+  }
+  return tombstones;
+}
+
+size_t VersionStore::GetChainCount() const {
+  size_t count = 0;
+  for (const Stripe &stripe : this->stripes) {
+    count += stripe.chainCount.load(std::memory_order_relaxed);
+  }
+  return count;
+}
+
+size_t VersionStore::GetVersionCount() const {
+  size_t count = 0;
+  for (const Stripe &stripe : this->stripes) {
+    count += stripe.versionCount.load(std::memory_order_relaxed);
+  }
+  return count;
+}
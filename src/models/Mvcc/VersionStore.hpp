@@ -0,0 +1,150 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "./TimestampOracle.hpp"
+
+// The older versions of keys whose newest version is in an index, kept in
+// memory. A key has a chain here only while some reader may need one of
+// its older versions. The chain's newest version then overrides the
+// index, which lets a Delete leave the key in the index (so snapshot scans
+// still find it) until the versions before it are collected and Purge
+// removes it for good.
+//
+// A writer, holding the key against other writers, calls Record before it
+// changes the index and Commit after. Until Commit stamps it, the new
+// version is pending and every reader rolls it back. A reader reads the
+// index first and Resolve after, so it either sees the index without the
+// change or the chain with it; both give the version its timestamp asks
+// for.
+//
+// Purge is the one change that removes what a reader may already have
+// read, so each stripe of keys carries a sequence number that is odd while
+// a purge is under way. Readers take it before reading the index and
+// validate it after Resolve, retrying if it moved.
+class VersionStore {
+public:
+  static constexpr size_t STRIPES = 64;
+  struct PurgeVersions {
+    uint64_t total;
+    std::array<uint64_t, STRIPES> stripes;
+  };
+
+  enum class PruneResult {
+    // No chain, or versions still needed.
+    Kept,
+    // The chain matched the index and is gone.
+    Dropped,
+    // Only a delete is left; the key waits for Purge.
+    Tombstone,
+  };
+
+  VersionStore() = default;
+
+  VersionStore(const VersionStore &) = delete;
+  VersionStore &operator=(const VersionStore &) = delete;
+  VersionStore(VersionStore &&) = delete;
+  VersionStore &operator=(VersionStore &&) = delete;
+
+  // Waits out a purge in `key`'s stripe and returns the stripe's sequence
+  // number, to pass to ValidateRead.
+  uint64_t BeginRead(std::string_view key) const;
+  bool ValidateRead(std::string_view key, uint64_t version) const;
+  // The same for a scan, which may read any key. While no purge starts,
+  // validating a key does not need to find its stripe.
+  PurgeVersions BeginScan() const;
+  bool ValidateScan(std::string_view key,
+                    const PurgeVersions &versions) const;
+
+  // Turns `value`, what the index holds for `key`, into the version
+  // visible at `timestamp`.
+  void Resolve(std::string_view key, uint64_t timestamp,
+               std::optional<uint64_t> &value) const;
+
+  // Writer side; the caller keeps other writers of `key` out.
+  //
+  // Whether `key` has a chain, and if so its newest version.
+  bool Latest(std::string_view key, std::optional<uint64_t> &value) const;
+  // Notes that a pending write replaces `before` with `after`.
+  void Record(std::string_view key, std::optional<uint64_t> before,
+              std::optional<uint64_t> after);
+  // Stamps the pending write with the next time of `oracle`, and returns
+  // it. The stripe is held meanwhile, so a reader whose snapshot is at or
+  // after the stamp finds it.
+  uint64_t Commit(std::string_view key, TimestampOracle &oracle);
+  // Takes back the pending write, which failed.
+  void Rollback(std::string_view key);
+  // Drops versions of `key` replaced at or before `oldest`, as returned by
+  // TimestampOracle::GetOldestActive.
+  PruneResult Prune(std::string_view key, uint64_t oldest);
+  // Removes a Tombstone key: `remove` takes it out of the index, then its
+  // chain goes.
+  void Purge(std::string_view key, const std::function<void()> &remove);
+
+  // Prunes every chain and returns the keys left as Tombstone.
+  std::vector<std::string> Collect(uint64_t oldest);
+
+  size_t GetChainCount() const;
+  // Older versions held, across all chains.
+  size_t GetVersionCount() const;
+
+private:
+  static constexpr uint64_t PENDING = UINT64_MAX;
+
+  struct Version {
+    // PENDING until Commit.
+    uint64_t timestamp;
+    // The value the write at `timestamp` replaced, or none if the key was
+    // absent.
+    std::optional<uint64_t> before;
+  };
+
+  struct Chain {
+    std::optional<uint64_t> newest;
+    // Oldest first.
+    std::vector<Version> versions;
+  };
+
+  struct KeyHash {
+    using is_transparent = void;
+    size_t operator()(std::string_view key) const;
+  };
+
+  struct alignas(64) Stripe {
+    mutable std::shared_mutex mutex;
+    std::unordered_map<std::string, Chain, KeyHash, std::equal_to<>> chains;
+    // Readers skip the lock while there are no chains.
+    std::atomic<size_t> chainCount{0};
+    std::atomic<size_t> versionCount{0};
+    std::atomic<uint64_t> purgeVersion{0};
+    // One purge per stripe at a time, so the sequence number is odd for
+    // exactly as long as one is under way.
+    std::mutex purgeMutex;
+  };
+
+  std::array<Stripe, STRIPES> stripes;
+  // Chains across stripes, and purges ever started, so reads of keys
+  // without versions need not find their stripe.
+  std::atomic<size_t> chainTotal{0};
+  std::atomic<uint64_t> purgeTotal{0};
+
+  Stripe &StripeFor(std::string_view key);
+  const Stripe &StripeFor(std::string_view key) const;
+  static size_t StripeIndex(std::string_view key);
+  // With the stripe held exclusively.
+  static PruneResult PruneChain(Stripe &stripe, Chain &chain,
+                                uint64_t oldest);
+  // With the stripe held exclusively.
+  void EraseChain(Stripe &stripe);
+};
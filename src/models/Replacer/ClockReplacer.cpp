@@ -0,0 +1,45 @@
+#include "./ClockReplacer.hpp"
+
+ClockReplacer::ClockReplacer(size_t capacity)
+    : capacity(capacity), hand(0), referenced(capacity),
+      tracked(capacity, 0) {}
+
+void ClockReplacer::RecordInsert(size_t frameId, BlockId) {
+  this->tracked[frameId] = 1;
+  this->referenced[frameId].store(1, std::memory_order_relaxed);
+}
+
+void ClockReplacer::RecordPrefetch(size_t frameId, BlockId) {
+  // No reference bit: the first sweep to reach it takes it.
+  this->tracked[frameId] = 1;
+  this->referenced[frameId].store(0, std::memory_order_relaxed);
+}
+
+void ClockReplacer::RecordAccess(size_t frameId) {
+  auto &bit = this->referenced[frameId];
+  if (bit.load(std::memory_order_relaxed) == 0) {
+    bit.store(1, std::memory_order_relaxed);
+  }
+}
+
+size_t ClockReplacer::Evict(const std::function<bool(size_t)> &isEvictable) {
+  // Two full sweeps clear every reference bit, so a third would only revisit
+  // pinned frames.
+  for (size_t step = 0; step < 2 * this->capacity + 1; ++step) {
+    size_t frameId = this->hand;
+    this->hand = (this->hand + 1) % this->capacity;
+
+    if (!this->tracked[frameId]) {
+      continue;
+    }
+    if (this->referenced[frameId].load(std::memory_order_relaxed) != 0) {
+      this->referenced[frameId].store(0, std::memory_order_relaxed);
+      continue;
+    }
+    if (isEvictable(frameId)) {
+      this->tracked[frameId] = 0;
+      return frameId;
+    }
+  }
+  return NO_FRAME;
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+#include "./Replacer.hpp"
+
+// Second-chance CLOCK. A hit only sets the frame's reference bit, and skips
+// the store when the bit is already set so hot frames stay read-shared.
+class ClockReplacer : public Replacer {
+public:
+  explicit ClockReplacer(size_t capacity);
+
+  void RecordInsert(size_t frameId, BlockId blockId) override;
+  void RecordPrefetch(size_t frameId, BlockId blockId) override;
+  void RecordAccess(size_t frameId) override;
+  size_t Evict(const std::function<bool(size_t)> &isEvictable) override;
+
+private:
+  size_t capacity;
+  size_t hand;
+  std::vector<std::atomic<uint8_t>> referenced;
+  std::vector<uint8_t> tracked;
+};
@@ -0,0 +1,225 @@
+#include "./LRUKReplacer.hpp"
+
+#include <utility>
+
+LRUKReplacer::LRUKReplacer(size_t capacity, size_t k)
+    : capacity(capacity), k(k == 0 ? 1 : k), clock(0),
+      history(capacity * (k == 0 ? 1 : k), 0), accessCount(capacity, 0),
+      location(capacity, Location::None), youngPrev(capacity + 1, capacity),
+      youngNext(capacity + 1, capacity), heapPos(capacity, 0),
+      heapKey(capacity, 0), pending(capacity) {
+  this->heap.reserve(capacity);
+  this->stash.reserve(capacity);
+}
+
+void LRUKReplacer::RecordInsert(size_t frameId, BlockId) {
+  std::lock_guard<std::mutex> lock(this->mutex);
+  this->Untrack(frameId);
+  this->pending[frameId].store(0, std::memory_order_relaxed);
+  this->accessCount[frameId] = 0;
+  this->location[frameId] = Location::Young;
+  this->YoungPushBack(frameId);
+  this->Touch(frameId);
+}
+
+void LRUKReplacer::RecordPrefetch(size_t frameId, BlockId) {
+  std::lock_guard<std::mutex> lock(this->mutex);
+  this->Untrack(frameId);
+  this->pending[frameId].store(0, std::memory_order_relaxed);
+  // Zero recorded accesses and the head of the young FIFO: the next victim
+  // until a real access moves it to the tail.
+  this->accessCount[frameId] = 0;
+  this->location[frameId] = Location::Young;
+  this->YoungPushFront(frameId);
+}
+
+void LRUKReplacer::RecordAccess(size_t frameId) {
+  auto &flag = this->pending[frameId];
+  if (flag.load(std::memory_order_relaxed) == 0) {
+    flag.store(1, std::memory_order_relaxed);
+  }
+  std::unique_lock<std::mutex> lock(this->mutex, std::try_to_lock);
+  if (lock.owns_lock()) {
+    this->TouchPending(frameId);
+  }
+}
+
+size_t LRUKReplacer::Evict(const std::function<bool(size_t)> &isEvictable) {
+  std::lock_guard<std::mutex> lock(this->mutex);
+
+  size_t frameId = this->youngNext[this->capacity];
+  while (frameId != this->capacity) {
+    size_t following = this->youngNext[frameId];
+    if (this->TouchPending(frameId)) {
+      // Moved on by a hit recorded only now. Pushed back from the end of
+      // the FIFO, it is still next in line.
+      if (following == this->capacity &&
+          this->location[frameId] == Location::Young) {
+        following = frameId;
+      }
+    } else if (isEvictable(frameId)) {
+      this->YoungUnlink(frameId);
+      this->location[frameId] = Location::None;
+      return frameId;
+    }
+    frameId = following;
+  }
+
+  size_t victim = NO_FRAME;
+  while (!this->heap.empty()) {
+    size_t top = this->heap.front();
+    this->TouchPending(top);
+    if (this->heapKey[top] != this->KthTimestamp(top)) {
+      // Hit since it was placed: move it down to where its key now goes.
+      // A top with a current key is the true minimum, since no frame's key
+      // is below the one it is stored with.
+      this->heapKey[top] = this->KthTimestamp(top);
+      this->SiftDown(0);
+      continue;
+    }
+    size_t frameId = this->HeapPopMin();
+    if (isEvictable(frameId)) {
+      this->location[frameId] = Location::None;
+      victim = frameId;
+      break;
+    }
+    this->stash.push_back(frameId);
+  }
+  for (size_t frameId : this->stash) {
+    this->HeapPush(frameId);
+  }
+  this->stash.clear();
+  return victim;
+}
+
+bool LRUKReplacer::Touch(size_t frameId) {
+  uint64_t count = this->accessCount[frameId]++;
+  this->history[frameId * this->k + count % this->k] = ++this->clock;
+
+  if (this->location[frameId] == Location::Young) {
+    if (count + 1 >= this->k) {
+      this->YoungUnlink(frameId);
+      this->HeapPush(frameId);
+      return true;
+    }
+    if (count == 0) {
+      // First access: a prefetched frame leaves the head of the FIFO and
+      // queues like a freshly inserted one.
+      this->YoungUnlink(frameId);
+      this->YoungPushBack(frameId);
+      return true;
+    }
+  }
+  // A heap frame keeps its place: its key only grew, and Evict moves it
+  // down once it reaches the top.
+  return false;
+}
+
+bool LRUKReplacer::TouchPending(size_t frameId) {
+  auto &flag = this->pending[frameId];
+  if (flag.load(std::memory_order_relaxed) == 0) {
+    return false;
+  }
+  flag.store(0, std::memory_order_relaxed);
+  return this->location[frameId] != Location::None && this->Touch(frameId);
+}
+
+uint64_t LRUKReplacer::KthTimestamp(size_t frameId) const {
+  return this->history[frameId * this->k +
+                       this->accessCount[frameId] % this->k];
+}
+
+void LRUKReplacer::Untrack(size_t frameId) {
+  if (this->location[frameId] == Location::Young) {
+    this->YoungUnlink(frameId);
+  } else if (this->location[frameId] == Location::Heap) {
+    size_t index = this->heapPos[frameId];
+    this->HeapSwap(index, this->heap.size() - 1);
+    this->heap.pop_back();
+    if (index < this->heap.size()) {
+      this->SiftDown(index);
+      this->SiftUp(index);
+    }
+  }
+  this->location[frameId] = Location::None;
+}
+
+void LRUKReplacer::YoungPushBack(size_t frameId) {
+  size_t last = this->youngPrev[this->capacity];
+  this->youngPrev[frameId] = last;
+  this->youngNext[frameId] = this->capacity;
+  this->youngNext[last] = frameId;
+  this->youngPrev[this->capacity] = frameId;
+}
+
+void LRUKReplacer::YoungPushFront(size_t frameId) {
+  size_t first = this->youngNext[this->capacity];
+  this->youngPrev[frameId] = this->capacity;
+  this->youngNext[frameId] = first;
+  this->youngPrev[first] = frameId;
+  this->youngNext[this->capacity] = frameId;
+}
+
+void LRUKReplacer::YoungUnlink(size_t frameId) {
+  this->youngNext[this->youngPrev[frameId]] = this->youngNext[frameId];
+  this->youngPrev[this->youngNext[frameId]] = this->youngPrev[frameId];
+}
+
+void LRUKReplacer::HeapPush(size_t frameId) {
+  this->location[frameId] = Location::Heap;
+  this->heapPos[frameId] = this->heap.size();
+  this->heapKey[frameId] = this->KthTimestamp(frameId);
+  this->heap.push_back(frameId);
+  this->SiftUp(this->heap.size() - 1);
+}
+
+size_t LRUKReplacer::HeapPopMin() {
+  size_t frameId = this->heap.front();
+  this->HeapSwap(0, this->heap.size() - 1);
+  this->heap.pop_back();
+  if (!this->heap.empty()) {
+    this->SiftDown(0);
+  }
+  this->location[frameId] = Location::None;
+  return frameId;
+}
+
+void LRUKReplacer::SiftUp(size_t index) {
+  while (index > 0) {
+    size_t parent = (index - 1) / 2;
+    if (this->heapKey[this->heap[parent]] <=
+        this->heapKey[this->heap[index]]) {
+      return;
+    }
+    this->HeapSwap(parent, index);
+    index = parent;
+  }
+}
+
+void LRUKReplacer::SiftDown(size_t index) {
+  size_t size = this->heap.size();
+  while (true) {
+    size_t smallest = index;
+    size_t left = 2 * index + 1;
+    size_t right = left + 1;
+    if (left < size && this->heapKey[this->heap[left]] <
+                           this->heapKey[this->heap[smallest]]) {
+      smallest = left;
+    }
+    if (right < size && this->heapKey[this->heap[right]] <
+                            this->heapKey[this->heap[smallest]]) {
+      smallest = right;
+    }
+    if (smallest == index) {
+      return;
+    }
+    this->HeapSwap(index, smallest);
+    index = smallest;
+  }
+}
+
+void LRUKReplacer::HeapSwap(size_t a, size_t b) {
+  std::swap(this->heap[a], this->heap[b]);
+  this->heapPos[this->heap[a]] = a;
+  this->heapPos[this->heap[b]] = b;
+}
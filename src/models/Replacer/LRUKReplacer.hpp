@@ -0,0 +1,75 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+#include "./Replacer.hpp"
+
+// LRU-K (O'Neil et al.). Evicts the frame whose K-th most recent access is
+// oldest; frames seen fewer than K times have infinite backward distance and
+// go first, oldest first. Frames with K accesses live in an indexed min-heap
+// keyed by that K-th timestamp. A hit only records its timestamp, O(1) under
+// the mutex: keys only grow, so a frame whose key went stale is put back in
+// place when it reaches the top during Evict, which stays O(log n) per
+// frame moved.
+//
+// The hit path never waits for the mutex. It flags the frame as accessed,
+// as CLOCK sets a reference bit, and records the timestamp only if the
+// mutex is free; otherwise Evict records it when it reaches the frame, or
+// the frame's next uncontended hit does.
+class LRUKReplacer : public Replacer {
+public:
+  LRUKReplacer(size_t capacity, size_t k);
+
+  void RecordInsert(size_t frameId, BlockId blockId) override;
+  void RecordPrefetch(size_t frameId, BlockId blockId) override;
+  void RecordAccess(size_t frameId) override;
+  size_t Evict(const std::function<bool(size_t)> &isEvictable) override;
+
+private:
+  enum class Location : uint8_t { None, Young, Heap };
+
+  size_t capacity;
+  size_t k;
+  uint64_t clock;
+
+  std::vector<uint64_t> history;
+  std::vector<uint64_t> accessCount;
+  std::vector<Location> location;
+
+  // Frames with fewer than K accesses, FIFO through an intrusive list whose
+  // sentinel is index `capacity`.
+  std::vector<size_t> youngPrev;
+  std::vector<size_t> youngNext;
+
+  std::vector<size_t> heap;
+  std::vector<size_t> heapPos;
+  // The K-th timestamp each heap frame was placed with; at most its
+  // current one.
+  std::vector<uint64_t> heapKey;
+  std::vector<size_t> stash;
+  // Hits not yet recorded, set without the mutex.
+  std::vector<std::atomic<uint8_t>> pending;
+
+  std::mutex mutex;
+
+  // Both return whether the access moved a young frame, to the back of the
+  // FIFO or into the heap.
+  bool Touch(size_t frameId);
+  // Records the hit `pending` holds for `frameId`, if any.
+  bool TouchPending(size_t frameId);
+  uint64_t KthTimestamp(size_t frameId) const;
+
+  void Untrack(size_t frameId);
+  void YoungPushBack(size_t frameId);
+  void YoungPushFront(size_t frameId);
+  void YoungUnlink(size_t frameId);
+
+  void HeapPush(size_t frameId);
+  size_t HeapPopMin();
+  void SiftUp(size_t index);
+  void SiftDown(size_t index);
+  void HeapSwap(size_t a, size_t b);
+};
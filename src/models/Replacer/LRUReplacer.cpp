@@ -0,0 +1,66 @@
+#include "./LRUReplacer.hpp"
+
+LRUReplacer::LRUReplacer(size_t capacity)
+    : sentinel(capacity), prev(capacity + 1, capacity),
+      next(capacity + 1, capacity), linked(capacity, 0) {}
+
+void LRUReplacer::RecordInsert(size_t frameId, BlockId) {
+  std::lock_guard<std::mutex> lock(this->mutex);
+  if (this->linked[frameId]) {
+    this->Unlink(frameId);
+  }
+  this->PushBack(frameId);
+}
+
+void LRUReplacer::RecordPrefetch(size_t frameId, BlockId) {
+  std::lock_guard<std::mutex> lock(this->mutex);
+  if (this->linked[frameId]) {
+    this->Unlink(frameId);
+  }
+  this->PushFront(frameId);
+}
+
+void LRUReplacer::RecordAccess(size_t frameId) {
+  std::lock_guard<std::mutex> lock(this->mutex);
+  if (!this->linked[frameId]) {
+    return;
+  }
+  this->Unlink(frameId);
+  this->PushBack(frameId);
+}
+
+size_t LRUReplacer::Evict(const std::function<bool(size_t)> &isEvictable) {
+  std::lock_guard<std::mutex> lock(this->mutex);
+  for (size_t frameId = this->next[this->sentinel]; frameId != this->sentinel;
+       frameId = this->next[frameId]) {
+    if (isEvictable(frameId)) {
+      this->Unlink(frameId);
+      return frameId;
+    }
+  }
+  return NO_FRAME;
+}
+
+void LRUReplacer::Unlink(size_t frameId) {
+  this->next[this->prev[frameId]] = this->next[frameId];
+  this->prev[this->next[frameId]] = this->prev[frameId];
+  this->linked[frameId] = 0;
+}
+
+void LRUReplacer::PushBack(size_t frameId) {
+  size_t last = this->prev[this->sentinel];
+  this->prev[frameId] = last;
+  this->next[frameId] = this->sentinel;
+  this->next[last] = frameId;
+  this->prev[this->sentinel] = frameId;
+  this->linked[frameId] = 1;
+}
+
+void LRUReplacer::PushFront(size_t frameId) {
+  size_t first = this->next[this->sentinel];
+  this->prev[frameId] = this->sentinel;
+  this->next[frameId] = first;
+  this->prev[first] = frameId;
+  this->next[this->sentinel] = frameId;
+  this->linked[frameId] = 1;
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <mutex>
+#include <vector>
+
+#include "./Replacer.hpp"
+
+// Exact LRU over an intrusive doubly linked list indexed by frame id, so a
+// hit relinks two array slots instead of allocating a list node.
+class LRUReplacer : public Replacer {
+public:
+  explicit LRUReplacer(size_t capacity);
+
+  void RecordInsert(size_t frameId, BlockId blockId) override;
+  void RecordPrefetch(size_t frameId, BlockId blockId) override;
+  void RecordAccess(size_t frameId) override;
+  size_t Evict(const std::function<bool(size_t)> &isEvictable) override;
+
+private:
+  // Index `capacity` is the list sentinel: next is LRU, prev is MRU.
+  size_t sentinel;
+  std::vector<size_t> prev;
+  std::vector<size_t> next;
+  std::vector<uint8_t> linked;
+  std::mutex mutex;
+
+  void Unlink(size_t frameId);
+  void PushBack(size_t frameId);
+  void PushFront(size_t frameId);
+};
@@ -0,0 +1,20 @@
+#include "./Replacer.hpp"
+#include "./ClockReplacer.hpp"
+#include "./LRUKReplacer.hpp"
+#include "./LRUReplacer.hpp"
+#include "./TwoQueueReplacer.hpp"
+
+std::unique_ptr<Replacer> Replacer::Create(ReplacerPolicy policy,
+                                           size_t capacity) {
+  switch (policy) {
+  case ReplacerPolicy::LRU:
+    return std::make_unique<LRUReplacer>(capacity);
+  case ReplacerPolicy::LRUK:
+    return std::make_unique<LRUKReplacer>(capacity, 2);
+  case ReplacerPolicy::TwoQueue:
+    return std::make_unique<TwoQueueReplacer>(capacity);
+  case ReplacerPolicy::Clock:
+  default:
+    return std::make_unique<ClockReplacer>(capacity);
+  }
+}
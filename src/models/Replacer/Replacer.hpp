@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <memory>
+
+#include "../../types/Constants.hpp"
+
+enum class ReplacerPolicy { LRU, Clock, LRUK, TwoQueue };
+
+// Chooses which BufferPool frame to recycle on a miss.
+//
+// RecordInsert and Evict are serialized by the caller (the pool's frame
+// mutex). RecordAccess is the hit path: it may run concurrently with them
+// and with itself, must be safe for frames the replacer is not tracking, and
+// never allocates.
+class Replacer {
+public:
+  static constexpr size_t NO_FRAME = static_cast<size_t>(-1);
+
+  virtual ~Replacer() = default;
+
+  // `frameId` now holds `blockId` and becomes an eviction candidate.
+  virtual void RecordInsert(size_t frameId, BlockId blockId) = 0;
+  // Like RecordInsert, for a block read ahead of demand: the frame is
+  // tracked cold, so an unused prefetch is evicted before the working set.
+  // The first RecordAccess treats it like any other resident frame.
+  virtual void RecordPrefetch(size_t frameId, BlockId blockId) = 0;
+  virtual void RecordAccess(size_t frameId) = 0;
+  // Picks a victim among tracked frames accepted by `isEvictable` and stops
+  // tracking it. Returns NO_FRAME when every candidate is rejected.
+  virtual size_t Evict(const std::function<bool(size_t)> &isEvictable) = 0;
+
+  static std::unique_ptr<Replacer> Create(ReplacerPolicy policy,
+                                          size_t capacity);
+};
@@ -0,0 +1,190 @@
+#include "./TwoQueueReplacer.hpp"
+
+TwoQueueReplacer::TwoQueueReplacer(size_t capacity)
+    : capacity(capacity), a1inTarget(capacity / 4 == 0 ? 1 : capacity / 4),
+      a1inSize(0), queue(capacity, Queue::None),
+      frameBlock(capacity, INVALID_BLOCK_ID), referencedInA1in(capacity, 0),
+      prefetched(capacity, 0), prev(capacity + 2),
+      next(capacity + 2), pending(capacity),
+      ghostRing(capacity / 2 == 0 ? 1 : capacity / 2), ghostHead(0),
+      ghostSize(0), ghostSequence(0) {
+  for (size_t sentinel = capacity; sentinel < capacity + 2; ++sentinel) {
+    this->prev[sentinel] = sentinel;
+    this->next[sentinel] = sentinel;
+  }
+  this->ghostIndex.reserve(this->ghostRing.size());
+}
+
+void TwoQueueReplacer::RecordInsert(size_t frameId, BlockId blockId) {
+  std::lock_guard<std::mutex> lock(this->mutex);
+  if (this->queue[frameId] != Queue::None) {
+    this->Unlink(frameId);
+  }
+  this->frameBlock[frameId] = blockId;
+  this->referencedInA1in[frameId] = 0;
+  this->prefetched[frameId] = 0;
+  this->pending[frameId].store(0, std::memory_order_relaxed);
+
+  auto ghost = this->ghostIndex.find(blockId);
+  if (ghost != this->ghostIndex.end()) {
+    this->ghostIndex.erase(ghost);
+    this->PushBack(frameId, Queue::Am);
+  } else {
+    this->PushBack(frameId, Queue::A1in);
+  }
+}
+
+void TwoQueueReplacer::RecordPrefetch(size_t frameId, BlockId blockId) {
+  std::lock_guard<std::mutex> lock(this->mutex);
+  if (this->queue[frameId] != Queue::None) {
+    this->Unlink(frameId);
+  }
+  this->frameBlock[frameId] = blockId;
+  this->referencedInA1in[frameId] = 0;
+  this->prefetched[frameId] = 1;
+  this->pending[frameId].store(0, std::memory_order_relaxed);
+  this->PushFront(frameId, Queue::A1in);
+}
+
+void TwoQueueReplacer::RecordAccess(size_t frameId) {
+  auto &flag = this->pending[frameId];
+  if (flag.load(std::memory_order_relaxed) == 0) {
+    flag.store(1, std::memory_order_relaxed);
+  }
+  std::unique_lock<std::mutex> lock(this->mutex, std::try_to_lock);
+  if (lock.owns_lock()) {
+    this->ApplyPending(frameId);
+  }
+}
+
+bool TwoQueueReplacer::ApplyPending(size_t frameId) {
+  auto &flag = this->pending[frameId];
+  if (flag.load(std::memory_order_relaxed) == 0) {
+    return false;
+  }
+  flag.store(0, std::memory_order_relaxed);
+  this->prefetched[frameId] = 0;
+  if (this->queue[frameId] == Queue::Am) {
+    this->Unlink(frameId);
+    this->PushBack(frameId, Queue::Am);
+  } else if (this->queue[frameId] == Queue::A1in) {
+    // Only remembered; the promotion decision waits until the frame reaches
+    // the head of A1in, so a burst of correlated hits costs nothing here.
+    this->referencedInA1in[frameId] = 1;
+  }
+  return true;
+}
+
+size_t
+TwoQueueReplacer::Evict(const std::function<bool(size_t)> &isEvictable) {
+  std::lock_guard<std::mutex> lock(this->mutex);
+
+  size_t a1inHead = this->next[this->Sentinel(Queue::A1in)];
+  if (a1inHead < this->capacity) {
+    this->ApplyPending(a1inHead);
+  }
+  bool coldPrefetch =
+      a1inHead < this->capacity && this->prefetched[a1inHead] != 0;
+  Queue first = this->a1inSize > this->a1inTarget || coldPrefetch
+                    ? Queue::A1in
+                    : Queue::Am;
+  Queue second = first == Queue::A1in ? Queue::Am : Queue::A1in;
+
+  size_t victim = this->EvictFrom(first, isEvictable);
+  if (victim == NO_FRAME) {
+    victim = this->EvictFrom(second, isEvictable);
+  }
+  return victim;
+}
+
+size_t TwoQueueReplacer::EvictFrom(
+    Queue q, const std::function<bool(size_t)> &isEvictable) {
+  size_t sentinel = this->Sentinel(q);
+  size_t frameId = this->next[sentinel];
+  while (frameId != sentinel) {
+    size_t following = this->next[frameId];
+    if (this->ApplyPending(frameId) && q == Queue::Am) {
+      // Sent to the back; still next in line if it was already last.
+      if (following == sentinel) {
+        following = frameId;
+      }
+      frameId = following;
+      continue;
+    }
+    if (q == Queue::A1in && this->referencedInA1in[frameId]) {
+      this->referencedInA1in[frameId] = 0;
+      this->Unlink(frameId);
+      this->PushBack(frameId, Queue::Am);
+      frameId = following;
+      continue;
+    }
+    if (!isEvictable(frameId)) {
+      frameId = following;
+      continue;
+    }
+    this->Unlink(frameId);
+    if (q == Queue::A1in && !this->prefetched[frameId]) {
+      this->RememberGhost(this->frameBlock[frameId]);
+    }
+    return frameId;
+  }
+  return NO_FRAME;
+}
+
+void TwoQueueReplacer::RememberGhost(BlockId blockId) {
+  if (this->ghostSize == this->ghostRing.size()) {
+    const GhostEntry &oldest = this->ghostRing[this->ghostHead];
+    auto entry = this->ghostIndex.find(oldest.blockId);
+    if (entry != this->ghostIndex.end() &&
+        entry->second == oldest.sequence) {
+      this->ghostIndex.erase(entry);
+    }
+    this->ghostHead = (this->ghostHead + 1) % this->ghostRing.size();
+    this->ghostSize--;
+  }
+
+  uint64_t sequence = ++this->ghostSequence;
+  size_t slot = (this->ghostHead + this->ghostSize) % this->ghostRing.size();
+  this->ghostRing[slot] = GhostEntry{blockId, sequence};
+  this->ghostSize++;
+  this->ghostIndex[blockId] = sequence;
+}
+
+size_t TwoQueueReplacer::Sentinel(Queue q) const {
+  return q == Queue::A1in ? this->capacity : this->capacity + 1;
+}
+
+void TwoQueueReplacer::PushBack(size_t frameId, Queue q) {
+  size_t sentinel = this->Sentinel(q);
+  size_t last = this->prev[sentinel];
+  this->prev[frameId] = last;
+  this->next[frameId] = sentinel;
+  this->next[last] = frameId;
+  this->prev[sentinel] = frameId;
+  this->queue[frameId] = q;
+  if (q == Queue::A1in) {
+    this->a1inSize++;
+  }
+}
+
+void TwoQueueReplacer::PushFront(size_t frameId, Queue q) {
+  size_t sentinel = this->Sentinel(q);
+  size_t first = this->next[sentinel];
+  this->prev[frameId] = sentinel;
+  this->next[frameId] = first;
+  this->prev[first] = frameId;
+  this->next[sentinel] = frameId;
+  this->queue[frameId] = q;
+  if (q == Queue::A1in) {
+    this->a1inSize++;
+  }
+}
+
+void TwoQueueReplacer::Unlink(size_t frameId) {
+  this->next[this->prev[frameId]] = this->next[frameId];
+  this->prev[this->next[frameId]] = this->prev[frameId];
+  if (this->queue[frameId] == Queue::A1in) {
+    this->a1inSize--;
+  }
+  this->queue[frameId] = Queue::None;
+}
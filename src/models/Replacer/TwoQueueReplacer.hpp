@@ -0,0 +1,75 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "./Replacer.hpp"
+
+// 2Q (Johnson & Shasha). New blocks enter the A1in FIFO and are promoted to
+// the Am LRU when they prove to be reused: either they are fetched again
+// after falling out of A1in (the A1out ghost queue of recently evicted block
+// ids detects this), or they were hit while in A1in and reach its head. A
+// sequential scan touches each block once, so it churns A1in and leaves the
+// hot Am frames alone.
+//
+// The hit path never waits for the mutex: it flags the frame as accessed,
+// as CLOCK sets a reference bit, and applies the hit only if the mutex is
+// free. Evict applies a pending hit when it reaches the frame, which sends
+// an Am frame to the back, so a hit under contention is late but not lost.
+class TwoQueueReplacer : public Replacer {
+public:
+  explicit TwoQueueReplacer(size_t capacity);
+
+  void RecordInsert(size_t frameId, BlockId blockId) override;
+  void RecordPrefetch(size_t frameId, BlockId blockId) override;
+  void RecordAccess(size_t frameId) override;
+  size_t Evict(const std::function<bool(size_t)> &isEvictable) override;
+
+private:
+  enum class Queue : uint8_t { None, A1in, Am };
+
+  struct GhostEntry {
+    BlockId blockId;
+    uint64_t sequence;
+  };
+
+  size_t capacity;
+  size_t a1inTarget;
+  size_t a1inSize;
+
+  std::vector<Queue> queue;
+  std::vector<BlockId> frameBlock;
+  std::vector<uint8_t> referencedInA1in;
+  // Read ahead and not yet accessed: sits at the head of A1in and is not
+  // remembered in A1out when evicted, since nothing asked for it.
+  std::vector<uint8_t> prefetched;
+  // Two intrusive lists share these arrays; sentinels sit at `capacity`
+  // (A1in) and `capacity + 1` (Am).
+  std::vector<size_t> prev;
+  std::vector<size_t> next;
+  // Hits not yet applied, set without the mutex.
+  std::vector<std::atomic<uint8_t>> pending;
+
+  // A1out: FIFO ring of evicted block ids plus a lookup map. The sequence
+  // number lets a stale ring slot skip erasing a newer map entry.
+  std::vector<GhostEntry> ghostRing;
+  size_t ghostHead;
+  size_t ghostSize;
+  uint64_t ghostSequence;
+  std::unordered_map<BlockId, uint64_t> ghostIndex;
+
+  std::mutex mutex;
+
+  size_t Sentinel(Queue q) const;
+  void PushBack(size_t frameId, Queue q);
+  void PushFront(size_t frameId, Queue q);
+  void Unlink(size_t frameId);
+  // Applies the hit `pending` holds for `frameId`; returns whether there
+  // was one.
+  bool ApplyPending(size_t frameId);
+  size_t EvictFrom(Queue q, const std::function<bool(size_t)> &isEvictable);
+  void RememberGhost(BlockId blockId);
+};
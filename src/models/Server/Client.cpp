@@ -0,0 +1,216 @@
+#include "./Client.hpp"
+#include "./Server.hpp"
+
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <memory>
+
+namespace {
+
+constexpr size_t READ_SIZE = 65536;
+
+[[noreturn]] void ThrowErrno(const std::string &message) {
+  throw ServerException(message + ": " + std::strerror(errno));
+}
+
+} // namespace
+
+KVClient::KVClient(const std::string &host, uint16_t port)
+    : input(READ_SIZE) {
+  addrinfo hints{};
+  hints.ai_family = AF_UNSPEC;
+  hints.ai_socktype = SOCK_STREAM;
+  hints.ai_flags = AI_NUMERICSERV;
+  addrinfo *addresses = nullptr;
+  std::string service = std::to_string(port);
+  int err = ::getaddrinfo(host.c_str(), service.c_str(), &hints, &addresses);
+  if (err != 0) {
+    throw ServerException("Cannot resolve " + host + ": " +
+                          ::gai_strerror(err));
+  }
+  std::unique_ptr<addrinfo, decltype(&::freeaddrinfo)> owned(
+      addresses, &::freeaddrinfo);
+  for (addrinfo *address = addresses; address != nullptr;
+       address = address->ai_next) {
+    this->fd = ::socket(address->ai_family, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (this->fd < 0) {
+      continue;
+    }
+    if (::connect(this->fd, address->ai_addr, address->ai_addrlen) == 0) {
+      int one = 1;
+      ::setsockopt(this->fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+      return;
+    }
+    ::close(this->fd);
+    this->fd = -1;
+  }
+  ThrowErrno("Cannot connect to " + host + ":" + service);
+}
+
+KVClient::KVClient(const std::string &unixPath) : input(READ_SIZE) {
+  sockaddr_un address{};
+  address.sun_family = AF_UNIX;
+  if (unixPath.size() >= sizeof(address.sun_path)) {
+    throw ServerException("Unix socket path too long: " + unixPath);
+  }
+  std::memcpy(address.sun_path, unixPath.c_str(), unixPath.size() + 1);
+  this->fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (this->fd < 0) {
+    ThrowErrno("socket failed");
+  }
+  if (::connect(this->fd, reinterpret_cast<sockaddr *>(&address),
+                sizeof(address)) != 0) {
+    int err = errno;
+    ::close(this->fd);
+    errno = err;
+    ThrowErrno("Cannot connect to " + unixPath);
+  }
+}
+
+KVClient::~KVClient() {
+  if (this->fd >= 0) {
+    ::close(this->fd);
+  }
+}
+
+uint32_t KVClient::Send(KVOpcode op, std::string_view key, uint64_t value,
+                        uint32_t limit) {
+  KVRequest request;
+  request.id = this->nextId++;
+  request.op = op;
+  request.key = key;
+  request.value = value;
+  request.limit = limit;
+  Protocol::AppendRequest(this->output, request);
+  return request.id;
+}
+
+uint32_t KVClient::SendGet(std::string_view key) {
+  return this->Send(KVOpcode::Get, key, 0, 0);
+}
+
+uint32_t KVClient::SendPut(std::string_view key, uint64_t value) {
+  return this->Send(KVOpcode::Put, key, value, 0);
+}
+
+uint32_t KVClient::SendDelete(std::string_view key) {
+  return this->Send(KVOpcode::Delete, key, 0, 0);
+}
+
+uint32_t KVClient::SendScan(std::string_view startKey, uint32_t limit) {
+  return this->Send(KVOpcode::Scan, startKey, 0, limit);
+}
+
+void KVClient::SendRaw(std::string_view bytes) { this->output += bytes; }
+
+void KVClient::Flush() {
+  size_t offset = 0;
+  while (offset < this->output.size()) {
+    ssize_t sent = ::send(this->fd, this->output.data() + offset,
+                          this->output.size() - offset, MSG_NOSIGNAL);
+    if (sent < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      ThrowErrno("send failed");
+    }
+    offset += static_cast<size_t>(sent);
+  }
+  this->output.clear();
+}
+
+void KVClient::FinishSending() {
+  this->Flush();
+  if (::shutdown(this->fd, SHUT_WR) != 0) {
+    ThrowErrno("shutdown failed");
+  }
+}
+
+KVResponse KVClient::Receive() {
+  this->Flush();
+  while (true) {
+    const char *data = this->input.data() + this->inputStart;
+    size_t available = this->inputEnd - this->inputStart;
+    size_t frameSize = 0;
+    try {
+      frameSize = Protocol::FrameSize(data, available);
+    } catch (const ProtocolException &e) {
+      throw ServerException(std::string("Bad response: ") + e.what());
+    }
+    if (frameSize != 0 && frameSize <= available) {
+      KVResponse response;
+      try {
+        response = Protocol::ParseResponse(data, frameSize);
+      } catch (const ProtocolException &e) {
+        throw ServerException(std::string("Bad response: ") + e.what());
+      }
+      this->inputStart += frameSize;
+      return response;
+    }
+
+    // Make room for the rest of the frame, then wait for more of it.
+    if (this->inputStart > 0) {
+      std::memmove(this->input.data(), data, available);
+      this->inputStart = 0;
+      this->inputEnd = available;
+    }
+    size_t needed = std::max(frameSize, available + READ_SIZE / 2);
+    if (this->input.size() < needed) {
+      this->input.resize(std::max(needed, this->input.size() * 2));
+    }
+    ssize_t received;
+    do {
+      received = ::read(this->fd, this->input.data() + this->inputEnd,
+                        this->input.size() - this->inputEnd);
+    } while (received < 0 && errno == EINTR);
+    if (received < 0) {
+      ThrowErrno("read failed");
+    }
+    if (received == 0) {
+      throw ServerException("Connection closed by server");
+    }
+    this->inputEnd += static_cast<size_t>(received);
+  }
+}
+
+KVResponse KVClient::RoundTrip(uint32_t id) {
+  KVResponse response = this->Receive();
+  if (response.id != id) {
+    throw ServerException("Response out of order: expected id " +
+                          std::to_string(id) + ", got " +
+                          std::to_string(response.id));
+  }
+  if (response.status == KVStatus::Error) {
+    throw ServerException(response.error);
+  }
+  return response;
+}
+
+std::optional<uint64_t> KVClient::Get(std::string_view key) {
+  KVResponse response = this->RoundTrip(this->SendGet(key));
+  if (response.status == KVStatus::NotFound) {
+    return std::nullopt;
+  }
+  return response.value;
+}
+
+void KVClient::Put(std::string_view key, uint64_t value) {
+  this->RoundTrip(this->SendPut(key, value));
+}
+
+bool KVClient::Delete(std::string_view key) {
+  return this->RoundTrip(this->SendDelete(key)).status == KVStatus::Ok;
+}
+
+std::vector<std::pair<std::string, uint64_t>>
+KVClient::Scan(std::string_view startKey, uint32_t limit) {
+  return this->RoundTrip(this->SendScan(startKey, limit)).entries;
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "./Protocol.hpp"
+
+// A blocking connection to a Server. The Send calls only queue a request;
+// queued requests go out together on Flush, or on the next Receive, so
+// many can be in flight at once. Responses come back in request order.
+//
+// Get, Put, Delete and Scan are single round trips for when nothing else
+// is in flight; they throw ServerException on an Error response. Failures
+// of the connection itself throw ServerException too.
+class KVClient {
+public:
+  // Connects over TCP.
+  KVClient(const std::string &host, uint16_t port);
+  // Connects to a Unix socket.
+  explicit KVClient(const std::string &unixPath);
+  ~KVClient();
+
+  KVClient(const KVClient &) = delete;
+  KVClient &operator=(const KVClient &) = delete;
+  KVClient(KVClient &&) = delete;
+  KVClient &operator=(KVClient &&) = delete;
+
+  // Each returns the id its response will carry.
+  uint32_t SendGet(std::string_view key);
+  uint32_t SendPut(std::string_view key, uint64_t value);
+  uint32_t SendDelete(std::string_view key);
+  // A limit of 0 asks for as many entries as the server allows.
+  uint32_t SendScan(std::string_view startKey, uint32_t limit);
+  // Sends what was queued, raw bytes included.
+  void Flush();
+  // Flushes, then closes the sending side: the server sees the end of the
+  // requests but still sends every response.
+  void FinishSending();
+  // Waits for the next response.
+  KVResponse Receive();
+
+  // Queues bytes to be sent as they are, for exercising the server with
+  // frames of its own making.
+  void SendRaw(std::string_view bytes);
+
+  std::optional<uint64_t> Get(std::string_view key);
+  void Put(std::string_view key, uint64_t value);
+  bool Delete(std::string_view key);
+  std::vector<std::pair<std::string, uint64_t>>
+  Scan(std::string_view startKey, uint32_t limit);
+
+private:
+  int fd = -1;
+  uint32_t nextId = 1;
+  std::string output;
+  std::vector<char> input;
+  size_t inputStart = 0;
+  size_t inputEnd = 0;
+
+  uint32_t Send(KVOpcode op, std::string_view key, uint64_t value,
+                uint32_t limit);
+  KVResponse RoundTrip(uint32_t id);
+};
@@ -0,0 +1,180 @@
+#include "./Protocol.hpp"
+
+namespace {
+
+// Reads the fields of a frame body in order, checking each fits.
+class Reader {
+public:
+  Reader(const char *data, size_t size) : data(data), size(size) {}
+
+  const char *Take(size_t bytes) {
+    if (bytes > this->size - this->offset) {
+      throw ProtocolException("Truncated frame body");
+    }
+    const char *field = this->data + this->offset;
+    this->offset += bytes;
+    return field;
+  }
+
+  uint16_t U16() { return Protocol::DecodeU16(this->Take(2)); }
+  uint32_t U32() { return Protocol::DecodeU32(this->Take(4)); }
+  uint64_t U64() { return Protocol::DecodeU64(this->Take(8)); }
+
+  std::string_view Key() {
+    uint16_t length = this->U16();
+    return std::string_view(this->Take(length), length);
+  }
+
+  size_t Remaining() const { return this->size - this->offset; }
+
+  void ExpectEnd() const {
+    if (this->Remaining() != 0) {
+      throw ProtocolException("Trailing bytes after frame body");
+    }
+  }
+
+private:
+  const char *data;
+  size_t size;
+  size_t offset = 0;
+};
+
+} // namespace
+
+size_t Protocol::FrameSize(const char *data, size_t size) {
+  if (size < LENGTH_SIZE) {
+    return 0;
+  }
+  size_t frameSize = LENGTH_SIZE + DecodeU32(data);
+  if (frameSize < HEADER_SIZE || frameSize > MAX_FRAME_SIZE) {
+    throw ProtocolException("Invalid frame length " +
+                            std::to_string(frameSize));
+  }
+  return frameSize;
+}
+
+KVRequest Protocol::ParseRequest(const char *frame, size_t size) {
+  KVRequest request;
+  auto op = static_cast<uint8_t>(frame[LENGTH_SIZE]);
+  request.id = DecodeU32(frame + LENGTH_SIZE + 1);
+  Reader body(frame + HEADER_SIZE, size - HEADER_SIZE);
+  switch (op) {
+  case static_cast<uint8_t>(KVOpcode::Get):
+  case static_cast<uint8_t>(KVOpcode::Delete):
+    request.key = body.Key();
+    break;
+  case static_cast<uint8_t>(KVOpcode::Put):
+    request.key = body.Key();
+    request.value = body.U64();
+    break;
+  case static_cast<uint8_t>(KVOpcode::Scan):
+    request.key = body.Key();
+    request.limit = body.U32();
+    break;
+  default:
+    throw ProtocolException("Unknown opcode " + std::to_string(op));
+  }
+  body.ExpectEnd();
+  request.op = static_cast<KVOpcode>(op);
+  return request;
+}
+
+KVResponse Protocol::ParseResponse(const char *frame, size_t size) {
+  KVResponse response;
+  auto status = static_cast<uint8_t>(frame[LENGTH_SIZE]);
+  if (status > static_cast<uint8_t>(KVStatus::Error)) {
+    throw ProtocolException("Unknown status " + std::to_string(status));
+  }
+  response.status = static_cast<KVStatus>(status);
+  response.id = DecodeU32(frame + LENGTH_SIZE + 1);
+  Reader body(frame + HEADER_SIZE, size - HEADER_SIZE);
+  if (response.status == KVStatus::Error) {
+    response.error.assign(body.Take(body.Remaining()), size - HEADER_SIZE);
+    return response;
+  }
+  if (response.status != KVStatus::Ok || body.Remaining() == 0) {
+    body.ExpectEnd();
+    return response;
+  }
+  // Only Get and Scan answer with a body; which one is told by its size,
+  // since an Ok to Get is exactly a value.
+  if (body.Remaining() == 8) {
+    response.value = body.U64();
+    return response;
+  }
+  uint32_t count = body.U32();
+  for (uint32_t i = 0; i < count; ++i) {
+    std::string_view key = body.Key();
+    uint64_t value = body.U64();
+    response.entries.emplace_back(std::string(key), value);
+  }
+  body.ExpectEnd();
+  return response;
+}
+
+void Protocol::AppendRequest(std::string &out, const KVRequest &request) {
+  if (request.key.size() > UINT16_MAX) {
+    throw ProtocolException("Key too long for a frame");
+  }
+  size_t bodySize = 2 + request.key.size();
+  if (request.op == KVOpcode::Put) {
+    bodySize += 8;
+  } else if (request.op == KVOpcode::Scan) {
+    bodySize += 4;
+  }
+  size_t start = out.size();
+  out.resize(start + HEADER_SIZE + bodySize);
+  char *frame = out.data() + start;
+  EncodeU32(frame,
+            static_cast<uint32_t>(HEADER_SIZE - LENGTH_SIZE + bodySize));
+  frame[LENGTH_SIZE] = static_cast<char>(request.op);
+  EncodeU32(frame + LENGTH_SIZE + 1, request.id);
+  char *body = frame + HEADER_SIZE;
+  EncodeU16(body, static_cast<uint16_t>(request.key.size()));
+  request.key.copy(body + 2, request.key.size());
+  body += 2 + request.key.size();
+  if (request.op == KVOpcode::Put) {
+    EncodeU64(body, request.value);
+  } else if (request.op == KVOpcode::Scan) {
+    EncodeU32(body, request.limit);
+  }
+}
+
+void Protocol::EncodeU16(char *out, uint16_t value) {
+  for (int i = 0; i < 2; ++i) {
+    out[i] = static_cast<char>(value >> (8 * i));
+  }
+}
+
+void Protocol::EncodeU32(char *out, uint32_t value) {
+  for (int i = 0; i < 4; ++i) {
+    out[i] = static_cast<char>(value >> (8 * i));
+  }
+}
+
+void Protocol::EncodeU64(char *out, uint64_t value) {
+  for (int i = 0; i < 8; ++i) {
+    out[i] = static_cast<char>(value >> (8 * i));
+  }
+}
+
+uint16_t Protocol::DecodeU16(const char *in) {
+  return static_cast<uint16_t>(static_cast<unsigned char>(in[0]) |
+                               static_cast<unsigned char>(in[1]) << 8);
+}
+
+uint32_t Protocol::DecodeU32(const char *in) {
+  uint32_t value = 0;
+  for (int i = 3; i >= 0; --i) {
+    value = value << 8 | static_cast<unsigned char>(in[i]);
+  }
+  return value;
+}
+
+uint64_t Protocol::DecodeU64(const char *in) {
+  uint64_t value = 0;
+  for (int i = 7; i >= 0; --i) {
+    value = value << 8 | static_cast<unsigned char>(in[i]);
+  }
+  return value;
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+class ProtocolException : public std::runtime_error {
+public:
+  explicit ProtocolException(const std::string &message)
+      : std::runtime_error(message) {}
+};
+
+enum class KVOpcode : uint8_t { Get = 1, Put = 2, Delete = 3, Scan = 4 };
+
+enum class KVStatus : uint8_t { Ok = 0, NotFound = 1, Error = 2 };
+
+// A parsed request; `key` points into the frame it was parsed from.
+struct KVRequest {
+  uint32_t id = 0;
+  KVOpcode op = KVOpcode::Get;
+  std::string_view key;
+  uint64_t value = 0;
+  uint32_t limit = 0;
+};
+
+struct KVResponse {
+  uint32_t id = 0;
+  KVStatus status = KVStatus::Ok;
+  // Get's value.
+  uint64_t value = 0;
+  // Scan's keys and values, in key order.
+  std::vector<std::pair<std::string, uint64_t>> entries;
+  // What went wrong, with KVStatus::Error.
+  std::string error;
+};
+
+// The wire format of the KV server. Every frame, either way, is
+//
+//   u32 length of the rest | u8 code | u32 id | body
+//
+// with integers little-endian. A request's code is its KVOpcode and its
+// body:
+//
+//   Get, Delete   u16 key length | key
+//   Put           u16 key length | key | u64 value
+//   Scan          u16 key length | start key | u32 limit
+//
+// where a Scan limit of 0 asks for as many entries as the server allows.
+// A response's code is a KVStatus and its id the request's. Responses come
+// back in the order the requests were sent, so a client may send many
+// requests before it reads any (pipelining). Bodies are empty except:
+//
+//   Ok to Get     u64 value
+//   Ok to Scan    u32 count | count x (u16 key length | key | u64 value)
+//   Error         message
+class Protocol {
+public:
+  static constexpr size_t LENGTH_SIZE = 4;
+  // Length, code and id.
+  static constexpr size_t HEADER_SIZE = 9;
+  static constexpr size_t MAX_FRAME_SIZE = size_t{1} << 20;
+
+  // The size of the frame at the start of `data`, or 0 when fewer than
+  // LENGTH_SIZE bytes have arrived. Throws ProtocolException when the
+  // frame would be smaller than a header or larger than MAX_FRAME_SIZE;
+  // the stream cannot be resynchronized after that.
+  static size_t FrameSize(const char *data, size_t size);
+
+  // Parses one whole frame, as sized by FrameSize. Throws
+  // ProtocolException when its body does not match its opcode.
+  static KVRequest ParseRequest(const char *frame, size_t size);
+  static KVResponse ParseResponse(const char *frame, size_t size);
+
+  static void AppendRequest(std::string &out, const KVRequest &request);
+
+  static void EncodeU16(char *out, uint16_t value);
+  static void EncodeU32(char *out, uint32_t value);
+  static void EncodeU64(char *out, uint64_t value);
+  static uint16_t DecodeU16(const char *in);
+  static uint32_t DecodeU32(const char *in);
+  static uint64_t DecodeU64(const char *in);
+};
@@ -0,0 +1,675 @@
+#include "./Server.hpp"
+
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <deque>
+#include <unordered_map>
+
+namespace {
+
+constexpr size_t CHUNK_SIZE = 16384;
+constexpr size_t READ_SIZE = 65536;
+constexpr int MAX_EVENTS = 128;
+constexpr int MAX_IOVECS = 64;
+// Error messages are cut to this many bytes on the wire.
+constexpr size_t MAX_ERROR_SIZE = 256;
+
+[[noreturn]] void ThrowErrno(const std::string &message) {
+  throw ServerException(message + ": " + std::strerror(errno));
+}
+
+// Response bytes waiting to be sent. They are encoded in place into
+// chunks that never move, so a Scan can fill in its header after its
+// entries, and a send gathers the chunks into one writev.
+class OutputQueue {
+public:
+  // Room for `bytes` more bytes, which the caller writes before anything
+  // else is appended.
+  char *Append(size_t bytes) {
+    if (this->chunks.empty() ||
+        this->chunks.back().capacity - this->chunks.back().end < bytes) {
+      this->chunks.push_back(this->NewChunk(std::max(bytes, CHUNK_SIZE)));
+    }
+    Chunk &tail = this->chunks.back();
+    char *out = tail.data.get() + tail.end;
+    tail.end += bytes;
+    this->pending += bytes;
+    return out;
+  }
+
+  // Drops what was appended after the queue held `size` bytes.
+  void TruncateTo(size_t size) {
+    while (this->pending > size) {
+      Chunk &tail = this->chunks.back();
+      size_t start = this->chunks.size() == 1 ? this->headOffset : 0;
+      size_t drop = std::min(tail.end - start, this->pending - size);
+      tail.end -= drop;
+      this->pending -= drop;
+      if (tail.end == start) {
+        this->Recycle(std::move(tail));
+        this->chunks.pop_back();
+        if (this->chunks.empty()) {
+          this->headOffset = 0;
+        }
+      }
+    }
+  }
+
+  size_t Size() const { return this->pending; }
+  bool Empty() const { return this->pending == 0; }
+
+  int Gather(iovec *iov, int max) const {
+    int count = 0;
+    for (size_t i = 0; i < this->chunks.size() && count < max; ++i) {
+      size_t start = i == 0 ? this->headOffset : 0;
+      iov[count].iov_base = this->chunks[i].data.get() + start;
+      iov[count].iov_len = this->chunks[i].end - start;
+      count++;
+    }
+    return count;
+  }
+
+  void Consume(size_t bytes) {
+    this->pending -= bytes;
+    while (bytes > 0) {
+      Chunk &head = this->chunks.front();
+      size_t sent = std::min(bytes, head.end - this->headOffset);
+      this->headOffset += sent;
+      bytes -= sent;
+      if (this->headOffset == head.end) {
+        this->Recycle(std::move(head));
+        this->chunks.pop_front();
+        this->headOffset = 0;
+      }
+    }
+  }
+
+private:
+  struct Chunk {
+    std::unique_ptr<char[]> data;
+    size_t capacity = 0;
+    size_t end = 0;
+  };
+
+  std::deque<Chunk> chunks;
+  // Bytes of the first chunk already sent.
+  size_t headOffset = 0;
+  size_t pending = 0;
+  // One emptied chunk kept back, so a connection that answers and drains
+  // in turns does not allocate for every batch.
+  Chunk spare;
+
+  Chunk NewChunk(size_t capacity) {
+    if (this->spare.data != nullptr && this->spare.capacity >= capacity) {
+      Chunk chunk = std::move(this->spare);
+      this->spare = Chunk();
+      chunk.end = 0;
+      return chunk;
+    }
+    Chunk chunk;
+    chunk.data = std::make_unique<char[]>(capacity);
+    chunk.capacity = capacity;
+    return chunk;
+  }
+
+  void Recycle(Chunk &&chunk) {
+    if (chunk.capacity == CHUNK_SIZE) {
+      this->spare = std::move(chunk);
+    }
+  }
+};
+
+void EncodeResponseHeader(char *out, KVStatus status, uint32_t id,
+                          size_t bodySize) {
+  Protocol::EncodeU32(out, static_cast<uint32_t>(Protocol::HEADER_SIZE -
+                                                 Protocol::LENGTH_SIZE +
+                                                 bodySize));
+  out[Protocol::LENGTH_SIZE] = static_cast<char>(status);
+  Protocol::EncodeU32(out + Protocol::LENGTH_SIZE + 1, id);
+}
+
+// Appends a response header for a body of `bodySize` bytes and returns
+// where the body goes.
+char *AppendResponse(OutputQueue &output, KVStatus status, uint32_t id,
+                     size_t bodySize) {
+  char *out = output.Append(Protocol::HEADER_SIZE + bodySize);
+  EncodeResponseHeader(out, status, id, bodySize);
+  return out + Protocol::HEADER_SIZE;
+}
+
+void AppendError(OutputQueue &output, uint32_t id, std::string_view message) {
+  message = message.substr(0, MAX_ERROR_SIZE);
+  message.copy(AppendResponse(output, KVStatus::Error, id, message.size()),
+               message.size());
+}
+
+void AddToEpoll(int epollFd, int fd, uint32_t events) {
+  epoll_event event{};
+  event.events = events;
+  event.data.fd = fd;
+  if (::epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &event) != 0) {
+    ThrowErrno("epoll_ctl failed");
+  }
+}
+
+void CloseFd(int &fd) {
+  if (fd >= 0) {
+    ::close(fd);
+    fd = -1;
+  }
+}
+
+} // namespace
+
+struct Server::Connection {
+  int fd;
+  std::vector<char> input = std::vector<char>(READ_SIZE);
+  // Received bytes not yet run as requests: [inputStart, inputEnd).
+  size_t inputStart = 0;
+  size_t inputEnd = 0;
+  OutputQueue output;
+  // The peer has shut down its side; close once the output is sent.
+  bool readClosed = false;
+  uint32_t events = 0;
+};
+
+struct Server::Reactor {
+  int epollFd = -1;
+  // Written by Stop to wake the loop.
+  int wakeFd = -1;
+  int tcpListenFd = -1;
+  std::thread thread;
+  std::unordered_map<int, std::unique_ptr<Connection>> connections;
+  std::atomic<uint64_t> accepted{0};
+};
+
+Server::Server(KVEngine &engine, const ServerConfig &config)
+    : engine(engine), config(config) {}
+
+Server::~Server() { this->Stop(); }
+
+void Server::Start() {
+  if (!this->reactors.empty()) {
+    throw ServerException("Server already started");
+  }
+  if (this->config.host.empty() && this->config.unixPath.empty()) {
+    throw ServerException("Server has neither a TCP host nor a Unix path");
+  }
+  unsigned count = this->config.reactors;
+  if (count == 0) {
+    count = std::max(1u, std::thread::hardware_concurrency());
+  }
+
+  try {
+    for (unsigned i = 0; i < count; ++i) {
+      this->reactors.push_back(std::make_unique<Reactor>());
+      Reactor &reactor = *this->reactors.back();
+      reactor.epollFd = ::epoll_create1(EPOLL_CLOEXEC);
+      if (reactor.epollFd < 0) {
+        ThrowErrno("epoll_create1 failed");
+      }
+      reactor.wakeFd = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+      if (reactor.wakeFd < 0) {
+        ThrowErrno("eventfd failed");
+      }
+      AddToEpoll(reactor.epollFd, reactor.wakeFd, EPOLLIN);
+    }
+    this->OpenListeners();
+  } catch (...) {
+    this->CloseListeners();
+    this->reactors.clear();
+    throw;
+  }
+
+  unsigned cpus = std::max(1u, std::thread::hardware_concurrency());
+  for (size_t i = 0; i < this->reactors.size(); ++i) {
+    Reactor &reactor = *this->reactors[i];
+    reactor.thread = std::thread([this, &reactor]() { this->Run(reactor); });
+    if (this->config.pinReactors) {
+      cpu_set_t cpuSet;
+      CPU_ZERO(&cpuSet);
+      CPU_SET(i % cpus, &cpuSet);
+      // Best effort: a restricted cpuset refuses, and the loop still runs.
+      ::pthread_setaffinity_np(reactor.thread.native_handle(),
+                               sizeof(cpuSet), &cpuSet);
+    }
+  }
+}
+
+void Server::OpenListeners() {
+  this->port = 0;
+  if (!this->config.host.empty()) {
+    addrinfo hints{};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags = AI_PASSIVE | AI_NUMERICSERV;
+    addrinfo *addresses = nullptr;
+    std::string service = std::to_string(this->config.port);
+    int err = ::getaddrinfo(this->config.host.c_str(), service.c_str(),
+                            &hints, &addresses);
+    if (err != 0) {
+      throw ServerException("Cannot resolve " + this->config.host + ": " +
+                            ::gai_strerror(err));
+    }
+    std::unique_ptr<addrinfo, decltype(&::freeaddrinfo)> owned(
+        addresses, &::freeaddrinfo);
+    sockaddr_storage address{};
+    std::memcpy(&address, addresses->ai_addr, addresses->ai_addrlen);
+    socklen_t addressSize = addresses->ai_addrlen;
+
+    // One socket per reactor on the same port; the first settles the port
+    // when any free one was asked for.
+    for (auto &reactor : this->reactors) {
+      int fd = ::socket(addresses->ai_family,
+                        SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+      if (fd < 0) {
+        ThrowErrno("socket failed");
+      }
+      reactor->tcpListenFd = fd;
+      int one = 1;
+      ::setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+      if (::setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &one, sizeof(one)) !=
+          0) {
+        ThrowErrno("SO_REUSEPORT failed");
+      }
+      if (::bind(fd, reinterpret_cast<sockaddr *>(&address), addressSize) !=
+              0 ||
+          ::listen(fd, SOMAXCONN) != 0) {
+        ThrowErrno("Cannot listen on " + this->config.host + ":" + service);
+      }
+      if (this->port == 0) {
+        sockaddr_storage bound{};
+        socklen_t boundSize = sizeof(bound);
+        ::getsockname(fd, reinterpret_cast<sockaddr *>(&bound), &boundSize);
+        uint16_t boundPort =
+            bound.ss_family == AF_INET6
+                ? ntohs(reinterpret_cast<sockaddr_in6 *>(&bound)->sin6_port)
+                : ntohs(reinterpret_cast<sockaddr_in *>(&bound)->sin_port);
+        this->port = boundPort;
+        if (address.ss_family == AF_INET6) {
+          reinterpret_cast<sockaddr_in6 *>(&address)->sin6_port =
+              htons(boundPort);
+        } else {
+          reinterpret_cast<sockaddr_in *>(&address)->sin_port =
+              htons(boundPort);
+        }
+      }
+      AddToEpoll(reactor->epollFd, fd, EPOLLIN);
+    }
+  }
+
+  if (!this->config.unixPath.empty()) {
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    if (this->config.unixPath.size() >= sizeof(address.sun_path)) {
+      throw ServerException("Unix socket path too long: " +
+                            this->config.unixPath);
+    }
+    std::memcpy(address.sun_path, this->config.unixPath.c_str(),
+                this->config.unixPath.size() + 1);
+    ::unlink(this->config.unixPath.c_str());
+    this->unixListenFd =
+        ::socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (this->unixListenFd < 0) {
+      ThrowErrno("socket failed");
+    }
+    if (::bind(this->unixListenFd, reinterpret_cast<sockaddr *>(&address),
+               sizeof(address)) != 0 ||
+        ::listen(this->unixListenFd, SOMAXCONN) != 0) {
+      ThrowErrno("Cannot listen on " + this->config.unixPath);
+    }
+    for (auto &reactor : this->reactors) {
+      AddToEpoll(reactor->epollFd, this->unixListenFd,
+                 EPOLLIN | EPOLLEXCLUSIVE);
+    }
+  }
+}
+
+void Server::CloseListeners() {
+  for (auto &reactor : this->reactors) {
+    CloseFd(reactor->tcpListenFd);
+    CloseFd(reactor->wakeFd);
+    CloseFd(reactor->epollFd);
+  }
+  if (this->unixListenFd >= 0) {
+    CloseFd(this->unixListenFd);
+    ::unlink(this->config.unixPath.c_str());
+  }
+}
+
+void Server::Stop() {
+  if (this->reactors.empty()) {
+    return;
+  }
+  this->stopping.store(true, std::memory_order_release);
+  for (auto &reactor : this->reactors) {
+    uint64_t one = 1;
+    ssize_t written = ::write(reactor->wakeFd, &one, sizeof(one));
+    (void)written;
+  }
+  for (auto &reactor : this->reactors) {
+    if (reactor->thread.joinable()) {
+      reactor->thread.join();
+    }
+  }
+  this->CloseListeners();
+  this->reactors.clear();
+  this->stopping.store(false, std::memory_order_relaxed);
+}
+
+uint16_t Server::GetPort() const { return this->port; }
+
+size_t Server::GetReactorCount() const { return this->reactors.size(); }
+
+std::vector<uint64_t> Server::GetAcceptCounts() const {
+  std::vector<uint64_t> counts;
+  for (const auto &reactor : this->reactors) {
+    counts.push_back(reactor->accepted.load(std::memory_order_relaxed));
+  }
+  return counts;
+}
+
+void Server::Run(Reactor &reactor) {
+  epoll_event events[MAX_EVENTS];
+  while (!this->stopping.load(std::memory_order_acquire)) {
+    int ready = ::epoll_wait(reactor.epollFd, events, MAX_EVENTS, -1);
+    if (ready < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      break;
+    }
+    for (int i = 0; i < ready; ++i) {
+      int fd = events[i].data.fd;
+      uint32_t happened = events[i].events;
+      if (fd == reactor.wakeFd) {
+        continue;
+      }
+      if (fd == reactor.tcpListenFd || fd == this->unixListenFd) {
+        this->Accept(reactor, fd);
+        continue;
+      }
+      auto it = reactor.connections.find(fd);
+      if (it == reactor.connections.end()) {
+        continue;
+      }
+      Connection &connection = *it->second;
+      bool open = true;
+      if ((happened & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR)) != 0) {
+        open = this->HandleReadable(reactor, connection);
+      }
+      if (open && (happened & EPOLLOUT) != 0) {
+        open = this->HandleWritable(reactor, connection);
+      }
+      if (!open) {
+        this->CloseConnection(reactor, fd);
+      }
+    }
+  }
+  for (auto &[fd, connection] : reactor.connections) {
+    ::close(fd);
+  }
+  reactor.connections.clear();
+}
+
+void Server::Accept(Reactor &reactor, int listenFd) {
+  while (true) {
+    int fd = ::accept4(listenFd, nullptr, nullptr,
+                       SOCK_NONBLOCK | SOCK_CLOEXEC);
+    if (fd < 0) {
+      if (errno == EINTR || errno == ECONNABORTED) {
+        continue;
+      }
+      // EAGAIN once the backlog is empty; out of descriptors leaves the
+      // rest queued until connections close.
+      return;
+    }
+    if (listenFd == reactor.tcpListenFd) {
+      int one = 1;
+      ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    }
+    auto connection = std::make_unique<Connection>();
+    connection->fd = fd;
+    connection->events = EPOLLIN | EPOLLRDHUP;
+    epoll_event event{};
+    event.events = connection->events;
+    event.data.fd = fd;
+    if (::epoll_ctl(reactor.epollFd, EPOLL_CTL_ADD, fd, &event) != 0) {
+      ::close(fd);
+      continue;
+    }
+    reactor.connections.emplace(fd, std::move(connection));
+    reactor.accepted.fetch_add(1, std::memory_order_relaxed);
+  }
+}
+
+void Server::CloseConnection(Reactor &reactor, int fd) {
+  ::epoll_ctl(reactor.epollFd, EPOLL_CTL_DEL, fd, nullptr);
+  ::close(fd);
+  reactor.connections.erase(fd);
+}
+
+bool Server::HandleReadable(Reactor &reactor, Connection &connection) {
+  if (!connection.readClosed &&
+      connection.output.Size() < this->config.maxPendingOutput) {
+    if (connection.inputEnd == connection.input.size()) {
+      if (connection.inputStart > 0) {
+        std::memmove(connection.input.data(),
+                     connection.input.data() + connection.inputStart,
+                     connection.inputEnd - connection.inputStart);
+        connection.inputEnd -= connection.inputStart;
+        connection.inputStart = 0;
+      } else {
+        // A frame larger than the buffer; frames are bounded, so is this.
+        connection.input.resize(connection.input.size() * 2);
+      }
+    }
+    ssize_t received;
+    do {
+      received = ::read(connection.fd,
+                        connection.input.data() + connection.inputEnd,
+                        connection.input.size() - connection.inputEnd);
+    } while (received < 0 && errno == EINTR);
+    if (received > 0) {
+      connection.inputEnd += static_cast<size_t>(received);
+    } else if (received == 0) {
+      connection.readClosed = true;
+    } else if (errno != EAGAIN && errno != EWOULDBLOCK) {
+      return false;
+    }
+  }
+
+  if (!this->Serve(connection)) {
+    return false;
+  }
+  if (connection.readClosed && connection.output.Empty()) {
+    return false;
+  }
+  this->UpdateInterest(reactor, connection);
+  return true;
+}
+
+bool Server::HandleWritable(Reactor &reactor, Connection &connection) {
+  if (!this->Flush(connection)) {
+    return false;
+  }
+  // Requests left unread while the output was full.
+  if (connection.inputStart < connection.inputEnd &&
+      !this->Serve(connection)) {
+    return false;
+  }
+  if (connection.readClosed && connection.output.Empty()) {
+    return false;
+  }
+  this->UpdateInterest(reactor, connection);
+  return true;
+}
+
+// Runs buffered requests and sends their responses for as long as the
+// socket takes them. Requests held back by a full output are already read,
+// so no read event will come for them once it drains.
+bool Server::Serve(Connection &connection) {
+  while (true) {
+    size_t start = connection.inputStart;
+    if (!this->ProcessInput(connection) || !this->Flush(connection)) {
+      return false;
+    }
+    if (connection.inputStart == start ||
+        connection.inputStart == connection.inputEnd ||
+        connection.output.Size() >= this->config.maxPendingOutput) {
+      return true;
+    }
+  }
+}
+
+bool Server::ProcessInput(Connection &connection) {
+  while (connection.output.Size() < this->config.maxPendingOutput) {
+    const char *data = connection.input.data() + connection.inputStart;
+    size_t available = connection.inputEnd - connection.inputStart;
+    size_t frameSize;
+    try {
+      frameSize = Protocol::FrameSize(data, available);
+    } catch (const ProtocolException &) {
+      return false;
+    }
+    if (frameSize == 0 || frameSize > available) {
+      break;
+    }
+    try {
+      this->Execute(Protocol::ParseRequest(data, frameSize), connection);
+    } catch (const ProtocolException &e) {
+      // The frame's bounds are sound, so only this request fails.
+      AppendError(connection.output,
+                  Protocol::DecodeU32(data + Protocol::LENGTH_SIZE + 1),
+                  e.what());
+    }
+    connection.inputStart += frameSize;
+  }
+  if (connection.inputStart == connection.inputEnd) {
+    connection.inputStart = 0;
+    connection.inputEnd = 0;
+  }
+  return true;
+}
+
+void Server::Execute(const KVRequest &request, Connection &connection) {
+  OutputQueue &output = connection.output;
+  auto respond = [&output, &request](KVStatus status, size_t bodySize) {
+    return AppendResponse(output, status, request.id, bodySize);
+  };
+
+  size_t mark = output.Size();
+  try {
+    if (request.key.size() > KVEngine::MAX_KEY_SIZE) {
+      throw ServerException("Key exceeds " +
+                            std::to_string(KVEngine::MAX_KEY_SIZE) +
+                            " bytes");
+    }
+    switch (request.op) {
+    case KVOpcode::Get: {
+      std::optional<uint64_t> value = this->engine.Get(request.key);
+      if (value) {
+        Protocol::EncodeU64(respond(KVStatus::Ok, 8), *value);
+      } else {
+        respond(KVStatus::NotFound, 0);
+      }
+      break;
+    }
+    case KVOpcode::Put:
+      this->engine.Put(request.key, request.value);
+      respond(KVStatus::Ok, 0);
+      break;
+    case KVOpcode::Delete:
+      respond(this->engine.Delete(request.key) ? KVStatus::Ok
+                                               : KVStatus::NotFound,
+              0);
+      break;
+    case KVOpcode::Scan: {
+      uint32_t limit = this->config.maxScanEntries;
+      if (request.limit != 0) {
+        limit = std::min(limit, request.limit);
+      }
+      // The header is filled in once the entries are counted; the chunk
+      // it is in does not move.
+      char *header = output.Append(Protocol::HEADER_SIZE + 4);
+      size_t bodySize = 4;
+      uint32_t count = 0;
+      if (limit > 0) {
+        this->engine.Scan(
+            request.key, [&](std::string_view key, uint64_t value) {
+              char *entry = output.Append(2 + key.size() + 8);
+              Protocol::EncodeU16(entry, static_cast<uint16_t>(key.size()));
+              std::memcpy(entry + 2, key.data(), key.size());
+              Protocol::EncodeU64(entry + 2 + key.size(), value);
+              bodySize += 2 + key.size() + 8;
+              return ++count < limit;
+            });
+      }
+      EncodeResponseHeader(header, KVStatus::Ok, request.id, bodySize);
+      Protocol::EncodeU32(header + Protocol::HEADER_SIZE, count);
+      break;
+    }
+    }
+  } catch (const std::exception &e) {
+    // A Scan may have failed halfway through its entries.
+    output.TruncateTo(mark);
+    AppendError(output, request.id, e.what());
+  }
+}
+
+bool Server::Flush(Connection &connection) {
+  while (!connection.output.Empty()) {
+    iovec iov[MAX_IOVECS];
+    msghdr message{};
+    message.msg_iov = iov;
+    message.msg_iovlen =
+        static_cast<size_t>(connection.output.Gather(iov, MAX_IOVECS));
+    // sendmsg rather than writev only for MSG_NOSIGNAL: a peer that went
+    // away must not raise SIGPIPE in the server.
+    ssize_t sent = ::sendmsg(connection.fd, &message, MSG_NOSIGNAL);
+    if (sent < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return errno == EAGAIN || errno == EWOULDBLOCK;
+    }
+    connection.output.Consume(static_cast<size_t>(sent));
+  }
+  return true;
+}
+
+void Server::UpdateInterest(Reactor &reactor, Connection &connection) {
+  // EPOLLRDHUP goes with EPOLLIN: a half-close is level-triggered, so left
+  // armed while reads are paused it would wake the loop over and over.
+  // Reads resume once the output drains, and the read sees the close.
+  uint32_t events = 0;
+  if (!connection.readClosed &&
+      connection.output.Size() < this->config.maxPendingOutput) {
+    events |= EPOLLIN | EPOLLRDHUP;
+  }
+  if (!connection.output.Empty()) {
+    events |= EPOLLOUT;
+  }
+  if (events == connection.events) {
+    return;
+  }
+  epoll_event event{};
+  event.events = events;
+  event.data.fd = connection.fd;
+  ::epoll_ctl(reactor.epollFd, EPOLL_CTL_MOD, connection.fd, &event);
+  connection.events = events;
+}
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../KVEngine/KVEngine.hpp"
+#include "./Protocol.hpp"
+
+class ServerException : public std::runtime_error {
+public:
+  explicit ServerException(const std::string &message)
+      : std::runtime_error(message) {}
+};
+
+struct ServerConfig {
+  // TCP address to listen on; an empty host leaves TCP off. Port 0 takes
+  // any free port, which GetPort then reports.
+  std::string host = "127.0.0.1";
+  uint16_t port = 7070;
+  // Unix socket to listen on as well, replacing any file at the path;
+  // empty for none.
+  std::string unixPath;
+  // Event loops, each on a thread of its own; 0 for one per core.
+  unsigned reactors = 0;
+  // Pins reactor i to CPU i modulo the number of CPUs.
+  bool pinReactors = true;
+  // Scans return at most this many entries, whatever the request asks.
+  uint32_t maxScanEntries = 1024;
+  // A connection is not read from while this many response bytes wait to
+  // be sent to it, so a client that pipelines without reading cannot grow
+  // the server's memory without bound.
+  size_t maxPendingOutput = size_t{4} << 20;
+};
+
+// Serves a KVEngine over the protocol in Protocol.hpp.
+//
+// Each reactor runs an epoll loop over its own connections and executes
+// their requests itself, in order, so a connection never moves between
+// threads. Every reactor has its own TCP listening socket on the same port
+// (SO_REUSEPORT), and the kernel spreads new connections across them; the
+// Unix socket is one listener in every reactor's epoll set, woken for one
+// of them at a time (EPOLLEXCLUSIVE).
+//
+// A reactor reads all a connection has sent, runs every whole request in
+// it, and sends the responses with one writev over the chunks they were
+// encoded into. Scan keys are copied straight from the pinned index page
+// into those chunks.
+class Server {
+public:
+  explicit Server(KVEngine &engine,
+                  const ServerConfig &config = ServerConfig());
+  ~Server();
+
+  Server(const Server &) = delete;
+  Server &operator=(const Server &) = delete;
+  Server(Server &&) = delete;
+  Server &operator=(Server &&) = delete;
+
+  // Binds the listeners and starts the reactors. Throws ServerException
+  // when a socket cannot be set up.
+  void Start();
+  // Closes every listener and connection and joins the reactors. Called by
+  // the destructor.
+  void Stop();
+
+  // The TCP port listened on, once started.
+  uint16_t GetPort() const;
+  size_t GetReactorCount() const;
+  // Connections accepted by each reactor so far.
+  std::vector<uint64_t> GetAcceptCounts() const;
+
+private:
+  struct Connection;
+  struct Reactor;
+
+  KVEngine &engine;
+  ServerConfig config;
+  uint16_t port = 0;
+  int unixListenFd = -1;
+  std::atomic<bool> stopping{false};
+  std::vector<std::unique_ptr<Reactor>> reactors;
+
+  void OpenListeners();
+  void CloseListeners();
+  void Run(Reactor &reactor);
+  void Accept(Reactor &reactor, int listenFd);
+  void CloseConnection(Reactor &reactor, int fd);
+  // Each returns false once the connection is to be closed.
+  bool HandleReadable(Reactor &reactor, Connection &connection);
+  bool HandleWritable(Reactor &reactor, Connection &connection);
+  bool Serve(Connection &connection);
+  bool ProcessInput(Connection &connection);
+  bool Flush(Connection &connection);
+  void UpdateInterest(Reactor &reactor, Connection &connection);
+  void Execute(const KVRequest &request, Connection &connection);
+};
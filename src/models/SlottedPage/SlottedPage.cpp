@@ -0,0 +1,326 @@
+#include "./SlottedPage.hpp"
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+namespace {
+
+struct OverflowRef {
+  uint32_t length;
+  BlockId firstBlock;
+};
+
+struct OverflowHeader {
+  BlockId next;
+  uint32_t length;
+};
+
+// Value bytes each overflow block holds.
+size_t OverflowChunk(const BufferPool &pool) {
+  return pool.GetPayloadSize() - sizeof(OverflowHeader);
+}
+
+} // namespace
+
+SlottedPage::SlottedPage(Block *block, size_t pageSize)
+    : SlottedPage(std::span<char>(block->data, pageSize)) {}
+
+SlottedPage::SlottedPage(std::span<char> page)
+    : data(page.data()), pageSize(page.size()) {
+  if (this->pageSize > UINT16_MAX) {
+    throw SlottedPageException("Page of " + std::to_string(this->pageSize) +
+                               " bytes is too large for 16-bit offsets");
+  }
+}
+
+size_t SlottedPage::GetMaxInlineRecord() const { return this->pageSize / 4; }
+
+void SlottedPage::Init() {
+  Header *header = this->GetHeader();
+  header->slotCount = 0;
+  header->dataStart = static_cast<uint16_t>(this->pageSize);
+  header->garbageBytes = 0;
+  header->reserved = 0;
+}
+
+uint16_t SlottedPage::GetSlotCount() const {
+  return this->GetHeader()->slotCount;
+}
+
+size_t SlottedPage::GetFreeSpace() const {
+  size_t free = this->ContiguousFree() + this->GetHeader()->garbageBytes;
+  for (SlotId slot = 0; slot < this->GetHeader()->slotCount; ++slot) {
+    if (this->GetSlots()[slot].offset == 0) {
+      return free;
+    }
+  }
+  return free < sizeof(Slot) ? 0 : free - sizeof(Slot);
+}
+
+bool SlottedPage::IsLive(SlotId slot) const {
+  return slot < this->GetHeader()->slotCount &&
+         this->GetSlots()[slot].offset != 0;
+}
+
+SlotId SlottedPage::Insert(std::string_view record) {
+  if (record.size() > this->GetMaxInlineRecord()) {
+    throw SlottedPageException("Record of " + std::to_string(record.size()) +
+                               " bytes exceeds the inline limit of " +
+                               std::to_string(this->GetMaxInlineRecord()));
+  }
+  return this->PlaceRecord(record, 0);
+}
+
+bool SlottedPage::Update(SlotId slot, std::string_view record) {
+  if (record.size() > this->GetMaxInlineRecord()) {
+    throw SlottedPageException("Record of " + std::to_string(record.size()) +
+                               " bytes exceeds the inline limit of " +
+                               std::to_string(this->GetMaxInlineRecord()));
+  }
+  Slot &entry = this->CheckedSlot(slot);
+  Header *header = this->GetHeader();
+  uint16_t oldLength = entry.length & ~OVERFLOW_FLAG;
+  uint16_t newLength = static_cast<uint16_t>(record.size());
+
+  if (newLength <= oldLength) {
+    if (newLength > 0) {
+      std::memmove(this->data + entry.offset, record.data(), newLength);
+    }
+    header->garbageBytes += oldLength - newLength;
+    entry.length = newLength;
+    return true;
+  }
+
+  if (this->ContiguousFree() + header->garbageBytes + oldLength < newLength) {
+    return false;
+  }
+  // Drop the old bytes first so compaction can reclaim them.
+  entry.offset = 0;
+  entry.length = 0;
+  header->garbageBytes += oldLength;
+  if (this->ContiguousFree() < newLength) {
+    this->Compact();
+  }
+  header->dataStart -= newLength;
+  std::memcpy(this->data + header->dataStart, record.data(), newLength);
+  entry.offset = header->dataStart;
+  entry.length = newLength;
+  return true;
+}
+
+void SlottedPage::Delete(SlotId slot) {
+  Slot &entry = this->CheckedSlot(slot);
+  Header *header = this->GetHeader();
+  header->garbageBytes += entry.length & ~OVERFLOW_FLAG;
+  entry.offset = 0;
+  entry.length = 0;
+
+  // Trailing free slots give their directory space back.
+  while (header->slotCount > 0 &&
+         this->GetSlots()[header->slotCount - 1].offset == 0) {
+    header->slotCount--;
+  }
+}
+
+std::string_view SlottedPage::Get(SlotId slot) const {
+  const Slot &entry = this->CheckedSlot(slot);
+  return {this->data + entry.offset,
+          static_cast<size_t>(entry.length & ~OVERFLOW_FLAG)};
+}
+
+void SlottedPage::Compact() {
+  Header *header = this->GetHeader();
+  Slot *slots = this->GetSlots();
+
+  // Slide records to the back of the block, highest offset first, so each
+  // move only ever lands on bytes already moved or freed.
+  thread_local std::vector<SlotId> order;
+  order.clear();
+  for (SlotId slot = 0; slot < header->slotCount; ++slot) {
+    if (slots[slot].offset != 0) {
+      order.push_back(slot);
+    }
+  }
+  std::sort(order.begin(), order.end(), [slots](SlotId a, SlotId b) {
+    return slots[a].offset > slots[b].offset;
+  });
+
+  uint16_t end = static_cast<uint16_t>(this->pageSize);
+  for (SlotId slot : order) {
+    Slot &entry = slots[slot];
+    uint16_t length = entry.length & ~OVERFLOW_FLAG;
+    end -= length;
+    std::memmove(this->data + end, this->data + entry.offset, length);
+    entry.offset = end;
+  }
+  header->dataStart = end;
+  header->garbageBytes = 0;
+}
+
+SlotId SlottedPage::InsertRecord(BufferPool &pool, std::string_view value) {
+  if (value.size() <= this->GetMaxInlineRecord()) {
+    return this->PlaceRecord(value, 0);
+  }
+  if (value.size() > UINT32_MAX) {
+    throw SlottedPageException("Record of " + std::to_string(value.size()) +
+                               " bytes is too large");
+  }
+  // Check for room first so a full page does not strand a written chain.
+  if (this->GetFreeSpace() < sizeof(OverflowRef)) {
+    return INVALID_SLOT;
+  }
+
+  OverflowRef ref{static_cast<uint32_t>(value.size()),
+                  OverflowChain::Write(pool, value)};
+  return this->PlaceRecord(
+      std::string_view(reinterpret_cast<const char *>(&ref), sizeof(ref)),
+      OVERFLOW_FLAG);
+}
+
+void SlottedPage::ReadRecord(
+    BufferPool &pool, SlotId slot,
+    const std::function<void(std::string_view)> &visit) const {
+  std::string_view record = this->Get(slot);
+  if (!this->IsOverflow(slot)) {
+    visit(record);
+    return;
+  }
+  OverflowRef ref;
+  std::memcpy(&ref, record.data(), sizeof(ref));
+  OverflowChain::Read(pool, ref.firstBlock, ref.length, visit);
+}
+
+void SlottedPage::DeleteRecord(BufferPool &pool, SlotId slot) {
+  if (!this->IsOverflow(slot)) {
+    this->Delete(slot);
+    return;
+  }
+  // Drop the reference before the blocks, so the page never points at a
+  // freed chain.
+  OverflowRef ref;
+  std::memcpy(&ref, this->Get(slot).data(), sizeof(ref));
+  this->Delete(slot);
+  OverflowChain::Free(pool, ref.firstBlock, ref.length);
+}
+
+size_t SlottedPage::GetRecordLength(SlotId slot) const {
+  std::string_view record = this->Get(slot);
+  if (!this->IsOverflow(slot)) {
+    return record.size();
+  }
+  OverflowRef ref;
+  std::memcpy(&ref, record.data(), sizeof(ref));
+  return ref.length;
+}
+
+bool SlottedPage::IsOverflow(SlotId slot) const {
+  return (this->CheckedSlot(slot).length & OVERFLOW_FLAG) != 0;
+}
+
+SlottedPage::Header *SlottedPage::GetHeader() const {
+  return reinterpret_cast<Header *>(this->data);
+}
+
+SlottedPage::Slot *SlottedPage::GetSlots() const {
+  return reinterpret_cast<Slot *>(this->data + sizeof(Header));
+}
+
+SlottedPage::Slot &SlottedPage::CheckedSlot(SlotId slot) const {
+  if (!this->IsLive(slot)) {
+    throw SlottedPageException("No record in slot " + std::to_string(slot));
+  }
+  return this->GetSlots()[slot];
+}
+
+size_t SlottedPage::ContiguousFree() const {
+  const Header *header = this->GetHeader();
+  size_t directoryEnd = sizeof(Header) + header->slotCount * sizeof(Slot);
+  return header->dataStart - directoryEnd;
+}
+
+SlotId SlottedPage::PlaceRecord(std::string_view record, uint16_t flags) {
+  Header *header = this->GetHeader();
+  Slot *slots = this->GetSlots();
+
+  SlotId slot = 0;
+  while (slot < header->slotCount && slots[slot].offset != 0) {
+    slot++;
+  }
+  size_t slotBytes = slot == header->slotCount ? sizeof(Slot) : 0;
+  size_t needed = record.size() + slotBytes;
+  if (this->ContiguousFree() + header->garbageBytes < needed) {
+    return INVALID_SLOT;
+  }
+  if (this->ContiguousFree() < needed) {
+    this->Compact();
+  }
+
+  if (slotBytes != 0) {
+    header->slotCount++;
+  }
+  header->dataStart -= static_cast<uint16_t>(record.size());
+  if (!record.empty()) {
+    std::memcpy(this->data + header->dataStart, record.data(), record.size());
+  }
+  slots[slot].offset = header->dataStart;
+  slots[slot].length = static_cast<uint16_t>(record.size()) | flags;
+  return slot;
+}
+
+BlockId OverflowChain::Write(BufferPool &pool, std::string_view value) {
+  // Written back to front so each block can point at the one after it.
+  BlockId next = INVALID_BLOCK_ID;
+  size_t chunkSize = OverflowChunk(pool);
+  size_t chunks = (value.size() + chunkSize - 1) / chunkSize;
+  for (size_t chunk = chunks; chunk-- > 0;) {
+    size_t offset = chunk * chunkSize;
+    size_t length = std::min(chunkSize, value.size() - offset);
+
+    WritePageGuard guard = pool.NewPage(next).UpgradeWrite();
+    OverflowHeader header{next, static_cast<uint32_t>(length)};
+    std::memcpy(guard.GetData().data(), &header, sizeof(header));
+    std::memcpy(guard.GetData().data() + sizeof(header), value.data() + offset,
+                length);
+    next = guard.GetBlockId();
+  }
+  return next;
+}
+
+void OverflowChain::Read(BufferPool &pool, BlockId first, size_t length,
+                         const std::function<void(std::string_view)> &visit) {
+  size_t remaining = length;
+  BlockId blockId = first;
+  while (remaining > 0) {
+    if (blockId == INVALID_BLOCK_ID) {
+      throw SlottedPageException("Overflow chain ends " +
+                                 std::to_string(remaining) +
+                                 " bytes early");
+    }
+    ReadPageGuard guard = pool.FetchPageRead(blockId);
+    OverflowHeader header;
+    std::memcpy(&header, guard.GetData().data(), sizeof(header));
+    size_t chunk =
+        std::min<size_t>({header.length, remaining, OverflowChunk(pool)});
+    visit(std::string_view(guard.GetData().data() + sizeof(header), chunk));
+
+    remaining -= chunk;
+    blockId = header.next;
+  }
+}
+
+void OverflowChain::Free(BufferPool &pool, BlockId first, size_t length) {
+  size_t remaining = length;
+  BlockId blockId = first;
+  while (remaining > 0 && blockId != INVALID_BLOCK_ID) {
+    OverflowHeader header;
+    {
+      ReadPageGuard guard = pool.FetchPageRead(blockId);
+      std::memcpy(&header, guard.GetData().data(), sizeof(header));
+    }
+    pool.DeleteBlock(blockId);
+
+    remaining -=
+        std::min<size_t>({header.length, remaining, OverflowChunk(pool)});
+    blockId = header.next;
+  }
+}
@@ -0,0 +1,117 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+#include "../../types/Constants.hpp"
+#include "../Block/Block.hpp"
+#include "../BufferPool/BufferPool.hpp"
+
+class SlottedPageException : public std::runtime_error {
+public:
+  explicit SlottedPageException(const std::string &message)
+      : std::runtime_error(message) {}
+};
+
+using SlotId = uint16_t;
+
+// Record layout over a Block's data. A small header and a slot directory
+// grow from the front of the block, record bytes grow from the back, and
+// the gap between them is free space. Deleting or shrinking a record leaves
+// a hole that Compact() squeezes out in place; Insert and Update compact on
+// their own when only fragmented space is left. Slot ids stay stable across
+// compaction, and a deleted slot is reused by a later insert.
+//
+// A view only: it owns nothing, and the caller keeps the block pinned and
+// latched (shared for reads, exclusive for writes) while using it, as a
+// ReadPageGuard or WritePageGuard does. Lookups return views into the
+// frame that stay valid until the next modification.
+class SlottedPage {
+public:
+  static constexpr SlotId INVALID_SLOT = 0xFFFF;
+
+  // Over a pinned block whose payload is `pageSize` bytes, as the pool's
+  // GetPayloadSize() reports.
+  SlottedPage(Block *block, size_t pageSize);
+  // Over a WritePageGuard's data; the page spans all of `page`. Offsets are
+  // 16-bit, so a page is at most 65535 bytes.
+  explicit SlottedPage(std::span<char> page);
+
+  // Larger values go to an overflow chain and leave an 8-byte reference in
+  // the page, so a page always holds at least four records.
+  size_t GetMaxInlineRecord() const;
+
+  // Formats the block as an empty page.
+  void Init();
+
+  uint16_t GetSlotCount() const;
+  // Bytes available to a new record, counting fragmented space and the
+  // slot it would need.
+  size_t GetFreeSpace() const;
+  bool IsLive(SlotId slot) const;
+
+  // Inline record operations. Insert returns INVALID_SLOT and Update false
+  // when the record does not fit; the page is then left unchanged.
+  SlotId Insert(std::string_view record);
+  bool Update(SlotId slot, std::string_view record);
+  void Delete(SlotId slot);
+  std::string_view Get(SlotId slot) const;
+  void Compact();
+
+  // Record operations that spill values above GetMaxInlineRecord() into
+  // overflow blocks from `pool`. ReadRecord hands the value to `visit` one
+  // contiguous piece at a time, each a view into a pinned frame.
+  SlotId InsertRecord(BufferPool &pool, std::string_view value);
+  void ReadRecord(BufferPool &pool, SlotId slot,
+                  const std::function<void(std::string_view)> &visit) const;
+  // Deletes the record and frees its overflow chain, if any.
+  void DeleteRecord(BufferPool &pool, SlotId slot);
+  size_t GetRecordLength(SlotId slot) const;
+  bool IsOverflow(SlotId slot) const;
+
+private:
+  struct Header {
+    uint16_t slotCount;
+    // Record bytes occupy [dataStart, pageSize).
+    uint16_t dataStart;
+    // Bytes of deleted or shrunk records still below dataStart.
+    uint16_t garbageBytes;
+    uint16_t reserved;
+  };
+
+  struct Slot {
+    // 0 marks a free slot; record bytes never start inside the header.
+    uint16_t offset;
+    // Top bit flags an overflow reference.
+    uint16_t length;
+  };
+
+  static constexpr uint16_t OVERFLOW_FLAG = 0x8000;
+
+  char *data;
+  size_t pageSize;
+
+  Header *GetHeader() const;
+  Slot *GetSlots() const;
+  Slot &CheckedSlot(SlotId slot) const;
+  size_t ContiguousFree() const;
+  SlotId PlaceRecord(std::string_view record, uint16_t flags);
+};
+
+// Values too large for a page, stored as a chain of blocks that each hold
+// the next block's id and a chunk of the value, as much as the pool's
+// payload size leaves room for. Each block is allocated
+// near the one written before it, so a chain built from reused blocks
+// stays close together on disk.
+class OverflowChain {
+public:
+  static BlockId Write(BufferPool &pool, std::string_view value);
+  static void Read(BufferPool &pool, BlockId first, size_t length,
+                   const std::function<void(std::string_view)> &visit);
+  // Returns the chain's blocks to the pool's free-space map.
+  static void Free(BufferPool &pool, BlockId first, size_t length);
+};
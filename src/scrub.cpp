@@ -0,0 +1,39 @@
+#include "./models/DiskManager/DiskManager.hpp"
+
+#include <cstdlib>
+#include <iostream>
+
+// Verifies every block of a database against its stored checksum.
+// Usage: keyval-scrub <database> [threads]
+// Exits 0 when every block matches, 1 when some do not, 2 on errors.
+int main(int argc, char **argv) {
+  if (argc < 2 || argc > 3) {
+    std::cerr << "usage: " << argv[0] << " <database> [threads]\n";
+    return 2;
+  }
+  unsigned threads =
+      argc > 2 ? static_cast<unsigned>(std::strtoul(argv[2], nullptr, 10)) : 0;
+
+  try {
+    // Opened the way the database was created.
+    DatabaseHeader header = DiskManager::ReadHeader(argv[1]);
+    if (header.blockFormat == DiskManager::PLAIN_BLOCK_FORMAT) {
+      std::cerr << argv[1] << " was created without checksums\n";
+      return 2;
+    }
+    DiskManagerConfig config;
+    config.blockSize = header.blockSize;
+    config.compression = header.compression;
+    DiskManager diskManager(argv[1], config);
+    std::vector<BlockId> mismatched = diskManager.Scrub(threads);
+    for (BlockId id : mismatched) {
+      std::cout << "block " << id << ": checksum mismatch\n";
+    }
+    std::cout << diskManager.GetBlockCount() << " blocks scanned, "
+              << mismatched.size() << " failed their checksum\n";
+    return mismatched.empty() ? 0 : 1;
+  } catch (const DiskManagerException &e) {
+    std::cerr << e.what() << "\n";
+    return 2;
+  }
+}
@@ -4,3 +4,8 @@
 using BlockId = uint32_t;
 constexpr int BLOCK_SIZE = 4096; // 4KB
 constexpr BlockId INVALID_BLOCK_ID = static_cast<BlockId>(-1);
+
+// Log sequence number: the byte offset just past a record in the write-ahead
+// log, so LSNs grow with the log and 0 means "no record".
+using LSN = uint64_t;
+constexpr LSN INVALID_LSN = 0;
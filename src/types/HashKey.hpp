@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+
+// 64-bit key hash: multiply-xorshift over 8-byte words with a splitmix64
+// finalizer, so every bit is well mixed. ExtendibleHash takes its directory
+// slot from the low bits and its fingerprint from the top byte; filters
+// derive their probes from all of it.
+inline uint64_t HashKey(std::string_view key) {
+  uint64_t hash = 0x243f6a8885a308d3ull ^ key.size();
+  size_t offset = 0;
+  for (; offset + 8 <= key.size(); offset += 8) {
+    uint64_t word;
+    std::memcpy(&word, key.data() + offset, 8);
+    hash = (hash ^ word) * 0x9e3779b97f4a7c15ull;
+    hash ^= hash >> 29;
+  }
+  uint64_t tail = 0;
+  if (offset < key.size()) {
+    std::memcpy(&tail, key.data() + offset, key.size() - offset);
+  }
+  hash = (hash ^ tail) * 0x9e3779b97f4a7c15ull;
+
+  hash = (hash ^ (hash >> 30)) * 0xbf58476d1ce4e5b9ull;
+  hash = (hash ^ (hash >> 27)) * 0x94d049bb133111ebull;
+  return hash ^ (hash >> 31);
+}
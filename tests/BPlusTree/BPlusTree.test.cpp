@@ -0,0 +1,338 @@
+#include "../../src/models/BPlusTree/BPlusTree.hpp"
+#include "../../src/models/BufferPool/BufferPool.hpp"
+#include "../../src/models/DiskManager/DiskManager.hpp"
+#include "../common/TempPath.hpp"
+
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <random>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+static std::string key_for(uint64_t n) {
+  char buf[32];
+  std::snprintf(buf, sizeof(buf), "user%012llu",
+                static_cast<unsigned long long>(n));
+  return buf;
+}
+
+static void test_put_get_delete_single_key() {
+  std::string path = make_temp_db_path();
+  try {
+    BufferPool pool(16, std::make_unique<DiskManager>(path));
+    BPlusTree tree(pool);
+
+    assert(!tree.Get("missing").has_value() && "Empty tree has no keys");
+    tree.Put("alpha", 1);
+    assert(tree.Get("alpha") == 1u);
+    tree.Put("alpha", 2);
+    assert(tree.Get("alpha") == 2u && "Put should overwrite");
+    assert(tree.Delete("alpha"));
+    assert(!tree.Get("alpha").has_value());
+    assert(!tree.Delete("alpha") && "Deleting twice should report absence");
+  } catch (...) {
+    safe_remove(path);
+    throw;
+  }
+  safe_remove(path);
+}
+
+static void test_matches_map_under_random_operations() {
+  std::string path = make_temp_db_path();
+  try {
+    // A small pool forces nodes through eviction and reload.
+    BufferPool pool(64, std::make_unique<DiskManager>(path));
+    BPlusTree tree(pool);
+    std::map<std::string, uint64_t> expected;
+
+    std::mt19937_64 eng(42);
+    std::uniform_int_distribution<uint64_t> pick(0, 19999);
+    for (int op = 0; op < 60000; ++op) {
+      std::string key = key_for(pick(eng));
+      if (op % 4 == 3) {
+        bool deleted = tree.Delete(key);
+        assert(deleted == (expected.erase(key) == 1));
+      } else {
+        tree.Put(key, static_cast<uint64_t>(op));
+        expected[key] = static_cast<uint64_t>(op);
+      }
+    }
+
+    for (uint64_t n = 0; n < 20000; ++n) {
+      std::string key = key_for(n);
+      auto entry = expected.find(key);
+      std::optional<uint64_t> value = tree.Get(key);
+      if (entry == expected.end()) {
+        assert(!value.has_value() && "Deleted key should be absent");
+      } else {
+        assert(value == entry->second && "Value should match the model");
+      }
+    }
+
+    auto entry = expected.begin();
+    size_t visited = 0;
+    tree.Scan("", [&](std::string_view key, uint64_t value) {
+      assert(entry != expected.end() && key == entry->first &&
+             value == entry->second && "Scan should follow key order");
+      ++entry;
+      ++visited;
+      return true;
+    });
+    assert(visited == expected.size() && "Scan should visit every key");
+  } catch (...) {
+    safe_remove(path);
+    throw;
+  }
+  safe_remove(path);
+}
+
+static void test_scan_starts_at_key_and_stops_early() {
+  std::string path = make_temp_db_path();
+  try {
+    BufferPool pool(64, std::make_unique<DiskManager>(path));
+    BPlusTree tree(pool);
+    for (uint64_t n = 0; n < 1000; n += 2) {
+      tree.Put(key_for(n), n);
+    }
+
+    std::vector<uint64_t> seen;
+    tree.Scan(key_for(501), [&](std::string_view, uint64_t value) {
+      seen.push_back(value);
+      return seen.size() < 5;
+    });
+    assert((seen == std::vector<uint64_t>{502, 504, 506, 508, 510}) &&
+           "Scan should start at the first key >= start and stop on false");
+  } catch (...) {
+    safe_remove(path);
+    throw;
+  }
+  safe_remove(path);
+}
+
+static void test_prefix_truncation_handles_diverging_keys() {
+  std::string path = make_temp_db_path();
+  try {
+    BufferPool pool(64, std::make_unique<DiskManager>(path));
+    BPlusTree tree(pool);
+
+    // A long shared prefix, then keys that break it in both directions,
+    // including a key that is itself a prefix of the others.
+    std::string prefix = "tenant/000042/orders/";
+    for (uint64_t n = 0; n < 500; ++n) {
+      tree.Put(prefix + std::to_string(n), n);
+    }
+    tree.Put("tenant/000042/", 1000);
+    tree.Put("tenant/000043/orders/1", 1001);
+    tree.Put("a", 1002);
+    tree.Put(std::string(BPlusTree::MAX_KEY_SIZE, '\xff'), 1003);
+    tree.Put(std::string("tenant/000042/orders/\0", 22), 1004);
+
+    for (uint64_t n = 0; n < 500; ++n) {
+      assert(tree.Get(prefix + std::to_string(n)) == n);
+    }
+    assert(tree.Get("tenant/000042/") == 1000u);
+    assert(tree.Get("tenant/000043/orders/1") == 1001u);
+    assert(tree.Get("a") == 1002u);
+    assert(tree.Get(std::string(BPlusTree::MAX_KEY_SIZE, '\xff')) == 1003u);
+    assert(tree.Get(std::string("tenant/000042/orders/\0", 22)) == 1004u);
+    assert(!tree.Get("tenant/000042/orders/").has_value());
+
+    std::string previous;
+    size_t count = 0;
+    tree.Scan("", [&](std::string_view key, uint64_t) {
+      assert((count == 0 || previous < key) && "Keys should stay sorted");
+      previous = std::string(key);
+      count++;
+      return true;
+    });
+    assert(count == 505);
+  } catch (...) {
+    safe_remove(path);
+    throw;
+  }
+  safe_remove(path);
+}
+
+static void test_long_key_throws() {
+  std::string path = make_temp_db_path();
+  try {
+    BufferPool pool(16, std::make_unique<DiskManager>(path));
+    BPlusTree tree(pool);
+    bool threw = false;
+    try {
+      tree.Put(std::string(BPlusTree::MAX_KEY_SIZE + 1, 'k'), 1);
+    } catch (const BPlusTreeException &) {
+      threw = true;
+    }
+    assert(threw && "Keys longer than MAX_KEY_SIZE should be rejected");
+  } catch (...) {
+    safe_remove(path);
+    throw;
+  }
+  safe_remove(path);
+}
+
+static void test_tree_survives_reopen() {
+  std::string path = make_temp_db_path();
+  try {
+    BlockId metaBlockId;
+    {
+      BufferPool pool(32, std::make_unique<DiskManager>(path));
+      BPlusTree tree(pool);
+      metaBlockId = tree.GetMetaBlockId();
+      for (uint64_t n = 0; n < 5000; ++n) {
+        tree.Put(key_for(n), n * 3);
+      }
+    }
+
+    BufferPool pool(32, std::make_unique<DiskManager>(path));
+    BPlusTree tree(pool, metaBlockId);
+    for (uint64_t n = 0; n < 5000; ++n) {
+      assert(tree.Get(key_for(n)) == n * 3 && "Keys should persist");
+    }
+
+    bool threw = false;
+    try {
+      BPlusTree notATree(pool, metaBlockId + 1);
+    } catch (const BPlusTreeException &) {
+      threw = true;
+    }
+    assert(threw && "Opening a non-meta block should throw");
+  } catch (...) {
+    safe_remove(path);
+    throw;
+  }
+  safe_remove(path);
+}
+
+static void test_node_capacity_follows_block_size() {
+  // Blocks the same keys take in a tree over `blockSize` blocks, checked
+  // again after a reopen.
+  auto blocksUsed = [](size_t blockSize) {
+    std::string path = make_temp_db_path();
+    try {
+      DiskManagerConfig diskConfig;
+      diskConfig.blockSize = blockSize;
+      BlockId metaBlockId;
+      BlockId nextBlock;
+      {
+        BufferPool pool(64, std::make_unique<DiskManager>(path, diskConfig));
+        BPlusTree tree(pool);
+        metaBlockId = tree.GetMetaBlockId();
+        for (uint64_t n = 0; n < 5000; ++n) {
+          tree.Put(key_for(n), n);
+        }
+        nextBlock = pool.NewPage().GetBlockId();
+      }
+      BufferPool pool(64, std::make_unique<DiskManager>(path, diskConfig));
+      BPlusTree tree(pool, metaBlockId);
+      for (uint64_t n = 0; n < 5000; ++n) {
+        assert(tree.Get(key_for(n)) == n && "Keys should persist");
+      }
+      safe_remove(path);
+      return nextBlock;
+    } catch (...) {
+      safe_remove(path);
+      throw;
+    }
+  };
+
+  BlockId small = blocksUsed(BLOCK_SIZE);
+  BlockId large = blocksUsed(4 * BLOCK_SIZE);
+  assert(large * 3 < small &&
+         "Nodes in larger blocks should hold proportionally more keys");
+}
+
+static void test_concurrent_readers_and_writers() {
+  std::string path = make_temp_db_path();
+  try {
+    BufferPool pool(256, std::make_unique<DiskManager>(path));
+    BPlusTree tree(pool);
+    constexpr uint64_t keysPerWriter = 3000;
+    constexpr int writers = 4;
+    constexpr int readers = 4;
+
+    std::atomic<bool> wrongValue{false};
+    std::atomic<bool> writersDone{false};
+    std::vector<std::thread> threads;
+    for (int w = 0; w < writers; ++w) {
+      threads.emplace_back([&, w]() {
+        for (uint64_t i = 0; i < keysPerWriter; ++i) {
+          uint64_t n = i * writers + static_cast<uint64_t>(w);
+          tree.Put(key_for(n), n);
+        }
+      });
+    }
+    for (int r = 0; r < readers; ++r) {
+      threads.emplace_back([&, r]() {
+        std::mt19937_64 eng(static_cast<uint64_t>(r));
+        std::uniform_int_distribution<uint64_t> pick(
+            0, keysPerWriter * writers - 1);
+        while (!writersDone) {
+          uint64_t n = pick(eng);
+          std::optional<uint64_t> value = tree.Get(key_for(n));
+          if (value.has_value() && *value != n) {
+            wrongValue = true;
+          }
+        }
+      });
+    }
+    for (int w = 0; w < writers; ++w) {
+      threads[static_cast<size_t>(w)].join();
+    }
+    writersDone = true;
+    for (size_t t = writers; t < threads.size(); ++t) {
+      threads[t].join();
+    }
+
+    assert(!wrongValue && "Readers should never see a torn value");
+    for (uint64_t n = 0; n < keysPerWriter * writers; ++n) {
+      assert(tree.Get(key_for(n)) == n && "Every concurrent put should land");
+    }
+  } catch (...) {
+    safe_remove(path);
+    throw;
+  }
+  safe_remove(path);
+}
+
+int main() {
+  std::cout << "Running BPlusTree unit tests...\n";
+
+  test_put_get_delete_single_key();
+  std::cout << " - put/get/delete single key test passed\n";
+
+  test_matches_map_under_random_operations();
+  std::cout << " - matches map under random operations test passed\n";
+
+  test_scan_starts_at_key_and_stops_early();
+  std::cout << " - scan starts at key and stops early test passed\n";
+
+  test_prefix_truncation_handles_diverging_keys();
+  std::cout << " - prefix truncation handles diverging keys test passed\n";
+
+  test_long_key_throws();
+  std::cout << " - long key throws test passed\n";
+
+  test_tree_survives_reopen();
+  std::cout << " - tree survives reopen test passed\n";
+
+  test_node_capacity_follows_block_size();
+  std::cout << " - node capacity follows block size test passed\n";
+
+  test_concurrent_readers_and_writers();
+  std::cout << " - concurrent readers and writers test passed\n";
+
+  std::cout << "All BPlusTree tests passed.\n";
+  return 0;
+}
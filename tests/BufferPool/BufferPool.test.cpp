@@ -1,38 +1,29 @@
 #include "../../src/models/BufferPool/BufferPool.hpp"
 #include "../../src/models/DiskManager/DiskManager.hpp"
+#include "../../src/models/LogManager/LogManager.hpp"
+#include "../common/TempPath.hpp"
 
+#include <algorithm>
+#include <atomic>
 #include <cassert>
+#include <cerrno>
 #include <chrono>
+#include <cstdint>
 #include <cstring>
 #include <filesystem>
+#include <fstream>
 #include <iostream>
 #include <memory>
 #include <random>
+#include <span>
 #include <string>
 #include <system_error>
+#include <thread>
+#include <vector>
 
 using namespace std::string_literals;
 namespace fs = std::filesystem;
 
-static std::string make_temp_db_path() {
-  auto tmp = fs::temp_directory_path();
-  auto now =
-      std::chrono::high_resolution_clock::now().time_since_epoch().count();
-  std::random_device rd;
-  std::mt19937_64 eng(rd());
-  std::uniform_int_distribution<uint64_t> dist;
-  uint64_t r = dist(eng);
-  std::string filename = "keyval_test_bufferpool_" + std::to_string(now) + "_" +
-                         std::to_string(r) + ".db";
-  return (tmp / filename).string();
-}
-
-static void safe_remove(const std::string &path) {
-  std::error_code ec;
-  fs::remove(path, ec);
-  (void)ec;
-}
-
 static void test_fetch_block_not_in_pool() {
   std::string path = make_temp_db_path();
   try {
@@ -240,6 +231,22 @@ static void test_flush_block_writes_to_disk() {
     pool.FlushBlock(id);
     assert(!block->isDirty && "Block should not be dirty after flush");
 
+    // A flush waits for a writer holding the latch, so the page it writes
+    // is never half changed.
+    block->WLatch();
+    std::memset(block->data, 'G', BLOCK_SIZE / 2);
+    block->isDirty = true;
+    std::thread flusher([&pool, id]() { pool.FlushBlock(id); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    std::memset(block->data + BLOCK_SIZE / 2, 'G', BLOCK_SIZE / 2);
+    block->WUnlatch();
+    flusher.join();
+    std::vector<char> buf(BLOCK_SIZE);
+    DiskManager(path).ReadBlock(id, buf.data());
+    assert(std::all_of(buf.begin(), buf.end(),
+                       [](char c) { return c == 'G'; }) &&
+           "A flush should write the page as the writer left it");
+
     pool.ReleaseBlock(id, false);
   } catch (...) {
     safe_remove(path);
@@ -326,6 +333,808 @@ static void test_multiple_blocks_lru_eviction() {
   safe_remove(path);
 }
 
+static void test_every_replacer_policy_round_trips_dirty_blocks() {
+  for (auto policy : {ReplacerPolicy::LRU, ReplacerPolicy::Clock,
+                      ReplacerPolicy::LRUK, ReplacerPolicy::TwoQueue}) {
+    std::string path = make_temp_db_path();
+    try {
+      BufferPoolConfig config;
+      config.replacerPolicy = policy;
+      BufferPool pool(2, std::make_unique<DiskManager>(path), config);
+
+      std::vector<BlockId> ids;
+      for (int i = 0; i < 6; ++i) {
+        Block *block = pool.NewBlock();
+        std::memset(block->data, 'a' + i, BLOCK_SIZE);
+        ids.push_back(block->block_id);
+        pool.ReleaseBlock(block->block_id, true);
+      }
+
+      for (int i = 0; i < 6; ++i) {
+        Block *block = pool.FetchBlock(ids[i]);
+        assert(block->data[0] == 'a' + i &&
+               "Evicted dirty block should be written back");
+        pool.ReleaseBlock(ids[i], false);
+      }
+    } catch (...) {
+      safe_remove(path);
+      throw;
+    }
+    safe_remove(path);
+  }
+}
+
+static bool wait_until_clean(Block *block) {
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+  while (block->isDirty && std::chrono::steady_clock::now() < deadline) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+  }
+  return !block->isDirty;
+}
+
+static void test_background_flusher_writes_unpinned_dirty_blocks() {
+  std::string path = make_temp_db_path();
+  try {
+    BufferPoolConfig config;
+    config.backgroundFlush = true;
+    config.flushInterval = std::chrono::milliseconds(10);
+    BufferPool pool(4, std::make_unique<DiskManager>(path), config);
+
+    Block *released = pool.NewBlock();
+    BlockId releasedId = released->block_id;
+    std::memset(released->data, 'B', BLOCK_SIZE);
+    pool.ReleaseBlock(releasedId, true);
+
+    Block *pinned = pool.NewBlock();
+    std::memset(pinned->data, 'P', BLOCK_SIZE);
+    pinned->isDirty = true;
+
+    assert(wait_until_clean(released) &&
+           "Background writer should flush an unpinned dirty block");
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    assert(pinned->isDirty && "Background writer should skip pinned blocks");
+
+    DiskManager reader(path);
+    std::vector<char> buf(BLOCK_SIZE, 0);
+    reader.ReadBlock(releasedId, buf.data());
+    assert(buf[0] == 'B' && "Flushed contents should be on disk");
+
+    BufferPoolFlushStats stats = pool.GetFlushStats();
+    assert(stats.pagesFlushed >= 1 && "Stats should count flushed pages");
+    assert(stats.dirtyPages == 1 && "Only the pinned block stays dirty");
+
+    pool.ReleaseBlock(pinned->block_id, true);
+  } catch (...) {
+    safe_remove(path);
+    throw;
+  }
+  safe_remove(path);
+}
+
+static void test_dirty_ratio_wakes_background_flusher() {
+  std::string path = make_temp_db_path();
+  try {
+    BufferPoolConfig config;
+    config.backgroundFlush = true;
+    config.flushInterval = std::chrono::hours(1);
+    config.dirtyRatioThreshold = 0.5;
+    BufferPool pool(4, std::make_unique<DiskManager>(path), config);
+
+    std::vector<Block *> blocks;
+    for (int i = 0; i < 3; ++i) {
+      Block *block = pool.NewBlock();
+      blocks.push_back(block);
+      pool.ReleaseBlock(block->block_id, true);
+    }
+
+    for (Block *block : blocks) {
+      assert(wait_until_clean(block) &&
+             "Crossing the dirty ratio should trigger a flush pass");
+    }
+  } catch (...) {
+    safe_remove(path);
+    throw;
+  }
+  safe_remove(path);
+}
+
+static void test_checkpoint_flushes_every_dirty_block() {
+  std::string path = make_temp_db_path();
+  try {
+    BufferPool pool(4, std::make_unique<DiskManager>(path));
+
+    Block *released = pool.NewBlock();
+    std::memset(released->data, 'R', BLOCK_SIZE);
+    pool.ReleaseBlock(released->block_id, true);
+
+    Block *pinned = pool.NewBlock();
+    std::memset(pinned->data, 'Q', BLOCK_SIZE);
+    pinned->isDirty = true;
+
+    assert(pool.GetFlushStats().dirtyPages == 2);
+    size_t written = pool.Checkpoint();
+    assert(written == 2 && "Checkpoint should write pinned and unpinned");
+    assert(!released->isDirty && !pinned->isDirty);
+
+    BufferPoolFlushStats stats = pool.GetFlushStats();
+    assert(stats.dirtyPages == 0);
+    assert(stats.checkpoints == 1);
+    assert(stats.pagesFlushed == 2);
+
+    DiskManager reader(path);
+    std::vector<char> buf(BLOCK_SIZE, 0);
+    reader.ReadBlock(pinned->block_id, buf.data());
+    assert(buf[0] == 'Q' && "Checkpoint should reach disk");
+
+    pool.ReleaseBlock(pinned->block_id, false);
+  } catch (...) {
+    safe_remove(path);
+    throw;
+  }
+  safe_remove(path);
+}
+
+// Writes `count` blocks, block i filled with 'a' + i.
+static void write_lettered_blocks(
+    const std::string &path, BlockId count,
+    const DiskManagerConfig &config = DiskManagerConfig()) {
+  DiskManager dm(path, config);
+  std::vector<char> buf(BLOCK_SIZE);
+  for (BlockId i = 0; i < count; ++i) {
+    BlockId id = dm.AllocateBlock();
+    std::memset(buf.data(), 'a' + static_cast<int>(i), BLOCK_SIZE);
+    dm.WriteBlock(id, buf.data());
+  }
+}
+
+// Overwrites blocks [first, first + count) behind the pool's back, so a
+// later FetchBlock still seeing the old letter proves the block was resident.
+static void overwrite_blocks_on_disk(const std::string &path, BlockId first,
+                                     BlockId count) {
+  DiskManager dm(path);
+  std::vector<char> buf(BLOCK_SIZE, 'Z');
+  for (BlockId id = first; id < first + count; ++id) {
+    dm.WriteBlock(id, buf.data());
+  }
+}
+
+static void test_prefetch_blocks_loads_without_pinning() {
+  std::string path = make_temp_db_path();
+  try {
+    write_lettered_blocks(path, 8);
+    BufferPool pool(8, std::make_unique<DiskManager>(path));
+
+    assert(pool.PrefetchBlocks(2, 4) == 4 && "Four reads should be issued");
+    assert(pool.PrefetchBlocks(2, 4) == 0 &&
+           "Resident blocks should not be read again");
+    assert(pool.PrefetchBlocks(6, 100) == 2 &&
+           "Prefetch should stop at the end of the file");
+    assert(pool.PrefetchBlocks(8, 4) == 0);
+    pool.WaitForPrefetches();
+
+    overwrite_blocks_on_disk(path, 2, 6);
+    for (BlockId id = 2; id < 8; ++id) {
+      Block *block = pool.FetchBlock(id);
+      assert(block->data[0] == 'a' + static_cast<int>(id) &&
+             block->data[BLOCK_SIZE - 1] == 'a' + static_cast<int>(id) &&
+             "Prefetched block should be served from the pool");
+      assert(block->referenceCount == 1 &&
+             "A completed prefetch should leave the frame unpinned");
+      pool.ReleaseBlock(id, false);
+    }
+  } catch (...) {
+    safe_remove(path);
+    throw;
+  }
+  safe_remove(path);
+}
+
+// Refuses every submission: by completing each request with the error on
+// the submitting thread, as UringIOEngine does when io_uring_enter fails,
+// or by throwing before it takes any.
+class RefusingIOEngine : public IOEngine {
+public:
+  explicit RefusingIOEngine(bool throws) : throws(throws) {}
+
+  void Submit(std::vector<IORequest> &requests) override {
+    if (this->throws) {
+      throw IOEngineException("io_uring_enter failed");
+    }
+    for (auto &request : requests) {
+      if (request.callback) {
+        request.callback(-EIO);
+      }
+    }
+  }
+  bool RegisterBuffers(const std::vector<iovec> &) override { return false; }
+  const char *Name() const override { return "refusing"; }
+
+private:
+  bool throws;
+};
+
+static void test_refused_prefetch_releases_frames() {
+  for (bool throws : {false, true}) {
+    std::string path = make_temp_db_path();
+    try {
+      write_lettered_blocks(path, 8);
+      DiskManagerConfig config;
+      config.ioEngineFactory = [throws](int) {
+        return std::make_unique<RefusingIOEngine>(throws);
+      };
+      BufferPool pool(8, std::make_unique<DiskManager>(path, config));
+
+      assert(pool.PrefetchBlocks(0, 4) == 4);
+      pool.WaitForPrefetches();
+      for (BlockId id = 0; id < 4; ++id) {
+        Block *block = pool.FetchBlock(id);
+        assert(block->data[0] == 'a' + static_cast<int>(id) &&
+               "A refused prefetch should leave the block to a normal miss");
+        assert(block->referenceCount == 1 &&
+               "A refused prefetch should not leave its frame pinned");
+        pool.ReleaseBlock(id, false);
+      }
+    } catch (...) {
+      safe_remove(path);
+      throw;
+    }
+    safe_remove(path);
+  }
+}
+
+static void test_unused_prefetch_is_evicted_before_working_set() {
+  for (auto policy : {ReplacerPolicy::LRU, ReplacerPolicy::Clock,
+                      ReplacerPolicy::LRUK, ReplacerPolicy::TwoQueue}) {
+    std::string path = make_temp_db_path();
+    try {
+      write_lettered_blocks(path, 8);
+      BufferPoolConfig config;
+      config.replacerPolicy = policy;
+      BufferPool pool(4, std::make_unique<DiskManager>(path), config);
+
+      for (BlockId id = 0; id < 3; ++id) {
+        pool.FetchBlock(id);
+        pool.ReleaseBlock(id, false);
+      }
+      assert(pool.PrefetchBlocks(5, 1) == 1);
+      pool.WaitForPrefetches();
+
+      pool.FetchBlock(6);
+      pool.ReleaseBlock(6, false);
+
+      overwrite_blocks_on_disk(path, 0, 3);
+      for (BlockId id = 0; id < 3; ++id) {
+        Block *block = pool.FetchBlock(id);
+        assert(block->data[0] == 'a' + static_cast<int>(id) &&
+               "The working set should survive an unused prefetch");
+        pool.ReleaseBlock(id, false);
+      }
+    } catch (...) {
+      safe_remove(path);
+      throw;
+    }
+    safe_remove(path);
+  }
+}
+
+static void test_sequential_fetches_trigger_readahead() {
+  std::string path = make_temp_db_path();
+  try {
+    write_lettered_blocks(path, 16);
+    BufferPoolConfig config;
+    config.readaheadBlocks = 4;
+    config.readaheadTrigger = 2;
+    BufferPool pool(16, std::make_unique<DiskManager>(path), config);
+
+    for (BlockId id = 0; id < 2; ++id) {
+      pool.FetchBlock(id);
+      pool.ReleaseBlock(id, false);
+    }
+    pool.WaitForPrefetches();
+
+    overwrite_blocks_on_disk(path, 2, 4);
+    for (BlockId id = 2; id < 6; ++id) {
+      Block *block = pool.FetchBlock(id);
+      assert(block->data[0] == 'a' + static_cast<int>(id) &&
+             "The next window should have been read ahead");
+      pool.ReleaseBlock(id, false);
+    }
+  } catch (...) {
+    safe_remove(path);
+    throw;
+  }
+  safe_remove(path);
+}
+
+// Modifies `block` under its write latch and logs the change.
+static LSN log_and_modify(LogManager &log, Block *block, char fill) {
+  block->WLatch();
+  std::memset(block->data, fill, BLOCK_SIZE);
+  LSN lsn = log.Append(&fill, 1);
+  block->pageLSN = lsn;
+  block->WUnlatch();
+  return lsn;
+}
+
+static void test_write_ahead_rule_on_every_block_write() {
+  std::string path = make_temp_db_path();
+  std::string logPath = path + ".log";
+  try {
+    LogManager log(logPath);
+    BufferPool pool(2, std::make_unique<DiskManager>(path), BufferPoolConfig(),
+                    &log);
+
+    // Eviction.
+    Block *evicted = pool.NewBlock();
+    LSN evictedLSN = log_and_modify(log, evicted, 'E');
+    pool.ReleaseBlock(evicted->block_id, true);
+    Block *pinned = pool.NewBlock();
+    assert(log.GetFlushedLSN() < evictedLSN);
+    BlockId replacement = pool.NewBlock()->block_id;
+    assert(log.GetFlushedLSN() >= evictedLSN &&
+           "Evicting a dirty block should flush the log first");
+    pool.ReleaseBlock(replacement, false);
+
+    // FlushBlock.
+    LSN flushedLSN = log_and_modify(log, pinned, 'F');
+    pool.ReleaseBlock(pinned->block_id, true);
+    assert(log.GetFlushedLSN() < flushedLSN);
+    pool.FlushBlock(pinned->block_id);
+    assert(log.GetFlushedLSN() >= flushedLSN &&
+           "FlushBlock should flush the log first");
+
+    // Checkpoint.
+    Block *checkpointed = pool.FetchBlock(pinned->block_id);
+    LSN checkpointLSN = log_and_modify(log, checkpointed, 'C');
+    checkpointed->isDirty = true;
+    assert(log.GetFlushedLSN() < checkpointLSN);
+    assert(pool.Checkpoint() == 1);
+    assert(log.GetFlushedLSN() >= checkpointLSN &&
+           "Checkpoint should flush the log first");
+    pool.ReleaseBlock(checkpointed->block_id, false);
+  } catch (...) {
+    safe_remove(path);
+    safe_remove(logPath);
+    throw;
+  }
+  safe_remove(path);
+  safe_remove(logPath);
+}
+
+static void test_page_guards_unpin_on_scope_exit() {
+  std::string path = make_temp_db_path();
+  try {
+    // One frame: every guard below must have unpinned it for the next
+    // allocation to succeed.
+    BufferPool pool(1, std::make_unique<DiskManager>(path));
+    BlockId first;
+    {
+      PageGuard guard = pool.NewPage();
+      first = guard.GetBlockId();
+      assert(guard.GetBlock()->referenceCount == 1);
+    }
+    {
+      PageGuard guard = pool.NewPage();
+      assert(guard.GetBlockId() != first);
+    }
+
+    PageGuard moved = pool.FetchPage(first);
+    PageGuard target = std::move(moved);
+    assert(!moved.IsValid() && target.IsValid() &&
+           "Moving a guard should transfer the pin");
+    target.Drop();
+    assert(!target.IsValid());
+
+    ReadPageGuard reader = pool.FetchPage(first).UpgradeRead();
+    reader = ReadPageGuard();
+    WritePageGuard writer = pool.NewPage().UpgradeWrite();
+    assert(writer.IsValid() && "Assigning over a guard should drop its pin");
+  } catch (...) {
+    safe_remove(path);
+    throw;
+  }
+  safe_remove(path);
+}
+
+static void test_write_guard_marks_dirty_and_read_guards_share() {
+  std::string path = make_temp_db_path();
+  try {
+    BufferPool pool(4, std::make_unique<DiskManager>(path));
+    BlockId id;
+    {
+      WritePageGuard writer = pool.NewPage().UpgradeWrite();
+      id = writer.GetBlockId();
+      std::span<char> data = writer.GetData();
+      assert(data.size() == static_cast<size_t>(BLOCK_SIZE));
+      std::memset(data.data(), 'G', data.size());
+      assert(pool.GetFlushStats().dirtyPages == 0 &&
+             "The page is marked dirty when the guard drops");
+    }
+    assert(pool.GetFlushStats().dirtyPages == 1 &&
+           "A write guard should mark its page dirty");
+
+    ReadPageGuard first = pool.FetchPageRead(id);
+    ReadPageGuard second = pool.FetchPageRead(id);
+    assert(first.GetData()[0] == 'G' &&
+           second.GetData()[BLOCK_SIZE - 1] == 'G' &&
+           "Read guards should share the latch and see the write");
+    first.Drop();
+    second.Drop();
+
+    pool.FlushBlock(id);
+    assert(pool.GetFlushStats().dirtyPages == 0);
+    {
+      ReadPageGuard reader = pool.FetchPageRead(id);
+    }
+    assert(pool.GetFlushStats().dirtyPages == 0 &&
+           "A read guard should not dirty its page");
+  } catch (...) {
+    safe_remove(path);
+    throw;
+  }
+  safe_remove(path);
+}
+
+static void test_frames_are_page_aligned() {
+  std::string path = make_temp_db_path();
+  try {
+    // Large enough for a huge-page arena.
+    BufferPool pool(1024, std::make_unique<DiskManager>(path));
+    for (int i = 0; i < 3; ++i) {
+      PageGuard guard = pool.NewPage();
+      assert(reinterpret_cast<uintptr_t>(guard.GetBlock()->data) % 4096 == 0 &&
+             "Frames should start on a page boundary");
+    }
+  } catch (...) {
+    safe_remove(path);
+    throw;
+  }
+  safe_remove(path);
+}
+
+static void test_mmap_backend_round_trips_changed_blocks() {
+  std::string path = make_temp_db_path();
+  try {
+    write_lettered_blocks(path, 8);
+    DiskManagerConfig diskConfig;
+    diskConfig.readBackend = DiskReadBackend::Mmap;
+    BufferPool pool(2, std::make_unique<DiskManager>(path, diskConfig));
+
+    Block *block = pool.FetchBlock(3);
+    assert(block->data[0] == 'd' && "A mapped miss should see the block");
+    std::memset(block->data, 'Q', BLOCK_SIZE);
+    pool.ReleaseBlock(3, true);
+    block = pool.FetchBlock(4);
+    std::memset(block->data, 'R', BLOCK_SIZE);
+    pool.ReleaseBlock(4, true);
+    pool.FlushBlock(4);
+
+    // Evict both: 3 is written on eviction, 4 was already written back.
+    for (BlockId id = 0; id < 2; ++id) {
+      pool.FetchBlock(id);
+      pool.ReleaseBlock(id, false);
+    }
+    block = pool.FetchBlock(3);
+    assert(block->data[BLOCK_SIZE - 1] == 'Q' &&
+           "A changed mapped block should survive eviction");
+    pool.ReleaseBlock(3, false);
+    block = pool.FetchBlock(4);
+    assert(block->data[0] == 'R');
+    pool.ReleaseBlock(4, false);
+
+    // Once evicted, no private copy may shadow the file.
+    for (BlockId id = 0; id < 2; ++id) {
+      pool.FetchBlock(id);
+      pool.ReleaseBlock(id, false);
+    }
+    overwrite_blocks_on_disk(path, 3, 2);
+    for (BlockId id = 3; id < 5; ++id) {
+      block = pool.FetchBlock(id);
+      assert(block->data[0] == 'Z' &&
+             "A mapped miss should see writes made behind the pool");
+      pool.ReleaseBlock(id, false);
+    }
+  } catch (...) {
+    safe_remove(path);
+    throw;
+  }
+  safe_remove(path);
+}
+
+static void test_direct_io_pool_round_trips_blocks() {
+  std::string path = make_temp_db_path();
+  try {
+    DiskManagerConfig diskConfig;
+    diskConfig.directIO = true;
+    BufferPool pool(4, std::make_unique<DiskManager>(path, diskConfig));
+    for (int i = 0; i < 16; ++i) {
+      WritePageGuard page = pool.NewPage().UpgradeWrite();
+      std::memset(page.GetData().data(), 'a' + i, BLOCK_SIZE);
+    }
+    assert(pool.Checkpoint() == 4 && "The resident pages go through staging");
+
+    for (BlockId id = 0; id < 16; ++id) {
+      ReadPageGuard page = pool.FetchPageRead(id);
+      assert(page.GetData()[BLOCK_SIZE - 1] == 'a' + static_cast<int>(id) &&
+             "Evicted and checkpointed pages should read back");
+    }
+
+    size_t frames = BufferPool::FramesForMemory(100 * BLOCK_SIZE);
+    assert(frames > 0 && frames < 100 &&
+           "Sizing should charge each frame for more than its page");
+    assert(BufferPool::FramesForPhysicalMemory(0.5) > 0);
+    assert(BufferPool::FramesForPhysicalMemory(0.25) <=
+           BufferPool::FramesForPhysicalMemory(0.5));
+  } catch (...) {
+    safe_remove(path);
+    throw;
+  }
+  safe_remove(path);
+}
+
+static void test_corrupted_blocks_fail_fetch() {
+  for (DiskReadBackend backend :
+       {DiskReadBackend::Pread, DiskReadBackend::Mmap}) {
+    std::string path = make_temp_db_path();
+    try {
+      DiskManagerConfig checksummed;
+      checksummed.checksums = true;
+      write_lettered_blocks(path, 6, checksummed);
+      {
+        std::fstream file(path,
+                          std::ios::in | std::ios::out | std::ios::binary);
+        file.seekp(DiskManager::HEADER_SIZE + 2 * BLOCK_SIZE + 17);
+        file.put('!');
+      }
+      DiskManagerConfig diskConfig;
+      diskConfig.readBackend = backend;
+      BufferPool pool(3, std::make_unique<DiskManager>(path, diskConfig));
+
+      // Twice: a failed load must leave no frame claiming the block.
+      for (int attempt = 0; attempt < 2; ++attempt) {
+        bool threw = false;
+        try {
+          pool.FetchBlock(2);
+        } catch (const BlockChecksumException &e) {
+          threw = e.GetBlockId() == 2;
+        }
+        assert(threw && "A corrupted block should fail to load");
+      }
+
+      pool.PrefetchBlocks(2, 1);
+      pool.WaitForPrefetches();
+      bool threw = false;
+      try {
+        pool.FetchBlock(2);
+      } catch (const BlockChecksumException &) {
+        threw = true;
+      }
+      assert(threw && "A failed prefetch should not leave the block resident");
+
+      for (BlockId id = 0; id < 6; ++id) {
+        if (id == 2) {
+          continue;
+        }
+        Block *block = pool.FetchBlock(id);
+        assert(block->data[0] == 'a' + static_cast<int>(id));
+        pool.ReleaseBlock(id, false);
+      }
+    } catch (...) {
+      safe_remove(path);
+      throw;
+    }
+    safe_remove(path);
+  }
+}
+
+static void test_compressed_pool_round_trips_blocks() {
+  std::string path = make_temp_db_path();
+  try {
+    DiskManagerConfig diskConfig;
+    diskConfig.compression = BlockCompression::Lz4;
+    BufferPool pool(4, std::make_unique<DiskManager>(path, diskConfig));
+    for (int i = 0; i < 16; ++i) {
+      WritePageGuard page = pool.NewPage().UpgradeWrite();
+      std::memset(page.GetData().data(), 'a' + i, BLOCK_SIZE);
+      page.GetData()[i] = '!';
+    }
+    // Evicted pages were written one by one, resident ones through the
+    // batched checkpoint path.
+    assert(pool.Checkpoint() == 4);
+
+    for (BlockId id = 0; id < 16; ++id) {
+      ReadPageGuard page = pool.FetchPageRead(id);
+      assert(page.GetData()[id] == '!' &&
+             page.GetData()[BLOCK_SIZE - 1] == 'a' + static_cast<int>(id) &&
+             "Frames should hold the decompressed page");
+    }
+    assert(fs::file_size(path) < 16u * BLOCK_SIZE / 4 &&
+           "Repetitive pages should be stored compressed");
+  } catch (...) {
+    safe_remove(path);
+    throw;
+  }
+  safe_remove(path);
+}
+
+static void test_pool_uses_disk_block_size() {
+  for (DiskReadBackend backend :
+       {DiskReadBackend::Pread, DiskReadBackend::Mmap}) {
+    std::string path = make_temp_db_path();
+    try {
+      DiskManagerConfig diskConfig;
+      diskConfig.readBackend = backend;
+      diskConfig.blockSize = 16384;
+      BufferPool pool(3, std::make_unique<DiskManager>(path, diskConfig));
+      assert(pool.GetBlockSize() == 16384u);
+      for (int i = 0; i < 8; ++i) {
+        WritePageGuard page = pool.NewPage().UpgradeWrite();
+        assert(page.GetData().size() == 16384u &&
+               "Pages should span the disk's block size");
+        std::memset(page.GetData().data(), 'a' + i, 16384);
+      }
+      assert(pool.Checkpoint() == 3);
+
+      for (BlockId id = 0; id < 8; ++id) {
+        ReadPageGuard page = pool.FetchPageRead(id);
+        assert(page.GetData()[0] == 'a' + static_cast<int>(id) &&
+               page.GetData()[16383] == 'a' + static_cast<int>(id) &&
+               "Whole blocks should survive eviction");
+      }
+    } catch (...) {
+      safe_remove(path);
+      throw;
+    }
+    safe_remove(path);
+  }
+}
+
+static void test_delete_block_discards_frame_and_frees_block() {
+  std::string path = make_temp_db_path();
+  try {
+    BufferPool pool(4, std::make_unique<DiskManager>(path));
+    for (int i = 0; i < 3; ++i) {
+      Block *block = pool.NewBlock();
+      std::memset(block->data, 'D', BLOCK_SIZE);
+      pool.ReleaseBlock(block->block_id, true);
+    }
+
+    Block *pinned = pool.FetchBlock(1);
+    bool threw = false;
+    try {
+      pool.DeleteBlock(1);
+    } catch (const BufferPoolException &) {
+      threw = true;
+    }
+    assert(threw && "A pinned block should not be deleted");
+    pool.ReleaseBlock(pinned->block_id, false);
+
+    pool.DeleteBlock(1);
+    assert(pool.GetFlushStats().dirtyPages == 2 &&
+           "A deleted block should not be written back");
+    Block *reused = pool.NewBlock();
+    assert(reused->block_id == 1u && "The freed block should be reused");
+    assert(reused->data[0] == 0 && reused->data[BLOCK_SIZE - 1] == 0 &&
+           "A reused block should start zeroed");
+    pool.ReleaseBlock(1, false);
+  } catch (...) {
+    safe_remove(path);
+    throw;
+  }
+  safe_remove(path);
+}
+
+static void test_peek_block_sees_frame_reuse() {
+  std::string path = make_temp_db_path();
+  try {
+    BufferPool pool(2, std::make_unique<DiskManager>(path));
+    for (int i = 0; i < 2; ++i) {
+      Block *block = pool.NewBlock();
+      std::memset(block->data, 'a' + i, BLOCK_SIZE);
+      pool.ReleaseBlock(block->block_id, true);
+    }
+    uint64_t hits = pool.GetStats().hits;
+
+    uint64_t version;
+    Block *peeked = pool.PeekBlock(0, version);
+    assert(peeked != nullptr && peeked->block_id == 0u &&
+           peeked->data[0] == 'a' && "A resident block should be found");
+    assert((version & 1) == 0 && peeked->referenceCount == 0 &&
+           "A peek should neither pin nor report a writer");
+    assert(pool.GetStats().hits == hits && "A peek is not a fetch");
+    uint64_t unused;
+    assert(pool.PeekBlock(7, unused) == nullptr);
+
+    // Reusing the frame moves its version, so the reader can tell.
+    for (int i = 0; i < 2; ++i) {
+      pool.ReleaseBlock(pool.NewBlock()->block_id, false);
+    }
+    assert(peeked->version.load() != version &&
+           "Evicting the block should move its frame's version");
+    assert(pool.PeekBlock(0, unused) == nullptr);
+
+    Block *fresh = pool.PeekBlock(3, version);
+    assert(fresh != nullptr && fresh->block_id == 3u);
+    pool.DeleteBlock(3);
+    assert(fresh->version.load() != version &&
+           "Deleting the block should move its frame's version");
+    assert(pool.PeekBlock(3, unused) == nullptr);
+  } catch (...) {
+    safe_remove(path);
+    throw;
+  }
+  safe_remove(path);
+}
+
+static void test_concurrent_fetch_release_stress() {
+  std::string path = make_temp_db_path();
+  try {
+    constexpr size_t threadCount = 8;
+    constexpr size_t blockCount = 64;
+    constexpr size_t opsPerThread = 4000;
+
+    auto dm = std::make_unique<DiskManager>(path);
+    for (size_t i = 0; i < blockCount; ++i) {
+      dm->AllocateBlock();
+    }
+
+    BufferPoolConfig config;
+    config.shardCount = 4;
+    BufferPool pool(16, std::move(dm), config);
+
+    std::atomic<bool> wrongBlock{false};
+    std::vector<std::thread> workers;
+    for (size_t t = 0; t < threadCount; ++t) {
+      workers.emplace_back([&pool, &wrongBlock, t]() {
+        std::mt19937 eng(static_cast<unsigned>(t));
+        std::uniform_int_distribution<BlockId> pick(0, blockCount - 1);
+        for (size_t op = 0; op < opsPerThread; ++op) {
+          BlockId id = pick(eng);
+          Block *block = pool.FetchBlock(id);
+          if (block->block_id != id) {
+            wrongBlock = true;
+          }
+
+          // Slot 0 stamps the owning block id, slot 1 counts increments.
+          block->WLatch();
+          uint64_t header[2];
+          std::memcpy(header, block->data, sizeof(header));
+          if (header[1] != 0 && header[0] != id) {
+            wrongBlock = true;
+          }
+          header[0] = id;
+          header[1]++;
+          std::memcpy(block->data, header, sizeof(header));
+          block->WUnlatch();
+
+          pool.ReleaseBlock(id, true);
+        }
+      });
+    }
+    for (auto &worker : workers) {
+      worker.join();
+    }
+    assert(!wrongBlock && "Every fetch should return the requested block");
+
+    uint64_t total = 0;
+    for (BlockId id = 0; id < blockCount; ++id) {
+      Block *block = pool.FetchBlock(id);
+      block->RLatch();
+      uint64_t header[2];
+      std::memcpy(header, block->data, sizeof(header));
+      block->RUnlatch();
+      total += header[1];
+      pool.ReleaseBlock(id, false);
+    }
+    assert(total == threadCount * opsPerThread &&
+           "No increment should be lost across concurrent evictions");
+  } catch (...) {
+    safe_remove(path);
+    throw;
+  }
+  safe_remove(path);
+}
+
 int main() {
   std::cout << "Running BufferPool unit tests...\n";
 
@@ -362,6 +1171,66 @@ int main() {
   test_multiple_blocks_lru_eviction();
   std::cout << " - multiple blocks LRU eviction test passed\n";
 
+  test_every_replacer_policy_round_trips_dirty_blocks();
+  std::cout << " - every replacer policy round trips dirty blocks test passed\n";
+
+  test_background_flusher_writes_unpinned_dirty_blocks();
+  std::cout << " - background flusher writes unpinned dirty blocks test passed\n";
+
+  test_dirty_ratio_wakes_background_flusher();
+  std::cout << " - dirty ratio wakes background flusher test passed\n";
+
+  test_checkpoint_flushes_every_dirty_block();
+  std::cout << " - checkpoint flushes every dirty block test passed\n";
+
+  test_prefetch_blocks_loads_without_pinning();
+  std::cout << " - prefetch blocks loads without pinning test passed\n";
+
+  test_refused_prefetch_releases_frames();
+  std::cout << " - refused prefetch releases frames test passed\n";
+
+  test_unused_prefetch_is_evicted_before_working_set();
+  std::cout << " - unused prefetch is evicted before working set test passed\n";
+
+  test_sequential_fetches_trigger_readahead();
+  std::cout << " - sequential fetches trigger readahead test passed\n";
+
+  test_write_ahead_rule_on_every_block_write();
+  std::cout << " - write-ahead rule on every block write test passed\n";
+
+  test_page_guards_unpin_on_scope_exit();
+  std::cout << " - page guards unpin on scope exit test passed\n";
+
+  test_write_guard_marks_dirty_and_read_guards_share();
+  std::cout << " - write guard marks dirty and read guards share test passed\n";
+
+  test_frames_are_page_aligned();
+  std::cout << " - frames are page aligned test passed\n";
+
+  test_mmap_backend_round_trips_changed_blocks();
+  std::cout << " - mmap backend round trips changed blocks test passed\n";
+
+  test_direct_io_pool_round_trips_blocks();
+  std::cout << " - direct I/O pool round trips blocks test passed\n";
+
+  test_corrupted_blocks_fail_fetch();
+  std::cout << " - corrupted blocks fail fetch test passed\n";
+
+  test_compressed_pool_round_trips_blocks();
+  std::cout << " - compressed pool round trips blocks test passed\n";
+
+  test_pool_uses_disk_block_size();
+  std::cout << " - pool uses disk block size test passed\n";
+
+  test_delete_block_discards_frame_and_frees_block();
+  std::cout << " - delete block discards frame and frees block test passed\n";
+
+  test_peek_block_sees_frame_reuse();
+  std::cout << " - peek block sees frame reuse test passed\n";
+
+  test_concurrent_fetch_release_stress();
+  std::cout << " - concurrent fetch/release stress test passed\n";
+
   std::cout << "All BufferPool tests passed.\n";
   return 0;
 }
\ No newline at end of file
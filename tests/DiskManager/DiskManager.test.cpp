@@ -1,38 +1,24 @@
 #include "../../src/models/DiskManager/DiskManager.hpp"
+#include "../common/TempPath.hpp"
 
+#include <algorithm>
+#include <atomic>
 #include <cassert>
 #include <chrono>
+#include <cstdint>
 #include <cstring>
 #include <filesystem>
+#include <fstream>
 #include <iostream>
 #include <random>
 #include <string>
 #include <system_error>
+#include <thread>
+#include <vector>
 
 using namespace std::string_literals;
 namespace fs = std::filesystem;
 
-static std::string make_temp_db_path() {
-
-  auto tmp = fs::temp_directory_path();
-  auto now =
-      std::chrono::high_resolution_clock::now().time_since_epoch().count();
-  std::random_device rd;
-  std::mt19937_64 eng(rd());
-  std::uniform_int_distribution<uint64_t> dist;
-  uint64_t r = dist(eng);
-  std::string filename = "keyval_test_diskmanager_" + std::to_string(now) +
-                         "_" + std::to_string(r) + ".db";
-  return (tmp / filename).string();
-}
-
-static void safe_remove(const std::string &path) {
-  std::error_code ec;
-  fs::remove(path, ec);
-
-  (void)ec;
-}
-
 static void test_allocate_and_increment_block_ids() {
   std::string path = make_temp_db_path();
   try {
@@ -56,6 +42,158 @@ static void test_allocate_and_increment_block_ids() {
   safe_remove(path);
 }
 
+static void test_bulk_allocation_grows_file_in_extents() {
+  std::string path = make_temp_db_path();
+  try {
+    DiskManagerConfig config;
+    config.growthBlocks = 64;
+    {
+      DiskManager dm(path, config);
+      assert(dm.AllocateBlock() == 0u);
+      assert(fs::file_size(path) ==
+                 DiskManager::HEADER_SIZE + 64u * BLOCK_SIZE &&
+             "The first allocation should reserve a whole extent");
+      assert(dm.AllocateBlocks(10) == 1u && dm.GetBlockCount() == 11u);
+      assert(dm.AllocateBlocks(100) == 11u &&
+             "A run longer than an extent should still be consecutive");
+      assert(fs::file_size(path) >=
+             DiskManager::HEADER_SIZE + 111u * BLOCK_SIZE);
+
+      std::vector<char> buf(BLOCK_SIZE, 'x');
+      dm.ReadBlock(110, buf.data());
+      assert(buf[0] == 0 && buf[BLOCK_SIZE - 1] == 0 &&
+             "New blocks should read as zeros");
+      bool threw = false;
+      try {
+        dm.ReadBlock(111, buf.data());
+      } catch (const DiskManagerException &) {
+        threw = true;
+      }
+      assert(threw && "Reserved but unallocated blocks stay unreadable");
+
+      std::vector<std::thread> threads;
+      std::vector<std::vector<BlockId>> ids(4);
+      for (size_t t = 0; t < ids.size(); ++t) {
+        threads.emplace_back([&dm, &ids, t]() {
+          for (int i = 0; i < 500; ++i) {
+            ids[t].push_back(dm.AllocateBlock());
+          }
+        });
+      }
+      for (auto &thread : threads) {
+        thread.join();
+      }
+      std::vector<BlockId> all;
+      for (const auto &perThread : ids) {
+        all.insert(all.end(), perThread.begin(), perThread.end());
+      }
+      std::sort(all.begin(), all.end());
+      for (size_t i = 0; i < all.size(); ++i) {
+        assert(all[i] == 111 + i && "Concurrent ids should be unique");
+      }
+    }
+    assert(fs::file_size(path) ==
+               DiskManager::HEADER_SIZE + 2111u * BLOCK_SIZE &&
+           "Closing should trim the unused end of the extent");
+    DiskManager reopened(path, config);
+    assert(reopened.GetBlockCount() == 2111u);
+    assert(reopened.AllocateBlock() == 2111u);
+  } catch (...) {
+    safe_remove(path);
+    throw;
+  }
+  safe_remove(path);
+}
+
+static void test_crash_does_not_count_reserved_blocks() {
+  std::string path = make_temp_db_path();
+  std::string image = make_temp_db_path();
+  try {
+    DiskManagerConfig config;
+    config.growthBlocks = 64;
+    DiskManager dm(path, config);
+    dm.AllocateBlocks(3);
+    BlockId last = dm.AllocateBlock();
+    std::vector<char> buf(BLOCK_SIZE, 'w');
+    dm.WriteBlock(last, buf.data());
+    dm.AllocateBlock();
+    assert(DiskManager::ReadHeader(path).blockCount == 0 &&
+           "Allocations inside an extent should not write the header");
+    // A copy of the open file stands in for a crash: nothing is trimmed.
+    fs::copy_file(path, image);
+    assert(fs::file_size(image) ==
+           DiskManager::HEADER_SIZE + 64u * BLOCK_SIZE);
+
+    {
+      DiskManager recovered(image, config);
+      assert(recovered.GetBlockCount() == 4u &&
+             "Blocks past the last one written should not survive a crash");
+      assert(recovered.AllocateBlock() == 4u &&
+             "The reserved blocks should be handed out again");
+    }
+    safe_remove(image);
+
+    dm.SyncFile();
+    fs::copy_file(path, image);
+    DiskManager synced(image, config);
+    assert(synced.GetBlockCount() == 5u &&
+           "Blocks handed out before a sync should survive a crash");
+  } catch (...) {
+    safe_remove(path);
+    safe_remove(image);
+    throw;
+  }
+  safe_remove(path);
+  safe_remove(image);
+}
+
+static void test_freed_blocks_are_reused_near_hint() {
+  std::string path = make_temp_db_path();
+  try {
+    {
+      DiskManager dm(path);
+      dm.AllocateBlocks(200);
+      for (BlockId id : {10u, 100u, 150u, 199u}) {
+        dm.DeallocateBlock(id);
+      }
+      assert(dm.GetFreeBlockCount() == 4u);
+
+      assert(dm.AllocateBlock(140) == 150u && "Nearest free block above");
+      assert(dm.AllocateBlock(105) == 100u && "Nearest free block below");
+      assert(dm.AllocateBlock() == 10u && "Without a hint, the lowest");
+      assert(dm.GetFreeBlockCount() == 1u);
+
+      bool threw = false;
+      try {
+        dm.DeallocateBlock(10);
+        dm.DeallocateBlock(10);
+      } catch (const DiskManagerException &) {
+        threw = true;
+      }
+      assert(threw && "Freeing a block twice should throw");
+      threw = false;
+      try {
+        dm.DeallocateBlock(200);
+      } catch (const DiskManagerException &) {
+        threw = true;
+      }
+      assert(threw && "Freeing an unallocated block should throw");
+    }
+
+    // Free blocks 10 and 199 persist; 199 is trimmed off the end on close.
+    DiskManager reopened(path);
+    assert(reopened.GetBlockCount() == 199u &&
+           "Free blocks at the end should be trimmed");
+    assert(reopened.GetFreeBlockCount() == 1u);
+    assert(reopened.AllocateBlock() == 10u && "The free map should persist");
+    assert(reopened.AllocateBlock() == 199u);
+  } catch (...) {
+    safe_remove(path);
+    throw;
+  }
+  safe_remove(path);
+}
+
 static void test_write_and_read_block_contents() {
   std::string path = make_temp_db_path();
   try {
@@ -145,12 +283,678 @@ static void test_null_buffer_throws() {
   safe_remove(path);
 }
 
+static void test_concurrent_read_write_throughput() {
+  std::string path = make_temp_db_path();
+  try {
+    DiskManager dm(path);
+
+    constexpr size_t maxThreads = 8;
+    constexpr size_t blocksPerThread = 16;
+    constexpr size_t opsPerThread = 2000;
+    for (size_t i = 0; i < maxThreads * blocksPerThread; ++i) {
+      dm.AllocateBlock();
+    }
+
+    for (size_t threadCount = 1; threadCount <= maxThreads; threadCount *= 2) {
+      std::atomic<bool> mismatch{false};
+      auto start = std::chrono::steady_clock::now();
+
+      std::vector<std::thread> workers;
+      for (size_t t = 0; t < threadCount; ++t) {
+        workers.emplace_back([&dm, &mismatch, t]() {
+          std::vector<char> write_buf(BLOCK_SIZE);
+          std::vector<char> read_buf(BLOCK_SIZE);
+          for (size_t op = 0; op < opsPerThread; ++op) {
+            BlockId id =
+                static_cast<BlockId>(t * blocksPerThread + op % blocksPerThread);
+            std::memset(write_buf.data(), static_cast<int>((t + op) & 0xFF),
+                        BLOCK_SIZE);
+            dm.WriteBlock(id, write_buf.data());
+            dm.ReadBlock(id, read_buf.data());
+            if (std::memcmp(write_buf.data(), read_buf.data(), BLOCK_SIZE) !=
+                0) {
+              mismatch = true;
+            }
+          }
+        });
+      }
+      for (auto &worker : workers) {
+        worker.join();
+      }
+
+      auto elapsed = std::chrono::duration<double>(
+                         std::chrono::steady_clock::now() - start)
+                         .count();
+      assert(!mismatch && "Concurrent read should observe the thread's write");
+
+      double opsPerSec =
+          static_cast<double>(threadCount * opsPerThread * 2) / elapsed;
+      std::cout << "   " << threadCount << " thread(s): "
+                << static_cast<long long>(opsPerSec) << " block ops/sec\n";
+    }
+  } catch (...) {
+    safe_remove(path);
+    throw;
+  }
+  safe_remove(path);
+}
+
+static void test_async_read_write() {
+  std::string path = make_temp_db_path();
+  try {
+    DiskManager dm(path);
+
+    constexpr size_t blocks = 64;
+    for (size_t i = 0; i < blocks; ++i) {
+      dm.AllocateBlock();
+    }
+
+    std::vector<char> write_buf(blocks * BLOCK_SIZE);
+    std::vector<std::future<void>> writes;
+    for (size_t i = 0; i < blocks; ++i) {
+      std::memset(write_buf.data() + i * BLOCK_SIZE, static_cast<int>(i + 1),
+                  BLOCK_SIZE);
+      writes.push_back(dm.WriteBlockAsync(static_cast<BlockId>(i),
+                                          write_buf.data() + i * BLOCK_SIZE));
+    }
+    for (auto &write : writes) {
+      write.get();
+    }
+
+    std::vector<char> read_buf(blocks * BLOCK_SIZE, 0);
+    std::atomic<size_t> completed{0};
+    std::atomic<size_t> failed{0};
+    std::vector<BlockIORequest> batch;
+    for (size_t i = 0; i < blocks; ++i) {
+      batch.push_back(BlockIORequest{
+          IOOperation::Read, static_cast<BlockId>(i),
+          read_buf.data() + i * BLOCK_SIZE, [&](int result) {
+            if (result != 0) {
+              failed++;
+            }
+            completed++;
+            completed.notify_all();
+          }});
+    }
+    dm.SubmitBatch(batch);
+    for (size_t seen = completed.load(); seen < blocks;
+         seen = completed.load()) {
+      completed.wait(seen);
+    }
+
+    assert(failed == 0 && "Batched reads should succeed");
+    assert(std::memcmp(write_buf.data(), read_buf.data(), write_buf.size()) ==
+               0 &&
+           "Async reads should return async writes");
+
+    std::vector<char> single(BLOCK_SIZE, 0);
+    dm.ReadBlockAsync(3u, single.data()).get();
+    assert(single[0] == 4 && "ReadBlockAsync should load block contents");
+
+    bool threw = false;
+    try {
+      dm.ReadBlockAsync(static_cast<BlockId>(blocks), single.data()).get();
+    } catch (const DiskManagerException &) {
+      threw = true;
+    }
+    assert(threw && "Async read of unallocated block should throw");
+  } catch (...) {
+    safe_remove(path);
+    throw;
+  }
+  safe_remove(path);
+}
+
+static void test_mmap_backend_maps_blocks_in_place() {
+  std::string path = make_temp_db_path();
+  try {
+    DiskManagerConfig config;
+    config.readBackend = DiskReadBackend::Mmap;
+    config.mmapWindowBytes = DiskManager::HEADER_SIZE + 8 * BLOCK_SIZE;
+    DiskManager dm(path, config);
+    assert(dm.MappedBlock(0) == nullptr && "Unallocated blocks are not mapped");
+
+    for (int i = 0; i < 9; ++i) {
+      dm.AllocateBlock();
+    }
+    std::vector<char> buf(BLOCK_SIZE, 'A');
+    dm.WriteBlock(1, buf.data());
+    char *view = dm.MappedBlock(1);
+    assert(view != nullptr && view[0] == 'A' && view[BLOCK_SIZE - 1] == 'A' &&
+           "The mapping should show the block's contents");
+
+    std::memset(buf.data(), 'B', BLOCK_SIZE);
+    dm.WriteBlock(1, buf.data());
+    assert(view[0] == 'B' && "The mapping should track later writes");
+
+    view[0] = 'X';
+    dm.ReadBlock(1, buf.data());
+    assert(buf[0] == 'B' && "Writing through the mapping must not reach disk");
+    dm.DropMappedBlock(1);
+    assert(view[0] == 'B' && "Dropping the block should discard the copy");
+
+    assert(dm.MappedBlock(7) != nullptr);
+    assert(dm.MappedBlock(8) == nullptr &&
+           "Blocks past the window should not be mapped");
+
+    DiskManager preadOnly(path);
+    assert(preadOnly.MappedBlock(1) == nullptr &&
+           "The pread backend maps nothing");
+  } catch (...) {
+    safe_remove(path);
+    throw;
+  }
+  safe_remove(path);
+}
+
+static void test_direct_io_bounces_unaligned_buffers() {
+  std::string path = make_temp_db_path();
+  try {
+    DiskManagerConfig config;
+    config.directIO = true;
+    // The filesystem may refuse O_DIRECT; every buffer must work either way.
+    DiskManager dm(path, config);
+    for (int i = 0; i < 4; ++i) {
+      dm.AllocateBlock();
+    }
+
+    std::vector<char> raw(3 * BLOCK_SIZE);
+    char *aligned = raw.data() + (DiskManager::DIRECT_IO_ALIGNMENT -
+                                  reinterpret_cast<uintptr_t>(raw.data()) %
+                                      DiskManager::DIRECT_IO_ALIGNMENT);
+    char *unaligned = aligned + BLOCK_SIZE + 1;
+
+    std::memset(unaligned, 'U', BLOCK_SIZE);
+    dm.WriteBlock(0, unaligned);
+    std::memset(aligned, 'A', BLOCK_SIZE);
+    dm.WriteBlock(1, aligned);
+
+    dm.ReadBlock(0, aligned);
+    assert(aligned[0] == 'U' && aligned[BLOCK_SIZE - 1] == 'U' &&
+           "An unaligned write should land intact");
+    dm.ReadBlock(1, unaligned);
+    assert(unaligned[0] == 'A' && unaligned[BLOCK_SIZE - 1] == 'A' &&
+           "An unaligned read should return the block");
+
+    std::memset(unaligned, 'W', BLOCK_SIZE);
+    dm.WriteBlockAsync(2, unaligned).get();
+    std::memset(unaligned, 0, BLOCK_SIZE);
+    dm.ReadBlockAsync(2, unaligned).get();
+    assert(unaligned[0] == 'W' && unaligned[BLOCK_SIZE - 1] == 'W' &&
+           "Async I/O should bounce unaligned buffers too");
+
+    bool threw = false;
+    try {
+      config.readBackend = DiskReadBackend::Mmap;
+      DiskManager mapped(path, config);
+    } catch (const DiskManagerException &) {
+      threw = true;
+    }
+    assert(threw && "Direct I/O and the mmap backend should be exclusive");
+  } catch (...) {
+    safe_remove(path);
+    throw;
+  }
+  safe_remove(path);
+}
+
+// `offset` counts from the end of the file header.
+static void corrupt_byte(const std::string &path, long long offset) {
+  offset += static_cast<long long>(DiskManager::HEADER_SIZE);
+  std::fstream file(path, std::ios::in | std::ios::out | std::ios::binary);
+  file.seekg(offset);
+  char byte = static_cast<char>(file.get());
+  file.seekp(offset);
+  file.put(static_cast<char>(byte ^ 0x20));
+}
+
+static void test_checksums_detect_corrupted_blocks() {
+  std::string path = make_temp_db_path();
+  try {
+    std::vector<char> buf(BLOCK_SIZE);
+    {
+      DiskManagerConfig config;
+      config.checksums = true;
+      DiskManager dm(path, config);
+      assert(dm.GetPayloadSize() == BLOCK_SIZE - DiskManager::TRAILER_SIZE);
+      for (int i = 0; i < 300; ++i) {
+        BlockId id = dm.AllocateBlock();
+        std::fill(buf.begin(), buf.end(), static_cast<char>('a' + i % 26));
+        // The last block is left unwritten, so it has no checksum.
+        if (i < 299) {
+          dm.WriteBlock(id, buf.data());
+        }
+      }
+    }
+    corrupt_byte(path, 7LL * BLOCK_SIZE + 100);
+    corrupt_byte(path, 250LL * BLOCK_SIZE + BLOCK_SIZE - 1);
+
+    // Reopened with checksums, as the header records.
+    DiskManager dm(path);
+    dm.ReadBlock(6, buf.data());
+    dm.ReadBlock(299, buf.data());
+
+    bool threw = false;
+    try {
+      dm.ReadBlock(7, buf.data());
+    } catch (const BlockChecksumException &e) {
+      threw = e.GetBlockId() == 7;
+    }
+    assert(threw && "A corrupted block should fail its checksum on read");
+
+    threw = false;
+    try {
+      dm.ReadBlockAsync(250, buf.data()).get();
+    } catch (const BlockChecksumException &e) {
+      threw = e.GetBlockId() == 250;
+    }
+    assert(threw && "Async reads should verify checksums too");
+
+    assert((dm.Scrub(3) == std::vector<BlockId>{7, 250}) &&
+           "The scrubber should find every corrupted block");
+
+    std::fill(buf.begin(), buf.end(), 'z');
+    dm.WriteBlock(7, buf.data());
+    dm.WriteBlockAsync(250, buf.data()).get();
+    std::vector<char> stamped = buf;
+    dm.ReadBlock(7, buf.data());
+    dm.ReadBlock(250, buf.data());
+    assert(buf == stamped &&
+           "An async write should stamp the trailer in its own buffer");
+    assert(dm.Scrub(1).empty() && "Rewriting a block should restamp it");
+
+    corrupt_byte(path, 7LL * BLOCK_SIZE);
+    dm.DeallocateBlock(7);
+    BlockId reused = dm.AllocateBlock(7);
+    assert(reused == 7u);
+    dm.ReadBlock(reused, buf.data());
+  } catch (...) {
+    safe_remove(path);
+    throw;
+  }
+
+  try {
+    DiskManagerConfig config;
+    config.checksums = false;
+    DiskManager dm(path, config);
+    assert(dm.GetPayloadSize() == BLOCK_SIZE - DiskManager::TRAILER_SIZE &&
+           "A database keeps the trailers it was created with");
+    corrupt_byte(path, 6LL * BLOCK_SIZE);
+    assert(dm.Scrub(2) == std::vector<BlockId>{6});
+  } catch (...) {
+    safe_remove(path);
+    throw;
+  }
+  safe_remove(path);
+
+  try {
+    DiskManager dm(path);
+    assert(dm.GetPayloadSize() == BLOCK_SIZE &&
+           "Without checksums callers should own whole blocks");
+    std::vector<char> buf(BLOCK_SIZE, 'q');
+    dm.WriteBlock(dm.AllocateBlock(), buf.data());
+    corrupt_byte(path, BLOCK_SIZE - 1);
+    dm.ReadBlock(0, buf.data());
+    assert(buf.back() == ('q' ^ 0x20) && buf.front() == 'q' &&
+           "Blocks without checksums should be read back unverified");
+    assert(dm.Scrub(2).empty());
+    assert(DiskManager::ReadHeader(path).blockFormat ==
+           DiskManager::PLAIN_BLOCK_FORMAT);
+  } catch (...) {
+    safe_remove(path);
+    throw;
+  }
+  safe_remove(path);
+}
+
+// Blocks read back match what was written up to their trailer.
+static bool same_payload(const std::vector<char> &a,
+                         const std::vector<char> &b) {
+  return a.size() == b.size() &&
+         std::equal(a.begin(), a.end() - DiskManager::TRAILER_SIZE, b.begin());
+}
+
+// A page of similar rows, the kind of data that compresses a few times.
+static void fill_with_rows(std::vector<char> &buf, int seed) {
+  std::string rows;
+  for (int i = 0; rows.size() < buf.size(); ++i) {
+    rows += "row:" + std::to_string(seed * 1000 + i) + "|state=ok|";
+  }
+  std::memcpy(buf.data(), rows.data(), buf.size());
+}
+
+static void test_compressed_blocks_round_trip() {
+  std::string path = make_temp_db_path();
+  try {
+    DiskManagerConfig config;
+    config.compression = BlockCompression::Lz4;
+    config.checksums = true;
+    std::vector<char> buf(BLOCK_SIZE);
+    std::vector<char> random(BLOCK_SIZE);
+    std::mt19937 eng(9);
+    for (char &byte : random) {
+      byte = static_cast<char>(eng());
+    }
+    {
+      DiskManager dm(path, config);
+      assert(dm.UsesCompression());
+      for (int i = 0; i < 64; ++i) {
+        BlockId id = dm.AllocateBlock();
+        fill_with_rows(buf, i);
+        dm.WriteBlock(id, buf.data());
+      }
+      dm.AllocateBlock();
+      dm.WriteBlock(10, random.data());
+      // Grows from a compressed extent into a whole one and back.
+      dm.WriteBlock(11, random.data());
+      fill_with_rows(buf, 11);
+      dm.WriteBlock(11, buf.data());
+      dm.WriteBlockAsync(12, random.data()).get();
+      dm.SyncFile();
+    }
+    assert(fs::file_size(path) < 30u * BLOCK_SIZE &&
+           "65 blocks of rows should take a fraction of their size");
+
+    DiskManager dm(path, config);
+    assert(dm.GetBlockCount() == 65u &&
+           "The block count should survive a reopen");
+    std::vector<char> expected(BLOCK_SIZE);
+    for (BlockId id = 0; id < 64; ++id) {
+      dm.ReadBlock(id, buf.data());
+      if (id == 10 || id == 12) {
+        assert(same_payload(buf, random) &&
+               "Incompressible blocks should be stored");
+        continue;
+      }
+      fill_with_rows(expected, static_cast<int>(id));
+      assert(same_payload(buf, expected));
+    }
+    dm.ReadBlockAsync(64, buf.data()).get();
+    assert(std::all_of(buf.begin(), buf.end(), [](char c) { return c == 0; }) &&
+           "A block never written should read as zeros");
+    dm.ReadBlockAsync(5, buf.data()).get();
+    fill_with_rows(expected, 5);
+    assert(same_payload(buf, expected) && "Async reads should decompress");
+
+    // A freed block's extent goes to the next block that needs one.
+    auto size = fs::file_size(path);
+    dm.DeallocateBlock(10);
+    BlockId id = dm.AllocateBlocks(1);
+    dm.WriteBlock(id, random.data());
+    assert(fs::file_size(path) == size && "The freed extent should be reused");
+
+    corrupt_byte(path, 40);
+    assert(dm.Scrub(2) == std::vector<BlockId>{0});
+
+    bool threw = false;
+    try {
+      DiskManager plain(path);
+    } catch (const DiskManagerException &) {
+      threw = true;
+    }
+    assert(threw && "A compressed database needs compression to open");
+  } catch (...) {
+    safe_remove(path);
+    throw;
+  }
+  safe_remove(path);
+}
+
+static void test_overlapping_compressed_writes_keep_extents_apart() {
+  std::string path = make_temp_db_path();
+  try {
+    DiskManagerConfig config;
+    config.compression = BlockCompression::Lz4;
+    config.checksums = true;
+    std::vector<char> rows(BLOCK_SIZE);
+    std::vector<char> random(BLOCK_SIZE);
+    std::vector<char> neighbour(BLOCK_SIZE);
+    fill_with_rows(rows, 1);
+    fill_with_rows(neighbour, 2);
+    std::mt19937 eng(5);
+    for (char &byte : random) {
+      byte = static_cast<char>(eng());
+    }
+
+    DiskManager dm(path, config);
+    dm.AllocateBlocks(2);
+    // Two threads move block 0 between extent sizes over each other while
+    // a third rewrites block 1. Were an extent released twice, block 1
+    // would be handed one block 0 still writes to.
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 2; ++t) {
+      threads.emplace_back([&dm, &rows, &random, t]() {
+        std::vector<char> buf(BLOCK_SIZE);
+        for (int i = 0; i < 500; ++i) {
+          buf = (i + t) % 2 == 0 ? rows : random;
+          if (i % 3 == 0) {
+            dm.WriteBlockAsync(0, buf.data()).get();
+          } else {
+            dm.WriteBlock(0, buf.data());
+          }
+        }
+      });
+    }
+    threads.emplace_back([&dm, &neighbour]() {
+      std::vector<char> buf(BLOCK_SIZE);
+      for (int i = 0; i < 500; ++i) {
+        buf = neighbour;
+        dm.WriteBlock(1, buf.data());
+      }
+    });
+    for (auto &thread : threads) {
+      thread.join();
+    }
+
+    std::vector<char> buf(BLOCK_SIZE);
+    dm.ReadBlock(1, buf.data());
+    assert(same_payload(buf, neighbour) &&
+           "Block 1 should not share an extent with block 0");
+    dm.ReadBlock(0, buf.data());
+    assert((same_payload(buf, rows) || same_payload(buf, random)) &&
+           "Block 0 should hold one of the writes made to it");
+    assert(fs::file_size(path) < 8u * BLOCK_SIZE &&
+           "The extents of superseded writes should be reused");
+  } catch (...) {
+    safe_remove(path);
+    throw;
+  }
+  safe_remove(path);
+}
+
+static void test_block_size_is_recorded_in_header() {
+  std::string path = make_temp_db_path();
+  try {
+    DiskManagerConfig config;
+    config.blockSize = 16384;
+    std::vector<char> buf(config.blockSize);
+    {
+      DiskManager dm(path, config);
+      assert(dm.GetBlockSize() == 16384u);
+      for (int i = 0; i < 8; ++i) {
+        BlockId id = dm.AllocateBlock();
+        std::fill(buf.begin(), buf.end(), static_cast<char>('a' + i));
+        buf.back() = static_cast<char>('A' + i);
+        dm.WriteBlock(id, buf.data());
+      }
+      dm.WriteBlockAsync(3, buf.data()).get();
+    }
+    assert(fs::file_size(path) == DiskManager::HEADER_SIZE + 8u * 16384 &&
+           "Blocks should be laid out at the configured size");
+    DatabaseHeader header = DiskManager::ReadHeader(path);
+    assert(header.blockSize == 16384u &&
+           header.compression == BlockCompression::None &&
+           header.blockFormat == DiskManager::PLAIN_BLOCK_FORMAT);
+
+    bool threw = false;
+    try {
+      DiskManager defaults(path);
+    } catch (const DiskManagerException &) {
+      threw = true;
+    }
+    assert(threw && "Opening with another block size should throw");
+
+    DiskManager dm(path, config);
+    dm.ReadBlock(5, buf.data());
+    assert(buf[0] == 'f' && buf[16383] == 'F');
+    dm.ReadBlockAsync(3, buf.data()).get();
+    assert(buf[0] == 'h' && buf[16383] == 'H' &&
+           "Async I/O should move whole blocks");
+    assert(dm.Scrub(2).empty());
+  } catch (...) {
+    safe_remove(path);
+    throw;
+  }
+  safe_remove(path);
+
+  for (size_t blockSize : {size_t{2048}, size_t{12288}, size_t{131072}}) {
+    DiskManagerConfig config;
+    config.blockSize = blockSize;
+    bool threw = false;
+    try {
+      DiskManager dm(path, config);
+    } catch (const DiskManagerException &) {
+      threw = true;
+    }
+    assert(threw && "Unsupported block sizes should be refused");
+  }
+  safe_remove(path);
+
+  // Headers written before the block format was recorded hold zeros there:
+  // format 1, whose blocks have no trailer. Formats from a later build are
+  // refused.
+  {
+    DiskManagerConfig config;
+    config.checksums = true;
+    DiskManager dm(path, config);
+  }
+  auto set_format = [&path](uint32_t format) {
+    std::fstream file(path, std::ios::in | std::ios::out | std::ios::binary);
+    file.seekp(20);
+    file.write(reinterpret_cast<const char *>(&format), sizeof(format));
+  };
+  set_format(0);
+  assert(DiskManager::ReadHeader(path).blockFormat == 1);
+  {
+    DiskManager dm(path);
+    assert(dm.GetPayloadSize() == BLOCK_SIZE);
+  }
+  set_format(DiskManager::BLOCK_FORMAT_VERSION + 1);
+  bool threw = false;
+  try {
+    DiskManager dm(path);
+  } catch (const DiskManagerException &) {
+    threw = true;
+  }
+  assert(threw && "Blocks in a newer format should be refused");
+  safe_remove(path);
+
+  // The largest blocks still compress: Lz4 takes a whole 64 KiB block.
+  try {
+    DiskManagerConfig config;
+    config.blockSize = DiskManager::MAX_BLOCK_SIZE;
+    config.compression = BlockCompression::Lz4;
+    std::vector<char> buf(config.blockSize);
+    std::vector<char> expected(config.blockSize);
+    {
+      DiskManager dm(path, config);
+      for (int i = 0; i < 4; ++i) {
+        BlockId id = dm.AllocateBlock();
+        fill_with_rows(buf, i);
+        dm.WriteBlock(id, buf.data());
+      }
+    }
+    assert(fs::file_size(path) <
+               DiskManager::HEADER_SIZE + 2 * DiskManager::MAX_BLOCK_SIZE &&
+           "Rows should compress at the largest block size");
+    DiskManager dm(path, config);
+    for (BlockId id = 0; id < 4; ++id) {
+      dm.ReadBlock(id, buf.data());
+      fill_with_rows(expected, static_cast<int>(id));
+      assert(buf == expected);
+    }
+  } catch (...) {
+    safe_remove(path);
+    throw;
+  }
+  safe_remove(path);
+}
+
+static void test_opens_header_less_files() {
+  std::string path = make_temp_db_path();
+  try {
+    // The layout before the header: 4 KiB blocks from offset 0.
+    {
+      std::ofstream file(path, std::ios::binary);
+      std::vector<char> block(BLOCK_SIZE);
+      for (int i = 0; i < 3; ++i) {
+        std::fill(block.begin(), block.end(), static_cast<char>('a' + i));
+        block.back() = static_cast<char>('A' + i);
+        file.write(block.data(), static_cast<std::streamsize>(block.size()));
+      }
+    }
+    DatabaseHeader header = DiskManager::ReadHeader(path);
+    assert(header.blockSize == BLOCK_SIZE &&
+           header.compression == BlockCompression::None &&
+           header.blockFormat == DiskManager::PLAIN_BLOCK_FORMAT &&
+           header.blockCount == 3u);
+
+    std::vector<char> buf(BLOCK_SIZE);
+    {
+      DiskManager dm(path);
+      assert(dm.GetBlockCount() == 3u &&
+             "Every block of a header-less file should be counted");
+      assert(dm.GetPayloadSize() == BLOCK_SIZE);
+      dm.ReadBlock(1, buf.data());
+      assert(buf[0] == 'b' && buf[BLOCK_SIZE - 1] == 'B');
+      BlockId id = dm.AllocateBlock();
+      assert(id == 3u);
+      std::fill(buf.begin(), buf.end(), 'd');
+      dm.WriteBlock(id, buf.data());
+      dm.SyncFile();
+    }
+    assert(fs::file_size(path) == 4u * BLOCK_SIZE &&
+           "A header-less file should keep its layout");
+
+    DiskManager dm(path);
+    assert(dm.GetBlockCount() == 4u);
+    dm.ReadBlock(0, buf.data());
+    assert(buf[0] == 'a' && buf[BLOCK_SIZE - 1] == 'A');
+    dm.ReadBlock(3, buf.data());
+    assert(buf[0] == 'd' && buf[BLOCK_SIZE - 1] == 'd');
+    assert(dm.Scrub(2).empty());
+
+    DiskManagerConfig config;
+    config.blockSize = 16384;
+    bool threw = false;
+    try {
+      DiskManager other(path, config);
+    } catch (const DiskManagerException &) {
+      threw = true;
+    }
+    assert(threw && "A header-less file only holds 4 KiB blocks");
+  } catch (...) {
+    safe_remove(path);
+    throw;
+  }
+  safe_remove(path);
+}
+
 int main() {
   std::cout << "Running DiskManager unit tests...\n";
 
   test_allocate_and_increment_block_ids();
   std::cout << " - allocate and increment test passed\n";
 
+  test_bulk_allocation_grows_file_in_extents();
+  std::cout << " - bulk allocation grows file in extents test passed\n";
+
+  test_crash_does_not_count_reserved_blocks();
+  std::cout << " - crash does not count reserved blocks test passed\n";
+
+  test_freed_blocks_are_reused_near_hint();
+  std::cout << " - freed blocks are reused near hint test passed\n";
+
   test_write_and_read_block_contents();
   std::cout << " - write/read contents test passed\n";
 
@@ -160,6 +964,34 @@ int main() {
   test_null_buffer_throws();
   std::cout << " - null buffer throws test passed\n";
 
+  test_concurrent_read_write_throughput();
+  std::cout << " - concurrent read/write throughput test passed\n";
+
+  test_async_read_write();
+  std::cout << " - async read/write test passed\n";
+
+  test_mmap_backend_maps_blocks_in_place();
+  std::cout << " - mmap backend maps blocks in place test passed\n";
+
+  test_direct_io_bounces_unaligned_buffers();
+  std::cout << " - direct I/O bounces unaligned buffers test passed\n";
+
+  test_checksums_detect_corrupted_blocks();
+  std::cout << " - checksums detect corrupted blocks test passed\n";
+
+  test_compressed_blocks_round_trip();
+  std::cout << " - compressed blocks round trip test passed\n";
+
+  test_overlapping_compressed_writes_keep_extents_apart();
+  std::cout << " - overlapping compressed writes keep extents apart test "
+               "passed\n";
+
+  test_block_size_is_recorded_in_header();
+  std::cout << " - block size is recorded in header test passed\n";
+
+  test_opens_header_less_files();
+  std::cout << " - opens header-less files test passed\n";
+
   std::cout << "All DiskManager tests passed.\n";
   return 0;
 }
\ No newline at end of file
@@ -0,0 +1,293 @@
+#include "../../src/models/BufferPool/BufferPool.hpp"
+#include "../../src/models/DiskManager/DiskManager.hpp"
+#include "../../src/models/ExtendibleHash/ExtendibleHash.hpp"
+#include "../../src/models/Index/Index.hpp"
+#include "../common/TempPath.hpp"
+
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+static std::string key_for(uint64_t n) {
+  char buf[32];
+  std::snprintf(buf, sizeof(buf), "user%012llu",
+                static_cast<unsigned long long>(n));
+  return buf;
+}
+
+static void test_put_get_delete_single_key() {
+  std::string path = make_temp_db_path();
+  try {
+    BufferPool pool(16, std::make_unique<DiskManager>(path));
+    ExtendibleHash table(pool);
+
+    assert(!table.Get("missing").has_value() && "Empty table has no keys");
+    table.Put("alpha", 1);
+    assert(table.Get("alpha") == 1u);
+    table.Put("alpha", 2);
+    assert(table.Get("alpha") == 2u && "Put should overwrite");
+    table.Put("", 3);
+    assert(table.Get("") == 3u && "The empty key is a valid key");
+    assert(table.Delete("alpha"));
+    assert(!table.Get("alpha").has_value());
+    assert(!table.Delete("alpha") && "Deleting twice should report absence");
+  } catch (...) {
+    safe_remove(path);
+    throw;
+  }
+  safe_remove(path);
+}
+
+static void test_matches_map_under_random_operations() {
+  std::string path = make_temp_db_path();
+  try {
+    // A small pool forces buckets and directory pages through eviction.
+    BufferPool pool(64, std::make_unique<DiskManager>(path));
+    ExtendibleHash table(pool);
+    std::unordered_map<std::string, uint64_t> expected;
+
+    std::mt19937_64 eng(42);
+    std::uniform_int_distribution<uint64_t> pick(0, 39999);
+    for (int op = 0; op < 120000; ++op) {
+      std::string key = key_for(pick(eng));
+      if (op % 4 == 3) {
+        bool deleted = table.Delete(key);
+        assert(deleted == (expected.erase(key) == 1));
+      } else {
+        table.Put(key, static_cast<uint64_t>(op));
+        expected[key] = static_cast<uint64_t>(op);
+      }
+    }
+    assert(table.GetGlobalDepth() >= 9 &&
+           "Growing past one bucket should deepen the directory");
+
+    for (uint64_t n = 0; n < 40000; ++n) {
+      std::string key = key_for(n);
+      auto entry = expected.find(key);
+      std::optional<uint64_t> value = table.Get(key);
+      if (entry == expected.end()) {
+        assert(!value.has_value() && "Deleted key should be absent");
+      } else {
+        assert(value == entry->second && "Value should match the model");
+      }
+    }
+  } catch (...) {
+    safe_remove(path);
+    throw;
+  }
+  safe_remove(path);
+}
+
+static void test_long_key_throws() {
+  std::string path = make_temp_db_path();
+  try {
+    BufferPool pool(16, std::make_unique<DiskManager>(path));
+    ExtendibleHash table(pool);
+    table.Put(std::string(ExtendibleHash::MAX_KEY_SIZE, 'k'), 1);
+    assert(table.Get(std::string(ExtendibleHash::MAX_KEY_SIZE, 'k')) == 1u);
+
+    bool threw = false;
+    try {
+      table.Put(std::string(ExtendibleHash::MAX_KEY_SIZE + 1, 'k'), 1);
+    } catch (const ExtendibleHashException &) {
+      threw = true;
+    }
+    assert(threw && "Keys longer than MAX_KEY_SIZE should be rejected");
+  } catch (...) {
+    safe_remove(path);
+    throw;
+  }
+  safe_remove(path);
+}
+
+static void test_table_survives_reopen() {
+  std::string path = make_temp_db_path();
+  try {
+    BlockId metaBlockId;
+    uint32_t depth;
+    {
+      BufferPool pool(32, std::make_unique<DiskManager>(path));
+      ExtendibleHash table(pool);
+      metaBlockId = table.GetMetaBlockId();
+      // Enough keys for a directory that spans several blocks.
+      for (uint64_t n = 0; n < 100000; ++n) {
+        table.Put(key_for(n), n * 3);
+      }
+      depth = table.GetGlobalDepth();
+      assert(depth > 10);
+    }
+
+    BufferPool pool(32, std::make_unique<DiskManager>(path));
+    ExtendibleHash table(pool, metaBlockId);
+    assert(table.GetGlobalDepth() == depth);
+    for (uint64_t n = 0; n < 100000; ++n) {
+      assert(table.Get(key_for(n)) == n * 3 && "Keys should persist");
+    }
+
+    bool threw = false;
+    try {
+      ExtendibleHash notATable(pool, metaBlockId + 1);
+    } catch (const ExtendibleHashException &) {
+      threw = true;
+    }
+    assert(threw && "Opening a non-meta block should throw");
+  } catch (...) {
+    safe_remove(path);
+    throw;
+  }
+  safe_remove(path);
+}
+
+static void test_bucket_capacity_follows_block_size() {
+  // Directory depth the same keys reach in a table over `blockSize` blocks,
+  // checked again after a reopen.
+  auto depthFor = [](size_t blockSize) {
+    std::string path = make_temp_db_path();
+    try {
+      DiskManagerConfig diskConfig;
+      diskConfig.blockSize = blockSize;
+      BlockId metaBlockId;
+      uint32_t depth;
+      {
+        BufferPool pool(64, std::make_unique<DiskManager>(path, diskConfig));
+        ExtendibleHash table(pool);
+        metaBlockId = table.GetMetaBlockId();
+        for (uint64_t n = 0; n < 20000; ++n) {
+          table.Put(key_for(n), n);
+        }
+        depth = table.GetGlobalDepth();
+      }
+      BufferPool pool(64, std::make_unique<DiskManager>(path, diskConfig));
+      ExtendibleHash table(pool, metaBlockId);
+      for (uint64_t n = 0; n < 20000; ++n) {
+        assert(table.Get(key_for(n)) == n && "Keys should persist");
+      }
+      safe_remove(path);
+      return depth;
+    } catch (...) {
+      safe_remove(path);
+      throw;
+    }
+  };
+
+  assert(depthFor(4 * BLOCK_SIZE) + 1 < depthFor(BLOCK_SIZE) &&
+         "Buckets in larger blocks should hold proportionally more keys");
+}
+
+static void test_index_create_opens_either_type() {
+  std::string path = make_temp_db_path();
+  try {
+    BufferPool pool(64, std::make_unique<DiskManager>(path));
+    for (IndexType type : {IndexType::BPlusTree, IndexType::ExtendibleHash}) {
+      BlockId metaBlockId;
+      {
+        std::unique_ptr<Index> index = Index::Create(type, pool);
+        metaBlockId = index->GetMetaBlockId();
+        for (uint64_t n = 0; n < 2000; ++n) {
+          index->Put(key_for(n), n);
+        }
+        assert(index->Delete(key_for(7)));
+      }
+      std::unique_ptr<Index> index = Index::Create(type, pool, metaBlockId);
+      assert(index->Get(key_for(1999)) == 1999u);
+      assert(!index->Get(key_for(7)).has_value());
+    }
+  } catch (...) {
+    safe_remove(path);
+    throw;
+  }
+  safe_remove(path);
+}
+
+static void test_concurrent_readers_and_writers() {
+  std::string path = make_temp_db_path();
+  try {
+    BufferPool pool(256, std::make_unique<DiskManager>(path));
+    ExtendibleHash table(pool);
+    constexpr uint64_t keysPerWriter = 5000;
+    constexpr int writers = 4;
+    constexpr int readers = 4;
+
+    std::atomic<bool> wrongValue{false};
+    std::atomic<bool> writersDone{false};
+    std::vector<std::thread> threads;
+    for (int w = 0; w < writers; ++w) {
+      threads.emplace_back([&, w]() {
+        for (uint64_t i = 0; i < keysPerWriter; ++i) {
+          uint64_t n = i * writers + static_cast<uint64_t>(w);
+          table.Put(key_for(n), n);
+        }
+      });
+    }
+    for (int r = 0; r < readers; ++r) {
+      threads.emplace_back([&, r]() {
+        std::mt19937_64 eng(static_cast<uint64_t>(r));
+        std::uniform_int_distribution<uint64_t> pick(
+            0, keysPerWriter * writers - 1);
+        while (!writersDone) {
+          uint64_t n = pick(eng);
+          std::optional<uint64_t> value = table.Get(key_for(n));
+          if (value.has_value() && *value != n) {
+            wrongValue = true;
+          }
+        }
+      });
+    }
+    for (int w = 0; w < writers; ++w) {
+      threads[static_cast<size_t>(w)].join();
+    }
+    writersDone = true;
+    for (size_t t = writers; t < threads.size(); ++t) {
+      threads[t].join();
+    }
+
+    assert(!wrongValue && "Readers should never see a torn value");
+    for (uint64_t n = 0; n < keysPerWriter * writers; ++n) {
+      assert(table.Get(key_for(n)) == n && "Every concurrent put should land");
+    }
+  } catch (...) {
+    safe_remove(path);
+    throw;
+  }
+  safe_remove(path);
+}
+
+int main() {
+  std::cout << "Running ExtendibleHash unit tests...\n";
+
+  test_put_get_delete_single_key();
+  std::cout << " - put/get/delete single key test passed\n";
+
+  test_matches_map_under_random_operations();
+  std::cout << " - matches map under random operations test passed\n";
+
+  test_long_key_throws();
+  std::cout << " - long key throws test passed\n";
+
+  test_table_survives_reopen();
+  std::cout << " - table survives reopen test passed\n";
+
+  test_bucket_capacity_follows_block_size();
+  std::cout << " - bucket capacity follows block size test passed\n";
+
+  test_index_create_opens_either_type();
+  std::cout << " - index create opens either type test passed\n";
+
+  test_concurrent_readers_and_writers();
+  std::cout << " - concurrent readers and writers test passed\n";
+
+  std::cout << "All ExtendibleHash tests passed.\n";
+  return 0;
+}
@@ -0,0 +1,339 @@
+#include "../../src/models/BufferPool/BufferPool.hpp"
+#include "../../src/models/DiskManager/DiskManager.hpp"
+#include "../../src/models/Filter/BlockedBloomFilter.hpp"
+#include "../../src/models/Filter/CuckooFilter.hpp"
+#include "../../src/models/Filter/KeyFilter.hpp"
+#include "../../src/models/KVEngine/PagedEngine.hpp"
+#include "../common/TempPath.hpp"
+
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <sys/wait.h>
+#include <system_error>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+static std::string key_for(int i) {
+  char key[16];
+  std::snprintf(key, sizeof(key), "key%08d", i);
+  return key;
+}
+
+static std::string absent_key_for(int i) {
+  char key[16];
+  std::snprintf(key, sizeof(key), "nokey%08d", i);
+  return key;
+}
+
+static void test_bloom_has_no_false_negatives() {
+  constexpr int COUNT = 100000;
+  BlockedBloomFilter filter(COUNT, 10);
+  for (int i = 0; i < COUNT; ++i) {
+    filter.Add(key_for(i));
+  }
+  for (int i = 0; i < COUNT; ++i) {
+    assert(filter.MayContain(key_for(i)) && "Added keys must be found");
+  }
+  int falsePositives = 0;
+  for (int i = 0; i < COUNT; ++i) {
+    falsePositives += filter.MayContain(absent_key_for(i)) ? 1 : 0;
+  }
+  assert(falsePositives < COUNT * 3 / 100 &&
+         "10 bits per key should give about 1% false positives");
+  assert(filter.GetCount() == COUNT);
+  assert(filter.GetBlockCount() == (COUNT * 10 + 511) / 512);
+}
+
+static void test_bloom_simd_matches_portable() {
+  BlockedBloomFilter filter(5000, 8);
+  for (int i = 0; i < 5000; i += 2) {
+    filter.Add(key_for(i));
+  }
+  for (int i = 0; i < 10000; ++i) {
+    assert(filter.MayContain(key_for(i)) ==
+               filter.MayContainPortable(key_for(i)) &&
+           "Both probe paths must test the same bits");
+  }
+  bool threw = false;
+  try {
+    filter.Remove(key_for(0));
+  } catch (const FilterException &) {
+    threw = true;
+  }
+  assert(threw && !filter.SupportsRemove());
+}
+
+static void test_cuckoo_add_remove() {
+  constexpr int COUNT = 20000;
+  CuckooFilter filter(COUNT);
+  for (int i = 0; i < COUNT; ++i) {
+    assert(filter.Add(key_for(i)) && "A filter under capacity takes keys");
+  }
+  for (int i = 0; i < COUNT; i += 2) {
+    filter.Remove(key_for(i));
+  }
+  assert(filter.GetCount() == COUNT / 2);
+  int stillFound = 0;
+  for (int i = 0; i < COUNT; ++i) {
+    if (i % 2 == 1) {
+      assert(filter.MayContain(key_for(i)) && "Kept keys must be found");
+    } else {
+      stillFound += filter.MayContain(key_for(i)) ? 1 : 0;
+    }
+  }
+  assert(stillFound < COUNT / 200 &&
+         "Removed keys should be gone but for fingerprint collisions");
+}
+
+static void test_cuckoo_reports_full() {
+  CuckooFilter filter(1000);
+  std::vector<int> added;
+  for (int i = 0; i < 100000; ++i) {
+    if (!filter.Add(key_for(i))) {
+      break;
+    }
+    added.push_back(i);
+  }
+  assert(added.size() >= 1000 && added.size() < 100000 &&
+         "The filter should hold its capacity and then refuse keys");
+  for (int i : added) {
+    assert(filter.MayContain(key_for(i)) &&
+           "Keys added before the filter filled up must all be found");
+  }
+}
+
+static void test_cuckoo_lookups_never_miss_during_kicks() {
+  constexpr int COUNT = 40000;
+  CuckooFilter filter(COUNT);
+  std::atomic<int> published(0);
+  std::atomic<bool> missed(false);
+  std::atomic<bool> done(false);
+
+  std::vector<std::thread> readers;
+  for (int t = 0; t < 3; ++t) {
+    readers.emplace_back([&, t] {
+      std::mt19937 eng(static_cast<unsigned>(t));
+      while (!done.load()) {
+        int limit = published.load(std::memory_order_acquire);
+        if (limit == 0) {
+          continue;
+        }
+        if (!filter.MayContain(key_for(static_cast<int>(eng() % limit)))) {
+          missed = true;
+        }
+      }
+    });
+  }
+  // Filling to capacity makes later inserts evict.
+  for (int i = 0; i < COUNT; ++i) {
+    filter.Add(key_for(i));
+    published.store(i + 1, std::memory_order_release);
+  }
+  done = true;
+  for (auto &reader : readers) {
+    reader.join();
+  }
+  assert(!missed && "Moving fingerprints must never hide an added key");
+}
+
+static void test_filter_pages_round_trip() {
+  std::string path = make_temp_db_path();
+  try {
+    BufferPool pool(64, std::make_unique<DiskManager>(path));
+    BlockId header = KeyFilter::CreatePages(pool);
+
+    KeyFilterConfig config;
+    config.capacity = 50000;
+    assert(KeyFilter::Load(pool, header, config) == nullptr &&
+           "New pages hold no filter yet");
+
+    auto filter = KeyFilter::Create(config);
+    for (int i = 0; i < 30000; ++i) {
+      filter->Add(key_for(i));
+    }
+    KeyFilter::Save(*filter, pool, header);
+    auto loaded = KeyFilter::Load(pool, header, config);
+    assert(loaded != nullptr && loaded->GetCount() == 30000);
+    assert(std::equal(filter->GetBytes().begin(), filter->GetBytes().end(),
+                      loaded->GetBytes().begin(),
+                      loaded->GetBytes().end()) &&
+           "Loading should restore the table byte for byte");
+
+    KeyFilterConfig bloom;
+    bloom.type = KeyFilterType::Bloom;
+    bloom.capacity = 50000;
+    assert(KeyFilter::Load(pool, header, bloom) == nullptr &&
+           "A filter of another type must not be loaded");
+
+    // A smaller filter reuses the front of the chain and frees the rest.
+    auto small = KeyFilter::Create(bloom);
+    small->Add(key_for(1));
+    KeyFilter::Save(*small, pool, header);
+    auto reloaded = KeyFilter::Load(pool, header, bloom);
+    assert(reloaded != nullptr && reloaded->MayContain(key_for(1)));
+
+    KeyFilter::MarkStale(pool, header);
+    assert(KeyFilter::Load(pool, header, bloom) == nullptr &&
+           "Stale pages must not be trusted");
+  } catch (...) {
+    safe_remove(path);
+    throw;
+  }
+  safe_remove(path);
+}
+
+static void test_engine_filters_absent_keys() {
+  for (KeyFilterType type : {KeyFilterType::Bloom, KeyFilterType::Cuckoo}) {
+    std::string path = make_temp_db_path();
+    try {
+      PagedEngineConfig config;
+      config.filter.type = type;
+      config.filter.capacity = 10000;
+      {
+        PagedEngine engine(path, config);
+        assert(engine.GetFilter() != nullptr);
+        for (int i = 0; i < 5000; ++i) {
+          engine.Put(key_for(i), static_cast<uint64_t>(i));
+        }
+        for (int i = 0; i < 5000; i += 2) {
+          assert(engine.Delete(key_for(i)));
+        }
+        assert(!engine.Delete(absent_key_for(1)));
+        for (int i = 0; i < 5000; ++i) {
+          auto value = engine.Get(key_for(i));
+          assert(i % 2 == 0 ? !value.has_value()
+                            : value == static_cast<uint64_t>(i));
+          assert(!engine.Get(absent_key_for(i)).has_value());
+        }
+      }
+      // Reopened with the saved filter.
+      PagedEngine engine(path, config);
+      assert(engine.GetFilter() != nullptr);
+      for (int i = 1; i < 5000; i += 2) {
+        assert(engine.Get(key_for(i)) == static_cast<uint64_t>(i) &&
+               "The saved filter must hold every key");
+      }
+    } catch (...) {
+      safe_remove(path);
+      throw;
+    }
+    safe_remove(path);
+  }
+}
+
+static void test_engine_rebuilds_stale_filter() {
+  std::string path = make_temp_db_path();
+  try {
+    PagedEngineConfig config;
+    config.filter.capacity = 100;
+    {
+      PagedEngine engine(path, config);
+      engine.Put(key_for(1), 1);
+    }
+    // The child writes its changes back and exits without closing the
+    // engine, as a crash after a checkpoint would: the filter pages are
+    // still marked stale.
+    pid_t pid = ::fork();
+    if (pid == 0) {
+      auto *engine = new PagedEngine(path, config);
+      for (int i = 2; i < 1000; ++i) {
+        engine->Put(key_for(i), static_cast<uint64_t>(i));
+      }
+      engine->GetBufferPool().FlushAllBlocks();
+      ::_exit(0);
+    }
+    int status = 0;
+    ::waitpid(pid, &status, 0);
+    assert(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+
+    PagedEngine engine(path, config);
+    assert(engine.GetFilter() != nullptr &&
+           engine.GetFilter()->GetCapacity() >= 2 * 999 &&
+           "A rebuilt filter must be sized from the keys in the tree");
+    for (int i = 1; i < 1000; ++i) {
+      assert(engine.Get(key_for(i)) == static_cast<uint64_t>(i) &&
+             "A stale filter must be rebuilt from the tree");
+    }
+  } catch (...) {
+    safe_remove(path);
+    throw;
+  }
+  safe_remove(path);
+}
+
+static void test_engine_grows_full_filter() {
+  std::string path = make_temp_db_path();
+  try {
+    PagedEngineConfig config;
+    config.filter.capacity = 100;
+    {
+      PagedEngine engine(path, config);
+      for (int i = 0; i < 2000; ++i) {
+        engine.Put(key_for(i), static_cast<uint64_t>(i));
+      }
+      const KeyFilter *filter = engine.GetFilter();
+      assert(filter != nullptr &&
+             "A full cuckoo filter should be replaced, not dropped");
+      assert(filter->GetCapacity() >= 2000);
+      for (int i = 0; i < 2000; ++i) {
+        assert(engine.Get(key_for(i)) == static_cast<uint64_t>(i));
+      }
+    }
+    // Reopened with the smaller configured capacity, the saved filter keeps
+    // the capacity it grew to.
+    PagedEngine engine(path, config);
+    assert(engine.GetFilter() != nullptr);
+    assert(engine.GetFilter()->GetCapacity() >= 2000);
+    for (int i = 0; i < 2000; ++i) {
+      assert(engine.Get(key_for(i)) == static_cast<uint64_t>(i));
+    }
+  } catch (...) {
+    safe_remove(path);
+    throw;
+  }
+  safe_remove(path);
+}
+
+int main() {
+  std::cout << "Running Filter unit tests...\n";
+
+  test_bloom_has_no_false_negatives();
+  std::cout << " - bloom has no false negatives test passed\n";
+
+  test_bloom_simd_matches_portable();
+  std::cout << " - bloom simd matches portable test passed\n";
+
+  test_cuckoo_add_remove();
+  std::cout << " - cuckoo add remove test passed\n";
+
+  test_cuckoo_reports_full();
+  std::cout << " - cuckoo reports full test passed\n";
+
+  test_cuckoo_lookups_never_miss_during_kicks();
+  std::cout << " - cuckoo lookups never miss during kicks test passed\n";
+
+  test_filter_pages_round_trip();
+  std::cout << " - filter pages round trip test passed\n";
+
+  test_engine_filters_absent_keys();
+  std::cout << " - engine filters absent keys test passed\n";
+
+  test_engine_rebuilds_stale_filter();
+  std::cout << " - engine rebuilds stale filter test passed\n";
+
+  test_engine_grows_full_filter();
+  std::cout << " - engine grows full filter test passed\n";
+
+  std::cout << "All Filter tests passed.\n";
+  return 0;
+}
@@ -0,0 +1,183 @@
+#include "../../src/models/IOEngine/IOEngine.hpp"
+#include "../common/TempPath.hpp"
+
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <fcntl.h>
+#include <filesystem>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <string>
+#include <system_error>
+#include <unistd.h>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+constexpr size_t IO_SIZE = 4096;
+
+// Counts down completions so a test can wait for a whole batch.
+class CompletionLatch {
+public:
+  explicit CompletionLatch(size_t count) : remaining(count), failures(0) {}
+
+  void Done(int result) {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    if (result != 0) {
+      this->failures++;
+    }
+    if (--this->remaining == 0) {
+      this->cv.notify_all();
+    }
+  }
+
+  size_t Wait() {
+    std::unique_lock<std::mutex> lock(this->mutex);
+    this->cv.wait(lock, [this]() { return this->remaining == 0; });
+    return this->failures;
+  }
+
+private:
+  std::mutex mutex;
+  std::condition_variable cv;
+  size_t remaining;
+  size_t failures;
+};
+
+static std::unique_ptr<IOEngine> make_engine(int fd, IOEngineKind kind) {
+  try {
+    return IOEngine::Create(fd, kind, 32, 2);
+  } catch (const IOEngineException &) {
+    return nullptr;
+  }
+}
+
+static void run_batch_round_trip(IOEngineKind kind, bool registerBuffers) {
+  std::string path = make_temp_db_path();
+  int fd = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+  assert(fd >= 0);
+  try {
+    auto engine = make_engine(fd, kind);
+    if (!engine) {
+      std::cout << "   (engine unavailable, skipped)\n";
+      ::close(fd);
+      safe_remove(path);
+      return;
+    }
+
+    constexpr size_t blocks = 100;
+    std::vector<char> writeArena(blocks * IO_SIZE);
+    std::vector<char> readArena(blocks * IO_SIZE, 0);
+    for (size_t i = 0; i < blocks; ++i) {
+      std::memset(writeArena.data() + i * IO_SIZE, static_cast<int>(i + 1),
+                  IO_SIZE);
+    }
+
+    if (registerBuffers) {
+      std::vector<iovec> buffers = {
+          iovec{writeArena.data(), writeArena.size()},
+          iovec{readArena.data(), readArena.size()}};
+      bool registered = engine->RegisterBuffers(buffers);
+      if (kind == IOEngineKind::ThreadPool) {
+        assert(!registered && "Thread pool engine has no registered buffers");
+      }
+    }
+
+    CompletionLatch writes(blocks);
+    std::vector<IORequest> batch;
+    for (size_t i = 0; i < blocks; ++i) {
+      batch.push_back(IORequest{
+          IOOperation::Write, static_cast<long long>(i * IO_SIZE),
+          writeArena.data() + i * IO_SIZE, IO_SIZE,
+          [&writes](int result) { writes.Done(result); }});
+    }
+    engine->Submit(batch);
+    assert(writes.Wait() == 0 && "Batched writes should all succeed");
+
+    CompletionLatch reads(blocks);
+    batch.clear();
+    for (size_t i = 0; i < blocks; ++i) {
+      batch.push_back(IORequest{
+          IOOperation::Read, static_cast<long long>(i * IO_SIZE),
+          readArena.data() + i * IO_SIZE, IO_SIZE,
+          [&reads](int result) { reads.Done(result); }});
+    }
+    engine->Submit(batch);
+    assert(reads.Wait() == 0 && "Batched reads should all succeed");
+
+    assert(std::memcmp(writeArena.data(), readArena.data(),
+                       writeArena.size()) == 0 &&
+           "Read data should match written data");
+  } catch (...) {
+    ::close(fd);
+    safe_remove(path);
+    throw;
+  }
+  ::close(fd);
+  safe_remove(path);
+}
+
+static void test_thread_pool_batch_round_trip() {
+  run_batch_round_trip(IOEngineKind::ThreadPool, false);
+}
+
+static void test_uring_batch_round_trip() {
+  run_batch_round_trip(IOEngineKind::IoUring, false);
+}
+
+static void test_uring_registered_buffers() {
+  run_batch_round_trip(IOEngineKind::IoUring, true);
+}
+
+static void test_read_past_eof_reports_error() {
+  std::string path = make_temp_db_path();
+  int fd = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+  assert(fd >= 0);
+  try {
+    auto engine = make_engine(fd, IOEngineKind::Auto);
+    assert(engine && "Auto engine should always be available");
+
+    std::vector<char> buf(IO_SIZE);
+    std::atomic<int> observed{1};
+    CompletionLatch latch(1);
+    std::vector<IORequest> batch;
+    batch.push_back(IORequest{IOOperation::Read, 0, buf.data(), IO_SIZE,
+                              [&](int result) {
+                                observed = result;
+                                latch.Done(result);
+                              }});
+    engine->Submit(batch);
+    latch.Wait();
+    assert(observed < 0 && "Reading an empty file should fail");
+  } catch (...) {
+    ::close(fd);
+    safe_remove(path);
+    throw;
+  }
+  ::close(fd);
+  safe_remove(path);
+}
+
+int main() {
+  std::cout << "Running IOEngine unit tests...\n";
+
+  test_thread_pool_batch_round_trip();
+  std::cout << " - thread pool batch round trip test passed\n";
+
+  test_uring_batch_round_trip();
+  std::cout << " - io_uring batch round trip test passed\n";
+
+  test_uring_registered_buffers();
+  std::cout << " - io_uring registered buffers test passed\n";
+
+  test_read_past_eof_reports_error();
+  std::cout << " - read past EOF reports error test passed\n";
+
+  std::cout << "All IOEngine tests passed.\n";
+  return 0;
+}
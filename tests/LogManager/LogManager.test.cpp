@@ -0,0 +1,220 @@
+#include "../../src/models/LogManager/LogManager.hpp"
+#include "../common/TempPath.hpp"
+
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+static std::vector<std::string> read_all(LogManager &log) {
+  std::vector<std::string> records;
+  log.ReadRecords([&](LSN, const char *payload, size_t length) {
+    records.emplace_back(payload, length);
+  });
+  return records;
+}
+
+static void test_append_assigns_increasing_lsns() {
+  std::string path = make_temp_log_path();
+  try {
+    LogManager log(path);
+    LSN first = log.Append("alpha", 5);
+    LSN second = log.Append("beta", 4);
+
+    assert(first != INVALID_LSN && second > first &&
+           "LSNs should grow with the log");
+    assert(log.GetNextLSN() == second);
+    assert(log.GetFlushedLSN() == 0 && "Append alone should not sync");
+
+    log.Flush(first);
+    assert(log.GetFlushedLSN() >= first);
+  } catch (...) {
+    safe_remove(path);
+    throw;
+  }
+  safe_remove(path);
+}
+
+static void test_records_survive_reopen() {
+  std::string path = make_temp_log_path();
+  try {
+    LSN last;
+    {
+      LogManager log(path);
+      log.Commit("first", 5);
+      log.Commit("", 0);
+      last = log.Commit("third record", 12);
+    }
+
+    LogManager log(path);
+    assert(log.GetFlushedLSN() == last &&
+           "Reopening should resume after the last record");
+    std::vector<std::string> records = read_all(log);
+    assert(records.size() == 3);
+    assert(records[0] == "first");
+    assert(records[1].empty());
+    assert(records[2] == "third record");
+
+    LSN next = log.Commit("fourth", 6);
+    assert(next > last && "New records should follow the old ones");
+  } catch (...) {
+    safe_remove(path);
+    throw;
+  }
+  safe_remove(path);
+}
+
+static void test_torn_tail_is_discarded() {
+  std::string path = make_temp_log_path();
+  try {
+    LSN last;
+    {
+      LogManager log(path);
+      log.Commit("kept", 4);
+      last = log.Commit("also kept", 9);
+    }
+
+    {
+      // A record whose payload never fully reached the disk.
+      std::ofstream out(path, std::ios::binary | std::ios::app);
+      uint32_t length = 100;
+      uint32_t checksum = 0;
+      out.write(reinterpret_cast<const char *>(&length), sizeof(length));
+      out.write(reinterpret_cast<const char *>(&checksum), sizeof(checksum));
+      out.write("partial", 7);
+    }
+
+    LogManager log(path);
+    assert(log.GetFlushedLSN() == last && "The torn record should be dropped");
+    assert(fs::file_size(path) == last && "The torn tail should be truncated");
+    assert(read_all(log).size() == 2);
+
+    log.Commit("after", 5);
+    std::vector<std::string> records = read_all(log);
+    assert(records.size() == 3 && records[2] == "after");
+  } catch (...) {
+    safe_remove(path);
+    throw;
+  }
+  safe_remove(path);
+}
+
+static void test_corrupt_record_ends_the_log() {
+  std::string path = make_temp_log_path();
+  try {
+    LSN first;
+    {
+      LogManager log(path);
+      first = log.Commit("good", 4);
+      log.Commit("flipped", 7);
+    }
+
+    {
+      std::fstream file(path, std::ios::binary | std::ios::in | std::ios::out);
+      file.seekp(static_cast<std::streamoff>(first + 8));
+      file.put('F');
+    }
+
+    LogManager log(path);
+    std::vector<std::string> records = read_all(log);
+    assert(records.size() == 1 && records[0] == "good" &&
+           "A checksum mismatch should end the log");
+  } catch (...) {
+    safe_remove(path);
+    throw;
+  }
+  safe_remove(path);
+}
+
+static void test_flush_past_end_throws() {
+  std::string path = make_temp_log_path();
+  try {
+    LogManager log(path);
+    LSN lsn = log.Append("x", 1);
+    bool threw = false;
+    try {
+      log.Flush(lsn + 1);
+    } catch (const LogManagerException &) {
+      threw = true;
+    }
+    assert(threw && "Flushing an LSN never handed out should throw");
+  } catch (...) {
+    safe_remove(path);
+    throw;
+  }
+  safe_remove(path);
+}
+
+static void test_group_commit_batches_concurrent_commits() {
+  std::string path = make_temp_log_path();
+  try {
+    constexpr int threads = 8;
+    constexpr int commitsPerThread = 50;
+    LogManagerConfig config;
+    config.groupCommitDelay = std::chrono::microseconds(200);
+    LogManager log(path, config);
+
+    std::atomic<bool> durable{true};
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; ++t) {
+      workers.emplace_back([&log, &durable, t]() {
+        std::string record = "thread " + std::to_string(t);
+        for (int i = 0; i < commitsPerThread; ++i) {
+          LSN lsn = log.Commit(record.data(), record.size());
+          if (log.GetFlushedLSN() < lsn) {
+            durable = false;
+          }
+        }
+      });
+    }
+    for (auto &worker : workers) {
+      worker.join();
+    }
+
+    assert(durable && "Commit should return only once its record is synced");
+    assert(read_all(log).size() ==
+           static_cast<size_t>(threads * commitsPerThread));
+    assert(log.GetSyncCount() < static_cast<uint64_t>(threads *
+                                                      commitsPerThread) &&
+           "Concurrent commits should share syncs");
+  } catch (...) {
+    safe_remove(path);
+    throw;
+  }
+  safe_remove(path);
+}
+
+int main() {
+  std::cout << "Running LogManager unit tests...\n";
+
+  test_append_assigns_increasing_lsns();
+  std::cout << " - append assigns increasing LSNs test passed\n";
+
+  test_records_survive_reopen();
+  std::cout << " - records survive reopen test passed\n";
+
+  test_torn_tail_is_discarded();
+  std::cout << " - torn tail is discarded test passed\n";
+
+  test_corrupt_record_ends_the_log();
+  std::cout << " - corrupt record ends the log test passed\n";
+
+  test_flush_past_end_throws();
+  std::cout << " - flush past end throws test passed\n";
+
+  test_group_commit_batches_concurrent_commits();
+  std::cout << " - group commit batches concurrent commits test passed\n";
+
+  std::cout << "All LogManager tests passed.\n";
+  return 0;
+}
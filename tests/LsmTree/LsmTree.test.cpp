@@ -0,0 +1,393 @@
+#include "../../src/models/KVEngine/KVEngine.hpp"
+#include "../../src/models/LsmTree/LsmTree.hpp"
+#include "../../src/models/LsmTree/Memtable.hpp"
+#include "../../src/models/LsmTree/SSTable.hpp"
+#include "../common/TempPath.hpp"
+
+#include <cassert>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <random>
+#include <string>
+#include <sys/wait.h>
+#include <system_error>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+static std::string key_for(int i) {
+  char key[16];
+  std::snprintf(key, sizeof(key), "key%08d", i);
+  return key;
+}
+
+// Small enough that a few thousand keys go through every stage.
+static LsmTreeConfig small_config() {
+  LsmTreeConfig config;
+  config.memtableBytes = 16 * 1024;
+  config.targetFileBytes = 16 * 1024;
+  config.l0CompactionTrigger = 2;
+  config.l0StopTrigger = 4;
+  config.levelBaseBytes = 32 * 1024;
+  config.levelMultiplier = 4;
+  return config;
+}
+
+static void test_memtable_keeps_newest_version() {
+  Memtable memtable;
+  memtable.Add(1, "b", 10, false);
+  memtable.Add(2, "a", 20, false);
+  memtable.Add(3, "b", 30, false);
+  memtable.Add(4, "c", 0, true);
+
+  uint64_t value = 0;
+  bool tombstone = false;
+  assert(memtable.Get("b", value, tombstone) && value == 30 && !tombstone &&
+         "The highest sequence should win");
+  assert(memtable.Get("c", value, tombstone) && tombstone);
+  assert(!memtable.Get("d", value, tombstone));
+
+  std::vector<std::string> keys;
+  Memtable::Iterator it(memtable);
+  for (it.SeekToFirst(); it.Valid(); it.Next()) {
+    keys.emplace_back(it.Key());
+  }
+  assert((keys == std::vector<std::string>{"a", "b", "c"}) &&
+         "Iteration should visit each key once, in order");
+  it.Seek("b");
+  assert(it.Valid() && it.Key() == "b" && it.Value() == 30);
+}
+
+static void test_memtable_concurrent_adds() {
+  Memtable memtable;
+  constexpr int THREADS = 4;
+  constexpr int PER_THREAD = 5000;
+  std::vector<std::thread> threads;
+  for (int t = 0; t < THREADS; ++t) {
+    threads.emplace_back([&memtable, t] {
+      for (int i = 0; i < PER_THREAD; ++i) {
+        int n = i * THREADS + t;
+        memtable.Add(static_cast<uint64_t>(n) + 1, key_for(n),
+                     static_cast<uint64_t>(n), false);
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+
+  int count = 0;
+  std::string previous;
+  Memtable::Iterator it(memtable);
+  for (it.SeekToFirst(); it.Valid(); it.Next()) {
+    assert((count == 0 || previous < it.Key()) && "Keys should stay sorted");
+    previous = std::string(it.Key());
+    count++;
+  }
+  assert(count == THREADS * PER_THREAD && "No concurrent add may be lost");
+}
+
+static void test_sstable_round_trip() {
+  std::string path = make_temp_path(".sst");
+  try {
+    constexpr int COUNT = 5000;
+    {
+      SSTableWriter writer(path, 10);
+      for (int i = 0; i < COUNT; ++i) {
+        writer.Add(key_for(i * 2), static_cast<uint64_t>(i), i % 100 == 0);
+      }
+      writer.Finish();
+    }
+
+    SSTable table(path);
+    assert(table.GetEntryCount() == COUNT);
+    uint64_t value = 0;
+    bool tombstone = false;
+    assert(table.Get(key_for(1234), value, tombstone) && value == 617 &&
+           !tombstone);
+    assert(table.Get(key_for(200), value, tombstone) && tombstone);
+    assert(!table.Get(key_for(1235), value, tombstone) &&
+           "Keys between entries should be absent");
+
+    int misses = 0;
+    for (int i = 0; i < 1000; ++i) {
+      misses += table.MayContain("absent" + std::to_string(i)) ? 0 : 1;
+    }
+    assert(misses > 950 && "The Bloom filter should reject most absent keys");
+
+    SSTable::Iterator it(table);
+    it.Seek(key_for(3));
+    assert(it.Valid() && it.Key() == key_for(4) && it.Value() == 2);
+    int count = 0;
+    for (it.SeekToFirst(); it.Valid(); it.Next()) {
+      count++;
+    }
+    assert(count == COUNT);
+  } catch (...) {
+    safe_remove(path);
+    throw;
+  }
+  safe_remove(path);
+}
+
+static void test_sstable_detects_corruption() {
+  std::string path = make_temp_path(".sst");
+  try {
+    {
+      SSTableWriter writer(path, 10);
+      for (int i = 0; i < 100; ++i) {
+        writer.Add(key_for(i), static_cast<uint64_t>(i), false);
+      }
+      writer.Finish();
+    }
+    {
+      std::fstream file(path, std::ios::in | std::ios::out | std::ios::binary);
+      file.seekp(20);
+      file.put('\x7f');
+    }
+
+    SSTable table(path);
+    bool threw = false;
+    try {
+      uint64_t value = 0;
+      bool tombstone = false;
+      table.Get(key_for(0), value, tombstone);
+    } catch (const SSTableException &) {
+      threw = true;
+    }
+    assert(threw && "A damaged block should fail its checksum");
+  } catch (...) {
+    safe_remove(path);
+    throw;
+  }
+  safe_remove(path);
+}
+
+static void test_put_get_delete_scan() {
+  std::string dir = make_temp_path("");
+  try {
+    LsmTree tree(dir, small_config());
+    std::map<std::string, uint64_t> expected;
+    for (int i = 0; i < 3000; ++i) {
+      tree.Put(key_for(i), static_cast<uint64_t>(i));
+      expected[key_for(i)] = static_cast<uint64_t>(i);
+    }
+    for (int i = 0; i < 3000; i += 3) {
+      assert(tree.Delete(key_for(i)) && "Delete should find a present key");
+      expected.erase(key_for(i));
+    }
+    for (int i = 1; i < 3000; i += 3) {
+      tree.Put(key_for(i), static_cast<uint64_t>(i) * 10);
+      expected[key_for(i)] = static_cast<uint64_t>(i) * 10;
+    }
+    assert(!tree.Delete(key_for(0)) && "A deleted key is no longer present");
+    tree.WaitForCompactions();
+
+    for (int i = 0; i < 3000; ++i) {
+      auto it = expected.find(key_for(i));
+      auto value = tree.Get(key_for(i));
+      assert(it == expected.end() ? !value.has_value()
+                                  : value == it->second);
+    }
+
+    std::vector<std::pair<std::string, uint64_t>> scanned;
+    tree.Scan(key_for(1500), [&](std::string_view key, uint64_t value) {
+      scanned.emplace_back(key, value);
+      return scanned.size() < 100;
+    });
+    auto it = expected.lower_bound(key_for(1500));
+    assert(scanned.size() == 100);
+    for (const auto &entry : scanned) {
+      assert(entry.first == it->first && entry.second == it->second &&
+             "Scan should merge every level into one ordered view");
+      ++it;
+    }
+
+    LsmTreeStats stats = tree.GetStats();
+    assert(stats.flushes > 0 && stats.compactions > 0 &&
+           "The small config should flush and compact");
+    assert(stats.filesPerLevel[0] < small_config().l0StopTrigger);
+
+    bool threw = false;
+    try {
+      tree.Put(std::string(KVEngine::MAX_KEY_SIZE + 1, 'k'), 1);
+    } catch (const LsmTreeException &) {
+      threw = true;
+    }
+    assert(threw && "Oversized keys should be rejected");
+  } catch (...) {
+    safe_remove(dir);
+    throw;
+  }
+  safe_remove(dir);
+}
+
+static void test_reopen_keeps_data() {
+  std::string dir = make_temp_path("");
+  try {
+    {
+      LsmTree tree(dir, small_config());
+      for (int i = 0; i < 2000; ++i) {
+        tree.Put(key_for(i), static_cast<uint64_t>(i));
+      }
+      tree.Delete(key_for(7));
+    }
+    LsmTree tree(dir, small_config());
+    assert(tree.Get(key_for(1999)) == 1999u);
+    assert(!tree.Get(key_for(7)).has_value());
+    int count = 0;
+    tree.Scan("", [&](std::string_view, uint64_t) {
+      count++;
+      return true;
+    });
+    assert(count == 1999 && "Closing should write the memtable out");
+  } catch (...) {
+    safe_remove(dir);
+    throw;
+  }
+  safe_remove(dir);
+}
+
+static void test_crash_replays_log() {
+  std::string dir = make_temp_path("");
+  try {
+    LsmTreeConfig config = small_config();
+    config.syncWrites = true;
+    {
+      LsmTree tree(dir, config);
+      tree.Put(key_for(1), 1);
+    }
+    // The child exits without closing the tree, as a crash would: its
+    // writes are only in the log.
+    pid_t pid = ::fork();
+    if (pid == 0) {
+      auto *tree = new LsmTree(dir, config);
+      tree->Put(key_for(1), 100);
+      tree->Put(key_for(2), 200);
+      tree->Delete(key_for(3));
+      ::_exit(0);
+    }
+    int status = 0;
+    ::waitpid(pid, &status, 0);
+    assert(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+
+    LsmTree tree(dir, config);
+    assert(tree.Get(key_for(1)) == 100u &&
+           "Replayed records should override older tables");
+    assert(tree.Get(key_for(2)) == 200u);
+    assert(!tree.Get(key_for(3)).has_value());
+  } catch (...) {
+    safe_remove(dir);
+    throw;
+  }
+  safe_remove(dir);
+}
+
+static void test_concurrent_writers_and_readers() {
+  std::string dir = make_temp_path("");
+  try {
+    LsmTree tree(dir, small_config());
+    constexpr int THREADS = 4;
+    constexpr int PER_THREAD = 2000;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < THREADS; ++t) {
+      threads.emplace_back([&tree, t] {
+        for (int i = 0; i < PER_THREAD; ++i) {
+          int n = i * THREADS + t;
+          tree.Put(key_for(n), static_cast<uint64_t>(n));
+          assert(tree.Get(key_for(n)) == static_cast<uint64_t>(n) &&
+                 "A write should be visible to its writer at once");
+        }
+      });
+    }
+    for (auto &thread : threads) {
+      thread.join();
+    }
+    tree.WaitForCompactions();
+    for (int n = 0; n < THREADS * PER_THREAD; ++n) {
+      assert(tree.Get(key_for(n)) == static_cast<uint64_t>(n));
+    }
+  } catch (...) {
+    safe_remove(dir);
+    throw;
+  }
+  safe_remove(dir);
+}
+
+static void test_engines_agree() {
+  std::string lsmDir = make_temp_path("");
+  std::string pagedPath = make_temp_path(".db");
+  try {
+    auto lsm = KVEngine::Open(KVEngineType::Lsm, lsmDir);
+    auto paged = KVEngine::Open(KVEngineType::Paged, pagedPath);
+    std::mt19937 eng(42);
+    for (int i = 0; i < 5000; ++i) {
+      std::string key = key_for(static_cast<int>(eng() % 1000));
+      if (eng() % 4 == 0) {
+        assert(lsm->Delete(key) == paged->Delete(key));
+      } else {
+        lsm->Put(key, static_cast<uint64_t>(i));
+        paged->Put(key, static_cast<uint64_t>(i));
+      }
+    }
+
+    std::vector<std::pair<std::string, uint64_t>> fromLsm;
+    std::vector<std::pair<std::string, uint64_t>> fromPaged;
+    lsm->Scan("", [&](std::string_view key, uint64_t value) {
+      fromLsm.emplace_back(key, value);
+      return true;
+    });
+    paged->Scan("", [&](std::string_view key, uint64_t value) {
+      fromPaged.emplace_back(key, value);
+      return true;
+    });
+    assert(!fromLsm.empty() && fromLsm == fromPaged &&
+           "Both engines should hold the same table");
+  } catch (...) {
+    safe_remove(lsmDir);
+    safe_remove(pagedPath);
+    throw;
+  }
+  safe_remove(lsmDir);
+  safe_remove(pagedPath);
+}
+
+int main() {
+  std::cout << "Running LsmTree unit tests...\n";
+
+  test_memtable_keeps_newest_version();
+  std::cout << " - memtable keeps newest version test passed\n";
+
+  test_memtable_concurrent_adds();
+  std::cout << " - memtable concurrent adds test passed\n";
+
+  test_sstable_round_trip();
+  std::cout << " - sstable round trip test passed\n";
+
+  test_sstable_detects_corruption();
+  std::cout << " - sstable detects corruption test passed\n";
+
+  test_put_get_delete_scan();
+  std::cout << " - put get delete scan test passed\n";
+
+  test_reopen_keeps_data();
+  std::cout << " - reopen keeps data test passed\n";
+
+  test_crash_replays_log();
+  std::cout << " - crash replays log test passed\n";
+
+  test_concurrent_writers_and_readers();
+  std::cout << " - concurrent writers and readers test passed\n";
+
+  test_engines_agree();
+  std::cout << " - engines agree test passed\n";
+
+  std::cout << "All LsmTree tests passed.\n";
+  return 0;
+}
@@ -0,0 +1,136 @@
+#include "../../src/models/Lz4/Lz4.hpp"
+
+#include <cassert>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+static std::vector<char> round_trip(const std::vector<char> &input,
+                                    size_t &compressedSize) {
+  std::vector<char> packed(input.size() + input.size() / 255 + 16);
+  compressedSize =
+      Lz4::Compress(input.data(), input.size(), packed.data(), packed.size());
+  assert(compressedSize != 0 && "A worst-case sized buffer always fits");
+  std::vector<char> output(input.size());
+  size_t size = Lz4::Decompress(packed.data(), compressedSize, output.data(),
+                                output.size());
+  assert(size == input.size());
+  return output;
+}
+
+static void test_round_trips_varied_inputs() {
+  std::mt19937 eng(3);
+  std::vector<std::vector<char>> inputs;
+  inputs.push_back(std::vector<char>(1, 'x'));
+  inputs.push_back(std::vector<char>(13, 'y'));
+  inputs.push_back(std::vector<char>(4096, 0));
+  inputs.push_back(std::vector<char>(Lz4::MAX_INPUT_SIZE, 'z'));
+
+  std::vector<char> random(4096);
+  for (char &byte : random) {
+    byte = static_cast<char>(eng());
+  }
+  inputs.push_back(random);
+
+  // Records sharing most of their bytes, like a page of similar rows.
+  std::string text;
+  for (int i = 0; text.size() < 4096; ++i) {
+    text += "user:" + std::to_string(100000 + i * 7) +
+            "|status=active|region=eu-west-1|score=" +
+            std::to_string(eng() % 1000) + ";";
+  }
+  inputs.push_back(std::vector<char>(text.begin(), text.begin() + 4096));
+
+  // Short periods exercise overlapping matches.
+  for (size_t period : {1u, 2u, 3u, 7u, 8u, 9u, 300u}) {
+    std::vector<char> periodic(5000);
+    for (size_t i = 0; i < periodic.size(); ++i) {
+      periodic[i] = static_cast<char>('a' + i % period);
+    }
+    inputs.push_back(periodic);
+  }
+
+  for (const auto &input : inputs) {
+    size_t compressedSize;
+    assert(round_trip(input, compressedSize) == input);
+  }
+
+  size_t compressedSize;
+  round_trip(inputs[5], compressedSize);
+  assert(compressedSize * 3 < 4096 && "Similar rows should compress 3x");
+  round_trip(inputs[2], compressedSize);
+  assert(compressedSize < 64 && "A zero page should compress to bytes");
+}
+
+static void test_reports_output_that_does_not_fit() {
+  std::mt19937 eng(5);
+  std::vector<char> random(4096);
+  for (char &byte : random) {
+    byte = static_cast<char>(eng());
+  }
+  std::vector<char> packed(4096);
+  assert(Lz4::Compress(random.data(), random.size(), packed.data(), 3584) ==
+             0 &&
+         "Incompressible data should not fit in less than its size");
+  std::vector<char> tooLong(Lz4::MAX_INPUT_SIZE + 1, 'a');
+  assert(Lz4::Compress(tooLong.data(), tooLong.size(), packed.data(),
+                       packed.size()) == 0);
+
+  std::vector<char> zeros(4096, 0);
+  size_t size =
+      Lz4::Compress(zeros.data(), zeros.size(), packed.data(), packed.size());
+  std::vector<char> small(4095);
+  assert(Lz4::Decompress(packed.data(), size, small.data(), small.size()) ==
+             0 &&
+         "Decompression must not write past its capacity");
+}
+
+static void test_rejects_malformed_input() {
+  std::vector<char> text(4096);
+  for (size_t i = 0; i < text.size(); ++i) {
+    text[i] = static_cast<char>("keyval pages "[i % 13]);
+  }
+  std::vector<char> packed(4096);
+  size_t size =
+      Lz4::Compress(text.data(), text.size(), packed.data(), packed.size());
+  std::vector<char> output(4096);
+
+  for (size_t cut = 0; cut < size; ++cut) {
+    assert(Lz4::Decompress(packed.data(), cut, output.data(),
+                           output.size()) != text.size() &&
+           "A truncated block should not decode to the full page");
+  }
+  const char badOffset[] = {0x10, 'a', 0x05, 0x00, 0x00};
+  assert(Lz4::Decompress(badOffset, sizeof(badOffset), output.data(),
+                         output.size()) == 0 &&
+         "A match before the start of the output should be rejected");
+
+  // Random corruption must never read or write out of bounds.
+  std::mt19937 eng(11);
+  for (int trial = 0; trial < 2000; ++trial) {
+    std::vector<char> corrupt(packed.begin(), packed.begin() + size);
+    for (int flips = 0; flips < 3; ++flips) {
+      corrupt[eng() % corrupt.size()] = static_cast<char>(eng());
+    }
+    Lz4::Decompress(corrupt.data(), corrupt.size(), output.data(),
+                    output.size());
+  }
+}
+
+int main() {
+  std::cout << "Running Lz4 unit tests...\n";
+
+  test_round_trips_varied_inputs();
+  std::cout << " - round trips varied inputs test passed\n";
+
+  test_reports_output_that_does_not_fit();
+  std::cout << " - reports output that does not fit test passed\n";
+
+  test_rejects_malformed_input();
+  std::cout << " - rejects malformed input test passed\n";
+
+  std::cout << "All Lz4 tests passed.\n";
+  return 0;
+}
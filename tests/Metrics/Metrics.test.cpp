@@ -0,0 +1,310 @@
+#include "../../src/models/BufferPool/BufferPool.hpp"
+#include "../../src/models/DiskManager/DiskManager.hpp"
+#include "../../src/models/Metrics/LatencyHistogram.hpp"
+#include "../../src/models/Metrics/PerThread.hpp"
+#include "../common/TempPath.hpp"
+
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+static void test_histogram_buckets() {
+  // Exact below 16, then 16 buckets per power of two.
+  for (uint64_t v = 0; v < 16; ++v) {
+    assert(LatencyHistogram::BucketFor(v) == v);
+    assert(LatencyHistogram::BucketUpperBound(v) == v);
+  }
+  assert(LatencyHistogram::BucketFor(16) == 16);
+  assert(LatencyHistogram::BucketFor(31) == 31);
+  assert(LatencyHistogram::BucketFor(32) == 32);
+  assert(LatencyHistogram::BucketFor(33) == 32);
+  assert(LatencyHistogram::BucketUpperBound(32) == 33);
+  assert(LatencyHistogram::BucketFor(UINT64_MAX) ==
+         LatencyHistogram::BUCKETS - 1);
+
+  // Every value lands in a bucket whose range holds it and is within 1/16
+  // of it.
+  std::mt19937_64 eng(1);
+  for (int i = 0; i < 100000; ++i) {
+    uint64_t value = eng() >> (eng() % 37 + 27);
+    size_t bucket = LatencyHistogram::BucketFor(value);
+    uint64_t upper = LatencyHistogram::BucketUpperBound(bucket);
+    assert(upper >= value && "A bucket's bound must cover its values");
+    assert(upper - value <= value / 16 && "Buckets must be 1/16 wide");
+    if (bucket > 0) {
+      assert(LatencyHistogram::BucketUpperBound(bucket - 1) < value &&
+             "Buckets must not overlap");
+    }
+  }
+}
+
+static void test_histogram_percentiles() {
+  LatencyHistogram histogram;
+  assert(histogram.Percentile(99) == 0 && histogram.GetMean() == 0);
+  for (uint64_t v = 1; v <= 1000; ++v) {
+    histogram.Record(v * 1000);
+  }
+  assert(histogram.GetCount() == 1000);
+  assert(histogram.GetMax() == 1000000);
+  assert(histogram.GetMean() == 500500.0);
+  uint64_t p50 = histogram.Percentile(50);
+  uint64_t p99 = histogram.Percentile(99);
+  assert(p50 >= 500000 && p50 <= 500000 + 500000 / 16);
+  assert(p99 >= 990000 && p99 <= 990000 + 990000 / 16);
+  assert(histogram.Percentile(100) == 1000000);
+
+  LatencyHistogram other;
+  other.Record(7, 3);
+  histogram.Merge(other);
+  assert(histogram.GetCount() == 1003);
+  assert(histogram.GetBucketCount(7) == 3);
+  assert(histogram.Percentile(0) == 7);
+
+  std::string json = histogram.ToJson();
+  assert(json.front() == '{' && json.back() == '}');
+  assert(json.find("\"count\":1003") != std::string::npos);
+  assert(histogram.ToText().find("max=1000000") != std::string::npos);
+}
+
+static void test_per_thread_sums_every_thread() {
+  struct Counters {
+    std::atomic<uint64_t> events{0};
+  };
+  PerThread<Counters> counters;
+  auto total = [&counters]() {
+    uint64_t sum = 0;
+    counters.ForEach([&sum](const Counters &c) { sum += c.events.load(); });
+    return sum;
+  };
+
+  // Threads come and go; counts of exited threads must stay in the sum.
+  for (int round = 0; round < 3; ++round) {
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+      threads.emplace_back([&counters]() {
+        for (int i = 0; i < 100000; ++i) {
+          BumpCounter(counters.Local().events);
+        }
+      });
+    }
+    for (auto &thread : threads) {
+      thread.join();
+    }
+  }
+  assert(total() == 12 * 100000 && "No increment may be lost");
+
+  size_t slots = 0;
+  counters.ForEach([&slots](const Counters &) { slots++; });
+  assert(slots <= 4 && "Slots of exited threads should be reused");
+
+  // More instances than a thread caches: the evicted slots are given up
+  // and new ones taken, still without losing counts.
+  std::vector<std::unique_ptr<PerThread<Counters>>> many;
+  for (int i = 0; i < 8; ++i) {
+    many.push_back(std::make_unique<PerThread<Counters>>());
+  }
+  for (int round = 0; round < 3; ++round) {
+    for (auto &instance : many) {
+      BumpCounter(instance->Local().events);
+    }
+  }
+  for (auto &instance : many) {
+    uint64_t sum = 0;
+    instance->ForEach([&sum](const Counters &c) { sum += c.events.load(); });
+    assert(sum == 3);
+  }
+}
+
+static void test_pool_counts_hits_misses_and_evictions() {
+  std::string path = make_temp_db_path();
+  try {
+    BufferPoolConfig config;
+    config.fetchTimingInterval = 4;
+    BufferPool pool(8, std::make_unique<DiskManager>(path), config);
+
+    // Sixteen blocks, the first eight written through a full pool, so
+    // making the last eight evicts the first eight dirty.
+    for (int i = 0; i < 16; ++i) {
+      PageGuard page = pool.NewPage();
+      page.GetData()[0] = static_cast<char>(i);
+      page.MarkDirty();
+    }
+    BufferPoolStats stats = pool.GetStats();
+    assert(stats.dirtyEvictions == 8 && stats.cleanEvictions == 0);
+    assert(stats.hits == 0 && stats.misses == 0);
+
+    // Blocks 8-15 are resident: hits. Blocks 0-7 are not: misses that
+    // evict the dirty 8-15.
+    for (BlockId id = 8; id < 16; ++id) {
+      pool.FetchPageRead(id);
+    }
+    for (BlockId id = 0; id < 8; ++id) {
+      pool.FetchPageRead(id);
+    }
+    // 8-15 again: misses evicting the clean 0-7.
+    for (BlockId id = 8; id < 16; ++id) {
+      pool.FetchPageRead(id);
+    }
+    stats = pool.GetStats();
+    assert(stats.hits == 8 && stats.misses == 16);
+    assert(stats.dirtyEvictions == 16 && stats.cleanEvictions == 8);
+    assert(stats.evictions == 24);
+    // All misses plus every fourth fetch that hit, weighted by four.
+    assert(stats.fetchLatency.GetCount() == 16 + 8);
+    assert(stats.disk.blocksRead == 16);
+    assert(stats.disk.bytesRead == 16 * BLOCK_SIZE);
+    assert(stats.disk.blocksWritten == 16);
+    assert(stats.disk.readLatency.GetCount() == 16);
+    assert(stats.disk.writeLatency.GetCount() == 16);
+
+    pool.FlushAllBlocks();
+    stats = pool.GetStats();
+    assert(stats.disk.fsyncs >= 1);
+
+    std::string text = stats.ToText();
+    assert(text.find("pool.hits 8\n") != std::string::npos);
+    assert(text.find("pool.clean_evictions 8\n") != std::string::npos);
+    assert(text.find("disk.blocks_read 16\n") != std::string::npos);
+    std::string json = stats.ToJson();
+    assert(json.find("\"misses\":16") != std::string::npos);
+    assert(json.find("\"disk\":{\"blocksRead\":16") != std::string::npos);
+  } catch (...) {
+    safe_remove(path);
+    throw;
+  }
+  safe_remove(path);
+}
+
+static void test_pool_counts_across_threads() {
+  std::string path = make_temp_db_path();
+  try {
+    BufferPoolConfig config;
+    config.fetchTimingInterval = 64;
+    BufferPool pool(64, std::make_unique<DiskManager>(path), config);
+    for (int i = 0; i < 32; ++i) {
+      pool.NewPage();
+    }
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+      threads.emplace_back([&pool, t]() {
+        for (int i = 0; i < 10000; ++i) {
+          pool.FetchPageRead(static_cast<BlockId>((i + t) % 32));
+        }
+      });
+    }
+    for (auto &thread : threads) {
+      thread.join();
+    }
+    BufferPoolStats stats = pool.GetStats();
+    assert(stats.hits == 40000 && stats.misses == 0);
+    // Each thread's fetches since its last sample are not timed yet.
+    assert(stats.fetchLatency.GetCount() % 64 == 0 &&
+           stats.fetchLatency.GetCount() > 40000 - 4 * 64 &&
+           stats.fetchLatency.GetCount() <= 40000 &&
+           "Sampled hits should stand for every hit");
+  } catch (...) {
+    safe_remove(path);
+    throw;
+  }
+  safe_remove(path);
+}
+
+static void test_pool_counts_fetches_alternating_pools() {
+  std::string pathA = make_temp_db_path();
+  std::string pathB = make_temp_db_path();
+  try {
+    BufferPoolConfig config;
+    config.fetchTimingInterval = 64;
+    BufferPool poolA(4, std::make_unique<DiskManager>(pathA), config);
+    BufferPool poolB(4, std::make_unique<DiskManager>(pathB), config);
+    for (int i = 0; i < 8; ++i) {
+      poolA.NewPage().MarkDirty();
+      poolB.NewPage().MarkDirty();
+    }
+    // Switching pools on every fetch: a hot block that hits, and six
+    // cycling through the other three frames that mostly miss.
+    for (int i = 0; i < 1000; ++i) {
+      auto id = static_cast<BlockId>(i % 2 == 0 ? 7 : i / 2 % 6);
+      poolA.FetchPageRead(id);
+      poolB.FetchPageRead(id);
+    }
+    for (BufferPool *pool : {&poolA, &poolB}) {
+      BufferPoolStats stats = pool->GetStats();
+      assert(stats.hits > 0 && stats.misses > 0);
+      assert(stats.hits + stats.misses == 1000 &&
+             "Every fetch should be counted as a hit or a miss");
+    }
+  } catch (...) {
+    safe_remove(pathA);
+    safe_remove(pathB);
+    throw;
+  }
+  safe_remove(pathA);
+  safe_remove(pathB);
+}
+
+static void test_metrics_can_be_disabled() {
+  std::string path = make_temp_db_path();
+  try {
+    DiskManagerConfig diskConfig;
+    diskConfig.metrics = false;
+    BufferPoolConfig config;
+    config.metrics = false;
+    BufferPool pool(4, std::make_unique<DiskManager>(path, diskConfig),
+                    config);
+    for (int i = 0; i < 8; ++i) {
+      pool.NewPage().MarkDirty();
+    }
+    for (BlockId id = 0; id < 8; ++id) {
+      pool.FetchPageRead(id);
+    }
+    pool.FlushAllBlocks();
+    BufferPoolStats stats = pool.GetStats();
+    assert(stats.hits == 0 && stats.misses == 0 && stats.evictions == 0);
+    assert(stats.fetchLatency.GetCount() == 0);
+    assert(stats.disk.blocksRead == 0 && stats.disk.fsyncs == 0);
+  } catch (...) {
+    safe_remove(path);
+    throw;
+  }
+  safe_remove(path);
+}
+
+int main() {
+  std::cout << "Running Metrics unit tests...\n";
+
+  test_histogram_buckets();
+  std::cout << " - histogram buckets test passed\n";
+
+  test_histogram_percentiles();
+  std::cout << " - histogram percentiles test passed\n";
+
+  test_per_thread_sums_every_thread();
+  std::cout << " - per thread sums every thread test passed\n";
+
+  test_pool_counts_hits_misses_and_evictions();
+  std::cout << " - pool counts hits misses and evictions test passed\n";
+
+  test_pool_counts_across_threads();
+  std::cout << " - pool counts across threads test passed\n";
+
+  test_pool_counts_fetches_alternating_pools();
+  std::cout << " - pool counts fetches alternating pools test passed\n";
+
+  test_metrics_can_be_disabled();
+  std::cout << " - metrics can be disabled test passed\n";
+
+  std::cout << "All Metrics tests passed.\n";
+  return 0;
+}
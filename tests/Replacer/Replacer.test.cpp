@@ -0,0 +1,205 @@
+#include "../../src/models/Replacer/Replacer.hpp"
+
+#include <cassert>
+#include <iostream>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+static bool any_frame(size_t) { return true; }
+
+// Minimal cache driven by a replacer; returns the number of hits.
+class SimulatedCache {
+public:
+  SimulatedCache(ReplacerPolicy policy, size_t capacity)
+      : replacer(Replacer::Create(policy, capacity)), capacity(capacity),
+        frameBlock(capacity, INVALID_BLOCK_ID) {}
+
+  bool Access(BlockId blockId) {
+    auto entry = this->resident.find(blockId);
+    if (entry != this->resident.end()) {
+      this->replacer->RecordAccess(entry->second);
+      return true;
+    }
+
+    size_t frameId = this->used < this->capacity
+                         ? this->used++
+                         : this->replacer->Evict(any_frame);
+    assert(frameId != Replacer::NO_FRAME);
+    if (this->frameBlock[frameId] != INVALID_BLOCK_ID) {
+      this->resident.erase(this->frameBlock[frameId]);
+    }
+    this->frameBlock[frameId] = blockId;
+    this->resident[blockId] = frameId;
+    this->replacer->RecordInsert(frameId, blockId);
+    return false;
+  }
+
+private:
+  std::unique_ptr<Replacer> replacer;
+  size_t capacity;
+  size_t used = 0;
+  std::vector<BlockId> frameBlock;
+  std::unordered_map<BlockId, size_t> resident;
+};
+
+static void test_lru_evicts_least_recently_used() {
+  auto replacer = Replacer::Create(ReplacerPolicy::LRU, 3);
+  replacer->RecordInsert(0, 10);
+  replacer->RecordInsert(1, 11);
+  replacer->RecordInsert(2, 12);
+  replacer->RecordAccess(0);
+
+  assert(replacer->Evict(any_frame) == 1 && "LRU frame should be evicted");
+  assert(replacer->Evict(any_frame) == 2);
+  assert(replacer->Evict(any_frame) == 0);
+  assert(replacer->Evict(any_frame) == Replacer::NO_FRAME &&
+         "Empty replacer should have no victim");
+}
+
+static void test_clock_gives_second_chance() {
+  auto replacer = Replacer::Create(ReplacerPolicy::Clock, 3);
+  replacer->RecordInsert(0, 10);
+  replacer->RecordInsert(1, 11);
+  replacer->RecordInsert(2, 12);
+
+  assert(replacer->Evict(any_frame) == 0 &&
+         "After clearing every bit the hand should stop at frame 0");
+
+  replacer->RecordAccess(1);
+  assert(replacer->Evict(any_frame) == 2 &&
+         "A referenced frame should be skipped once");
+}
+
+static void test_lru_k_prefers_frames_with_few_accesses() {
+  auto replacer = Replacer::Create(ReplacerPolicy::LRUK, 3);
+  replacer->RecordInsert(0, 10);
+  replacer->RecordInsert(1, 11);
+  replacer->RecordInsert(2, 12);
+  replacer->RecordAccess(1);
+  replacer->RecordAccess(0);
+
+  assert(replacer->Evict(any_frame) == 2 &&
+         "Frame with fewer than K accesses should go first");
+  assert(replacer->Evict(any_frame) == 0 &&
+         "Frame with the oldest K-th access should go next");
+}
+
+static void test_evict_skips_rejected_frames() {
+  for (auto policy : {ReplacerPolicy::LRU, ReplacerPolicy::Clock,
+                      ReplacerPolicy::LRUK, ReplacerPolicy::TwoQueue}) {
+    auto replacer = Replacer::Create(policy, 4);
+    for (size_t frameId = 0; frameId < 4; ++frameId) {
+      replacer->RecordInsert(frameId, static_cast<BlockId>(frameId));
+    }
+
+    size_t victim =
+        replacer->Evict([](size_t frameId) { return frameId == 3; });
+    assert(victim == 3 && "Only the accepted frame may be evicted");
+
+    victim = replacer->Evict([](size_t) { return false; });
+    assert(victim == Replacer::NO_FRAME &&
+           "Rejecting every frame should yield no victim");
+  }
+}
+
+static void test_prefetched_frames_are_evicted_first() {
+  for (auto policy : {ReplacerPolicy::LRU, ReplacerPolicy::Clock,
+                      ReplacerPolicy::LRUK, ReplacerPolicy::TwoQueue}) {
+    auto replacer = Replacer::Create(policy, 4);
+    replacer->RecordInsert(0, 10);
+    replacer->RecordInsert(1, 11);
+    replacer->RecordInsert(2, 12);
+    replacer->RecordPrefetch(3, 13);
+
+    assert(replacer->Evict(any_frame) == 3 &&
+           "An unused prefetch should be the first victim");
+
+    replacer->RecordPrefetch(3, 14);
+    replacer->RecordAccess(3);
+    assert(replacer->Evict(any_frame) != 3 &&
+           "A prefetch that was used should be treated as resident");
+  }
+}
+
+static void test_two_queue_resists_sequential_scan() {
+  constexpr size_t capacity = 16;
+  constexpr BlockId hotBlocks = 4;
+
+  auto hot_hits_after_scan = [](ReplacerPolicy policy) {
+    SimulatedCache cache(policy, capacity);
+    // Touch the hot set often enough to promote it past A1in.
+    for (int round = 0; round < 20; ++round) {
+      for (BlockId id = 0; id < hotBlocks; ++id) {
+        cache.Access(id);
+      }
+      cache.Access(static_cast<BlockId>(1000 + round));
+    }
+    for (BlockId id = 0; id < 200; ++id) {
+      cache.Access(10000 + id);
+    }
+    size_t hits = 0;
+    for (BlockId id = 0; id < hotBlocks; ++id) {
+      hits += cache.Access(id) ? 1 : 0;
+    }
+    return hits;
+  };
+
+  assert(hot_hits_after_scan(ReplacerPolicy::TwoQueue) == hotBlocks &&
+         "2Q should keep the hot set through a long scan");
+  assert(hot_hits_after_scan(ReplacerPolicy::LRU) == 0 &&
+         "LRU is expected to lose the hot set to the scan");
+}
+
+static void test_hits_under_contention_are_kept() {
+  // A hit from another thread while Evict holds the replacer's mutex only
+  // leaves a flag; the next Evict has to act on it anyway.
+  auto victim_after_contended_hit = [](ReplacerPolicy policy) {
+    auto replacer = Replacer::Create(policy, 8);
+    replacer->RecordInsert(0, 10);
+    replacer->RecordInsert(1, 11);
+    bool hit = false;
+    size_t none = replacer->Evict([&](size_t) {
+      if (!hit) {
+        std::thread([&]() { replacer->RecordAccess(0); }).join();
+        hit = true;
+      }
+      return false;
+    });
+    assert(none == Replacer::NO_FRAME);
+    return replacer->Evict(any_frame);
+  };
+
+  assert(victim_after_contended_hit(ReplacerPolicy::LRUK) == 1 &&
+         "LRU-K should count a hit made while Evict held the mutex");
+  assert(victim_after_contended_hit(ReplacerPolicy::TwoQueue) == 1 &&
+         "2Q should count a hit made while Evict held the mutex");
+}
+
+int main() {
+  std::cout << "Running Replacer unit tests...\n";
+
+  test_lru_evicts_least_recently_used();
+  std::cout << " - LRU evicts least recently used test passed\n";
+
+  test_clock_gives_second_chance();
+  std::cout << " - CLOCK second chance test passed\n";
+
+  test_lru_k_prefers_frames_with_few_accesses();
+  std::cout << " - LRU-K prefers frames with few accesses test passed\n";
+
+  test_evict_skips_rejected_frames();
+  std::cout << " - evict skips rejected frames test passed\n";
+
+  test_prefetched_frames_are_evicted_first();
+  std::cout << " - prefetched frames are evicted first test passed\n";
+
+  test_two_queue_resists_sequential_scan();
+  std::cout << " - 2Q resists sequential scan test passed\n";
+
+  test_hits_under_contention_are_kept();
+  std::cout << " - hits under contention are kept test passed\n";
+
+  std::cout << "All Replacer tests passed.\n";
+  return 0;
+}
@@ -0,0 +1,385 @@
+#include "../../src/models/KVEngine/KVEngine.hpp"
+#include "../../src/models/Server/Client.hpp"
+#include "../../src/models/Server/Protocol.hpp"
+#include "../../src/models/Server/Server.hpp"
+#include "../common/TempPath.hpp"
+
+#include <cassert>
+#include <chrono>
+#include <cstdio>
+#include <ctime>
+#include <filesystem>
+#include <iostream>
+#include <memory>
+#include <numeric>
+#include <random>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+static std::string key_for(int i) {
+  char key[16];
+  std::snprintf(key, sizeof(key), "key%08d", i);
+  return key;
+}
+
+// A server on an ephemeral port, and a Unix socket when asked, in front of
+// a fresh paged table.
+struct TestServer {
+  std::string path = make_temp_path(".db");
+  std::string unixPath;
+  std::unique_ptr<KVEngine> engine;
+  std::unique_ptr<Server> server;
+
+  explicit TestServer(ServerConfig config = ServerConfig()) {
+    config.port = 0;
+    config.pinReactors = false;
+    if (config.reactors == 0) {
+      config.reactors = 1;
+    }
+    this->unixPath = config.unixPath;
+    this->engine = KVEngine::Open(KVEngineType::Paged, this->path);
+    this->server = std::make_unique<Server>(*this->engine, config);
+    this->server->Start();
+  }
+
+  ~TestServer() {
+    this->server.reset();
+    this->engine.reset();
+    safe_remove(this->path);
+    if (!this->unixPath.empty()) {
+      safe_remove(this->unixPath);
+    }
+  }
+
+  std::unique_ptr<KVClient> Connect() const {
+    return std::make_unique<KVClient>("127.0.0.1", this->server->GetPort());
+  }
+};
+
+static std::string frame(uint8_t code, uint32_t id, const std::string &body) {
+  std::string out(Protocol::HEADER_SIZE, '\0');
+  Protocol::EncodeU32(out.data(), static_cast<uint32_t>(
+                                      Protocol::HEADER_SIZE -
+                                      Protocol::LENGTH_SIZE + body.size()));
+  out[Protocol::LENGTH_SIZE] = static_cast<char>(code);
+  Protocol::EncodeU32(out.data() + Protocol::LENGTH_SIZE + 1, id);
+  out += body;
+  return out;
+}
+
+static void test_protocol_round_trip() {
+  std::string wire;
+  KVRequest put;
+  put.id = 7;
+  put.op = KVOpcode::Put;
+  put.key = "apple";
+  put.value = 0x0102030405060708ULL;
+  Protocol::AppendRequest(wire, put);
+  KVRequest scan;
+  scan.id = 8;
+  scan.op = KVOpcode::Scan;
+  scan.key = "";
+  scan.limit = 10;
+  Protocol::AppendRequest(wire, scan);
+
+  // A frame is not complete until its last byte has arrived.
+  size_t first = Protocol::FrameSize(wire.data(), wire.size());
+  assert(first > Protocol::HEADER_SIZE && first < wire.size());
+  assert(Protocol::FrameSize(wire.data(), Protocol::LENGTH_SIZE - 1) == 0 &&
+         "A partial length should ask for more bytes");
+  assert(Protocol::FrameSize(wire.data(), first - 1) == first &&
+         "The length alone should size the frame");
+
+  KVRequest parsed = Protocol::ParseRequest(wire.data(), first);
+  assert(parsed.id == 7 && parsed.op == KVOpcode::Put);
+  assert(parsed.key == "apple" && parsed.value == put.value);
+
+  const char *rest = wire.data() + first;
+  size_t second = Protocol::FrameSize(rest, wire.size() - first);
+  assert(second == wire.size() - first);
+  parsed = Protocol::ParseRequest(rest, second);
+  assert(parsed.id == 8 && parsed.op == KVOpcode::Scan);
+  assert(parsed.key.empty() && parsed.limit == 10);
+
+  std::string huge(Protocol::LENGTH_SIZE, '\0');
+  Protocol::EncodeU32(huge.data(),
+                      static_cast<uint32_t>(Protocol::MAX_FRAME_SIZE));
+  bool threw = false;
+  try {
+    Protocol::FrameSize(huge.data(), huge.size());
+  } catch (const ProtocolException &) {
+    threw = true;
+  }
+  assert(threw && "An oversized length should be refused");
+
+  std::string unknown = frame(99, 1, "");
+  threw = false;
+  try {
+    Protocol::ParseRequest(unknown.data(), unknown.size());
+  } catch (const ProtocolException &) {
+    threw = true;
+  }
+  assert(threw && "An unknown opcode should be refused");
+}
+
+static void test_get_put_delete_scan() {
+  TestServer test;
+  auto client = test.Connect();
+
+  assert(!client->Get("missing").has_value());
+  client->Put("b", 2);
+  client->Put("a", 1);
+  client->Put("c", 3);
+  assert(client->Get("a") == std::optional<uint64_t>(1));
+  client->Put("a", 10);
+  assert(client->Get("a") == std::optional<uint64_t>(10) &&
+         "A second Put should replace the value");
+
+  auto entries = client->Scan("", 0);
+  assert(entries.size() == 3);
+  assert(entries[0].first == "a" && entries[0].second == 10);
+  assert(entries[2].first == "c" && entries[2].second == 3);
+  entries = client->Scan("b", 1);
+  assert(entries.size() == 1 && entries[0].first == "b");
+
+  assert(client->Delete("b"));
+  assert(!client->Delete("b") && "A second Delete should find nothing");
+  assert(!client->Get("b").has_value());
+  assert(test.engine->Get("c") == std::optional<uint64_t>(3) &&
+         "Writes should land in the engine being served");
+}
+
+static void test_pipelined_requests_stay_in_order() {
+  TestServer test;
+  auto client = test.Connect();
+
+  constexpr int COUNT = 1000;
+  std::vector<uint32_t> ids;
+  for (int i = 0; i < COUNT; ++i) {
+    ids.push_back(client->SendPut(key_for(i), static_cast<uint64_t>(i)));
+    ids.push_back(client->SendGet(key_for(i)));
+  }
+  client->Flush();
+  for (int i = 0; i < COUNT; ++i) {
+    KVResponse put = client->Receive();
+    assert(put.id == ids[2 * i] && put.status == KVStatus::Ok);
+    KVResponse get = client->Receive();
+    assert(get.id == ids[2 * i + 1] && "Responses should keep request order");
+    assert(get.status == KVStatus::Ok &&
+           get.value == static_cast<uint64_t>(i) &&
+           "A Get should see the Put pipelined before it");
+  }
+}
+
+static void test_unix_socket() {
+  ServerConfig config;
+  config.unixPath = make_temp_path(".sock");
+  TestServer test(config);
+
+  KVClient client(config.unixPath);
+  client.Put("unix", 42);
+  assert(client.Get("unix") == std::optional<uint64_t>(42));
+  assert(test.Connect()->Get("unix") == std::optional<uint64_t>(42) &&
+         "TCP and Unix clients should share the table");
+}
+
+static void test_concurrent_clients_across_reactors() {
+  ServerConfig config;
+  config.reactors = 4;
+  TestServer test(config);
+  assert(test.server->GetReactorCount() == 4);
+
+  constexpr int CLIENTS = 8;
+  constexpr int PER_CLIENT = 500;
+  std::vector<std::thread> threads;
+  for (int c = 0; c < CLIENTS; ++c) {
+    threads.emplace_back([&test, c] {
+      auto client = test.Connect();
+      for (int i = 0; i < PER_CLIENT; ++i) {
+        client->SendPut(key_for(c * PER_CLIENT + i),
+                        static_cast<uint64_t>(c));
+      }
+      for (int i = 0; i < PER_CLIENT; ++i) {
+        assert(client->Receive().status == KVStatus::Ok);
+      }
+      for (int i = 0; i < PER_CLIENT; i += 50) {
+        assert(client->Get(key_for(c * PER_CLIENT + i)) ==
+               std::optional<uint64_t>(static_cast<uint64_t>(c)));
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+
+  std::vector<uint64_t> accepts = test.server->GetAcceptCounts();
+  assert(accepts.size() == 4);
+  assert(std::accumulate(accepts.begin(), accepts.end(), uint64_t{0}) ==
+             CLIENTS &&
+         "Every connection should be accepted by exactly one reactor");
+  assert(test.Connect()->Scan("", 0).size() == 1024 &&
+         "A Scan should stop at the server's maximum");
+}
+
+static void test_bad_requests() {
+  TestServer test;
+  auto client = test.Connect();
+
+  std::string longKey(KVEngine::MAX_KEY_SIZE + 1, 'k');
+  uint32_t id = client->SendPut(longKey, 1);
+  KVResponse response = client->Receive();
+  assert(response.id == id && response.status == KVStatus::Error &&
+         !response.error.empty() && "An overlong key should fail the request");
+
+  client->SendRaw(frame(99, 500, "junk"));
+  response = client->Receive();
+  assert(response.id == 500 && response.status == KVStatus::Error &&
+         "An unknown opcode should fail only that request");
+
+  client->Put("still", 1);
+  assert(client->Get("still") == std::optional<uint64_t>(1) &&
+         "The connection should stay usable after a failed request");
+
+  std::string huge(Protocol::LENGTH_SIZE, '\0');
+  Protocol::EncodeU32(huge.data(),
+                      static_cast<uint32_t>(Protocol::MAX_FRAME_SIZE));
+  client->SendRaw(huge);
+  bool closed = false;
+  try {
+    client->Receive();
+  } catch (const ServerException &) {
+    closed = true;
+  }
+  assert(closed && "An oversized frame should close the connection");
+  assert(test.Connect()->Get("still") == std::optional<uint64_t>(1) &&
+         "Other connections should be unaffected");
+}
+
+static void test_large_scan() {
+  ServerConfig config;
+  config.maxScanEntries = 5000;
+  TestServer test(config);
+  auto client = test.Connect();
+
+  // Far more than one output chunk of entries.
+  constexpr int COUNT = 4000;
+  for (int i = 0; i < COUNT; ++i) {
+    client->SendPut(key_for(i), static_cast<uint64_t>(i) * 3);
+  }
+  for (int i = 0; i < COUNT; ++i) {
+    client->Receive();
+  }
+  uint32_t before = client->SendGet(key_for(1));
+  uint32_t scan = client->SendScan("", 0);
+  uint32_t after = client->SendGet(key_for(2));
+  assert(client->Receive().id == before);
+  KVResponse response = client->Receive();
+  assert(response.id == scan && response.status == KVStatus::Ok);
+  assert(response.entries.size() == COUNT);
+  for (int i = 0; i < COUNT; ++i) {
+    assert(response.entries[i].first == key_for(i));
+    assert(response.entries[i].second == static_cast<uint64_t>(i) * 3);
+  }
+  response = client->Receive();
+  assert(response.id == after && response.value == 6 &&
+         "Responses after a large Scan should follow it intact");
+}
+
+static void test_half_close_while_reads_are_paused() {
+  ServerConfig config;
+  config.maxPendingOutput = 4096;
+  TestServer test(config);
+  auto client = test.Connect();
+
+  constexpr int KEYS = 1000;
+  for (int i = 0; i < KEYS; ++i) {
+    client->SendPut(key_for(i), static_cast<uint64_t>(i));
+  }
+  for (int i = 0; i < KEYS; ++i) {
+    client->Receive();
+  }
+  // Far more response bytes than the socket buffers take, so the server
+  // stops reading with the half-close still unread.
+  constexpr int SCANS = 1000;
+  for (int i = 0; i < SCANS; ++i) {
+    client->SendScan("", 0);
+  }
+  client->FinishSending();
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+  std::clock_t start = std::clock();
+  std::this_thread::sleep_for(std::chrono::milliseconds(300));
+  double cpuSeconds =
+      static_cast<double>(std::clock() - start) / CLOCKS_PER_SEC;
+  assert(cpuSeconds < 0.1 &&
+         "A half-closed connection should not spin a paused reactor");
+
+  for (int i = 0; i < SCANS; ++i) {
+    KVResponse response = client->Receive();
+    assert(response.status == KVStatus::Ok &&
+           response.entries.size() == KEYS);
+  }
+  bool closed = false;
+  try {
+    client->Receive();
+  } catch (const ServerException &) {
+    closed = true;
+  }
+  assert(closed && "The half-close should be seen once reads resume");
+}
+
+static void test_stop_with_open_connections() {
+  TestServer test;
+  auto idle = test.Connect();
+  auto busy = test.Connect();
+  busy->Put("k", 1);
+
+  test.server->Stop();
+  bool closed = false;
+  try {
+    busy->Get("k");
+  } catch (const ServerException &) {
+    closed = true;
+  }
+  assert(closed && "Stop should close open connections");
+  test.server->Stop();
+  assert(test.engine->Get("k") == std::optional<uint64_t>(1));
+}
+
+int main() {
+  std::cout << "Running Server unit tests...\n";
+
+  test_protocol_round_trip();
+  std::cout << " - protocol round trip test passed\n";
+
+  test_get_put_delete_scan();
+  std::cout << " - get put delete scan test passed\n";
+
+  test_pipelined_requests_stay_in_order();
+  std::cout << " - pipelined requests stay in order test passed\n";
+
+  test_unix_socket();
+  std::cout << " - unix socket test passed\n";
+
+  test_concurrent_clients_across_reactors();
+  std::cout << " - concurrent clients across reactors test passed\n";
+
+  test_bad_requests();
+  std::cout << " - bad requests test passed\n";
+
+  test_large_scan();
+  std::cout << " - large scan test passed\n";
+
+  test_half_close_while_reads_are_paused();
+  std::cout << " - half close while reads are paused test passed\n";
+
+  test_stop_with_open_connections();
+  std::cout << " - stop with open connections test passed\n";
+
+  std::cout << "All Server tests passed.\n";
+  return 0;
+}
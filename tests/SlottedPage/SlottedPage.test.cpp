@@ -0,0 +1,299 @@
+#include "../../src/models/BufferPool/BufferPool.hpp"
+#include "../../src/models/DiskManager/DiskManager.hpp"
+#include "../../src/models/SlottedPage/SlottedPage.hpp"
+#include "../common/TempPath.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <chrono>
+#include <filesystem>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <system_error>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+static std::string record_for(size_t n) {
+  return "record-" + std::to_string(n);
+}
+
+static void test_fill_page_and_read_back() {
+  std::array<char, BLOCK_SIZE> buffer{};
+  SlottedPage page(buffer);
+  page.Init();
+
+  std::vector<SlotId> slots;
+  for (size_t n = 0;; ++n) {
+    SlotId slot = page.Insert(record_for(n));
+    if (slot == SlottedPage::INVALID_SLOT) {
+      break;
+    }
+    slots.push_back(slot);
+  }
+  assert(slots.size() > 200 && "Many small records should share one block");
+  assert(page.GetSlotCount() == slots.size());
+
+  for (size_t n = 0; n < slots.size(); ++n) {
+    assert(slots[n] == n && "Slots should be handed out in order");
+    assert(page.Get(slots[n]) == record_for(n));
+  }
+  std::string_view view = page.Get(0);
+  assert(view.data() >= buffer.data() &&
+         view.data() < buffer.data() + BLOCK_SIZE &&
+         "Get should return a view into the page");
+}
+
+static void test_delete_reuses_slot() {
+  std::array<char, BLOCK_SIZE> buffer{};
+  SlottedPage page(buffer);
+  page.Init();
+
+  for (size_t n = 0; n < 10; ++n) {
+    page.Insert(record_for(n));
+  }
+  page.Delete(3);
+  assert(!page.IsLive(3));
+  assert(page.Insert("replacement") == 3 && "Freed slot should be reused");
+  assert(page.Get(3) == "replacement");
+
+  page.Delete(9);
+  page.Delete(8);
+  assert(page.GetSlotCount() == 8 && "Trailing free slots should be trimmed");
+}
+
+static void test_update_shrinks_and_grows() {
+  std::array<char, BLOCK_SIZE> buffer{};
+  SlottedPage page(buffer);
+  page.Init();
+
+  SlotId first = page.Insert("a medium sized value");
+  SlotId second = page.Insert("neighbour");
+  assert(page.Update(first, "short"));
+  assert(page.Get(first) == "short");
+  assert(page.Update(first, std::string(500, 'g')));
+  assert(page.Get(first) == std::string(500, 'g'));
+  assert(page.Get(second) == "neighbour" && "Other records stay intact");
+
+  assert(page.Update(first, ""));
+  assert(page.Get(first).empty() && page.IsLive(first));
+}
+
+static void test_compaction_reclaims_fragmented_space() {
+  std::array<char, BLOCK_SIZE> buffer{};
+  SlottedPage page(buffer);
+  page.Init();
+
+  std::string chunk(500, 'x');
+  std::vector<SlotId> slots;
+  SlotId slot;
+  while ((slot = page.Insert(chunk)) != SlottedPage::INVALID_SLOT) {
+    slots.push_back(slot);
+  }
+  // Free every other record: plenty of space in total, none of it
+  // contiguous.
+  for (size_t i = 0; i < slots.size(); i += 2) {
+    page.Delete(slots[i]);
+  }
+  for (size_t i = 1; i < slots.size(); i += 2) {
+    assert(page.Update(slots[i], std::string(400, static_cast<char>('a' + i))));
+  }
+
+  std::string big(1000, 'b');
+  SlotId placed = page.Insert(big);
+  assert(placed != SlottedPage::INVALID_SLOT &&
+         "Insert should compact to use fragmented space");
+  assert(page.Get(placed) == big);
+  for (size_t i = 1; i < slots.size(); i += 2) {
+    assert(page.Get(slots[i]) ==
+               std::string(400, static_cast<char>('a' + i)) &&
+           "Compaction should keep slot ids stable");
+  }
+
+  while (page.GetFreeSpace() > 0) {
+    size_t length = std::min(page.GetFreeSpace(), page.GetMaxInlineRecord());
+    assert(page.Insert(std::string(length, 'f')) !=
+               SlottedPage::INVALID_SLOT &&
+           "GetFreeSpace should be exactly insertable");
+  }
+  assert(page.Insert("x") == SlottedPage::INVALID_SLOT);
+}
+
+static void test_invalid_slots_and_oversized_records_throw() {
+  std::array<char, BLOCK_SIZE> buffer{};
+  SlottedPage page(buffer);
+  page.Init();
+  SlotId slot = page.Insert("value");
+  page.Insert("other");
+  page.Delete(slot);
+
+  bool threw = false;
+  try {
+    page.Get(slot);
+  } catch (const SlottedPageException &) {
+    threw = true;
+  }
+  assert(threw && "Reading a deleted slot should throw");
+
+  threw = false;
+  try {
+    page.Delete(42);
+  } catch (const SlottedPageException &) {
+    threw = true;
+  }
+  assert(threw && "Deleting an unknown slot should throw");
+
+  threw = false;
+  try {
+    page.Insert(std::string(page.GetMaxInlineRecord() + 1, 'x'));
+  } catch (const SlottedPageException &) {
+    threw = true;
+  }
+  assert(threw && "Insert should reject records above the inline limit");
+}
+
+static void test_overflow_records_round_trip() {
+  std::string path = make_temp_db_path();
+  try {
+    // Fewer frames than the chain has blocks, so the read has to reload
+    // overflow pages from disk.
+    BufferPool pool(4, std::make_unique<DiskManager>(path));
+    Block *block = pool.NewBlock();
+    BlockId pageId = block->block_id;
+    SlottedPage page(block, pool.GetPayloadSize());
+    page.Init();
+
+    std::string value(20000, '\0');
+    for (size_t i = 0; i < value.size(); ++i) {
+      value[i] = static_cast<char>('a' + i % 26);
+    }
+    SlotId small = page.InsertRecord(pool, "inline");
+    pool.ReleaseBlock(pageId, true);
+
+    block = pool.FetchBlock(pageId);
+    SlottedPage reloaded(block, pool.GetPayloadSize());
+    SlotId large = reloaded.InsertRecord(pool, value);
+    assert(large != SlottedPage::INVALID_SLOT);
+    assert(!reloaded.IsOverflow(small) && reloaded.IsOverflow(large));
+    assert(reloaded.GetRecordLength(small) == 6);
+    assert(reloaded.GetRecordLength(large) == value.size());
+
+    std::string assembled;
+    size_t pieces = 0;
+    reloaded.ReadRecord(pool, large, [&](std::string_view piece) {
+      assembled.append(piece);
+      pieces++;
+    });
+    assert(assembled == value && "Overflow value should reassemble");
+    assert(pieces > 1 && "Overflow value should arrive in chunks");
+
+    std::string inlineValue;
+    reloaded.ReadRecord(pool, small, [&](std::string_view piece) {
+      inlineValue.append(piece);
+    });
+    assert(inlineValue == "inline");
+    pool.ReleaseBlock(pageId, false);
+  } catch (...) {
+    safe_remove(path);
+    throw;
+  }
+  safe_remove(path);
+}
+
+static void test_delete_record_frees_overflow_chain() {
+  std::string path = make_temp_db_path();
+  try {
+    BufferPool pool(8, std::make_unique<DiskManager>(path));
+    WritePageGuard guard = pool.NewPage().UpgradeWrite();
+    SlottedPage page(guard.GetData());
+    page.Init();
+
+    std::string value(3 * BLOCK_SIZE, 'v');
+    SlotId slot = page.InsertRecord(pool, value);
+    BlockId chainEnd = pool.NewPage().GetBlockId();
+    page.DeleteRecord(pool, slot);
+    assert(!page.IsLive(slot));
+
+    // The chain sat between the page and chainEnd; new blocks should come
+    // from there instead of growing the file.
+    for (BlockId expected = 1; expected < chainEnd; ++expected) {
+      assert(pool.NewPage(expected).GetBlockId() == expected &&
+             "Freed chain blocks should be reused");
+    }
+    assert(pool.NewPage().GetBlockId() == chainEnd + 1);
+
+    SlotId inlineSlot = page.InsertRecord(pool, "small");
+    page.DeleteRecord(pool, inlineSlot);
+    assert(!page.IsLive(inlineSlot) && "Inline records delete in place");
+  } catch (...) {
+    safe_remove(path);
+    throw;
+  }
+  safe_remove(path);
+}
+
+static void test_page_layout_follows_block_size() {
+  std::string path = make_temp_db_path();
+  try {
+    DiskManagerConfig diskConfig;
+    diskConfig.blockSize = 4 * BLOCK_SIZE;
+    BufferPool pool(8, std::make_unique<DiskManager>(path, diskConfig));
+    WritePageGuard guard = pool.NewPage().UpgradeWrite();
+    SlottedPage page(guard.GetData());
+    page.Init();
+    assert(page.GetMaxInlineRecord() == pool.GetPayloadSize() / 4);
+
+    // Inline here, though it would overflow a 4 KiB page.
+    SlotId inlineSlot = page.InsertRecord(pool, std::string(3000, 'i'));
+    assert(!page.IsOverflow(inlineSlot));
+
+    // Overflow blocks are filled to the larger payload too.
+    std::string value(3 * pool.GetPayloadSize(), 'v');
+    SlotId slot = page.InsertRecord(pool, value);
+    assert(page.IsOverflow(slot));
+    assert(pool.NewPage().GetBlockId() == 5 &&
+           "A value of three payloads should take four overflow blocks");
+    std::string assembled;
+    page.ReadRecord(pool, slot,
+                    [&](std::string_view piece) { assembled.append(piece); });
+    assert(assembled == value);
+  } catch (...) {
+    safe_remove(path);
+    throw;
+  }
+  safe_remove(path);
+}
+
+int main() {
+  std::cout << "Running SlottedPage unit tests...\n";
+
+  test_fill_page_and_read_back();
+  std::cout << " - fill page and read back test passed\n";
+
+  test_delete_reuses_slot();
+  std::cout << " - delete reuses slot test passed\n";
+
+  test_update_shrinks_and_grows();
+  std::cout << " - update shrinks and grows test passed\n";
+
+  test_compaction_reclaims_fragmented_space();
+  std::cout << " - compaction reclaims fragmented space test passed\n";
+
+  test_invalid_slots_and_oversized_records_throw();
+  std::cout << " - invalid slots and oversized records throw test passed\n";
+
+  test_overflow_records_round_trip();
+  std::cout << " - overflow records round trip test passed\n";
+
+  test_delete_record_frees_overflow_chain();
+  std::cout << " - delete record frees overflow chain test passed\n";
+
+  test_page_layout_follows_block_size();
+  std::cout << " - page layout follows block size test passed\n";
+
+  std::cout << "All SlottedPage tests passed.\n";
+  return 0;
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include "../../src/models/DiskManager/DiskManager.hpp"
+
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <random>
+#include <string>
+#include <system_error>
+
+// Scratch paths for the tests and benchmarks. The name carries the program
+// that made it, so a file left behind by a crash says where it came from;
+// the random part is kept short for Unix socket paths.
+inline std::string make_temp_path(const std::string &suffix) {
+  auto tmp = std::filesystem::temp_directory_path();
+  auto now =
+      std::chrono::high_resolution_clock::now().time_since_epoch().count();
+  std::random_device rd;
+  std::mt19937_64 eng(rd());
+  std::uniform_int_distribution<uint64_t> dist;
+  uint64_t r = dist(eng);
+  std::string filename = std::string("keyval_") +
+                         program_invocation_short_name + "_" +
+                         std::to_string(now) + "_" +
+                         std::to_string(r % 1000000) + suffix;
+  return (tmp / filename).string();
+}
+
+inline std::string make_temp_db_path() { return make_temp_path(".db"); }
+
+inline std::string make_temp_log_path() { return make_temp_path(".log"); }
+
+// Removes a file or an LSM directory, along with the side files DiskManager
+// keeps beside a database.
+inline void safe_remove(const std::string &path) {
+  std::error_code ec;
+  std::filesystem::remove_all(path, ec);
+  std::filesystem::remove(path + DiskManager::FREE_MAP_SUFFIX, ec);
+  std::filesystem::remove(path + DiskManager::EXTENT_MAP_SUFFIX, ec);
+  (void)ec;
+}